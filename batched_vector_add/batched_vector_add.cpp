@@ -0,0 +1,535 @@
+#include <vulkan/vulkan.h>
+
+#include <cassert>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// load a SPIR-V binary from disc
+std::vector<char> loadShaderCode(const char *filename) {
+  std::vector<char> shaderCode;
+  if (FILE *fp = fopen(filename, "rb")) {
+    char buf[1024];
+    while (size_t len = fread(buf, 1, sizeof(buf), fp)) {
+      shaderCode.insert(shaderCode.end(), buf, buf + len);
+    }
+    fclose(fp);
+  }
+  return shaderCode;
+}
+
+// search for compatible memory properties and return the memory type index
+int32_t findMemoryTypeFromProperties(
+    uint32_t memoryTypeBits, VkPhysicalDeviceMemoryProperties properties,
+    VkMemoryPropertyFlags requiredProperties) {
+  assert(properties.memoryTypeCount < 32u);
+  for (uint32_t index = 0; index < properties.memoryTypeCount; ++index) {
+    if (memoryTypeBits & (1u << index) &&
+        // Find the first memory type that supports all the required flags.
+        ((properties.memoryTypes[index].propertyFlags & requiredProperties) ==
+         requiredProperties)) {
+      return (int32_t)index;
+    }
+  }
+  return -1;
+}
+
+// create a compute pipeline from a SPIR-V binary found in SHADER_PATH
+VkResult createComputePipeline(VkDevice device, VkPipelineLayout layout,
+                               const char *filename, VkPipeline *pipeline) {
+  auto shaderCode =
+      loadShaderCode((std::string(SHADER_PATH) + filename).c_str());
+  if (shaderCode.empty()) {
+    fprintf(stderr, "failed to load '%s'\n", filename);
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
+  shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  shaderModuleCreateInfo.pCode =
+      reinterpret_cast<uint32_t *>(shaderCode.data());
+  shaderModuleCreateInfo.codeSize = shaderCode.size();
+  VkShaderModule shaderModule = VK_NULL_HANDLE;
+  VkResult error = vkCreateShaderModule(device, &shaderModuleCreateInfo,
+                                        nullptr, &shaderModule);
+  if (error) {
+    return error;
+  }
+  VkComputePipelineCreateInfo pipelineCreateInfo = {};
+  pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineCreateInfo.stage.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipelineCreateInfo.stage.module = shaderModule;
+  pipelineCreateInfo.stage.pName = "main";
+  pipelineCreateInfo.layout = layout;
+  error = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1,
+                                   &pipelineCreateInfo, nullptr, pipeline);
+  vkDestroyShaderModule(device, shaderModule, nullptr);
+  return error;
+}
+
+// a single small vector addition, A, B and result are device addresses
+struct VectorAddJob {
+  VkDeviceAddress a;
+  VkDeviceAddress b;
+  VkDeviceAddress result;
+  uint32_t count;
+};
+
+// mirrors struct job in vector_add_batched.comp
+struct BatchTableEntry {
+  VkDeviceAddress a;
+  VkDeviceAddress b;
+  VkDeviceAddress result;
+  uint32_t count;
+  uint32_t firstGroup;
+};
+
+// mirrors the push constant block of vector_add_batched.comp
+struct BatchPushConstants {
+  VkDeviceAddress table;
+  uint32_t jobCount;
+  uint32_t groupOffset;
+};
+
+// vector_add_batched.comp uses a local size of 64
+const uint32_t localSize = 64;
+
+// pack the jobs into a job table, the first workgroup of each job is the
+// exclusive prefix sum of the workgroups of all preceding jobs, returns the
+// total number of workgroups required by the batch
+uint32_t packBatch(const std::vector<VectorAddJob> &jobs,
+                   BatchTableEntry *table) {
+  uint32_t groupCount = 0;
+  for (size_t index = 0; index < jobs.size(); index++) {
+    table[index].a = jobs[index].a;
+    table[index].b = jobs[index].b;
+    table[index].result = jobs[index].result;
+    table[index].count = jobs[index].count;
+    table[index].firstGroup = groupCount;
+    groupCount += (jobs[index].count + localSize - 1) / localSize;
+  }
+  return groupCount;
+}
+
+// record a whole batch, usually as a single dispatch, but split when the
+// number of workgroups exceeds what the device can dispatch at once
+void recordBatch(VkCommandBuffer commandBuffer,
+                 VkPipelineLayout pipelineLayout, VkPipeline pipeline,
+                 VkDeviceAddress table, uint32_t jobCount, uint32_t groupCount,
+                 uint32_t maxGroupCount) {
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+  BatchPushConstants pushConstants = {};
+  pushConstants.table = table;
+  pushConstants.jobCount = jobCount;
+  while (pushConstants.groupOffset < groupCount) {
+    uint32_t groups = groupCount - pushConstants.groupOffset;
+    if (groups > maxGroupCount) {
+      groups = maxGroupCount;
+    }
+    vkCmdPushConstants(commandBuffer, pipelineLayout,
+                       VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                       sizeof(BatchPushConstants), &pushConstants);
+    vkCmdDispatch(commandBuffer, groups, 1, 1);
+    pushConstants.groupOffset += groups;
+  }
+}
+
+int main() {
+  VkApplicationInfo applicationInfo = {};
+  applicationInfo.pApplicationName = "Vulkan batched vector add example";
+  // buffer device address is core in Vulkan 1.2
+  applicationInfo.apiVersion = VK_API_VERSION_1_2;
+
+  VkInstanceCreateInfo instanceCreateInfo = {};
+  instanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+  instanceCreateInfo.pApplicationInfo = &applicationInfo;
+#ifdef ENABLE_LAYERS
+  // without a debug report callback, see vector_add, the validation layer
+  // prints its messages to stdout
+  std::vector<const char *> enabledLayerNames{"VK_LAYER_KHRONOS_validation"};
+  instanceCreateInfo.enabledLayerCount = enabledLayerNames.size();
+  instanceCreateInfo.ppEnabledLayerNames = enabledLayerNames.data();
+#endif
+
+  VkInstance instance = VK_NULL_HANDLE;
+  VkResult error = vkCreateInstance(&instanceCreateInfo, nullptr, &instance);
+  if (error) {
+    return error;
+  }
+
+  uint32_t count;
+  error = vkEnumeratePhysicalDevices(instance, &count, nullptr);
+  if (error) {
+    return error;
+  }
+  std::vector<VkPhysicalDevice> physicalDevices(count);
+  error = vkEnumeratePhysicalDevices(instance, &count, physicalDevices.data());
+  if (error) {
+    return error;
+  }
+
+  // find a Vulkan 1.2 physical device with a compute queue which supports
+  // shaders accessing buffers through their device address
+  VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+  uint32_t queueFamilyIndex = 0;
+  uint32_t timestampValidBits = 0;
+  for (auto device : physicalDevices) {
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(device, &properties);
+    if (properties.apiVersion < VK_API_VERSION_1_2) {
+      continue;
+    }
+    VkPhysicalDeviceBufferDeviceAddressFeatures addressFeatures = {};
+    addressFeatures.sType =
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES;
+    VkPhysicalDeviceFeatures2 features = {};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &addressFeatures;
+    vkGetPhysicalDeviceFeatures2(device, &features);
+    if (!addressFeatures.bufferDeviceAddress) {
+      continue;
+    }
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilyProperties(count);
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count,
+                                             queueFamilyProperties.data());
+    for (uint32_t index = 0; index < count; index++) {
+      if (queueFamilyProperties[index].queueFlags & VK_QUEUE_COMPUTE_BIT) {
+        physicalDevice = device;
+        queueFamilyIndex = index;
+        timestampValidBits = queueFamilyProperties[index].timestampValidBits;
+        break;
+      }
+    }
+    if (physicalDevice) {
+      break;
+    }
+  }
+  if (!physicalDevice) {
+    fprintf(stderr, "no device supports bufferDeviceAddress\n");
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+  }
+
+  VkPhysicalDeviceProperties physicalDeviceProperties;
+  vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties);
+  const VkPhysicalDeviceLimits &limits = physicalDeviceProperties.limits;
+
+  VkDeviceQueueCreateInfo queueCreateInfo = {};
+  queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+  queueCreateInfo.queueCount = 1;
+  queueCreateInfo.queueFamilyIndex = queueFamilyIndex;
+  float queuePriority = 1.0f;
+  queueCreateInfo.pQueuePriorities = &queuePriority;
+
+  VkPhysicalDeviceBufferDeviceAddressFeatures addressFeatures = {};
+  addressFeatures.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES;
+  addressFeatures.bufferDeviceAddress = VK_TRUE;
+
+  VkDeviceCreateInfo deviceCreateInfo = {};
+  deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+  deviceCreateInfo.pNext = &addressFeatures;
+  deviceCreateInfo.queueCreateInfoCount = 1;
+  deviceCreateInfo.pQueueCreateInfos = &queueCreateInfo;
+  VkDevice device = VK_NULL_HANDLE;
+  error = vkCreateDevice(physicalDevice, &deviceCreateInfo, nullptr, &device);
+  if (error) {
+    return error;
+  }
+
+  VkQueue queue;
+  vkGetDeviceQueue(device, queueFamilyIndex, 0, &queue);
+
+  VkPushConstantRange pushConstantRange = {};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(BatchPushConstants);
+
+  VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+  pipelineLayoutCreateInfo.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+  pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+  VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+  error = vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr,
+                                 &pipelineLayout);
+  if (error) {
+    return error;
+  }
+
+  VkPipeline pipeline = VK_NULL_HANDLE;
+  error = createComputePipeline(device, pipelineLayout,
+                                "vector_add_batched.spv", &pipeline);
+  if (error) {
+    return error;
+  }
+
+  // lots of tiny jobs of a few hundred elements or less, packed back to back
+  // in one set of buffers, but they could just as well live anywhere
+  const uint32_t jobCount = 4096;
+  std::vector<uint32_t> jobOffsets(jobCount);
+  std::vector<uint32_t> jobLengths(jobCount);
+  uint32_t elements = 0;
+  uint32_t seed = 1;
+  for (uint32_t job = 0; job < jobCount; job++) {
+    seed = seed * 1664525u + 1013904223u;
+    jobOffsets[job] = elements;
+    jobLengths[job] = (seed >> 8) % 512;
+    elements += jobLengths[job];
+  }
+
+  // A, B, result and the job table itself
+  VkBuffer buffers[4];
+  VkDeviceSize bufferSizes[4] = {
+      sizeof(int32_t) * elements, sizeof(int32_t) * elements,
+      sizeof(int32_t) * elements, sizeof(BatchTableEntry) * jobCount};
+  for (uint32_t index = 0; index < 4; index++) {
+    VkBufferCreateInfo bufferCreateInfo = {};
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.size = bufferSizes[index];
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                             VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    bufferCreateInfo.queueFamilyIndexCount = 1;
+    bufferCreateInfo.pQueueFamilyIndices = &queueFamilyIndex;
+    error = vkCreateBuffer(device, &bufferCreateInfo, nullptr, &buffers[index]);
+    if (error) {
+      return error;
+    }
+  }
+
+  VkDeviceSize bufferOffsets[4];
+  VkDeviceSize requiredMemorySize = 0;
+  VkMemoryRequirements memoryRequirements;
+  for (uint32_t index = 0; index < 4; index++) {
+    vkGetBufferMemoryRequirements(device, buffers[index], &memoryRequirements);
+    const VkDeviceSize alignment = memoryRequirements.alignment;
+    requiredMemorySize =
+        (requiredMemorySize + alignment - 1) / alignment * alignment;
+    bufferOffsets[index] = requiredMemorySize;
+    requiredMemorySize += memoryRequirements.size;
+  }
+
+  VkPhysicalDeviceMemoryProperties memoryProperties;
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+  auto memoryTypeIndex = findMemoryTypeFromProperties(
+      memoryRequirements.memoryTypeBits, memoryProperties,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  if (0 > memoryTypeIndex) {
+    return ~42;  // returns -43
+  }
+
+  VkMemoryAllocateFlagsInfo allocateFlagsInfo = {};
+  allocateFlagsInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
+  allocateFlagsInfo.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT;
+
+  VkMemoryAllocateInfo allocateInfo = {};
+  allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocateInfo.pNext = &allocateFlagsInfo;
+  allocateInfo.allocationSize = requiredMemorySize;
+  allocateInfo.memoryTypeIndex = memoryTypeIndex;
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  error = vkAllocateMemory(device, &allocateInfo, nullptr, &memory);
+  if (error) {
+    return error;
+  }
+
+  VkDeviceAddress addresses[4];
+  for (uint32_t index = 0; index < 4; index++) {
+    error = vkBindBufferMemory(device, buffers[index], memory,
+                               bufferOffsets[index]);
+    if (error) {
+      return error;
+    }
+    VkBufferDeviceAddressInfo addressInfo = {};
+    addressInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+    addressInfo.buffer = buffers[index];
+    addresses[index] = vkGetBufferDeviceAddress(device, &addressInfo);
+  }
+
+  char *data = nullptr;
+  error = vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0,
+                      reinterpret_cast<void **>(&data));
+  if (error) {
+    return error;
+  }
+  int32_t *aData = reinterpret_cast<int32_t *>(data + bufferOffsets[0]);
+  int32_t *bData = reinterpret_cast<int32_t *>(data + bufferOffsets[1]);
+  int32_t *resultData = reinterpret_cast<int32_t *>(data + bufferOffsets[2]);
+  BatchTableEntry *table =
+      reinterpret_cast<BatchTableEntry *>(data + bufferOffsets[3]);
+  for (uint32_t index = 0; index < elements; index++) {
+    aData[index] = index;
+    bData[index] = 3 * index;
+    resultData[index] = 42;
+  }
+
+  // describe the jobs and pack them into the job table
+  std::vector<VectorAddJob> jobs(jobCount);
+  for (uint32_t job = 0; job < jobCount; job++) {
+    const VkDeviceSize byteOffset = sizeof(int32_t) * jobOffsets[job];
+    jobs[job].a = addresses[0] + byteOffset;
+    jobs[job].b = addresses[1] + byteOffset;
+    jobs[job].result = addresses[2] + byteOffset;
+    jobs[job].count = jobLengths[job];
+  }
+  const uint32_t groupCount = packBatch(jobs, table);
+
+  // write timestamps before and after both the batched dispatch and the one
+  // dispatch per job equivalent so the launch overhead can be compared
+  VkQueryPool queryPool = VK_NULL_HANDLE;
+  if (timestampValidBits) {
+    VkQueryPoolCreateInfo queryPoolCreateInfo = {};
+    queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolCreateInfo.queryCount = 4;
+    error = vkCreateQueryPool(device, &queryPoolCreateInfo, nullptr,
+                              &queryPool);
+    if (error) {
+      return error;
+    }
+  }
+
+  VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+  commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+  commandPoolCreateInfo.queueFamilyIndex = queueFamilyIndex;
+  VkCommandPool commandPool = VK_NULL_HANDLE;
+  error = vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr,
+                              &commandPool);
+  if (error) {
+    return error;
+  }
+
+  VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
+  commandBufferAllocateInfo.sType =
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  commandBufferAllocateInfo.commandPool = commandPool;
+  commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  commandBufferAllocateInfo.commandBufferCount = 2;
+  VkCommandBuffer commandBuffers[2];
+  error = vkAllocateCommandBuffers(device, &commandBufferAllocateInfo,
+                                   commandBuffers);
+  if (error) {
+    return error;
+  }
+
+  VkCommandBufferBeginInfo beginInfo = {};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+  // the first command buffer processes every job with one dispatch
+  error = vkBeginCommandBuffer(commandBuffers[0], &beginInfo);
+  if (error) {
+    return error;
+  }
+  if (queryPool) {
+    vkCmdResetQueryPool(commandBuffers[0], queryPool, 0, 4);
+    vkCmdWriteTimestamp(commandBuffers[0], VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                        queryPool, 0);
+  }
+  recordBatch(commandBuffers[0], pipelineLayout, pipeline, addresses[3],
+              jobCount, groupCount, limits.maxComputeWorkGroupCount[0]);
+  if (queryPool) {
+    vkCmdWriteTimestamp(commandBuffers[0],
+                        VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, 1);
+  }
+  error = vkEndCommandBuffer(commandBuffers[0]);
+  if (error) {
+    return error;
+  }
+
+  // the second does the same work with a dispatch per job, each one pointing
+  // the kernel at a single entry of the table
+  error = vkBeginCommandBuffer(commandBuffers[1], &beginInfo);
+  if (error) {
+    return error;
+  }
+  if (queryPool) {
+    vkCmdWriteTimestamp(commandBuffers[1], VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                        queryPool, 2);
+  }
+  vkCmdBindPipeline(commandBuffers[1], VK_PIPELINE_BIND_POINT_COMPUTE,
+                    pipeline);
+  for (uint32_t job = 0; job < jobCount; job++) {
+    if (0 == jobLengths[job]) {
+      continue;
+    }
+    BatchPushConstants pushConstants = {};
+    pushConstants.table = addresses[3] + sizeof(BatchTableEntry) * job;
+    pushConstants.jobCount = 1;
+    pushConstants.groupOffset = table[job].firstGroup;
+    vkCmdPushConstants(commandBuffers[1], pipelineLayout,
+                       VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                       sizeof(BatchPushConstants), &pushConstants);
+    vkCmdDispatch(commandBuffers[1],
+                  (jobLengths[job] + localSize - 1) / localSize, 1, 1);
+  }
+  if (queryPool) {
+    vkCmdWriteTimestamp(commandBuffers[1],
+                        VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, 3);
+  }
+  error = vkEndCommandBuffer(commandBuffers[1]);
+  if (error) {
+    return error;
+  }
+
+  int failures = 0;
+  for (uint32_t pass = 0; pass < 2; pass++) {
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffers[pass];
+    error = vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+    if (error) {
+      return error;
+    }
+    vkQueueWaitIdle(queue);
+
+    for (uint32_t index = 0; index < elements; index++) {
+      if (resultData[index] != aData[index] + bData[index]) {
+        fprintf(stderr, "pass %u result[%u] is '%d' not '%d'!\n", pass, index,
+                resultData[index], aData[index] + bData[index]);
+        failures++;
+      }
+      // reset the result for the next pass
+      resultData[index] = 42;
+    }
+  }
+
+  if (queryPool) {
+    uint64_t timestamps[4];
+    error = vkGetQueryPoolResults(
+        device, queryPool, 0, 4, sizeof(timestamps), timestamps,
+        sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+    if (error) {
+      return error;
+    }
+    printf("%u jobs, %u elements\n", jobCount, elements);
+    printf("batched:  %.3f ms\n",
+           (timestamps[1] - timestamps[0]) * limits.timestampPeriod * 1e-6);
+    printf("per job:  %.3f ms\n",
+           (timestamps[3] - timestamps[2]) * limits.timestampPeriod * 1e-6);
+    vkDestroyQueryPool(device, queryPool, nullptr);
+  }
+  vkUnmapMemory(device, memory);
+
+  vkDestroyCommandPool(device, commandPool, nullptr);
+  vkFreeMemory(device, memory, nullptr);
+  for (auto buffer : buffers) {
+    vkDestroyBuffer(device, buffer, nullptr);
+  }
+  vkDestroyPipeline(device, pipeline, nullptr);
+  vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+  vkDestroyDevice(device, nullptr);
+  vkDestroyInstance(instance, nullptr);
+
+  if (failures) {
+    return 1;
+  }
+  printf("success\n");
+
+  return 0;
+}
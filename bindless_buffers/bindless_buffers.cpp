@@ -0,0 +1,542 @@
+#include <vulkan/vulkan.h>
+
+#include <cassert>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// load a SPIR-V binary from disc
+std::vector<char> loadShaderCode(const char *filename) {
+  std::vector<char> shaderCode;
+  if (FILE *fp = fopen(filename, "rb")) {
+    char buf[1024];
+    while (size_t len = fread(buf, 1, sizeof(buf), fp)) {
+      shaderCode.insert(shaderCode.end(), buf, buf + len);
+    }
+    fclose(fp);
+  }
+  return shaderCode;
+}
+
+// search for compatible memory properties and return the memory type index
+int32_t findMemoryTypeFromProperties(
+    uint32_t memoryTypeBits, VkPhysicalDeviceMemoryProperties properties,
+    VkMemoryPropertyFlags requiredProperties) {
+  assert(properties.memoryTypeCount < 32u);
+  for (uint32_t index = 0; index < properties.memoryTypeCount; ++index) {
+    if (memoryTypeBits & (1u << index) &&
+        // Find the first memory type that supports all the required flags.
+        ((properties.memoryTypes[index].propertyFlags & requiredProperties) ==
+         requiredProperties)) {
+      return (int32_t)index;
+    }
+  }
+  return -1;
+}
+
+// create a compute pipeline from a SPIR-V binary found in SHADER_PATH
+VkResult createComputePipeline(VkDevice device, VkPipelineLayout layout,
+                               const char *filename, VkPipeline *pipeline) {
+  auto shaderCode =
+      loadShaderCode((std::string(SHADER_PATH) + filename).c_str());
+  if (shaderCode.empty()) {
+    fprintf(stderr, "failed to load '%s'\n", filename);
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
+  shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  shaderModuleCreateInfo.pCode =
+      reinterpret_cast<uint32_t *>(shaderCode.data());
+  shaderModuleCreateInfo.codeSize = shaderCode.size();
+  VkShaderModule shaderModule = VK_NULL_HANDLE;
+  VkResult error = vkCreateShaderModule(device, &shaderModuleCreateInfo,
+                                        nullptr, &shaderModule);
+  if (error) {
+    return error;
+  }
+  VkComputePipelineCreateInfo pipelineCreateInfo = {};
+  pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineCreateInfo.stage.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipelineCreateInfo.stage.module = shaderModule;
+  pipelineCreateInfo.stage.pName = "main";
+  pipelineCreateInfo.layout = layout;
+  error = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1,
+                                   &pipelineCreateInfo, nullptr, pipeline);
+  vkDestroyShaderModule(device, shaderModule, nullptr);
+  return error;
+}
+
+// a single descriptor set holding every live storage buffer, kernels select
+// buffers by their slot in the table instead of through per job descriptor
+// sets, binding the table costs the same regardless of the number of jobs
+struct BufferTable {
+  VkDescriptorSet descriptorSet;
+  // slots released by remove() are handed out again before growing
+  std::vector<uint32_t> freeSlots;
+  uint32_t nextSlot;
+  uint32_t capacity;
+
+  // write a buffer into a free slot and return the slot index, returns
+  // UINT32_MAX when the table is full
+  uint32_t insert(VkDevice device, VkBuffer buffer) {
+    uint32_t slot;
+    if (!freeSlots.empty()) {
+      slot = freeSlots.back();
+      freeSlots.pop_back();
+    } else if (nextSlot < capacity) {
+      slot = nextSlot++;
+    } else {
+      return UINT32_MAX;
+    }
+    VkDescriptorBufferInfo bufferInfo = {};
+    bufferInfo.buffer = buffer;
+    bufferInfo.offset = 0;
+    bufferInfo.range = VK_WHOLE_SIZE;
+    VkWriteDescriptorSet writeDescriptorSet = {};
+    writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writeDescriptorSet.dstSet = descriptorSet;
+    writeDescriptorSet.dstBinding = 0;
+    writeDescriptorSet.dstArrayElement = slot;
+    writeDescriptorSet.descriptorCount = 1;
+    writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    writeDescriptorSet.pBufferInfo = &bufferInfo;
+    // because the binding is update after bind this is valid even while the
+    // set is bound in a command buffer which is still pending execution, as
+    // long as that command buffer does not use this slot
+    vkUpdateDescriptorSets(device, 1, &writeDescriptorSet, 0, nullptr);
+    return slot;
+  }
+
+  // the descriptor is left in place, the partially bound flag means stale
+  // slots are fine as long as no kernel accesses them
+  void remove(uint32_t slot) { freeSlots.push_back(slot); }
+};
+
+// mirrors the push constant block of vector_add_bindless.comp
+struct BindlessJob {
+  uint32_t a;
+  uint32_t b;
+  uint32_t result;
+  uint32_t count;
+};
+
+int main() {
+  VkApplicationInfo applicationInfo = {};
+  applicationInfo.pApplicationName = "Vulkan bindless buffers example";
+  // descriptor indexing is core in Vulkan 1.2
+  applicationInfo.apiVersion = VK_API_VERSION_1_2;
+
+  VkInstanceCreateInfo instanceCreateInfo = {};
+  instanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+  instanceCreateInfo.pApplicationInfo = &applicationInfo;
+#ifdef ENABLE_LAYERS
+  // without a debug report callback, see vector_add, the validation layer
+  // prints its messages to stdout
+  std::vector<const char *> enabledLayerNames{"VK_LAYER_KHRONOS_validation"};
+  instanceCreateInfo.enabledLayerCount = enabledLayerNames.size();
+  instanceCreateInfo.ppEnabledLayerNames = enabledLayerNames.data();
+#endif
+
+  VkInstance instance = VK_NULL_HANDLE;
+  VkResult error = vkCreateInstance(&instanceCreateInfo, nullptr, &instance);
+  if (error) {
+    return error;
+  }
+
+  uint32_t count;
+  error = vkEnumeratePhysicalDevices(instance, &count, nullptr);
+  if (error) {
+    return error;
+  }
+  std::vector<VkPhysicalDevice> physicalDevices(count);
+  error = vkEnumeratePhysicalDevices(instance, &count, physicalDevices.data());
+  if (error) {
+    return error;
+  }
+
+  // find a Vulkan 1.2 physical device with a compute queue which supports
+  // runtime sized, partially bound, update after bind storage buffer arrays
+  VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+  uint32_t queueFamilyIndex = 0;
+  for (auto device : physicalDevices) {
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(device, &properties);
+    if (properties.apiVersion < VK_API_VERSION_1_2) {
+      continue;
+    }
+    VkPhysicalDeviceVulkan12Features features12 = {};
+    features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_12_FEATURES;
+    VkPhysicalDeviceFeatures2 features = {};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &features12;
+    vkGetPhysicalDeviceFeatures2(device, &features);
+    if (!features.features.shaderStorageBufferArrayDynamicIndexing ||
+        !features12.runtimeDescriptorArray ||
+        !features12.descriptorBindingStorageBufferUpdateAfterBind ||
+        !features12.descriptorBindingUpdateUnusedWhilePending ||
+        !features12.descriptorBindingPartiallyBound) {
+      continue;
+    }
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilyProperties(count);
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count,
+                                             queueFamilyProperties.data());
+    for (uint32_t index = 0; index < count; index++) {
+      if (queueFamilyProperties[index].queueFlags & VK_QUEUE_COMPUTE_BIT) {
+        physicalDevice = device;
+        queueFamilyIndex = index;
+        break;
+      }
+    }
+    if (physicalDevice) {
+      break;
+    }
+  }
+  if (!physicalDevice) {
+    fprintf(stderr, "no device supports update after bind buffer arrays\n");
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+  }
+
+  // the size of the table is bounded by the update after bind limits
+  VkPhysicalDeviceDescriptorIndexingProperties indexingProperties = {};
+  indexingProperties.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+  VkPhysicalDeviceProperties2 properties = {};
+  properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+  properties.pNext = &indexingProperties;
+  vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+  uint32_t tableCapacity = 65536;
+  if (tableCapacity >
+      indexingProperties.maxPerStageDescriptorUpdateAfterBindStorageBuffers) {
+    tableCapacity =
+        indexingProperties.maxPerStageDescriptorUpdateAfterBindStorageBuffers;
+  }
+  if (tableCapacity >
+      indexingProperties.maxDescriptorSetUpdateAfterBindStorageBuffers) {
+    tableCapacity =
+        indexingProperties.maxDescriptorSetUpdateAfterBindStorageBuffers;
+  }
+
+  VkDeviceQueueCreateInfo queueCreateInfo = {};
+  queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+  queueCreateInfo.queueCount = 1;
+  queueCreateInfo.queueFamilyIndex = queueFamilyIndex;
+  float queuePriority = 1.0f;
+  queueCreateInfo.pQueuePriorities = &queuePriority;
+
+  VkPhysicalDeviceVulkan12Features features12 = {};
+  features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_12_FEATURES;
+  features12.runtimeDescriptorArray = VK_TRUE;
+  features12.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+  features12.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+  features12.descriptorBindingPartiallyBound = VK_TRUE;
+  VkPhysicalDeviceFeatures2 features = {};
+  features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+  features.pNext = &features12;
+  features.features.shaderStorageBufferArrayDynamicIndexing = VK_TRUE;
+
+  // when chaining VkPhysicalDeviceFeatures2 pEnabledFeatures must be null
+  VkDeviceCreateInfo deviceCreateInfo = {};
+  deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+  deviceCreateInfo.pNext = &features;
+  deviceCreateInfo.queueCreateInfoCount = 1;
+  deviceCreateInfo.pQueueCreateInfos = &queueCreateInfo;
+  VkDevice device = VK_NULL_HANDLE;
+  error = vkCreateDevice(physicalDevice, &deviceCreateInfo, nullptr, &device);
+  if (error) {
+    return error;
+  }
+
+  VkQueue queue;
+  vkGetDeviceQueue(device, queueFamilyIndex, 0, &queue);
+
+  // a single binding holding the whole table
+  // layout (std430, set=0, binding=0) buffer buffers { int data[]; } table[];
+  VkDescriptorSetLayoutBinding layoutBinding = {};
+  layoutBinding.binding = 0;
+  layoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  layoutBinding.descriptorCount = tableCapacity;
+  layoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+  // update after bind lets slots be written while the set is in use, partially
+  // bound means slots which are never accessed need not hold a valid buffer
+  VkDescriptorBindingFlags bindingFlags =
+      VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+      VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT |
+      VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+  VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsCreateInfo = {};
+  bindingFlagsCreateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+  bindingFlagsCreateInfo.bindingCount = 1;
+  bindingFlagsCreateInfo.pBindingFlags = &bindingFlags;
+
+  VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo = {};
+  setLayoutCreateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  setLayoutCreateInfo.pNext = &bindingFlagsCreateInfo;
+  setLayoutCreateInfo.flags =
+      VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+  setLayoutCreateInfo.bindingCount = 1;
+  setLayoutCreateInfo.pBindings = &layoutBinding;
+  VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+  error = vkCreateDescriptorSetLayout(device, &setLayoutCreateInfo, nullptr,
+                                      &setLayout);
+  if (error) {
+    return error;
+  }
+
+  VkPushConstantRange pushConstantRange = {};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(BindlessJob);
+
+  VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+  pipelineLayoutCreateInfo.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutCreateInfo.setLayoutCount = 1;
+  pipelineLayoutCreateInfo.pSetLayouts = &setLayout;
+  pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+  pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+  VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+  error = vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr,
+                                 &pipelineLayout);
+  if (error) {
+    return error;
+  }
+
+  VkPipeline pipeline = VK_NULL_HANDLE;
+  error = createComputePipeline(device, pipelineLayout,
+                                "vector_add_bindless.spv", &pipeline);
+  if (error) {
+    return error;
+  }
+
+  // the pool must also be created with the update after bind flag
+  VkDescriptorPoolSize poolSize = {};
+  poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  poolSize.descriptorCount = tableCapacity;
+  VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = {};
+  descriptorPoolCreateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  descriptorPoolCreateInfo.flags =
+      VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+  descriptorPoolCreateInfo.maxSets = 1;
+  descriptorPoolCreateInfo.poolSizeCount = 1;
+  descriptorPoolCreateInfo.pPoolSizes = &poolSize;
+  VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+  error = vkCreateDescriptorPool(device, &descriptorPoolCreateInfo, nullptr,
+                                 &descriptorPool);
+  if (error) {
+    return error;
+  }
+
+  BufferTable table = {};
+  table.capacity = tableCapacity;
+  VkDescriptorSetAllocateInfo descriptorSetAllocateInfo = {};
+  descriptorSetAllocateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  descriptorSetAllocateInfo.descriptorPool = descriptorPool;
+  descriptorSetAllocateInfo.descriptorSetCount = 1;
+  descriptorSetAllocateInfo.pSetLayouts = &setLayout;
+  error = vkAllocateDescriptorSets(device, &descriptorSetAllocateInfo,
+                                   &table.descriptorSet);
+  if (error) {
+    return error;
+  }
+
+  // many small jobs of differing lengths, each with its own three buffers
+  const uint32_t jobCount = 32;
+  std::vector<uint32_t> lengths(jobCount);
+  std::vector<VkBuffer> buffers(jobCount * 3);
+  for (uint32_t job = 0; job < jobCount; job++) {
+    lengths[job] = 64 + 61 * job;
+    VkBufferCreateInfo bufferCreateInfo = {};
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.size = sizeof(int32_t) * lengths[job];
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    bufferCreateInfo.queueFamilyIndexCount = 1;
+    bufferCreateInfo.pQueueFamilyIndices = &queueFamilyIndex;
+    for (uint32_t index = 0; index < 3; index++) {
+      error = vkCreateBuffer(device, &bufferCreateInfo, nullptr,
+                             &buffers[job * 3 + index]);
+      if (error) {
+        return error;
+      }
+    }
+  }
+
+  // sub-allocate one block of memory for all the buffers
+  std::vector<VkDeviceSize> bufferOffsets(buffers.size());
+  VkDeviceSize requiredMemorySize = 0;
+  VkMemoryRequirements memoryRequirements;
+  for (size_t index = 0; index < buffers.size(); index++) {
+    vkGetBufferMemoryRequirements(device, buffers[index], &memoryRequirements);
+    const VkDeviceSize alignment = memoryRequirements.alignment;
+    requiredMemorySize =
+        (requiredMemorySize + alignment - 1) / alignment * alignment;
+    bufferOffsets[index] = requiredMemorySize;
+    requiredMemorySize += memoryRequirements.size;
+  }
+
+  VkPhysicalDeviceMemoryProperties memoryProperties;
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+  auto memoryTypeIndex = findMemoryTypeFromProperties(
+      memoryRequirements.memoryTypeBits, memoryProperties,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  if (0 > memoryTypeIndex) {
+    return ~42;  // returns -43
+  }
+
+  VkMemoryAllocateInfo allocateInfo = {};
+  allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocateInfo.allocationSize = requiredMemorySize;
+  allocateInfo.memoryTypeIndex = memoryTypeIndex;
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  error = vkAllocateMemory(device, &allocateInfo, nullptr, &memory);
+  if (error) {
+    return error;
+  }
+
+  // bind each buffer to its memory and register it in the table, the slot is
+  // all a job needs to refer to the buffer from now on
+  std::vector<uint32_t> slots(buffers.size());
+  for (size_t index = 0; index < buffers.size(); index++) {
+    error = vkBindBufferMemory(device, buffers[index], memory,
+                               bufferOffsets[index]);
+    if (error) {
+      return error;
+    }
+    slots[index] = table.insert(device, buffers[index]);
+    if (slots[index] == UINT32_MAX) {
+      fprintf(stderr, "buffer table is full\n");
+      return VK_ERROR_TOO_MANY_OBJECTS;
+    }
+  }
+
+  char *data = nullptr;
+  error = vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0,
+                      reinterpret_cast<void **>(&data));
+  if (error) {
+    return error;
+  }
+  for (uint32_t job = 0; job < jobCount; job++) {
+    int32_t *aData = reinterpret_cast<int32_t *>(data + bufferOffsets[job * 3]);
+    int32_t *bData =
+        reinterpret_cast<int32_t *>(data + bufferOffsets[job * 3 + 1]);
+    int32_t *resultData =
+        reinterpret_cast<int32_t *>(data + bufferOffsets[job * 3 + 2]);
+    for (uint32_t index = 0; index < lengths[job]; index++) {
+      aData[index] = index * (job + 1);
+      bData[index] = job;
+      resultData[index] = 42;
+    }
+  }
+
+  VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+  commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+  commandPoolCreateInfo.queueFamilyIndex = queueFamilyIndex;
+  VkCommandPool commandPool = VK_NULL_HANDLE;
+  error = vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr,
+                              &commandPool);
+  if (error) {
+    return error;
+  }
+
+  VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
+  commandBufferAllocateInfo.sType =
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  commandBufferAllocateInfo.commandPool = commandPool;
+  commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  commandBufferAllocateInfo.commandBufferCount = 1;
+  VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+  error = vkAllocateCommandBuffers(device, &commandBufferAllocateInfo,
+                                   &commandBuffer);
+  if (error) {
+    return error;
+  }
+
+  VkCommandBufferBeginInfo beginInfo = {};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  error = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+  if (error) {
+    return error;
+  }
+
+  // the pipeline and the table are bound exactly once, after that each job
+  // costs only a push constant update and a dispatch
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                          pipelineLayout, 0, 1, &table.descriptorSet, 0,
+                          nullptr);
+  for (uint32_t job = 0; job < jobCount; job++) {
+    BindlessJob pushConstants = {};
+    pushConstants.a = slots[job * 3];
+    pushConstants.b = slots[job * 3 + 1];
+    pushConstants.result = slots[job * 3 + 2];
+    pushConstants.count = lengths[job];
+    vkCmdPushConstants(commandBuffer, pipelineLayout,
+                       VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(BindlessJob),
+                       &pushConstants);
+    vkCmdDispatch(commandBuffer, (lengths[job] + 63) / 64, 1, 1);
+  }
+
+  error = vkEndCommandBuffer(commandBuffer);
+  if (error) {
+    return error;
+  }
+
+  VkSubmitInfo submitInfo = {};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &commandBuffer;
+  error = vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+  if (error) {
+    return error;
+  }
+  vkQueueWaitIdle(queue);
+
+  int failures = 0;
+  for (uint32_t job = 0; job < jobCount; job++) {
+    int32_t *resultData =
+        reinterpret_cast<int32_t *>(data + bufferOffsets[job * 3 + 2]);
+    for (uint32_t index = 0; index < lengths[job]; index++) {
+      int32_t expected = index * (job + 1) + job;
+      if (resultData[index] != expected) {
+        fprintf(stderr, "job %u result[%u] is '%d' not '%d'!\n", job, index,
+                resultData[index], expected);
+        failures++;
+      }
+    }
+  }
+  vkUnmapMemory(device, memory);
+
+  // release the slots, they would be reused by the next buffers inserted
+  for (auto slot : slots) {
+    table.remove(slot);
+  }
+
+  vkDestroyCommandPool(device, commandPool, nullptr);
+  vkFreeMemory(device, memory, nullptr);
+  for (auto buffer : buffers) {
+    vkDestroyBuffer(device, buffer, nullptr);
+  }
+  vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+  vkDestroyPipeline(device, pipeline, nullptr);
+  vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+  vkDestroyDescriptorSetLayout(device, setLayout, nullptr);
+  vkDestroyDevice(device, nullptr);
+  vkDestroyInstance(instance, nullptr);
+
+  if (failures) {
+    return 1;
+  }
+  printf("success\n");
+
+  return 0;
+}
@@ -0,0 +1,729 @@
+#include <vulkan/vulkan.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+// load a SPIR-V binary from disc
+std::vector<char> loadShaderCode(const char *filename) {
+  std::vector<char> shaderCode;
+  if (FILE *fp = fopen(filename, "rb")) {
+    char buf[1024];
+    while (size_t len = fread(buf, 1, sizeof(buf), fp)) {
+      shaderCode.insert(shaderCode.end(), buf, buf + len);
+    }
+    fclose(fp);
+  }
+  return shaderCode;
+}
+
+// search for compatible memory properties and return the memory type index
+int32_t findMemoryTypeFromProperties(
+    uint32_t memoryTypeBits, VkPhysicalDeviceMemoryProperties properties,
+    VkMemoryPropertyFlags requiredProperties) {
+  assert(properties.memoryTypeCount < 32u);
+  for (uint32_t index = 0; index < properties.memoryTypeCount; ++index) {
+    if (memoryTypeBits & (1u << index) &&
+        // Find the first memory type that supports all the required flags.
+        ((properties.memoryTypes[index].propertyFlags & requiredProperties) ==
+         requiredProperties)) {
+      return (int32_t)index;
+    }
+  }
+  return -1;
+}
+
+// create a compute pipeline from a SPIR-V binary found in SHADER_PATH
+VkResult createComputePipeline(VkDevice device, VkPipelineLayout layout,
+                               const char *filename,
+                               const VkSpecializationInfo *specializationInfo,
+                               VkPipeline *pipeline) {
+  auto shaderCode =
+      loadShaderCode((std::string(SHADER_PATH) + filename).c_str());
+  if (shaderCode.empty()) {
+    fprintf(stderr, "failed to load '%s'\n", filename);
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
+  shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  shaderModuleCreateInfo.pCode =
+      reinterpret_cast<uint32_t *>(shaderCode.data());
+  shaderModuleCreateInfo.codeSize = shaderCode.size();
+  VkShaderModule shaderModule = VK_NULL_HANDLE;
+  VkResult error = vkCreateShaderModule(device, &shaderModuleCreateInfo,
+                                        nullptr, &shaderModule);
+  if (error) {
+    return error;
+  }
+  VkComputePipelineCreateInfo pipelineCreateInfo = {};
+  pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineCreateInfo.stage.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipelineCreateInfo.stage.module = shaderModule;
+  pipelineCreateInfo.stage.pName = "main";
+  pipelineCreateInfo.stage.pSpecializationInfo = specializationInfo;
+  pipelineCreateInfo.layout = layout;
+  error = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1,
+                                   &pipelineCreateInfo, nullptr, pipeline);
+  vkDestroyShaderModule(device, shaderModule, nullptr);
+  return error;
+}
+
+// the number of values in each compressed block, see unpack.comp
+const uint32_t blockSize = 1024;
+
+// the modes of a compressed block
+enum { FRAME, DELTA };
+
+uint32_t divideRoundUp(uint32_t value, uint32_t divisor) {
+  return (value + divisor - 1) / divisor;
+}
+
+// the number of bits needed to store value
+uint32_t bitWidth(uint32_t value) {
+  uint32_t width = 0;
+  while (width < 32 && value >> width) {
+    width++;
+  }
+  return width;
+}
+
+// compress count values in the format decoded by unpack.comp, each block
+// uses whichever of frame of reference or delta encoding packs it in fewer
+// bits
+std::vector<uint32_t> compressColumn(const int32_t *values, uint32_t count) {
+  const uint32_t blockCount = divideRoundUp(count, blockSize);
+  std::vector<uint32_t> words(4 * blockCount);
+  std::vector<uint32_t> frames(blockSize);
+  std::vector<uint32_t> deltas(blockSize);
+  for (uint32_t block = 0; block < blockCount; block++) {
+    const int32_t *first = values + block * blockSize;
+    const uint32_t length = std::min(blockSize, count - block * blockSize);
+
+    // differences wrap, so they decode exactly whatever their size, the first
+    // value is the reference so only the differences after it count
+    const int32_t minValue = *std::min_element(first, first + length);
+    int32_t minDelta =
+        length > 1 ? (int32_t)((uint32_t)first[1] - first[0]) : 0;
+    for (uint32_t index = 2; index < length; index++) {
+      minDelta = std::min(
+          minDelta, (int32_t)((uint32_t)first[index] - first[index - 1]));
+    }
+    uint32_t maxFrame = 0;
+    uint32_t maxDelta = 0;
+    for (uint32_t index = 0; index < length; index++) {
+      frames[index] = (uint32_t)first[index] - minValue;
+      deltas[index] =
+          index ? (uint32_t)first[index] - first[index - 1] - minDelta : 0;
+      maxFrame = std::max(maxFrame, frames[index]);
+      maxDelta = std::max(maxDelta, deltas[index]);
+    }
+    const uint32_t mode =
+        bitWidth(maxDelta) < bitWidth(maxFrame) ? DELTA : FRAME;
+    const uint32_t width = bitWidth(mode == DELTA ? maxDelta : maxFrame);
+    const std::vector<uint32_t> &packed = mode == DELTA ? deltas : frames;
+
+    words[4 * block] = mode == DELTA ? first[0] : minValue;
+    words[4 * block + 1] = mode == DELTA ? minDelta : 0;
+    words[4 * block + 2] = width | mode << 8;
+    words[4 * block + 3] = words.size();
+    // a whole block is always packed, with a spare word so the decoder can
+    // read two words for every value
+    const uint32_t offset = words.size();
+    words.resize(offset + blockSize * width / 32 + 1, 0);
+    for (uint32_t index = 0; width && index < length; index++) {
+      const uint32_t bit = index * width;
+      const uint32_t word = offset + bit / 32;
+      const uint32_t shift = bit % 32;
+      words[word] |= packed[index] << shift;
+      if (shift + width > 32) {
+        words[word + 1] |= packed[index] >> (32 - shift);
+      }
+    }
+  }
+  return words;
+}
+
+// each pipeline has its own layout, unpack.comp binds the compressed column
+// and the values it decodes to, add.comp binds a, b and the result
+struct Kernel {
+  VkDescriptorSetLayout setLayout;
+  VkPipelineLayout pipelineLayout;
+  VkPipeline pipeline;
+};
+
+VkResult createKernel(VkDevice device, const char *filename,
+                      uint32_t bindingCount, Kernel *kernel) {
+  std::vector<VkDescriptorSetLayoutBinding> layoutBindings;
+  VkDescriptorSetLayoutBinding layoutBinding = {};
+  layoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  layoutBinding.descriptorCount = 1;
+  layoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  for (uint32_t binding = 0; binding < bindingCount; binding++) {
+    layoutBinding.binding = binding;
+    layoutBindings.push_back(layoutBinding);
+  }
+
+  VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo = {};
+  setLayoutCreateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  setLayoutCreateInfo.bindingCount = layoutBindings.size();
+  setLayoutCreateInfo.pBindings = layoutBindings.data();
+  VkResult error = vkCreateDescriptorSetLayout(device, &setLayoutCreateInfo,
+                                               nullptr, &kernel->setLayout);
+  if (error) {
+    return error;
+  }
+
+  // both shaders take the count as their only push constant
+  VkPushConstantRange pushConstantRange = {};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(uint32_t);
+
+  VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+  pipelineLayoutCreateInfo.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutCreateInfo.setLayoutCount = 1;
+  pipelineLayoutCreateInfo.pSetLayouts = &kernel->setLayout;
+  pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+  pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+  error = vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr,
+                                 &kernel->pipelineLayout);
+  if (error) {
+    return error;
+  }
+  return createComputePipeline(device, kernel->pipelineLayout, filename,
+                               nullptr, &kernel->pipeline);
+}
+
+void destroyKernel(VkDevice device, Kernel &kernel) {
+  vkDestroyPipeline(device, kernel.pipeline, nullptr);
+  vkDestroyPipelineLayout(device, kernel.pipelineLayout, nullptr);
+  vkDestroyDescriptorSetLayout(device, kernel.setLayout, nullptr);
+}
+
+// dispatch kernel over count elements, with workgroupSize elements to each
+// workgroup
+void recordKernel(VkCommandBuffer commandBuffer, const Kernel &kernel,
+                  VkDescriptorSet descriptorSet, uint32_t count,
+                  uint32_t workgroupSize, uint32_t maxGroupCount) {
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                    kernel.pipeline);
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                          kernel.pipelineLayout, 0, 1, &descriptorSet, 0,
+                          nullptr);
+  vkCmdPushConstants(commandBuffer, kernel.pipelineLayout,
+                     VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t),
+                     &count);
+  vkCmdDispatch(commandBuffer,
+                std::min(divideRoundUp(count, workgroupSize), maxGroupCount),
+                1, 1);
+}
+
+void recordBarrier(VkCommandBuffer commandBuffer,
+                   VkPipelineStageFlags srcStageMask,
+                   VkAccessFlags srcAccessMask,
+                   VkPipelineStageFlags dstStageMask,
+                   VkAccessFlags dstAccessMask) {
+  VkMemoryBarrier memoryBarrier = {};
+  memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  memoryBarrier.srcAccessMask = srcAccessMask;
+  memoryBarrier.dstAccessMask = dstAccessMask;
+  vkCmdPipelineBarrier(commandBuffer, srcStageMask, dstStageMask, 0, 1,
+                       &memoryBarrier, 0, nullptr, 0, nullptr);
+}
+
+uint32_t nextRandom(uint32_t &seed) {
+  seed = seed * 1664525u + 1013904223u;
+  return seed >> 8;
+}
+
+// create the buffers with usage and bind them to a single allocation of a
+// memory type with the properties which every buffer supports
+VkResult createBuffers(VkDevice device,
+                       const VkPhysicalDeviceMemoryProperties &properties,
+                       VkMemoryPropertyFlags memoryPropertyFlags,
+                       const std::vector<VkDeviceSize> &sizes,
+                       VkBufferUsageFlags usage, uint32_t queueFamilyIndex,
+                       std::vector<VkBuffer> &buffers, VkDeviceMemory *memory,
+                       std::vector<VkDeviceSize> &offsets) {
+  VkDeviceSize requiredMemorySize = 0;
+  uint32_t memoryTypeBits = ~0u;
+  for (VkDeviceSize size : sizes) {
+    VkBufferCreateInfo bufferCreateInfo = {};
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.size = size;
+    bufferCreateInfo.usage = usage;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    bufferCreateInfo.queueFamilyIndexCount = 1;
+    bufferCreateInfo.pQueueFamilyIndices = &queueFamilyIndex;
+    VkBuffer buffer;
+    VkResult error =
+        vkCreateBuffer(device, &bufferCreateInfo, nullptr, &buffer);
+    if (error) {
+      return error;
+    }
+    buffers.push_back(buffer);
+    VkMemoryRequirements memoryRequirements;
+    vkGetBufferMemoryRequirements(device, buffer, &memoryRequirements);
+    memoryTypeBits &= memoryRequirements.memoryTypeBits;
+    const VkDeviceSize alignment = memoryRequirements.alignment;
+    requiredMemorySize =
+        (requiredMemorySize + alignment - 1) / alignment * alignment;
+    offsets.push_back(requiredMemorySize);
+    requiredMemorySize += memoryRequirements.size;
+  }
+
+  // falling back to another memory type could give memory the caller cannot
+  // map, or must flush, so fail instead
+  auto memoryTypeIndex = findMemoryTypeFromProperties(
+      memoryTypeBits, properties, memoryPropertyFlags);
+  if (0 > memoryTypeIndex) {
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+  }
+  VkMemoryAllocateInfo allocateInfo = {};
+  allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocateInfo.allocationSize = requiredMemorySize;
+  allocateInfo.memoryTypeIndex = memoryTypeIndex;
+  VkResult error = vkAllocateMemory(device, &allocateInfo, nullptr, memory);
+  if (error) {
+    return error;
+  }
+  for (size_t index = 0; index < buffers.size(); index++) {
+    error = vkBindBufferMemory(device, buffers[index], *memory,
+                               offsets[index]);
+    if (error) {
+      return error;
+    }
+  }
+  return VK_SUCCESS;
+}
+
+int main() {
+  VkApplicationInfo applicationInfo = {};
+  applicationInfo.pApplicationName = "Vulkan bit unpack example";
+  applicationInfo.apiVersion = VK_MAKE_VERSION(1, 0, 0);
+
+  VkInstanceCreateInfo instanceCreateInfo = {};
+  instanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+  instanceCreateInfo.pApplicationInfo = &applicationInfo;
+#ifdef ENABLE_LAYERS
+  // without a debug report callback, see vector_add, the validation layer
+  // prints its messages to stdout
+  std::vector<const char *> enabledLayerNames{"VK_LAYER_KHRONOS_validation"};
+  instanceCreateInfo.enabledLayerCount = enabledLayerNames.size();
+  instanceCreateInfo.ppEnabledLayerNames = enabledLayerNames.data();
+#endif
+
+  VkInstance instance = VK_NULL_HANDLE;
+  VkResult error = vkCreateInstance(&instanceCreateInfo, nullptr, &instance);
+  if (error) {
+    return error;
+  }
+
+  uint32_t count;
+  error = vkEnumeratePhysicalDevices(instance, &count, nullptr);
+  if (error) {
+    return error;
+  }
+  std::vector<VkPhysicalDevice> physicalDevices(count);
+  error = vkEnumeratePhysicalDevices(instance, &count, physicalDevices.data());
+  if (error) {
+    return error;
+  }
+
+  // find the first physical device with a compute queue
+  VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+  uint32_t queueFamilyIndex = 0;
+  uint32_t timestampValidBits = 0;
+  for (auto device : physicalDevices) {
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilyProperties(count);
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count,
+                                             queueFamilyProperties.data());
+    for (uint32_t index = 0; index < count; index++) {
+      if (queueFamilyProperties[index].queueFlags & VK_QUEUE_COMPUTE_BIT) {
+        physicalDevice = device;
+        queueFamilyIndex = index;
+        timestampValidBits = queueFamilyProperties[index].timestampValidBits;
+        break;
+      }
+    }
+    if (physicalDevice) {
+      break;
+    }
+  }
+  if (!physicalDevice) {
+    fprintf(stderr, "no device with a compute queue\n");
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+  }
+
+  VkPhysicalDeviceProperties physicalDeviceProperties;
+  vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties);
+  const VkPhysicalDeviceLimits &limits = physicalDeviceProperties.limits;
+
+  VkDeviceQueueCreateInfo queueCreateInfo = {};
+  queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+  queueCreateInfo.queueCount = 1;
+  queueCreateInfo.queueFamilyIndex = queueFamilyIndex;
+  float queuePriority = 1.0f;
+  queueCreateInfo.pQueuePriorities = &queuePriority;
+
+  VkDeviceCreateInfo deviceCreateInfo = {};
+  deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+  deviceCreateInfo.queueCreateInfoCount = 1;
+  deviceCreateInfo.pQueueCreateInfos = &queueCreateInfo;
+  VkDevice device = VK_NULL_HANDLE;
+  error = vkCreateDevice(physicalDevice, &deviceCreateInfo, nullptr, &device);
+  if (error) {
+    return error;
+  }
+
+  VkQueue queue;
+  vkGetDeviceQueue(device, queueFamilyIndex, 0, &queue);
+
+  Kernel unpack;
+  error = createKernel(device, "unpack.spv", 2, &unpack);
+  if (error) {
+    return error;
+  }
+  Kernel add;
+  error = createKernel(device, "add.spv", 3, &add);
+  if (error) {
+    return error;
+  }
+  const uint32_t maxGroupCount = limits.maxComputeWorkGroupCount[0];
+
+  // two low entropy columns of 8M integers, increasing timestamps which
+  // delta encode well and readings in a narrow range which suit a frame of
+  // reference
+  const uint32_t valueCount = 1 << 23;
+  std::vector<int32_t> columnA(valueCount);
+  std::vector<int32_t> columnB(valueCount);
+  uint32_t seed = 42;
+  int32_t timestamp = 1 << 20;
+  for (uint32_t index = 0; index < valueCount; index++) {
+    timestamp += 1 + nextRandom(seed) % 16;
+    columnA[index] = timestamp;
+    columnB[index] = 1000 + nextRandom(seed) % 100;
+  }
+  const std::vector<uint32_t> compressedA =
+      compressColumn(columnA.data(), valueCount);
+  const std::vector<uint32_t> compressedB =
+      compressColumn(columnB.data(), valueCount);
+
+  // both compressed columns share a buffer, the second at an offset it can
+  // be bound at
+  const VkDeviceSize alignment = limits.minStorageBufferOffsetAlignment;
+  const VkDeviceSize compressedSizeA = sizeof(uint32_t) * compressedA.size();
+  const VkDeviceSize compressedSizeB = sizeof(uint32_t) * compressedB.size();
+  const VkDeviceSize compressedOffsetB =
+      (compressedSizeA + alignment - 1) / alignment * alignment;
+  const VkDeviceSize columnSize = sizeof(int32_t) * valueCount;
+
+  VkPhysicalDeviceMemoryProperties memoryProperties;
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+  const VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                   VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+                                   VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+  // the uploads and the result read back are in host visible memory, the
+  // columns the kernels consume in device local memory
+  enum { RAW_A, RAW_B, COMPRESSED, RESULT, HOST_BUFFER_COUNT };
+  std::vector<VkBuffer> hostBuffers;
+  std::vector<VkDeviceSize> hostOffsets;
+  VkDeviceMemory hostMemory = VK_NULL_HANDLE;
+  error = createBuffers(
+      device, memoryProperties,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      {columnSize, columnSize, compressedOffsetB + compressedSizeB,
+       columnSize},
+      usage, queueFamilyIndex, hostBuffers, &hostMemory, hostOffsets);
+  if (error) {
+    return error;
+  }
+  enum { A, B, C, DEVICE_BUFFER_COUNT };
+  std::vector<VkBuffer> deviceBuffers;
+  std::vector<VkDeviceSize> deviceOffsets;
+  VkDeviceMemory deviceMemory = VK_NULL_HANDLE;
+  error = createBuffers(device, memoryProperties,
+                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                        {columnSize, columnSize, columnSize}, usage,
+                        queueFamilyIndex, deviceBuffers, &deviceMemory,
+                        deviceOffsets);
+  if (error) {
+    return error;
+  }
+
+  // decode each compressed column, then add the columns
+  enum { UNPACK_A, UNPACK_B, ADD, SET_COUNT };
+  VkDescriptorPoolSize poolSize = {};
+  poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  poolSize.descriptorCount = 2 + 2 + 3;
+  VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = {};
+  descriptorPoolCreateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  descriptorPoolCreateInfo.maxSets = SET_COUNT;
+  descriptorPoolCreateInfo.poolSizeCount = 1;
+  descriptorPoolCreateInfo.pPoolSizes = &poolSize;
+  VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+  error = vkCreateDescriptorPool(device, &descriptorPoolCreateInfo, nullptr,
+                                 &descriptorPool);
+  if (error) {
+    return error;
+  }
+
+  const VkDescriptorSetLayout setLayouts[SET_COUNT] = {
+      unpack.setLayout, unpack.setLayout, add.setLayout};
+  VkDescriptorSetAllocateInfo descriptorSetAllocateInfo = {};
+  descriptorSetAllocateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  descriptorSetAllocateInfo.descriptorPool = descriptorPool;
+  descriptorSetAllocateInfo.descriptorSetCount = SET_COUNT;
+  descriptorSetAllocateInfo.pSetLayouts = setLayouts;
+  VkDescriptorSet descriptorSets[SET_COUNT];
+  error = vkAllocateDescriptorSets(device, &descriptorSetAllocateInfo,
+                                   descriptorSets);
+  if (error) {
+    return error;
+  }
+
+  const VkDescriptorBufferInfo bufferInfos[] = {
+      {hostBuffers[COMPRESSED], 0, compressedSizeA},
+      {deviceBuffers[A], 0, VK_WHOLE_SIZE},
+      {hostBuffers[COMPRESSED], compressedOffsetB, compressedSizeB},
+      {deviceBuffers[B], 0, VK_WHOLE_SIZE},
+      {deviceBuffers[A], 0, VK_WHOLE_SIZE},
+      {deviceBuffers[B], 0, VK_WHOLE_SIZE},
+      {deviceBuffers[C], 0, VK_WHOLE_SIZE}};
+  const uint32_t setOfBufferInfo[] = {UNPACK_A, UNPACK_A, UNPACK_B, UNPACK_B,
+                                      ADD,      ADD,      ADD};
+  const uint32_t bindingOfBufferInfo[] = {0, 1, 0, 1, 0, 1, 2};
+  std::vector<VkWriteDescriptorSet> descriptorSetWrites;
+  VkWriteDescriptorSet writeDescriptorSet = {};
+  writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  writeDescriptorSet.dstArrayElement = 0;
+  writeDescriptorSet.descriptorCount = 1;
+  writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  for (uint32_t index = 0; index < 7; index++) {
+    writeDescriptorSet.dstSet = descriptorSets[setOfBufferInfo[index]];
+    writeDescriptorSet.dstBinding = bindingOfBufferInfo[index];
+    writeDescriptorSet.pBufferInfo = &bufferInfos[index];
+    descriptorSetWrites.push_back(writeDescriptorSet);
+  }
+  vkUpdateDescriptorSets(device, descriptorSetWrites.size(),
+                         descriptorSetWrites.data(), 0, nullptr);
+
+  char *data = nullptr;
+  error = vkMapMemory(device, hostMemory, 0, VK_WHOLE_SIZE, 0,
+                      reinterpret_cast<void **>(&data));
+  if (error) {
+    return error;
+  }
+  memcpy(data + hostOffsets[RAW_A], columnA.data(), columnSize);
+  memcpy(data + hostOffsets[RAW_B], columnB.data(), columnSize);
+  memcpy(data + hostOffsets[COMPRESSED], compressedA.data(), compressedSizeA);
+  memcpy(data + hostOffsets[COMPRESSED] + compressedOffsetB,
+         compressedB.data(), compressedSizeB);
+  int32_t *resultData =
+      reinterpret_cast<int32_t *>(data + hostOffsets[RESULT]);
+
+  VkQueryPool queryPool = VK_NULL_HANDLE;
+  if (timestampValidBits) {
+    VkQueryPoolCreateInfo queryPoolCreateInfo = {};
+    queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolCreateInfo.queryCount = 2;
+    error = vkCreateQueryPool(device, &queryPoolCreateInfo, nullptr,
+                              &queryPool);
+    if (error) {
+      return error;
+    }
+  }
+
+  VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+  commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+  commandPoolCreateInfo.queueFamilyIndex = queueFamilyIndex;
+  VkCommandPool commandPool = VK_NULL_HANDLE;
+  error = vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr,
+                              &commandPool);
+  if (error) {
+    return error;
+  }
+
+  VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
+  commandBufferAllocateInfo.sType =
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  commandBufferAllocateInfo.commandPool = commandPool;
+  commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  commandBufferAllocateInfo.commandBufferCount = 1;
+  VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+  error = vkAllocateCommandBuffers(device, &commandBufferAllocateInfo,
+                                   &commandBuffer);
+  if (error) {
+    return error;
+  }
+
+  // record the work of function into the command buffer, submit it, wait for
+  // it to complete and return the time between the timestamps in
+  // milliseconds, or 0 if timestamps are not supported
+  auto submit = [&](std::function<void()> function,
+                    double *milliseconds) -> VkResult {
+    VkResult result = vkResetCommandPool(device, commandPool, 0);
+    if (result) {
+      return result;
+    }
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    result = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    if (result) {
+      return result;
+    }
+    if (queryPool) {
+      vkCmdResetQueryPool(commandBuffer, queryPool, 0, 2);
+      vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                          queryPool, 0);
+    }
+    function();
+    if (queryPool) {
+      vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                          queryPool, 1);
+    }
+    result = vkEndCommandBuffer(commandBuffer);
+    if (result) {
+      return result;
+    }
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    result = vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+    if (result) {
+      return result;
+    }
+    vkQueueWaitIdle(queue);
+
+    *milliseconds = 0.0;
+    if (queryPool) {
+      uint64_t timestamps[2];
+      result = vkGetQueryPoolResults(
+          device, queryPool, 0, 2, sizeof(timestamps), timestamps,
+          sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+      if (result) {
+        return result;
+      }
+      *milliseconds =
+          (timestamps[1] - timestamps[0]) * limits.timestampPeriod * 1e-6;
+    }
+    return VK_SUCCESS;
+  };
+
+  // both paths end by adding the columns and copying the result back
+  auto recordAddAndReadBack = [&] {
+    recordKernel(commandBuffer, add, descriptorSets[ADD], valueCount, 256,
+                 maxGroupCount);
+    recordBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                  VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                  VK_ACCESS_TRANSFER_READ_BIT);
+    VkBufferCopy region = {0, 0, columnSize};
+    vkCmdCopyBuffer(commandBuffer, deviceBuffers[C], hostBuffers[RESULT], 1,
+                    &region);
+  };
+
+  struct Path {
+    const char *name;
+    VkDeviceSize uploadedBytes;
+    std::function<void()> record;
+  };
+  const Path paths[] = {
+      {"copy raw columns", 2 * columnSize,
+       [&] {
+         VkBufferCopy region = {0, 0, columnSize};
+         vkCmdCopyBuffer(commandBuffer, hostBuffers[RAW_A], deviceBuffers[A],
+                         1, &region);
+         vkCmdCopyBuffer(commandBuffer, hostBuffers[RAW_B], deviceBuffers[B],
+                         1, &region);
+         recordBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_ACCESS_TRANSFER_WRITE_BIT,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_ACCESS_SHADER_READ_BIT);
+         recordAddAndReadBack();
+       }},
+      {"unpack compressed", compressedSizeA + compressedSizeB,
+       [&] {
+         // the decoder reads the compressed columns straight from host
+         // visible memory, one workgroup decodes each block
+         recordKernel(commandBuffer, unpack, descriptorSets[UNPACK_A],
+                      valueCount, blockSize, maxGroupCount);
+         recordKernel(commandBuffer, unpack, descriptorSets[UNPACK_B],
+                      valueCount, blockSize, maxGroupCount);
+         recordBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_ACCESS_SHADER_WRITE_BIT,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_ACCESS_SHADER_READ_BIT);
+         recordAddAndReadBack();
+       }}};
+
+  printf("%-20s %12s %8s %10s %10s\n", "path", "uploaded MB", "ratio",
+         "device ms", "GB/s");
+  int failures = 0;
+  for (const Path &path : paths) {
+    memset(resultData, 0, columnSize);
+    double milliseconds;
+    error = submit(path.record, &milliseconds);
+    if (error) {
+      return error;
+    }
+    // the throughput counts the uncompressed bytes moved
+    printf("%-20s %12.2f %8.2f %10.3f %10.1f\n", path.name,
+           path.uploadedBytes * 1e-6,
+           (double)(2 * columnSize) / path.uploadedBytes, milliseconds,
+           milliseconds > 0.0 ? 3.0 * columnSize / milliseconds * 1e-6
+                              : 0.0);
+    for (uint32_t index = 0; index < valueCount; index++) {
+      const int32_t expected = columnA[index] + columnB[index];
+      if (resultData[index] != expected) {
+        fprintf(stderr, "%s [%u] is '%d' not '%d'!\n", path.name, index,
+                resultData[index], expected);
+        failures++;
+        break;
+      }
+    }
+  }
+  vkUnmapMemory(device, hostMemory);
+
+  if (queryPool) {
+    vkDestroyQueryPool(device, queryPool, nullptr);
+  }
+  vkDestroyCommandPool(device, commandPool, nullptr);
+  vkFreeMemory(device, hostMemory, nullptr);
+  vkFreeMemory(device, deviceMemory, nullptr);
+  for (auto buffer : hostBuffers) {
+    vkDestroyBuffer(device, buffer, nullptr);
+  }
+  for (auto buffer : deviceBuffers) {
+    vkDestroyBuffer(device, buffer, nullptr);
+  }
+  vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+  destroyKernel(device, add);
+  destroyKernel(device, unpack);
+  vkDestroyDevice(device, nullptr);
+  vkDestroyInstance(instance, nullptr);
+
+  if (failures) {
+    return 1;
+  }
+  printf("success\n");
+
+  return 0;
+}
@@ -0,0 +1,706 @@
+#include <vulkan/vulkan.h>
+
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// load a SPIR-V binary from disc
+std::vector<char> loadShaderCode(const char *filename) {
+  std::vector<char> shaderCode;
+  if (FILE *fp = fopen(filename, "rb")) {
+    char buf[1024];
+    while (size_t len = fread(buf, 1, sizeof(buf), fp)) {
+      shaderCode.insert(shaderCode.end(), buf, buf + len);
+    }
+    fclose(fp);
+  }
+  return shaderCode;
+}
+
+// search for compatible memory properties and return the memory type index
+int32_t findMemoryTypeFromProperties(
+    uint32_t memoryTypeBits, VkPhysicalDeviceMemoryProperties properties,
+    VkMemoryPropertyFlags requiredProperties) {
+  assert(properties.memoryTypeCount < 32u);
+  for (uint32_t index = 0; index < properties.memoryTypeCount; ++index) {
+    if (memoryTypeBits & (1u << index) &&
+        // Find the first memory type that supports all the required flags.
+        ((properties.memoryTypes[index].propertyFlags & requiredProperties) ==
+         requiredProperties)) {
+      return (int32_t)index;
+    }
+  }
+  return -1;
+}
+
+// create a compute pipeline from a SPIR-V binary found in SHADER_PATH
+VkResult createComputePipeline(VkDevice device, VkPipelineLayout layout,
+                               const char *filename,
+                               const VkSpecializationInfo *specializationInfo,
+                               VkPipeline *pipeline) {
+  auto shaderCode =
+      loadShaderCode((std::string(SHADER_PATH) + filename).c_str());
+  if (shaderCode.empty()) {
+    fprintf(stderr, "failed to load '%s'\n", filename);
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
+  shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  shaderModuleCreateInfo.pCode =
+      reinterpret_cast<uint32_t *>(shaderCode.data());
+  shaderModuleCreateInfo.codeSize = shaderCode.size();
+  VkShaderModule shaderModule = VK_NULL_HANDLE;
+  VkResult error = vkCreateShaderModule(device, &shaderModuleCreateInfo,
+                                        nullptr, &shaderModule);
+  if (error) {
+    return error;
+  }
+  VkComputePipelineCreateInfo pipelineCreateInfo = {};
+  pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineCreateInfo.stage.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipelineCreateInfo.stage.module = shaderModule;
+  pipelineCreateInfo.stage.pName = "main";
+  pipelineCreateInfo.stage.pSpecializationInfo = specializationInfo;
+  pipelineCreateInfo.layout = layout;
+  error = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1,
+                                   &pipelineCreateInfo, nullptr, pipeline);
+  vkDestroyShaderModule(device, shaderModule, nullptr);
+  return error;
+}
+
+// reductions selected by the op specialization constant of reduce.comp
+enum Reduction { DOT, NRM2, ASUM, IAMAX, REDUCTION_COUNT };
+
+// mirrors the push constant block shared by all the level 1 shaders
+struct Blas1Params {
+  uint32_t n;
+  uint32_t incx;
+  uint32_t incy;
+  float alpha;
+  uint32_t resultIndex;
+};
+
+// mirrors struct result in reduce.comp, iamax returns a zero based index
+struct Blas1Result {
+  float value;
+  uint32_t index;
+};
+
+// the level 1 suite shares a pipeline layout whose descriptor set binds x, y,
+// the results and the reduction workspace in that order
+struct Blas1 {
+  VkPipelineLayout pipelineLayout;
+  VkPipeline axpy;
+  VkPipeline scal;
+  VkPipeline reduce[REDUCTION_COUNT];
+  uint32_t maxGroupCount;
+};
+
+// all the shaders use a local size of 256
+const uint32_t localSize = 256;
+// the workspace holds one partial result per reduction workgroup, a few
+// hundred workgroups are plenty to saturate memory bandwidth
+const uint32_t maxReductionGroups = 1024;
+// size in bytes of the workspace, the finished group counter followed by the
+// partials which are 8 byte aligned 16 byte structures
+const VkDeviceSize workspaceSize = 8 + 16 * maxReductionGroups;
+
+// every shader strides over the vector so the dispatch size is clamped
+uint32_t groupCountFor(uint32_t n, uint32_t maxGroupCount) {
+  uint32_t groups = (n + localSize - 1) / localSize;
+  return groups < maxGroupCount ? (groups ? groups : 1) : maxGroupCount;
+}
+
+void recordBlas1(VkCommandBuffer commandBuffer, const Blas1 &blas1,
+                 VkPipeline pipeline, const Blas1Params &params,
+                 uint32_t groupCount) {
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+  vkCmdPushConstants(commandBuffer, blas1.pipelineLayout,
+                     VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(Blas1Params),
+                     &params);
+  vkCmdDispatch(commandBuffer, groupCount, 1, 1);
+}
+
+// y = alpha * x + y
+void recordAxpy(VkCommandBuffer commandBuffer, const Blas1 &blas1, uint32_t n,
+                float alpha, uint32_t incx, uint32_t incy) {
+  Blas1Params params = {n, incx, incy, alpha, 0};
+  recordBlas1(commandBuffer, blas1, blas1.axpy, params,
+              groupCountFor(n, blas1.maxGroupCount));
+}
+
+// x = alpha * x
+void recordScal(VkCommandBuffer commandBuffer, const Blas1 &blas1, uint32_t n,
+                float alpha, uint32_t incx) {
+  Blas1Params params = {n, incx, 0, alpha, 0};
+  recordBlas1(commandBuffer, blas1, blas1.scal, params,
+              groupCountFor(n, blas1.maxGroupCount));
+}
+
+// reduce x, and y for dot, into results[resultIndex] with one dispatch
+void recordReduction(VkCommandBuffer commandBuffer, const Blas1 &blas1,
+                     Reduction reduction, uint32_t n, uint32_t incx,
+                     uint32_t incy, uint32_t resultIndex) {
+  Blas1Params params = {n, incx, incy, 0.0f, resultIndex};
+  const uint32_t maxGroups = blas1.maxGroupCount < maxReductionGroups
+                                 ? blas1.maxGroupCount
+                                 : maxReductionGroups;
+  recordBlas1(commandBuffer, blas1, blas1.reduce[reduction], params,
+              groupCountFor(n, maxGroups));
+}
+
+// make the writes of one operation visible to the next
+void recordComputeBarrier(VkCommandBuffer commandBuffer) {
+  VkMemoryBarrier memoryBarrier = {};
+  memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  memoryBarrier.dstAccessMask =
+      VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1,
+                       &memoryBarrier, 0, nullptr, 0, nullptr);
+}
+
+// straightforward host implementations used as the baseline, accumulating in
+// double precision so they double as the reference for accuracy
+double hostDot(uint32_t n, const float *x, const float *y) {
+  double sum = 0.0;
+  for (uint32_t i = 0; i < n; i++) {
+    sum += (double)x[i] * y[i];
+  }
+  return sum;
+}
+
+double hostNrm2(uint32_t n, const float *x) {
+  double sum = 0.0;
+  for (uint32_t i = 0; i < n; i++) {
+    sum += (double)x[i] * x[i];
+  }
+  return sqrt(sum);
+}
+
+double hostAsum(uint32_t n, const float *x) {
+  double sum = 0.0;
+  for (uint32_t i = 0; i < n; i++) {
+    sum += fabs(x[i]);
+  }
+  return sum;
+}
+
+uint32_t hostIamax(uint32_t n, const float *x) {
+  uint32_t index = 0;
+  for (uint32_t i = 1; i < n; i++) {
+    if (fabsf(x[i]) > fabsf(x[index])) {
+      index = i;
+    }
+  }
+  return index;
+}
+
+void hostAxpy(uint32_t n, float alpha, const float *x, float *y) {
+  for (uint32_t i = 0; i < n; i++) {
+    y[i] = fmaf(alpha, x[i], y[i]);
+  }
+}
+
+void hostScal(uint32_t n, float alpha, float *x) {
+  for (uint32_t i = 0; i < n; i++) {
+    x[i] *= alpha;
+  }
+}
+
+// milliseconds elapsed since start
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+int main() {
+  VkApplicationInfo applicationInfo = {};
+  applicationInfo.pApplicationName = "Vulkan BLAS level 1 example";
+  applicationInfo.apiVersion = VK_MAKE_VERSION(1, 0, 0);
+
+  VkInstanceCreateInfo instanceCreateInfo = {};
+  instanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+  instanceCreateInfo.pApplicationInfo = &applicationInfo;
+#ifdef ENABLE_LAYERS
+  // without a debug report callback, see vector_add, the validation layer
+  // prints its messages to stdout
+  std::vector<const char *> enabledLayerNames{"VK_LAYER_KHRONOS_validation"};
+  instanceCreateInfo.enabledLayerCount = enabledLayerNames.size();
+  instanceCreateInfo.ppEnabledLayerNames = enabledLayerNames.data();
+#endif
+
+  VkInstance instance = VK_NULL_HANDLE;
+  VkResult error = vkCreateInstance(&instanceCreateInfo, nullptr, &instance);
+  if (error) {
+    return error;
+  }
+
+  uint32_t count;
+  error = vkEnumeratePhysicalDevices(instance, &count, nullptr);
+  if (error) {
+    return error;
+  }
+  std::vector<VkPhysicalDevice> physicalDevices(count);
+  error = vkEnumeratePhysicalDevices(instance, &count, physicalDevices.data());
+  if (error) {
+    return error;
+  }
+
+  // find the first physical device with a compute queue
+  VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+  uint32_t queueFamilyIndex = 0;
+  uint32_t timestampValidBits = 0;
+  for (auto device : physicalDevices) {
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilyProperties(count);
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count,
+                                             queueFamilyProperties.data());
+    for (uint32_t index = 0; index < count; index++) {
+      if (queueFamilyProperties[index].queueFlags & VK_QUEUE_COMPUTE_BIT) {
+        physicalDevice = device;
+        queueFamilyIndex = index;
+        timestampValidBits = queueFamilyProperties[index].timestampValidBits;
+        break;
+      }
+    }
+    if (physicalDevice) {
+      break;
+    }
+  }
+  if (!physicalDevice) {
+    fprintf(stderr, "no device with a compute queue\n");
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+  }
+
+  VkPhysicalDeviceProperties physicalDeviceProperties;
+  vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties);
+  const VkPhysicalDeviceLimits &limits = physicalDeviceProperties.limits;
+
+  VkDeviceQueueCreateInfo queueCreateInfo = {};
+  queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+  queueCreateInfo.queueCount = 1;
+  queueCreateInfo.queueFamilyIndex = queueFamilyIndex;
+  float queuePriority = 1.0f;
+  queueCreateInfo.pQueuePriorities = &queuePriority;
+
+  VkDeviceCreateInfo deviceCreateInfo = {};
+  deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+  deviceCreateInfo.queueCreateInfoCount = 1;
+  deviceCreateInfo.pQueueCreateInfos = &queueCreateInfo;
+  VkDevice device = VK_NULL_HANDLE;
+  error = vkCreateDevice(physicalDevice, &deviceCreateInfo, nullptr, &device);
+  if (error) {
+    return error;
+  }
+
+  VkQueue queue;
+  vkGetDeviceQueue(device, queueFamilyIndex, 0, &queue);
+
+  // x, y, results and workspace
+  std::vector<VkDescriptorSetLayoutBinding> layoutBindings;
+  VkDescriptorSetLayoutBinding layoutBinding = {};
+  layoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  layoutBinding.descriptorCount = 1;
+  layoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  for (uint32_t binding = 0; binding < 4; binding++) {
+    layoutBinding.binding = binding;
+    layoutBindings.push_back(layoutBinding);
+  }
+
+  VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo = {};
+  setLayoutCreateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  setLayoutCreateInfo.bindingCount = layoutBindings.size();
+  setLayoutCreateInfo.pBindings = layoutBindings.data();
+  VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+  error = vkCreateDescriptorSetLayout(device, &setLayoutCreateInfo, nullptr,
+                                      &setLayout);
+  if (error) {
+    return error;
+  }
+
+  VkPushConstantRange pushConstantRange = {};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(Blas1Params);
+
+  Blas1 blas1 = {};
+  blas1.maxGroupCount = limits.maxComputeWorkGroupCount[0];
+  VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+  pipelineLayoutCreateInfo.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutCreateInfo.setLayoutCount = 1;
+  pipelineLayoutCreateInfo.pSetLayouts = &setLayout;
+  pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+  pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+  error = vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr,
+                                 &blas1.pipelineLayout);
+  if (error) {
+    return error;
+  }
+
+  error = createComputePipeline(device, blas1.pipelineLayout, "axpy.spv",
+                                nullptr, &blas1.axpy);
+  if (error) {
+    return error;
+  }
+  error = createComputePipeline(device, blas1.pipelineLayout, "scal.spv",
+                                nullptr, &blas1.scal);
+  if (error) {
+    return error;
+  }
+  VkSpecializationMapEntry specializationMapEntry = {};
+  specializationMapEntry.constantID = 0;
+  specializationMapEntry.offset = 0;
+  specializationMapEntry.size = sizeof(uint32_t);
+  for (uint32_t reduction = 0; reduction < REDUCTION_COUNT; reduction++) {
+    VkSpecializationInfo specializationInfo = {};
+    specializationInfo.mapEntryCount = 1;
+    specializationInfo.pMapEntries = &specializationMapEntry;
+    specializationInfo.dataSize = sizeof(uint32_t);
+    specializationInfo.pData = &reduction;
+    error = createComputePipeline(device, blas1.pipelineLayout, "reduce.spv",
+                                  &specializationInfo,
+                                  &blas1.reduce[reduction]);
+    if (error) {
+      return error;
+    }
+  }
+
+  const uint32_t n = 1 << 22;
+  enum { X, Y, RESULTS, WORKSPACE, BUFFER_COUNT };
+  const VkDeviceSize bufferSizes[BUFFER_COUNT] = {
+      sizeof(float) * n, sizeof(float) * n,
+      sizeof(Blas1Result) * REDUCTION_COUNT, workspaceSize};
+  VkBuffer buffers[BUFFER_COUNT];
+  for (uint32_t index = 0; index < BUFFER_COUNT; index++) {
+    VkBufferCreateInfo bufferCreateInfo = {};
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.size = bufferSizes[index];
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    bufferCreateInfo.queueFamilyIndexCount = 1;
+    bufferCreateInfo.pQueueFamilyIndices = &queueFamilyIndex;
+    error = vkCreateBuffer(device, &bufferCreateInfo, nullptr, &buffers[index]);
+    if (error) {
+      return error;
+    }
+  }
+
+  VkDeviceSize bufferOffsets[BUFFER_COUNT];
+  VkDeviceSize requiredMemorySize = 0;
+  VkMemoryRequirements memoryRequirements;
+  for (uint32_t index = 0; index < BUFFER_COUNT; index++) {
+    vkGetBufferMemoryRequirements(device, buffers[index], &memoryRequirements);
+    const VkDeviceSize alignment = memoryRequirements.alignment;
+    requiredMemorySize =
+        (requiredMemorySize + alignment - 1) / alignment * alignment;
+    bufferOffsets[index] = requiredMemorySize;
+    requiredMemorySize += memoryRequirements.size;
+  }
+
+  VkPhysicalDeviceMemoryProperties memoryProperties;
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+  auto memoryTypeIndex = findMemoryTypeFromProperties(
+      memoryRequirements.memoryTypeBits, memoryProperties,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  if (0 > memoryTypeIndex) {
+    return ~42;  // returns -43
+  }
+
+  VkMemoryAllocateInfo allocateInfo = {};
+  allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocateInfo.allocationSize = requiredMemorySize;
+  allocateInfo.memoryTypeIndex = memoryTypeIndex;
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  error = vkAllocateMemory(device, &allocateInfo, nullptr, &memory);
+  if (error) {
+    return error;
+  }
+  for (uint32_t index = 0; index < BUFFER_COUNT; index++) {
+    error = vkBindBufferMemory(device, buffers[index], memory,
+                               bufferOffsets[index]);
+    if (error) {
+      return error;
+    }
+  }
+
+  VkDescriptorPoolSize poolSize = {};
+  poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  poolSize.descriptorCount = layoutBindings.size();
+  VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = {};
+  descriptorPoolCreateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  descriptorPoolCreateInfo.maxSets = 1;
+  descriptorPoolCreateInfo.poolSizeCount = 1;
+  descriptorPoolCreateInfo.pPoolSizes = &poolSize;
+  VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+  error = vkCreateDescriptorPool(device, &descriptorPoolCreateInfo, nullptr,
+                                 &descriptorPool);
+  if (error) {
+    return error;
+  }
+
+  VkDescriptorSetAllocateInfo descriptorSetAllocateInfo = {};
+  descriptorSetAllocateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  descriptorSetAllocateInfo.descriptorPool = descriptorPool;
+  descriptorSetAllocateInfo.descriptorSetCount = 1;
+  descriptorSetAllocateInfo.pSetLayouts = &setLayout;
+  VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+  error = vkAllocateDescriptorSets(device, &descriptorSetAllocateInfo,
+                                   &descriptorSet);
+  if (error) {
+    return error;
+  }
+
+  VkDescriptorBufferInfo bufferInfos[BUFFER_COUNT];
+  std::vector<VkWriteDescriptorSet> descriptorSetWrites;
+  VkWriteDescriptorSet writeDescriptorSet = {};
+  writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  writeDescriptorSet.dstSet = descriptorSet;
+  writeDescriptorSet.dstArrayElement = 0;
+  writeDescriptorSet.descriptorCount = 1;
+  writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  for (uint32_t index = 0; index < BUFFER_COUNT; index++) {
+    bufferInfos[index].buffer = buffers[index];
+    bufferInfos[index].offset = 0;
+    bufferInfos[index].range = VK_WHOLE_SIZE;
+    writeDescriptorSet.dstBinding = index;
+    writeDescriptorSet.pBufferInfo = &bufferInfos[index];
+    descriptorSetWrites.push_back(writeDescriptorSet);
+  }
+  vkUpdateDescriptorSets(device, descriptorSetWrites.size(),
+                         descriptorSetWrites.data(), 0, nullptr);
+
+  char *data = nullptr;
+  error = vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0,
+                      reinterpret_cast<void **>(&data));
+  if (error) {
+    return error;
+  }
+  float *xData = reinterpret_cast<float *>(data + bufferOffsets[X]);
+  float *yData = reinterpret_cast<float *>(data + bufferOffsets[Y]);
+  Blas1Result *results =
+      reinterpret_cast<Blas1Result *>(data + bufferOffsets[RESULTS]);
+  // the reductions rely on the finished group counter starting at zero
+  *reinterpret_cast<uint32_t *>(data + bufferOffsets[WORKSPACE]) = 0;
+  uint32_t seed = 3;
+  for (uint32_t index = 0; index < n; index++) {
+    seed = seed * 1664525u + 1013904223u;
+    xData[index] = (float)(seed >> 8) / (float)(1 << 23) - 1.0f;
+    seed = seed * 1664525u + 1013904223u;
+    yData[index] = (float)(seed >> 8) / (float)(1 << 23) - 1.0f;
+  }
+  // make sure there is a unique largest magnitude for iamax to find
+  xData[n / 3] = -2.0f;
+
+  // keep copies for the host baseline
+  std::vector<float> hostX(xData, xData + n);
+  std::vector<float> hostY(yData, yData + n);
+
+  // a timestamp before the first and after each of the six operations
+  const uint32_t operationCount = 6;
+  VkQueryPool queryPool = VK_NULL_HANDLE;
+  if (timestampValidBits) {
+    VkQueryPoolCreateInfo queryPoolCreateInfo = {};
+    queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolCreateInfo.queryCount = operationCount + 1;
+    error = vkCreateQueryPool(device, &queryPoolCreateInfo, nullptr,
+                              &queryPool);
+    if (error) {
+      return error;
+    }
+  }
+
+  VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+  commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+  commandPoolCreateInfo.queueFamilyIndex = queueFamilyIndex;
+  VkCommandPool commandPool = VK_NULL_HANDLE;
+  error = vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr,
+                              &commandPool);
+  if (error) {
+    return error;
+  }
+
+  VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
+  commandBufferAllocateInfo.sType =
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  commandBufferAllocateInfo.commandPool = commandPool;
+  commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  commandBufferAllocateInfo.commandBufferCount = 1;
+  VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+  error = vkAllocateCommandBuffers(device, &commandBufferAllocateInfo,
+                                   &commandBuffer);
+  if (error) {
+    return error;
+  }
+
+  VkCommandBufferBeginInfo beginInfo = {};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  error = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+  if (error) {
+    return error;
+  }
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                          blas1.pipelineLayout, 0, 1, &descriptorSet, 0,
+                          nullptr);
+  if (queryPool) {
+    vkCmdResetQueryPool(commandBuffer, queryPool, 0, operationCount + 1);
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                        queryPool, 0);
+  }
+  // the reductions first, on the original data, then y = 0.5 * x + y and
+  // finally x = 3 * x, each one waits for the previous as they share the
+  // workspace or the vectors
+  const float axpyAlpha = 0.5f;
+  const float scalAlpha = 3.0f;
+  for (uint32_t operation = 0; operation < operationCount; operation++) {
+    if (operation) {
+      recordComputeBarrier(commandBuffer);
+    }
+    if (operation < REDUCTION_COUNT) {
+      recordReduction(commandBuffer, blas1, Reduction(operation), n, 1, 1,
+                      operation);
+    } else if (operation == REDUCTION_COUNT) {
+      recordAxpy(commandBuffer, blas1, n, axpyAlpha, 1, 1);
+    } else {
+      recordScal(commandBuffer, blas1, n, scalAlpha, 1);
+    }
+    if (queryPool) {
+      vkCmdWriteTimestamp(commandBuffer,
+                          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, queryPool,
+                          operation + 1);
+    }
+  }
+  error = vkEndCommandBuffer(commandBuffer);
+  if (error) {
+    return error;
+  }
+
+  VkSubmitInfo submitInfo = {};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &commandBuffer;
+  error = vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+  if (error) {
+    return error;
+  }
+  vkQueueWaitIdle(queue);
+
+  // run the host baseline, timing each operation
+  double hostMilliseconds[operationCount];
+  double reference[REDUCTION_COUNT];
+  auto start = std::chrono::steady_clock::now();
+  reference[DOT] = hostDot(n, hostX.data(), hostY.data());
+  hostMilliseconds[DOT] = millisecondsSince(start);
+  start = std::chrono::steady_clock::now();
+  reference[NRM2] = hostNrm2(n, hostX.data());
+  hostMilliseconds[NRM2] = millisecondsSince(start);
+  start = std::chrono::steady_clock::now();
+  reference[ASUM] = hostAsum(n, hostX.data());
+  hostMilliseconds[ASUM] = millisecondsSince(start);
+  start = std::chrono::steady_clock::now();
+  reference[IAMAX] = hostIamax(n, hostX.data());
+  hostMilliseconds[IAMAX] = millisecondsSince(start);
+  start = std::chrono::steady_clock::now();
+  hostAxpy(n, axpyAlpha, hostX.data(), hostY.data());
+  hostMilliseconds[REDUCTION_COUNT] = millisecondsSince(start);
+  start = std::chrono::steady_clock::now();
+  hostScal(n, scalAlpha, hostX.data());
+  hostMilliseconds[REDUCTION_COUNT + 1] = millisecondsSince(start);
+
+  double deviceMilliseconds[operationCount] = {};
+  if (queryPool) {
+    uint64_t timestamps[operationCount + 1];
+    error = vkGetQueryPoolResults(
+        device, queryPool, 0, operationCount + 1, sizeof(timestamps),
+        timestamps, sizeof(uint64_t),
+        VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+    if (error) {
+      return error;
+    }
+    for (uint32_t operation = 0; operation < operationCount; operation++) {
+      deviceMilliseconds[operation] =
+          (timestamps[operation + 1] - timestamps[operation]) *
+          limits.timestampPeriod * 1e-6;
+    }
+  }
+
+  const char *names[operationCount] = {"dot",  "nrm2", "asum",
+                                       "iamax", "axpy", "scal"};
+  printf("n = %u\n%-6s %12s %12s %14s %14s\n", n, "op", "device ms",
+         "host ms", "device", "reference");
+  int failures = 0;
+  for (uint32_t operation = 0; operation < operationCount; operation++) {
+    printf("%-6s %12.3f %12.3f", names[operation],
+           deviceMilliseconds[operation], hostMilliseconds[operation]);
+    if (operation == IAMAX) {
+      printf(" %14u %14u\n", results[IAMAX].index, (uint32_t)reference[IAMAX]);
+      if (results[IAMAX].index != (uint32_t)reference[IAMAX]) {
+        failures++;
+      }
+    } else if (operation < REDUCTION_COUNT) {
+      const double value = results[operation].value;
+      printf(" %14.6g %14.6g\n", value, reference[operation]);
+      // the compensated sums are accurate well beyond single precision
+      // rounding of the result, so a tight relative tolerance is used
+      if (fabs(value - reference[operation]) >
+          1e-6 * fabs(reference[operation])) {
+        failures++;
+      }
+    } else {
+      printf("\n");
+    }
+  }
+
+  // axpy and scal are elementwise, allow for the device not fusing the fma
+  for (uint32_t index = 0; index < n; index++) {
+    const float tolerance = 1e-6f * (1.0f + fabsf(hostY[index]));
+    if (fabsf(yData[index] - hostY[index]) > tolerance ||
+        xData[index] != hostX[index]) {
+      fprintf(stderr, "x[%u] y[%u] are '%f' '%f' not '%f' '%f'!\n", index,
+              index, xData[index], yData[index], hostX[index], hostY[index]);
+      failures++;
+    }
+  }
+  vkUnmapMemory(device, memory);
+
+  if (queryPool) {
+    vkDestroyQueryPool(device, queryPool, nullptr);
+  }
+  vkDestroyCommandPool(device, commandPool, nullptr);
+  vkFreeMemory(device, memory, nullptr);
+  for (auto buffer : buffers) {
+    vkDestroyBuffer(device, buffer, nullptr);
+  }
+  vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+  for (auto pipeline : blas1.reduce) {
+    vkDestroyPipeline(device, pipeline, nullptr);
+  }
+  vkDestroyPipeline(device, blas1.scal, nullptr);
+  vkDestroyPipeline(device, blas1.axpy, nullptr);
+  vkDestroyPipelineLayout(device, blas1.pipelineLayout, nullptr);
+  vkDestroyDescriptorSetLayout(device, setLayout, nullptr);
+  vkDestroyDevice(device, nullptr);
+  vkDestroyInstance(instance, nullptr);
+
+  if (failures) {
+    return 1;
+  }
+  printf("success\n");
+
+  return 0;
+}
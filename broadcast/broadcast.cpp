@@ -0,0 +1,659 @@
+#include <vulkan/vulkan.h>
+
+#include <cassert>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// load a SPIR-V binary from disc
+std::vector<char> loadShaderCode(const char *filename) {
+  std::vector<char> shaderCode;
+  if (FILE *fp = fopen(filename, "rb")) {
+    char buf[1024];
+    while (size_t len = fread(buf, 1, sizeof(buf), fp)) {
+      shaderCode.insert(shaderCode.end(), buf, buf + len);
+    }
+    fclose(fp);
+  }
+  return shaderCode;
+}
+
+// search for compatible memory properties and return the memory type index
+int32_t findMemoryTypeFromProperties(
+    uint32_t memoryTypeBits, VkPhysicalDeviceMemoryProperties properties,
+    VkMemoryPropertyFlags requiredProperties) {
+  assert(properties.memoryTypeCount < 32u);
+  for (uint32_t index = 0; index < properties.memoryTypeCount; ++index) {
+    if (memoryTypeBits & (1u << index) &&
+        // Find the first memory type that supports all the required flags.
+        ((properties.memoryTypes[index].propertyFlags & requiredProperties) ==
+         requiredProperties)) {
+      return (int32_t)index;
+    }
+  }
+  return -1;
+}
+
+// create a compute pipeline from a SPIR-V binary found in SHADER_PATH
+VkResult createComputePipeline(VkDevice device, VkPipelineLayout layout,
+                               const char *filename,
+                               const VkSpecializationInfo *specializationInfo,
+                               VkPipeline *pipeline) {
+  auto shaderCode =
+      loadShaderCode((std::string(SHADER_PATH) + filename).c_str());
+  if (shaderCode.empty()) {
+    fprintf(stderr, "failed to load '%s'\n", filename);
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
+  shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  shaderModuleCreateInfo.pCode =
+      reinterpret_cast<uint32_t *>(shaderCode.data());
+  shaderModuleCreateInfo.codeSize = shaderCode.size();
+  VkShaderModule shaderModule = VK_NULL_HANDLE;
+  VkResult error = vkCreateShaderModule(device, &shaderModuleCreateInfo,
+                                        nullptr, &shaderModule);
+  if (error) {
+    return error;
+  }
+  VkComputePipelineCreateInfo pipelineCreateInfo = {};
+  pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineCreateInfo.stage.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipelineCreateInfo.stage.module = shaderModule;
+  pipelineCreateInfo.stage.pName = "main";
+  pipelineCreateInfo.stage.pSpecializationInfo = specializationInfo;
+  pipelineCreateInfo.layout = layout;
+  error = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1,
+                                   &pipelineCreateInfo, nullptr, pipeline);
+  vkDestroyShaderModule(device, shaderModule, nullptr);
+  return error;
+}
+
+// the elementwise shaders support results of up to 4 dimensions
+const uint32_t maxDimensions = 4;
+
+// operations selected by the op specialization constant of the shaders
+enum ElementwiseOp {
+  ADD,
+  SUBTRACT,
+  MULTIPLY,
+  DIVIDE,
+  MINIMUM,
+  MAXIMUM,
+  OP_COUNT
+};
+
+// a view of some elements of a buffer, the innermost dimension is last and
+// all offsets and strides are counted in elements
+struct TensorView {
+  uint32_t rank;
+  uint32_t shape[maxDimensions];
+  int32_t strides[maxDimensions];
+  uint32_t offset;
+};
+
+// mirrors the push constant block of both elementwise shaders
+struct ElementwiseParams {
+  uint32_t shape[maxDimensions];
+  int32_t strideA[maxDimensions];
+  int32_t strideB[maxDimensions];
+  uint32_t offsetA;
+  uint32_t offsetB;
+  uint32_t offsetResult;
+  uint32_t count;
+  float scalar;
+  uint32_t scalarB;
+};
+
+// describe a dense row major tensor starting at offset
+TensorView denseView(uint32_t rank, const uint32_t *shape, uint32_t offset) {
+  TensorView view = {};
+  view.rank = rank;
+  view.offset = offset;
+  int32_t stride = 1;
+  for (uint32_t dimension = rank; dimension-- > 0;) {
+    view.shape[dimension] = shape[dimension];
+    view.strides[dimension] = stride;
+    stride *= shape[dimension];
+  }
+  return view;
+}
+
+// swap the two innermost dimensions of a view without moving any data
+TensorView transposeView(TensorView view) {
+  assert(view.rank >= 2);
+  const uint32_t inner = view.rank - 1;
+  const uint32_t outer = view.rank - 2;
+  uint32_t size = view.shape[inner];
+  view.shape[inner] = view.shape[outer];
+  view.shape[outer] = size;
+  int32_t stride = view.strides[inner];
+  view.strides[inner] = view.strides[outer];
+  view.strides[outer] = stride;
+  return view;
+}
+
+// broadcast a against b, or against the scalar when b is null, following the
+// NumPy rules: shapes are aligned on their innermost dimension and a size of
+// one stretches to match the other operand by using a stride of zero, the
+// result is dense with the broadcast shape starting at offsetResult
+//
+// dimensions are then coalesced wherever every operand steps through memory
+// uniformly across them, when that leaves a single dimension with unit
+// strides the contiguous fast path can be used
+//
+// returns false if the shapes are incompatible
+bool planElementwise(const TensorView &a, const TensorView *b, float scalar,
+                     uint32_t offsetResult, ElementwiseParams &params,
+                     bool &contiguous) {
+  const uint32_t rank = (b && b->rank > a.rank) ? b->rank : a.rank;
+  uint32_t shape[maxDimensions];
+  int32_t strideA[maxDimensions];
+  int32_t strideB[maxDimensions];
+  uint32_t coalescedRank = 0;
+  for (uint32_t dimension = 0; dimension < rank; dimension++) {
+    uint32_t sizeA = 1, sizeB = 1;
+    int32_t stepA = 0, stepB = 0;
+    if (dimension >= rank - a.rank) {
+      sizeA = a.shape[dimension - (rank - a.rank)];
+      stepA = a.strides[dimension - (rank - a.rank)];
+    }
+    if (b && dimension >= rank - b->rank) {
+      sizeB = b->shape[dimension - (rank - b->rank)];
+      stepB = b->strides[dimension - (rank - b->rank)];
+    }
+    if (sizeA != sizeB && sizeA != 1 && sizeB != 1) {
+      return false;
+    }
+    const uint32_t size = sizeA > sizeB ? sizeA : sizeB;
+    if (size == 1) {
+      // contributes nothing to the indexing so drop it
+      continue;
+    }
+    stepA = sizeA == 1 ? 0 : stepA;
+    stepB = sizeB == 1 ? 0 : stepB;
+    // the result is dense so it never prevents merging with the outer
+    // dimension, only the operand strides need checking
+    if (coalescedRank &&
+        strideA[coalescedRank - 1] == stepA * (int32_t)size &&
+        strideB[coalescedRank - 1] == stepB * (int32_t)size) {
+      shape[coalescedRank - 1] *= size;
+      strideA[coalescedRank - 1] = stepA;
+      strideB[coalescedRank - 1] = stepB;
+    } else {
+      shape[coalescedRank] = size;
+      strideA[coalescedRank] = stepA;
+      strideB[coalescedRank] = stepB;
+      coalescedRank++;
+    }
+  }
+
+  params = {};
+  params.offsetA = a.offset;
+  params.offsetB = b ? b->offset : 0;
+  params.offsetResult = offsetResult;
+  params.scalar = scalar;
+  params.scalarB = b ? 0 : 1;
+  params.count = 1;
+  // pad the outer dimensions so the shaders can always unravel 4 dimensions
+  const uint32_t padding = maxDimensions - coalescedRank;
+  for (uint32_t dimension = 0; dimension < maxDimensions; dimension++) {
+    if (dimension < padding) {
+      params.shape[dimension] = 1;
+      params.strideA[dimension] = 0;
+      params.strideB[dimension] = 0;
+    } else {
+      params.shape[dimension] = shape[dimension - padding];
+      params.strideA[dimension] = strideA[dimension - padding];
+      params.strideB[dimension] = strideB[dimension - padding];
+    }
+    params.count *= params.shape[dimension];
+  }
+
+  contiguous =
+      coalescedRank == 0 ||
+      (coalescedRank == 1 && strideA[0] == 1 && (!b || strideB[0] == 1));
+  return true;
+}
+
+int main() {
+  VkApplicationInfo applicationInfo = {};
+  applicationInfo.pApplicationName = "Vulkan broadcasting elementwise example";
+  applicationInfo.apiVersion = VK_MAKE_VERSION(1, 0, 0);
+
+  VkInstanceCreateInfo instanceCreateInfo = {};
+  instanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+  instanceCreateInfo.pApplicationInfo = &applicationInfo;
+#ifdef ENABLE_LAYERS
+  // without a debug report callback, see vector_add, the validation layer
+  // prints its messages to stdout
+  std::vector<const char *> enabledLayerNames{"VK_LAYER_KHRONOS_validation"};
+  instanceCreateInfo.enabledLayerCount = enabledLayerNames.size();
+  instanceCreateInfo.ppEnabledLayerNames = enabledLayerNames.data();
+#endif
+
+  VkInstance instance = VK_NULL_HANDLE;
+  VkResult error = vkCreateInstance(&instanceCreateInfo, nullptr, &instance);
+  if (error) {
+    return error;
+  }
+
+  uint32_t count;
+  error = vkEnumeratePhysicalDevices(instance, &count, nullptr);
+  if (error) {
+    return error;
+  }
+  std::vector<VkPhysicalDevice> physicalDevices(count);
+  error = vkEnumeratePhysicalDevices(instance, &count, physicalDevices.data());
+  if (error) {
+    return error;
+  }
+
+  // find the first physical device with a compute queue
+  VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+  uint32_t queueFamilyIndex = 0;
+  for (auto device : physicalDevices) {
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilyProperties(count);
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count,
+                                             queueFamilyProperties.data());
+    for (uint32_t index = 0; index < count; index++) {
+      if (queueFamilyProperties[index].queueFlags & VK_QUEUE_COMPUTE_BIT) {
+        physicalDevice = device;
+        queueFamilyIndex = index;
+        break;
+      }
+    }
+    if (physicalDevice) {
+      break;
+    }
+  }
+  if (!physicalDevice) {
+    fprintf(stderr, "no device with a compute queue\n");
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+  }
+
+  VkDeviceQueueCreateInfo queueCreateInfo = {};
+  queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+  queueCreateInfo.queueCount = 1;
+  queueCreateInfo.queueFamilyIndex = queueFamilyIndex;
+  float queuePriority = 1.0f;
+  queueCreateInfo.pQueuePriorities = &queuePriority;
+
+  VkDeviceCreateInfo deviceCreateInfo = {};
+  deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+  deviceCreateInfo.queueCreateInfoCount = 1;
+  deviceCreateInfo.pQueueCreateInfos = &queueCreateInfo;
+  VkDevice device = VK_NULL_HANDLE;
+  error = vkCreateDevice(physicalDevice, &deviceCreateInfo, nullptr, &device);
+  if (error) {
+    return error;
+  }
+
+  VkQueue queue;
+  vkGetDeviceQueue(device, queueFamilyIndex, 0, &queue);
+
+  // the same 3 bindings as vector_add.comp
+  std::vector<VkDescriptorSetLayoutBinding> layoutBindings;
+  VkDescriptorSetLayoutBinding layoutBinding = {};
+  layoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  layoutBinding.descriptorCount = 1;
+  layoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  for (uint32_t binding = 0; binding < 3; binding++) {
+    layoutBinding.binding = binding;
+    layoutBindings.push_back(layoutBinding);
+  }
+
+  VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo = {};
+  setLayoutCreateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  setLayoutCreateInfo.bindingCount = layoutBindings.size();
+  setLayoutCreateInfo.pBindings = layoutBindings.data();
+  VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+  error = vkCreateDescriptorSetLayout(device, &setLayoutCreateInfo, nullptr,
+                                      &setLayout);
+  if (error) {
+    return error;
+  }
+
+  VkPushConstantRange pushConstantRange = {};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(ElementwiseParams);
+
+  VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+  pipelineLayoutCreateInfo.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutCreateInfo.setLayoutCount = 1;
+  pipelineLayoutCreateInfo.pSetLayouts = &setLayout;
+  pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+  pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+  VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+  error = vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr,
+                                 &pipelineLayout);
+  if (error) {
+    return error;
+  }
+
+  // specialize both variants of the shader for every operation, the
+  // operation is folded into the pipeline so there is no runtime switch
+  VkPipeline pipelines[2][OP_COUNT];  // strided and contiguous
+  const char *shaderNames[2] = {"elementwise_strided.spv",
+                                "elementwise_contiguous.spv"};
+  VkSpecializationMapEntry specializationMapEntry = {};
+  specializationMapEntry.constantID = 0;
+  specializationMapEntry.offset = 0;
+  specializationMapEntry.size = sizeof(uint32_t);
+  for (uint32_t variant = 0; variant < 2; variant++) {
+    for (uint32_t op = 0; op < OP_COUNT; op++) {
+      VkSpecializationInfo specializationInfo = {};
+      specializationInfo.mapEntryCount = 1;
+      specializationInfo.pMapEntries = &specializationMapEntry;
+      specializationInfo.dataSize = sizeof(uint32_t);
+      specializationInfo.pData = &op;
+      error = createComputePipeline(device, pipelineLayout,
+                                    shaderNames[variant], &specializationInfo,
+                                    &pipelines[variant][op]);
+      if (error) {
+        return error;
+      }
+    }
+  }
+
+  // all the inputs live in one buffer and every operand is a view into it,
+  // both input bindings refer to that buffer
+  const uint32_t rows = 64;
+  const uint32_t columns = 100;
+  const uint32_t vectorLength = 1000;
+  const uint32_t matrixShape[2] = {rows, columns};
+  const uint32_t transposedShape[2] = {columns, rows};
+  const uint32_t rowShape[1] = {columns};
+  const uint32_t columnShape[2] = {rows, 1};
+  const uint32_t vectorShape[1] = {vectorLength};
+  const TensorView matrix = denseView(2, matrixShape, 0);
+  const TensorView row = denseView(1, rowShape, rows * columns);
+  const TensorView transposed = transposeView(
+      denseView(2, transposedShape, rows * columns + columns));
+  const TensorView vector =
+      denseView(1, vectorShape, 2 * rows * columns + columns);
+  // the first elements of the vector double as a column vector
+  const TensorView column = denseView(2, columnShape, vector.offset);
+  const uint32_t inputElements = vector.offset + vectorLength;
+
+  // the jobs to run and where their results go in the result buffer
+  struct Job {
+    ElementwiseOp op;
+    const TensorView *a;
+    const TensorView *b;
+    float scalar;
+    uint32_t offsetResult;
+    const char *description;
+  };
+  const uint32_t matrixElements = rows * columns;
+  const Job jobs[] = {
+      {ADD, &matrix, &row, 0.0f, 0, "matrix + row vector"},
+      {SUBTRACT, &matrix, &transposed, 0.0f, matrixElements,
+       "matrix - transposed matrix"},
+      {MULTIPLY, &vector, nullptr, 2.5f, 2 * matrixElements,
+       "vector * scalar"},
+      {MAXIMUM, &matrix, &matrix, 0.0f, 2 * matrixElements + vectorLength,
+       "max(matrix, matrix)"},
+      {MULTIPLY, &matrix, &column, 0.0f, 3 * matrixElements + vectorLength,
+       "matrix * column vector"},
+  };
+  const uint32_t jobCount = sizeof(jobs) / sizeof(jobs[0]);
+  const uint32_t resultElements = 4 * matrixElements + vectorLength;
+
+  ElementwiseParams params[jobCount];
+  bool contiguous[jobCount];
+  for (uint32_t job = 0; job < jobCount; job++) {
+    if (!planElementwise(*jobs[job].a, jobs[job].b, jobs[job].scalar,
+                         jobs[job].offsetResult, params[job],
+                         contiguous[job])) {
+      fprintf(stderr, "%s: shapes can not be broadcast\n",
+              jobs[job].description);
+      return VK_ERROR_FORMAT_NOT_SUPPORTED;
+    }
+    printf("%-28s %s\n", jobs[job].description,
+           contiguous[job] ? "contiguous" : "strided");
+  }
+
+  VkBuffer buffers[2];  // inputs and results
+  const VkDeviceSize bufferSizes[2] = {sizeof(float) * inputElements,
+                                       sizeof(float) * resultElements};
+  for (uint32_t index = 0; index < 2; index++) {
+    VkBufferCreateInfo bufferCreateInfo = {};
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.size = bufferSizes[index];
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    bufferCreateInfo.queueFamilyIndexCount = 1;
+    bufferCreateInfo.pQueueFamilyIndices = &queueFamilyIndex;
+    error = vkCreateBuffer(device, &bufferCreateInfo, nullptr, &buffers[index]);
+    if (error) {
+      return error;
+    }
+  }
+
+  VkDeviceSize bufferOffsets[2];
+  VkDeviceSize requiredMemorySize = 0;
+  VkMemoryRequirements memoryRequirements;
+  for (uint32_t index = 0; index < 2; index++) {
+    vkGetBufferMemoryRequirements(device, buffers[index], &memoryRequirements);
+    const VkDeviceSize alignment = memoryRequirements.alignment;
+    requiredMemorySize =
+        (requiredMemorySize + alignment - 1) / alignment * alignment;
+    bufferOffsets[index] = requiredMemorySize;
+    requiredMemorySize += memoryRequirements.size;
+  }
+
+  VkPhysicalDeviceMemoryProperties memoryProperties;
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+  auto memoryTypeIndex = findMemoryTypeFromProperties(
+      memoryRequirements.memoryTypeBits, memoryProperties,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  if (0 > memoryTypeIndex) {
+    return ~42;  // returns -43
+  }
+
+  VkMemoryAllocateInfo allocateInfo = {};
+  allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocateInfo.allocationSize = requiredMemorySize;
+  allocateInfo.memoryTypeIndex = memoryTypeIndex;
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  error = vkAllocateMemory(device, &allocateInfo, nullptr, &memory);
+  if (error) {
+    return error;
+  }
+  for (uint32_t index = 0; index < 2; index++) {
+    error = vkBindBufferMemory(device, buffers[index], memory,
+                               bufferOffsets[index]);
+    if (error) {
+      return error;
+    }
+  }
+
+  VkDescriptorPoolSize poolSize = {};
+  poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  poolSize.descriptorCount = layoutBindings.size();
+  VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = {};
+  descriptorPoolCreateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  descriptorPoolCreateInfo.maxSets = 1;
+  descriptorPoolCreateInfo.poolSizeCount = 1;
+  descriptorPoolCreateInfo.pPoolSizes = &poolSize;
+  VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+  error = vkCreateDescriptorPool(device, &descriptorPoolCreateInfo, nullptr,
+                                 &descriptorPool);
+  if (error) {
+    return error;
+  }
+
+  VkDescriptorSetAllocateInfo descriptorSetAllocateInfo = {};
+  descriptorSetAllocateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  descriptorSetAllocateInfo.descriptorPool = descriptorPool;
+  descriptorSetAllocateInfo.descriptorSetCount = 1;
+  descriptorSetAllocateInfo.pSetLayouts = &setLayout;
+  VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+  error = vkAllocateDescriptorSets(device, &descriptorSetAllocateInfo,
+                                   &descriptorSet);
+  if (error) {
+    return error;
+  }
+
+  // A and B both see the input buffer, the views select what they read
+  VkDescriptorBufferInfo inputInfo = {};
+  inputInfo.buffer = buffers[0];
+  inputInfo.offset = 0;
+  inputInfo.range = VK_WHOLE_SIZE;
+  VkDescriptorBufferInfo resultInfo = {};
+  resultInfo.buffer = buffers[1];
+  resultInfo.offset = 0;
+  resultInfo.range = VK_WHOLE_SIZE;
+  const VkDescriptorBufferInfo *bindingInfos[3] = {&inputInfo, &inputInfo,
+                                                   &resultInfo};
+  std::vector<VkWriteDescriptorSet> descriptorSetWrites;
+  VkWriteDescriptorSet writeDescriptorSet = {};
+  writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  writeDescriptorSet.dstSet = descriptorSet;
+  writeDescriptorSet.dstArrayElement = 0;
+  writeDescriptorSet.descriptorCount = 1;
+  writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  for (uint32_t binding = 0; binding < 3; binding++) {
+    writeDescriptorSet.dstBinding = binding;
+    writeDescriptorSet.pBufferInfo = bindingInfos[binding];
+    descriptorSetWrites.push_back(writeDescriptorSet);
+  }
+  vkUpdateDescriptorSets(device, descriptorSetWrites.size(),
+                         descriptorSetWrites.data(), 0, nullptr);
+
+  char *data = nullptr;
+  error = vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0,
+                      reinterpret_cast<void **>(&data));
+  if (error) {
+    return error;
+  }
+  float *inputData = reinterpret_cast<float *>(data + bufferOffsets[0]);
+  float *resultData = reinterpret_cast<float *>(data + bufferOffsets[1]);
+  for (uint32_t index = 0; index < inputElements; index++) {
+    inputData[index] = (float)(index % 97) - 48.0f;
+  }
+  for (uint32_t index = 0; index < resultElements; index++) {
+    resultData[index] = 42.0f;
+  }
+
+  VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+  commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+  commandPoolCreateInfo.queueFamilyIndex = queueFamilyIndex;
+  VkCommandPool commandPool = VK_NULL_HANDLE;
+  error = vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr,
+                              &commandPool);
+  if (error) {
+    return error;
+  }
+
+  VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
+  commandBufferAllocateInfo.sType =
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  commandBufferAllocateInfo.commandPool = commandPool;
+  commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  commandBufferAllocateInfo.commandBufferCount = 1;
+  VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+  error = vkAllocateCommandBuffers(device, &commandBufferAllocateInfo,
+                                   &commandBuffer);
+  if (error) {
+    return error;
+  }
+
+  VkCommandBufferBeginInfo beginInfo = {};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  error = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+  if (error) {
+    return error;
+  }
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                          pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+  // every job writes its own range of the result buffer and only reads the
+  // inputs so no barriers are required between them
+  for (uint32_t job = 0; job < jobCount; job++) {
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                      pipelines[contiguous[job] ? 1 : 0][jobs[job].op]);
+    vkCmdPushConstants(commandBuffer, pipelineLayout,
+                       VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                       sizeof(ElementwiseParams), &params[job]);
+    vkCmdDispatch(commandBuffer, (params[job].count + 63) / 64, 1, 1);
+  }
+  error = vkEndCommandBuffer(commandBuffer);
+  if (error) {
+    return error;
+  }
+
+  VkSubmitInfo submitInfo = {};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &commandBuffer;
+  error = vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+  if (error) {
+    return error;
+  }
+  vkQueueWaitIdle(queue);
+
+  // compute what each job should have produced with plain loops
+  std::vector<float> expected(resultElements);
+  const float *m = inputData + matrix.offset;
+  const float *r = inputData + row.offset;
+  const float *t = inputData + transposed.offset;  // columns x rows
+  const float *v = inputData + vector.offset;
+  for (uint32_t y = 0; y < rows; y++) {
+    for (uint32_t x = 0; x < columns; x++) {
+      const uint32_t i = y * columns + x;
+      const float mv = m[i];
+      expected[i] = mv + r[x];
+      expected[matrixElements + i] = mv - t[x * rows + y];
+      expected[2 * matrixElements + vectorLength + i] = mv;
+      expected[3 * matrixElements + vectorLength + i] = mv * v[y];
+    }
+  }
+  for (uint32_t i = 0; i < vectorLength; i++) {
+    expected[2 * matrixElements + i] = v[i] * 2.5f;
+  }
+
+  int failures = 0;
+  for (uint32_t index = 0; index < resultElements; index++) {
+    if (resultData[index] != expected[index]) {
+      fprintf(stderr, "result[%u] is '%f' not '%f'!\n", index,
+              resultData[index], expected[index]);
+      failures++;
+    }
+  }
+  vkUnmapMemory(device, memory);
+
+  vkDestroyCommandPool(device, commandPool, nullptr);
+  vkFreeMemory(device, memory, nullptr);
+  for (auto buffer : buffers) {
+    vkDestroyBuffer(device, buffer, nullptr);
+  }
+  vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+  for (auto &variant : pipelines) {
+    for (auto pipeline : variant) {
+      vkDestroyPipeline(device, pipeline, nullptr);
+    }
+  }
+  vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+  vkDestroyDescriptorSetLayout(device, setLayout, nullptr);
+  vkDestroyDevice(device, nullptr);
+  vkDestroyInstance(instance, nullptr);
+
+  if (failures) {
+    return 1;
+  }
+  printf("success\n");
+
+  return 0;
+}
@@ -0,0 +1,414 @@
+#include <vulkan/vulkan.h>
+
+#include <cassert>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// load a SPIR-V binary from disc
+std::vector<char> loadShaderCode(const char *filename) {
+  std::vector<char> shaderCode;
+  if (FILE *fp = fopen(filename, "rb")) {
+    char buf[1024];
+    while (size_t len = fread(buf, 1, sizeof(buf), fp)) {
+      shaderCode.insert(shaderCode.end(), buf, buf + len);
+    }
+    fclose(fp);
+  }
+  return shaderCode;
+}
+
+// search for compatible memory properties and return the memory type index
+int32_t findMemoryTypeFromProperties(
+    uint32_t memoryTypeBits, VkPhysicalDeviceMemoryProperties properties,
+    VkMemoryPropertyFlags requiredProperties) {
+  assert(properties.memoryTypeCount < 32u);
+  for (uint32_t index = 0; index < properties.memoryTypeCount; ++index) {
+    if (memoryTypeBits & (1u << index) &&
+        // Find the first memory type that supports all the required flags.
+        ((properties.memoryTypes[index].propertyFlags & requiredProperties) ==
+         requiredProperties)) {
+      return (int32_t)index;
+    }
+  }
+  return -1;
+}
+
+// create a compute pipeline from a SPIR-V binary found in SHADER_PATH
+VkResult createComputePipeline(VkDevice device, VkPipelineLayout layout,
+                               const char *filename, VkPipeline *pipeline) {
+  auto shaderCode =
+      loadShaderCode((std::string(SHADER_PATH) + filename).c_str());
+  if (shaderCode.empty()) {
+    fprintf(stderr, "failed to load '%s'\n", filename);
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
+  shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  shaderModuleCreateInfo.pCode =
+      reinterpret_cast<uint32_t *>(shaderCode.data());
+  shaderModuleCreateInfo.codeSize = shaderCode.size();
+  VkShaderModule shaderModule = VK_NULL_HANDLE;
+  VkResult error = vkCreateShaderModule(device, &shaderModuleCreateInfo,
+                                        nullptr, &shaderModule);
+  if (error) {
+    return error;
+  }
+  VkComputePipelineCreateInfo pipelineCreateInfo = {};
+  pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineCreateInfo.stage.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipelineCreateInfo.stage.module = shaderModule;
+  pipelineCreateInfo.stage.pName = "main";
+  pipelineCreateInfo.layout = layout;
+  error = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1,
+                                   &pipelineCreateInfo, nullptr, pipeline);
+  vkDestroyShaderModule(device, shaderModule, nullptr);
+  return error;
+}
+
+// mirrors the push constant block of the vector_add_address shaders, this is
+// everything the device needs to know about a job
+struct AddressJob {
+  VkDeviceAddress a;
+  VkDeviceAddress b;
+  VkDeviceAddress result;
+  uint32_t count;
+  uint32_t padding;
+};
+
+// both shaders use a local size of 64
+const uint32_t localSize = 64;
+
+// record a single job, choosing the ivec4 variant when every address is
+// suitably aligned, no descriptor set is touched
+void recordAddressJob(VkCommandBuffer commandBuffer,
+                      VkPipelineLayout pipelineLayout, VkPipeline pipeline,
+                      VkPipeline pipelineVec4, const AddressJob &job) {
+  const bool aligned = ((job.a | job.b | job.result) & 15) == 0;
+  uint32_t invocations = aligned ? (job.count + 3) / 4 : job.count;
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                    aligned ? pipelineVec4 : pipeline);
+  vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT,
+                     0, sizeof(AddressJob), &job);
+  vkCmdDispatch(commandBuffer, (invocations + localSize - 1) / localSize, 1,
+                1);
+}
+
+int main() {
+  VkApplicationInfo applicationInfo = {};
+  applicationInfo.pApplicationName = "Vulkan buffer device address example";
+  // buffer device address is core in Vulkan 1.2
+  applicationInfo.apiVersion = VK_API_VERSION_1_2;
+
+  VkInstanceCreateInfo instanceCreateInfo = {};
+  instanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+  instanceCreateInfo.pApplicationInfo = &applicationInfo;
+#ifdef ENABLE_LAYERS
+  // without a debug report callback, see vector_add, the validation layer
+  // prints its messages to stdout
+  std::vector<const char *> enabledLayerNames{"VK_LAYER_KHRONOS_validation"};
+  instanceCreateInfo.enabledLayerCount = enabledLayerNames.size();
+  instanceCreateInfo.ppEnabledLayerNames = enabledLayerNames.data();
+#endif
+
+  VkInstance instance = VK_NULL_HANDLE;
+  VkResult error = vkCreateInstance(&instanceCreateInfo, nullptr, &instance);
+  if (error) {
+    return error;
+  }
+
+  uint32_t count;
+  error = vkEnumeratePhysicalDevices(instance, &count, nullptr);
+  if (error) {
+    return error;
+  }
+  std::vector<VkPhysicalDevice> physicalDevices(count);
+  error = vkEnumeratePhysicalDevices(instance, &count, physicalDevices.data());
+  if (error) {
+    return error;
+  }
+
+  // find a Vulkan 1.2 physical device with a compute queue which supports
+  // shaders accessing buffers through their device address
+  VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+  uint32_t queueFamilyIndex = 0;
+  for (auto device : physicalDevices) {
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(device, &properties);
+    if (properties.apiVersion < VK_API_VERSION_1_2) {
+      continue;
+    }
+    VkPhysicalDeviceBufferDeviceAddressFeatures addressFeatures = {};
+    addressFeatures.sType =
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES;
+    VkPhysicalDeviceFeatures2 features = {};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &addressFeatures;
+    vkGetPhysicalDeviceFeatures2(device, &features);
+    if (!addressFeatures.bufferDeviceAddress) {
+      continue;
+    }
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilyProperties(count);
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count,
+                                             queueFamilyProperties.data());
+    for (uint32_t index = 0; index < count; index++) {
+      if (queueFamilyProperties[index].queueFlags & VK_QUEUE_COMPUTE_BIT) {
+        physicalDevice = device;
+        queueFamilyIndex = index;
+        break;
+      }
+    }
+    if (physicalDevice) {
+      break;
+    }
+  }
+  if (!physicalDevice) {
+    fprintf(stderr, "no device supports bufferDeviceAddress\n");
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+  }
+
+  VkDeviceQueueCreateInfo queueCreateInfo = {};
+  queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+  queueCreateInfo.queueCount = 1;
+  queueCreateInfo.queueFamilyIndex = queueFamilyIndex;
+  float queuePriority = 1.0f;
+  queueCreateInfo.pQueuePriorities = &queuePriority;
+
+  // the feature must be explicitly enabled by chaining its structure into the
+  // device create info
+  VkPhysicalDeviceBufferDeviceAddressFeatures addressFeatures = {};
+  addressFeatures.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES;
+  addressFeatures.bufferDeviceAddress = VK_TRUE;
+
+  VkDeviceCreateInfo deviceCreateInfo = {};
+  deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+  deviceCreateInfo.pNext = &addressFeatures;
+  deviceCreateInfo.queueCreateInfoCount = 1;
+  deviceCreateInfo.pQueueCreateInfos = &queueCreateInfo;
+  VkDevice device = VK_NULL_HANDLE;
+  error = vkCreateDevice(physicalDevice, &deviceCreateInfo, nullptr, &device);
+  if (error) {
+    return error;
+  }
+
+  VkQueue queue;
+  vkGetDeviceQueue(device, queueFamilyIndex, 0, &queue);
+
+  // there are no descriptor set layouts at all, the only thing the pipeline
+  // layout describes is the push constant range holding the addresses
+  VkPushConstantRange pushConstantRange = {};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(AddressJob);
+
+  VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+  pipelineLayoutCreateInfo.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+  pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+  VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+  error = vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr,
+                                 &pipelineLayout);
+  if (error) {
+    return error;
+  }
+
+  VkPipeline pipeline = VK_NULL_HANDLE;
+  error = createComputePipeline(device, pipelineLayout,
+                                "vector_add_address.spv", &pipeline);
+  if (error) {
+    return error;
+  }
+  VkPipeline pipelineVec4 = VK_NULL_HANDLE;
+  error = createComputePipeline(device, pipelineLayout,
+                                "vector_add_address_vec4.spv", &pipelineVec4);
+  if (error) {
+    return error;
+  }
+
+  // the buffers must be created with the shader device address usage to be
+  // able to query their address
+  const uint32_t elements = 4096;
+  VkBufferCreateInfo bufferCreateInfo = {};
+  bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  bufferCreateInfo.size = sizeof(int32_t) * elements;
+  bufferCreateInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                           VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+  bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  bufferCreateInfo.queueFamilyIndexCount = 1;
+  bufferCreateInfo.pQueueFamilyIndices = &queueFamilyIndex;
+  VkBuffer buffers[3];  // A, B and result
+  for (auto &buffer : buffers) {
+    error = vkCreateBuffer(device, &bufferCreateInfo, nullptr, &buffer);
+    if (error) {
+      return error;
+    }
+  }
+
+  // sub-allocate a single block of memory for all three buffers, this time
+  // respecting the alignment requirements of each buffer
+  VkDeviceSize bufferOffsets[3];
+  VkDeviceSize requiredMemorySize = 0;
+  VkMemoryRequirements memoryRequirements;
+  for (uint32_t index = 0; index < 3; index++) {
+    vkGetBufferMemoryRequirements(device, buffers[index], &memoryRequirements);
+    const VkDeviceSize alignment = memoryRequirements.alignment;
+    requiredMemorySize =
+        (requiredMemorySize + alignment - 1) / alignment * alignment;
+    bufferOffsets[index] = requiredMemorySize;
+    requiredMemorySize += memoryRequirements.size;
+  }
+
+  VkPhysicalDeviceMemoryProperties memoryProperties;
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+  auto memoryTypeIndex = findMemoryTypeFromProperties(
+      memoryRequirements.memoryTypeBits, memoryProperties,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  if (0 > memoryTypeIndex) {
+    return ~42;  // returns -43
+  }
+
+  // memory backing a buffer whose address is queried must be allocated with
+  // the device address flag
+  VkMemoryAllocateFlagsInfo allocateFlagsInfo = {};
+  allocateFlagsInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
+  allocateFlagsInfo.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT;
+
+  VkMemoryAllocateInfo allocateInfo = {};
+  allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocateInfo.pNext = &allocateFlagsInfo;
+  allocateInfo.allocationSize = requiredMemorySize;
+  allocateInfo.memoryTypeIndex = memoryTypeIndex;
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  error = vkAllocateMemory(device, &allocateInfo, nullptr, &memory);
+  if (error) {
+    return error;
+  }
+
+  VkDeviceAddress addresses[3];
+  for (uint32_t index = 0; index < 3; index++) {
+    error = vkBindBufferMemory(device, buffers[index], memory,
+                               bufferOffsets[index]);
+    if (error) {
+      return error;
+    }
+    // once bound the address of a buffer is fixed for its lifetime
+    VkBufferDeviceAddressInfo addressInfo = {};
+    addressInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+    addressInfo.buffer = buffers[index];
+    addresses[index] = vkGetBufferDeviceAddress(device, &addressInfo);
+  }
+
+  // write the input data, as in vector_add the result should be all zeros
+  char *data = nullptr;
+  error = vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0,
+                      reinterpret_cast<void **>(&data));
+  if (error) {
+    return error;
+  }
+  int32_t *aData = reinterpret_cast<int32_t *>(data + bufferOffsets[0]);
+  int32_t *bData = reinterpret_cast<int32_t *>(data + bufferOffsets[1]);
+  int32_t *resultData = reinterpret_cast<int32_t *>(data + bufferOffsets[2]);
+  for (uint32_t index = 0; index < elements; index++) {
+    aData[index] = index;
+    bData[index] = -index;
+    resultData[index] = 42;
+  }
+
+  VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+  commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+  commandPoolCreateInfo.queueFamilyIndex = queueFamilyIndex;
+  VkCommandPool commandPool = VK_NULL_HANDLE;
+  error = vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr,
+                              &commandPool);
+  if (error) {
+    return error;
+  }
+
+  VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
+  commandBufferAllocateInfo.sType =
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  commandBufferAllocateInfo.commandPool = commandPool;
+  commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  commandBufferAllocateInfo.commandBufferCount = 1;
+  VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+  error = vkAllocateCommandBuffers(device, &commandBufferAllocateInfo,
+                                   &commandBuffer);
+  if (error) {
+    return error;
+  }
+
+  VkCommandBufferBeginInfo beginInfo = {};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  error = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+  if (error) {
+    return error;
+  }
+
+  // split the vectors into jobs at arbitrary element offsets, targeting a
+  // different range is nothing more than adding a byte offset to each
+  // address, the first two jobs start on a 16 byte boundary and take the
+  // ivec4 path while the last one starts at an odd element and does not
+  const uint32_t jobRanges[][2] = {{0, 1000}, {1000, 3}, {1003, 3093}};
+  for (auto &range : jobRanges) {
+    const VkDeviceSize byteOffset = sizeof(int32_t) * range[0];
+    AddressJob job = {};
+    job.a = addresses[0] + byteOffset;
+    job.b = addresses[1] + byteOffset;
+    job.result = addresses[2] + byteOffset;
+    job.count = range[1];
+    recordAddressJob(commandBuffer, pipelineLayout, pipeline, pipelineVec4,
+                     job);
+  }
+
+  error = vkEndCommandBuffer(commandBuffer);
+  if (error) {
+    return error;
+  }
+
+  VkSubmitInfo submitInfo = {};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &commandBuffer;
+  error = vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+  if (error) {
+    return error;
+  }
+  vkQueueWaitIdle(queue);
+
+  // the memory is coherent and stayed mapped so we can read back directly
+  int failures = 0;
+  for (uint32_t index = 0; index < elements; index++) {
+    if (resultData[index] != aData[index] + bData[index]) {
+      fprintf(stderr, "result[%u] is '%d' not '%d'!\n", index,
+              resultData[index], aData[index] + bData[index]);
+      failures++;
+    }
+  }
+  vkUnmapMemory(device, memory);
+
+  vkDestroyCommandPool(device, commandPool, nullptr);
+  vkFreeMemory(device, memory, nullptr);
+  for (auto buffer : buffers) {
+    vkDestroyBuffer(device, buffer, nullptr);
+  }
+  vkDestroyPipeline(device, pipelineVec4, nullptr);
+  vkDestroyPipeline(device, pipeline, nullptr);
+  vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+  vkDestroyDevice(device, nullptr);
+  vkDestroyInstance(instance, nullptr);
+
+  if (failures) {
+    return 1;
+  }
+  printf("success\n");
+
+  return 0;
+}
@@ -0,0 +1,788 @@
+#include <vulkan/vulkan.h>
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+// load a SPIR-V binary from disc
+std::vector<char> loadShaderCode(const char *filename) {
+  std::vector<char> shaderCode;
+  if (FILE *fp = fopen(filename, "rb")) {
+    char buf[1024];
+    while (size_t len = fread(buf, 1, sizeof(buf), fp)) {
+      shaderCode.insert(shaderCode.end(), buf, buf + len);
+    }
+    fclose(fp);
+  }
+  return shaderCode;
+}
+
+// search for compatible memory properties and return the memory type index
+int32_t findMemoryTypeFromProperties(
+    uint32_t memoryTypeBits, VkPhysicalDeviceMemoryProperties properties,
+    VkMemoryPropertyFlags requiredProperties) {
+  assert(properties.memoryTypeCount < 32u);
+  for (uint32_t index = 0; index < properties.memoryTypeCount; ++index) {
+    if (memoryTypeBits & (1u << index) &&
+        // Find the first memory type that supports all the required flags.
+        ((properties.memoryTypes[index].propertyFlags & requiredProperties) ==
+         requiredProperties)) {
+      return (int32_t)index;
+    }
+  }
+  return -1;
+}
+
+// create a compute pipeline from a SPIR-V binary found in SHADER_PATH
+VkResult createComputePipeline(VkDevice device, VkPipelineLayout layout,
+                               const char *filename,
+                               const VkSpecializationInfo *specializationInfo,
+                               VkPipeline *pipeline) {
+  auto shaderCode =
+      loadShaderCode((std::string(SHADER_PATH) + filename).c_str());
+  if (shaderCode.empty()) {
+    fprintf(stderr, "failed to load '%s'\n", filename);
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
+  shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  shaderModuleCreateInfo.pCode =
+      reinterpret_cast<uint32_t *>(shaderCode.data());
+  shaderModuleCreateInfo.codeSize = shaderCode.size();
+  VkShaderModule shaderModule = VK_NULL_HANDLE;
+  VkResult error = vkCreateShaderModule(device, &shaderModuleCreateInfo,
+                                        nullptr, &shaderModule);
+  if (error) {
+    return error;
+  }
+  VkComputePipelineCreateInfo pipelineCreateInfo = {};
+  pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineCreateInfo.stage.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipelineCreateInfo.stage.module = shaderModule;
+  pipelineCreateInfo.stage.pName = "main";
+  pipelineCreateInfo.stage.pSpecializationInfo = specializationInfo;
+  pipelineCreateInfo.layout = layout;
+  error = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1,
+                                   &pipelineCreateInfo, nullptr, pipeline);
+  vkDestroyShaderModule(device, shaderModule, nullptr);
+  return error;
+}
+
+// the bytes of the range each invocation of level 0 reads, see checksum.comp
+const uint32_t segmentBytes = 256;
+// the reflected Castagnoli polynomial
+const uint32_t polynomial = 0x82f63b78;
+// the result index of levels before the last
+const uint32_t none = 0xffffffff;
+
+// the layout of the tables binding of checksum.comp
+struct Tables {
+  uint32_t byteTables[4][256];
+  uint32_t powers[64];
+};
+
+struct PushConstants {
+  uint32_t offset;
+  uint32_t size;
+  uint32_t span;
+  uint32_t level;
+  uint32_t inOffset;
+  uint32_t outOffset;
+  uint32_t groupOffset;
+  uint32_t resultIndex;
+};
+
+struct Checksum {
+  VkDescriptorSetLayout setLayout;
+  VkPipelineLayout pipelineLayout;
+  VkPipeline pipeline;
+  uint32_t maxGroupCount;
+};
+
+uint32_t divideRoundUp(uint32_t value, uint32_t divisor) {
+  return (value + divisor - 1) / divisor;
+}
+
+// the product of a and b modulo the polynomial, in the reflected bit order
+// where the most significant bit is 1
+uint32_t multiply(uint32_t a, uint32_t b) {
+  uint32_t product = 0;
+  for (uint32_t bit = 0x80000000; bit; bit >>= 1) {
+    if (a & bit) {
+      product ^= b;
+    }
+    b = b & 1 ? (b >> 1) ^ polynomial : b >> 1;
+  }
+  return product;
+}
+
+Tables createTables() {
+  Tables tables;
+  for (uint32_t byte = 0; byte < 256; byte++) {
+    uint32_t crc = byte;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = crc & 1 ? (crc >> 1) ^ polynomial : crc >> 1;
+    }
+    tables.byteTables[0][byte] = crc;
+  }
+  for (uint32_t slice = 1; slice < 4; slice++) {
+    for (uint32_t byte = 0; byte < 256; byte++) {
+      const uint32_t crc = tables.byteTables[slice - 1][byte];
+      tables.byteTables[slice][byte] =
+          (crc >> 8) ^ tables.byteTables[0][crc & 0xff];
+    }
+  }
+  // x, then each power squared
+  tables.powers[0] = 0x40000000;
+  for (uint32_t k = 1; k < 64; k++) {
+    tables.powers[k] = multiply(tables.powers[k - 1], tables.powers[k - 1]);
+  }
+  return tables;
+}
+
+// the CRC32C of size bytes on the host
+uint32_t crc32c(const Tables &tables, const uint8_t *bytes, size_t size) {
+  uint32_t crc = 0xffffffff;
+  for (size_t index = 0; index < size; index++) {
+    crc = tables.byteTables[0][(crc ^ bytes[index]) & 0xff] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+// the number of CRCs each level writes to the partials binding, for a range
+// of size bytes
+std::vector<uint32_t> levelGroupCounts(uint32_t size) {
+  std::vector<uint32_t> groupCounts;
+  uint32_t elements = std::max(divideRoundUp(size, segmentBytes), 1u);
+  do {
+    elements = divideRoundUp(elements, 256);
+    groupCounts.push_back(elements);
+  } while (elements > 1);
+  return groupCounts;
+}
+
+// record the levels computing the CRC32C of size bytes of the data binding
+// from offset, which must be a multiple of 4, into checksums[resultIndex],
+// the levels use the partials binding so checksums recorded one after
+// another need a barrier between them
+void recordChecksum(VkCommandBuffer commandBuffer, const Checksum &checksum,
+                    VkDescriptorSet descriptorSet, uint32_t offset,
+                    uint32_t size, uint32_t resultIndex) {
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                    checksum.pipeline);
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                          checksum.pipelineLayout, 0, 1, &descriptorSet, 0,
+                          nullptr);
+  const std::vector<uint32_t> groupCounts = levelGroupCounts(size);
+  PushConstants pushConstants = {};
+  pushConstants.offset = offset;
+  pushConstants.size = size;
+  pushConstants.span = segmentBytes;
+  for (uint32_t level = 0; level < groupCounts.size(); level++) {
+    if (level) {
+      VkMemoryBarrier memoryBarrier = {};
+      memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+      memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+      memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+      vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                           VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1,
+                           &memoryBarrier, 0, nullptr, 0, nullptr);
+      pushConstants.span *= 256;
+      pushConstants.inOffset = pushConstants.outOffset;
+      pushConstants.outOffset += groupCounts[level - 1];
+    }
+    pushConstants.level = level;
+    pushConstants.resultIndex =
+        level + 1 == groupCounts.size() ? resultIndex : none;
+    for (pushConstants.groupOffset = 0;
+         pushConstants.groupOffset < groupCounts[level];
+         pushConstants.groupOffset += checksum.maxGroupCount) {
+      vkCmdPushConstants(commandBuffer, checksum.pipelineLayout,
+                         VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                         sizeof(PushConstants), &pushConstants);
+      vkCmdDispatch(commandBuffer,
+                    std::min(groupCounts[level] - pushConstants.groupOffset,
+                             checksum.maxGroupCount),
+                    1, 1);
+    }
+  }
+}
+
+uint32_t nextRandom(uint32_t &seed) {
+  seed = seed * 1664525u + 1013904223u;
+  return seed >> 8;
+}
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+// create the buffers with usage and bind them to a single allocation of a
+// memory type with the properties which every buffer supports
+VkResult createBuffers(VkDevice device,
+                       const VkPhysicalDeviceMemoryProperties &properties,
+                       VkMemoryPropertyFlags memoryPropertyFlags,
+                       const std::vector<VkDeviceSize> &sizes,
+                       VkBufferUsageFlags usage, uint32_t queueFamilyIndex,
+                       std::vector<VkBuffer> &buffers, VkDeviceMemory *memory,
+                       std::vector<VkDeviceSize> &offsets) {
+  VkDeviceSize requiredMemorySize = 0;
+  uint32_t memoryTypeBits = ~0u;
+  for (VkDeviceSize size : sizes) {
+    VkBufferCreateInfo bufferCreateInfo = {};
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.size = size;
+    bufferCreateInfo.usage = usage;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    bufferCreateInfo.queueFamilyIndexCount = 1;
+    bufferCreateInfo.pQueueFamilyIndices = &queueFamilyIndex;
+    VkBuffer buffer;
+    VkResult error =
+        vkCreateBuffer(device, &bufferCreateInfo, nullptr, &buffer);
+    if (error) {
+      return error;
+    }
+    buffers.push_back(buffer);
+    VkMemoryRequirements memoryRequirements;
+    vkGetBufferMemoryRequirements(device, buffer, &memoryRequirements);
+    memoryTypeBits &= memoryRequirements.memoryTypeBits;
+    const VkDeviceSize alignment = memoryRequirements.alignment;
+    requiredMemorySize =
+        (requiredMemorySize + alignment - 1) / alignment * alignment;
+    offsets.push_back(requiredMemorySize);
+    requiredMemorySize += memoryRequirements.size;
+  }
+
+  // falling back to another memory type could give memory the caller cannot
+  // map, or must flush, so fail instead
+  auto memoryTypeIndex = findMemoryTypeFromProperties(
+      memoryTypeBits, properties, memoryPropertyFlags);
+  if (0 > memoryTypeIndex) {
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+  }
+  VkMemoryAllocateInfo allocateInfo = {};
+  allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocateInfo.allocationSize = requiredMemorySize;
+  allocateInfo.memoryTypeIndex = memoryTypeIndex;
+  VkResult error = vkAllocateMemory(device, &allocateInfo, nullptr, memory);
+  if (error) {
+    return error;
+  }
+  for (size_t index = 0; index < buffers.size(); index++) {
+    error = vkBindBufferMemory(device, buffers[index], *memory,
+                               offsets[index]);
+    if (error) {
+      return error;
+    }
+  }
+  return VK_SUCCESS;
+}
+int main() {
+  VkApplicationInfo applicationInfo = {};
+  applicationInfo.pApplicationName = "Vulkan checksum example";
+  applicationInfo.apiVersion = VK_MAKE_VERSION(1, 0, 0);
+
+  VkInstanceCreateInfo instanceCreateInfo = {};
+  instanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+  instanceCreateInfo.pApplicationInfo = &applicationInfo;
+#ifdef ENABLE_LAYERS
+  // without a debug report callback, see vector_add, the validation layer
+  // prints its messages to stdout
+  std::vector<const char *> enabledLayerNames{"VK_LAYER_KHRONOS_validation"};
+  instanceCreateInfo.enabledLayerCount = enabledLayerNames.size();
+  instanceCreateInfo.ppEnabledLayerNames = enabledLayerNames.data();
+#endif
+
+  VkInstance instance = VK_NULL_HANDLE;
+  VkResult error = vkCreateInstance(&instanceCreateInfo, nullptr, &instance);
+  if (error) {
+    return error;
+  }
+
+  uint32_t count;
+  error = vkEnumeratePhysicalDevices(instance, &count, nullptr);
+  if (error) {
+    return error;
+  }
+  std::vector<VkPhysicalDevice> physicalDevices(count);
+  error = vkEnumeratePhysicalDevices(instance, &count, physicalDevices.data());
+  if (error) {
+    return error;
+  }
+
+  // find the first physical device with a compute queue
+  VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+  uint32_t queueFamilyIndex = 0;
+  uint32_t timestampValidBits = 0;
+  for (auto device : physicalDevices) {
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilyProperties(count);
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count,
+                                             queueFamilyProperties.data());
+    for (uint32_t index = 0; index < count; index++) {
+      if (queueFamilyProperties[index].queueFlags & VK_QUEUE_COMPUTE_BIT) {
+        physicalDevice = device;
+        queueFamilyIndex = index;
+        timestampValidBits = queueFamilyProperties[index].timestampValidBits;
+        break;
+      }
+    }
+    if (physicalDevice) {
+      break;
+    }
+  }
+  if (!physicalDevice) {
+    fprintf(stderr, "no device with a compute queue\n");
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+  }
+
+  VkPhysicalDeviceProperties physicalDeviceProperties;
+  vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties);
+  const VkPhysicalDeviceLimits &limits = physicalDeviceProperties.limits;
+
+  VkDeviceQueueCreateInfo queueCreateInfo = {};
+  queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+  queueCreateInfo.queueCount = 1;
+  queueCreateInfo.queueFamilyIndex = queueFamilyIndex;
+  float queuePriority = 1.0f;
+  queueCreateInfo.pQueuePriorities = &queuePriority;
+
+  VkDeviceCreateInfo deviceCreateInfo = {};
+  deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+  deviceCreateInfo.queueCreateInfoCount = 1;
+  deviceCreateInfo.pQueueCreateInfos = &queueCreateInfo;
+  VkDevice device = VK_NULL_HANDLE;
+  error = vkCreateDevice(physicalDevice, &deviceCreateInfo, nullptr, &device);
+  if (error) {
+    return error;
+  }
+
+  VkQueue queue;
+  vkGetDeviceQueue(device, queueFamilyIndex, 0, &queue);
+
+  Checksum checksum = {};
+  checksum.maxGroupCount = limits.maxComputeWorkGroupCount[0];
+
+  // the tables, the data, the partial CRCs and the checksums
+  std::vector<VkDescriptorSetLayoutBinding> layoutBindings;
+  VkDescriptorSetLayoutBinding layoutBinding = {};
+  layoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  layoutBinding.descriptorCount = 1;
+  layoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  for (uint32_t binding = 0; binding < 4; binding++) {
+    layoutBinding.binding = binding;
+    layoutBindings.push_back(layoutBinding);
+  }
+
+  VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo = {};
+  setLayoutCreateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  setLayoutCreateInfo.bindingCount = layoutBindings.size();
+  setLayoutCreateInfo.pBindings = layoutBindings.data();
+  error = vkCreateDescriptorSetLayout(device, &setLayoutCreateInfo, nullptr,
+                                      &checksum.setLayout);
+  if (error) {
+    return error;
+  }
+
+  VkPushConstantRange pushConstantRange = {};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(PushConstants);
+
+  VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+  pipelineLayoutCreateInfo.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutCreateInfo.setLayoutCount = 1;
+  pipelineLayoutCreateInfo.pSetLayouts = &checksum.setLayout;
+  pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+  pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+  error = vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr,
+                                 &checksum.pipelineLayout);
+  if (error) {
+    return error;
+  }
+  error = createComputePipeline(device, checksum.pipelineLayout,
+                                "checksum.spv", nullptr, &checksum.pipeline);
+  if (error) {
+    return error;
+  }
+
+  // 64MB of data which starts with the standard check string, whose
+  // CRC32C is 0xe3069283
+  const uint32_t dataSize = 1 << 26;
+  std::vector<uint32_t> data(dataSize / sizeof(uint32_t));
+  uint32_t seed = 42;
+  for (auto &word : data) {
+    word = nextRandom(seed) ^ nextRandom(seed) << 24;
+  }
+  const char checkString[] = "123456789";
+  memcpy(data.data(), checkString, strlen(checkString));
+  const uint8_t *dataBytes = reinterpret_cast<uint8_t *>(data.data());
+
+  // the checksums computed on the device, the ranges are the whole buffer,
+  // an unaligned length at an offset, the check string, and the whole
+  // buffer again after a word of it is corrupted
+  enum { WHOLE, RANGE, CHECK, CORRUPTED, CHECKSUM_COUNT };
+  const uint32_t rangeOffsets[CHECKSUM_COUNT] = {0, 4100, 0, 0};
+  const uint32_t rangeSizes[CHECKSUM_COUNT] = {
+      dataSize, 1000003, (uint32_t)strlen(checkString), dataSize};
+  const uint32_t corruptedWord = 1 << 18;
+
+  const Tables tables = createTables();
+  auto start = std::chrono::steady_clock::now();
+  uint32_t expected[CHECKSUM_COUNT];
+  for (uint32_t index = 0; index < CORRUPTED; index++) {
+    expected[index] = crc32c(tables, dataBytes + rangeOffsets[index],
+                             rangeSizes[index]);
+  }
+  const double hostMilliseconds = millisecondsSince(start);
+  std::vector<uint32_t> corrupted(data);
+  corrupted[corruptedWord] ^= 1;
+  expected[CORRUPTED] = crc32c(
+      tables, reinterpret_cast<uint8_t *>(corrupted.data()), dataSize);
+  if (expected[CHECK] != 0xe3069283) {
+    fprintf(stderr, "host CRC32C of the check string is '%08x'!\n",
+            expected[CHECK]);
+    return 1;
+  }
+
+  VkPhysicalDeviceMemoryProperties memoryProperties;
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+  const VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                   VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+                                   VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+  // the data is uploaded to device local memory, checked there and only the
+  // checksums are written to host visible memory, the read back buffer is
+  // only used to compare with reading the whole of the data back
+  enum { UPLOAD, READ_BACK, TABLES, CHECKSUMS, HOST_BUFFER_COUNT };
+  std::vector<VkBuffer> hostBuffers;
+  std::vector<VkDeviceSize> hostOffsets;
+  VkDeviceMemory hostMemory = VK_NULL_HANDLE;
+  error = createBuffers(device, memoryProperties,
+                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                        {dataSize, dataSize, sizeof(Tables),
+                         sizeof(uint32_t) * CHECKSUM_COUNT},
+                        usage, queueFamilyIndex, hostBuffers, &hostMemory,
+                        hostOffsets);
+  if (error) {
+    return error;
+  }
+  const std::vector<uint32_t> groupCounts = levelGroupCounts(dataSize);
+  uint32_t partialCount = 0;
+  for (uint32_t groupCount : groupCounts) {
+    partialCount += groupCount;
+  }
+  enum { DATA, PARTIALS, DEVICE_BUFFER_COUNT };
+  std::vector<VkBuffer> deviceBuffers;
+  std::vector<VkDeviceSize> deviceOffsets;
+  VkDeviceMemory deviceMemory = VK_NULL_HANDLE;
+  error = createBuffers(device, memoryProperties,
+                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                        {dataSize, sizeof(uint32_t) * partialCount}, usage,
+                        queueFamilyIndex, deviceBuffers, &deviceMemory,
+                        deviceOffsets);
+  if (error) {
+    return error;
+  }
+
+  VkDescriptorPoolSize poolSize = {};
+  poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  poolSize.descriptorCount = 4;
+  VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = {};
+  descriptorPoolCreateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  descriptorPoolCreateInfo.maxSets = 1;
+  descriptorPoolCreateInfo.poolSizeCount = 1;
+  descriptorPoolCreateInfo.pPoolSizes = &poolSize;
+  VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+  error = vkCreateDescriptorPool(device, &descriptorPoolCreateInfo, nullptr,
+                                 &descriptorPool);
+  if (error) {
+    return error;
+  }
+
+  VkDescriptorSetAllocateInfo descriptorSetAllocateInfo = {};
+  descriptorSetAllocateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  descriptorSetAllocateInfo.descriptorPool = descriptorPool;
+  descriptorSetAllocateInfo.descriptorSetCount = 1;
+  descriptorSetAllocateInfo.pSetLayouts = &checksum.setLayout;
+  VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+  error = vkAllocateDescriptorSets(device, &descriptorSetAllocateInfo,
+                                   &descriptorSet);
+  if (error) {
+    return error;
+  }
+
+  const VkDescriptorBufferInfo bufferInfos[] = {
+      {hostBuffers[TABLES], 0, VK_WHOLE_SIZE},
+      {deviceBuffers[DATA], 0, VK_WHOLE_SIZE},
+      {deviceBuffers[PARTIALS], 0, VK_WHOLE_SIZE},
+      {hostBuffers[CHECKSUMS], 0, VK_WHOLE_SIZE}};
+  std::vector<VkWriteDescriptorSet> descriptorSetWrites;
+  VkWriteDescriptorSet writeDescriptorSet = {};
+  writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  writeDescriptorSet.dstSet = descriptorSet;
+  writeDescriptorSet.dstArrayElement = 0;
+  writeDescriptorSet.descriptorCount = 1;
+  writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  for (uint32_t binding = 0; binding < 4; binding++) {
+    writeDescriptorSet.dstBinding = binding;
+    writeDescriptorSet.pBufferInfo = &bufferInfos[binding];
+    descriptorSetWrites.push_back(writeDescriptorSet);
+  }
+  vkUpdateDescriptorSets(device, descriptorSetWrites.size(),
+                         descriptorSetWrites.data(), 0, nullptr);
+
+  char *mapped = nullptr;
+  error = vkMapMemory(device, hostMemory, 0, VK_WHOLE_SIZE, 0,
+                      reinterpret_cast<void **>(&mapped));
+  if (error) {
+    return error;
+  }
+  memcpy(mapped + hostOffsets[UPLOAD], data.data(), dataSize);
+  memcpy(mapped + hostOffsets[TABLES], &tables, sizeof(Tables));
+  const uint8_t *readBackData =
+      reinterpret_cast<uint8_t *>(mapped + hostOffsets[READ_BACK]);
+  uint32_t *checksumsData =
+      reinterpret_cast<uint32_t *>(mapped + hostOffsets[CHECKSUMS]);
+  memset(checksumsData, 0, sizeof(uint32_t) * CHECKSUM_COUNT);
+  VkQueryPool queryPool = VK_NULL_HANDLE;
+  if (timestampValidBits) {
+    VkQueryPoolCreateInfo queryPoolCreateInfo = {};
+    queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolCreateInfo.queryCount = 2;
+    error = vkCreateQueryPool(device, &queryPoolCreateInfo, nullptr,
+                              &queryPool);
+    if (error) {
+      return error;
+    }
+  }
+
+  VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+  commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+  commandPoolCreateInfo.queueFamilyIndex = queueFamilyIndex;
+  VkCommandPool commandPool = VK_NULL_HANDLE;
+  error = vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr,
+                              &commandPool);
+  if (error) {
+    return error;
+  }
+
+  VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
+  commandBufferAllocateInfo.sType =
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  commandBufferAllocateInfo.commandPool = commandPool;
+  commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  commandBufferAllocateInfo.commandBufferCount = 1;
+  VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+  error = vkAllocateCommandBuffers(device, &commandBufferAllocateInfo,
+                                   &commandBuffer);
+  if (error) {
+    return error;
+  }
+
+  // record the work of function into the command buffer, submit it, wait for
+  // it to complete and return the time between the timestamps in
+  // milliseconds, or 0 if timestamps are not supported
+  auto submit = [&](std::function<void()> function,
+                    double *milliseconds) -> VkResult {
+    VkResult result = vkResetCommandPool(device, commandPool, 0);
+    if (result) {
+      return result;
+    }
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    result = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    if (result) {
+      return result;
+    }
+    if (queryPool) {
+      vkCmdResetQueryPool(commandBuffer, queryPool, 0, 2);
+      vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                          queryPool, 0);
+    }
+    function();
+    if (queryPool) {
+      vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                          queryPool, 1);
+    }
+    result = vkEndCommandBuffer(commandBuffer);
+    if (result) {
+      return result;
+    }
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    result = vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+    if (result) {
+      return result;
+    }
+    vkQueueWaitIdle(queue);
+
+    *milliseconds = 0.0;
+    if (queryPool) {
+      uint64_t timestamps[2];
+      result = vkGetQueryPoolResults(
+          device, queryPool, 0, 2, sizeof(timestamps), timestamps,
+          sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+      if (result) {
+        return result;
+      }
+      *milliseconds =
+          (timestamps[1] - timestamps[0]) * limits.timestampPeriod * 1e-6;
+    }
+    return VK_SUCCESS;
+  };
+
+  auto recordComputeBarrier = [&] {
+    VkMemoryBarrier memoryBarrier = {};
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask =
+        VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    memoryBarrier.dstAccessMask =
+        VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT |
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1,
+                         &memoryBarrier, 0, nullptr, 0, nullptr);
+  };
+
+  double uploadMilliseconds;
+  error = submit(
+      [&] {
+        VkBufferCopy region = {0, 0, dataSize};
+        vkCmdCopyBuffer(commandBuffer, hostBuffers[UPLOAD],
+                        deviceBuffers[DATA], 1, &region);
+      },
+      &uploadMilliseconds);
+  if (error) {
+    return error;
+  }
+
+  // check the uploaded data on the device, reading back 4 bytes a checksum
+  double checksumMilliseconds;
+  error = submit(
+      [&] {
+        for (uint32_t index = 0; index < CORRUPTED; index++) {
+          if (index) {
+            recordComputeBarrier();
+          }
+          recordChecksum(commandBuffer, checksum, descriptorSet,
+                         rangeOffsets[index], rangeSizes[index], index);
+        }
+      },
+      &checksumMilliseconds);
+  if (error) {
+    return error;
+  }
+
+  // corrupt a single bit of the data on the device and check it again
+  double corruptedMilliseconds;
+  error = submit(
+      [&] {
+        vkCmdUpdateBuffer(commandBuffer, deviceBuffers[DATA],
+                          sizeof(uint32_t) * corruptedWord, sizeof(uint32_t),
+                          &corrupted[corruptedWord]);
+        recordComputeBarrier();
+        recordChecksum(commandBuffer, checksum, descriptorSet,
+                       rangeOffsets[CORRUPTED], rangeSizes[CORRUPTED],
+                       CORRUPTED);
+      },
+      &corruptedMilliseconds);
+  if (error) {
+    return error;
+  }
+
+  // reading the corrupted data back to compare it with the host instead
+  double readBackMilliseconds;
+  error = submit(
+      [&] {
+        VkBufferCopy region = {0, 0, dataSize};
+        vkCmdCopyBuffer(commandBuffer, deviceBuffers[DATA],
+                        hostBuffers[READ_BACK], 1, &region);
+      },
+      &readBackMilliseconds);
+  if (error) {
+    return error;
+  }
+  start = std::chrono::steady_clock::now();
+  const bool readBackMatches =
+      !memcmp(readBackData, corrupted.data(), dataSize);
+  const double compareMilliseconds = millisecondsSince(start);
+
+  printf("uploaded %u MB in %.3f ms\n\n", dataSize >> 20, uploadMilliseconds);
+  printf("%-22s %14s %10s %10s\n", "check", "read back B", "device ms",
+         "host ms");
+  printf("%-22s %14zu %10.3f %10.3f\n", "checksum 3 ranges",
+         sizeof(uint32_t) * CORRUPTED, checksumMilliseconds,
+         hostMilliseconds);
+  printf("%-22s %14zu %10.3f %10s\n", "checksum corrupted",
+         sizeof(uint32_t), corruptedMilliseconds, "");
+  printf("%-22s %14u %10.3f %10.3f\n", "read back and compare", dataSize,
+         readBackMilliseconds, compareMilliseconds);
+
+  const char *checksumNames[CHECKSUM_COUNT] = {"whole", "range", "check",
+                                               "corrupted"};
+  int failures = 0;
+  for (uint32_t index = 0; index < CHECKSUM_COUNT; index++) {
+    if (checksumsData[index] != expected[index]) {
+      fprintf(stderr, "%s checksum is '%08x' not '%08x'!\n",
+              checksumNames[index], checksumsData[index], expected[index]);
+      failures++;
+    }
+  }
+  if (checksumsData[CORRUPTED] == checksumsData[WHOLE]) {
+    fprintf(stderr, "the corrupted data was not detected!\n");
+    failures++;
+  }
+  if (!readBackMatches) {
+    fprintf(stderr, "the data read back does not match!\n");
+    failures++;
+  }
+  vkUnmapMemory(device, hostMemory);
+
+  if (queryPool) {
+    vkDestroyQueryPool(device, queryPool, nullptr);
+  }
+  vkDestroyCommandPool(device, commandPool, nullptr);
+  vkFreeMemory(device, hostMemory, nullptr);
+  vkFreeMemory(device, deviceMemory, nullptr);
+  for (auto buffer : hostBuffers) {
+    vkDestroyBuffer(device, buffer, nullptr);
+  }
+  for (auto buffer : deviceBuffers) {
+    vkDestroyBuffer(device, buffer, nullptr);
+  }
+  vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+  vkDestroyPipeline(device, checksum.pipeline, nullptr);
+  vkDestroyPipelineLayout(device, checksum.pipelineLayout, nullptr);
+  vkDestroyDescriptorSetLayout(device, checksum.setLayout, nullptr);
+  vkDestroyDevice(device, nullptr);
+  vkDestroyInstance(instance, nullptr);
+
+  if (failures) {
+    return 1;
+  }
+  printf("success\n");
+
+  return 0;
+}
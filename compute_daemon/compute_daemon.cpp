@@ -0,0 +1,946 @@
+#include <vulkan/vulkan.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// load a SPIR-V binary from disc
+std::vector<char> loadShaderCode(const char *filename) {
+  std::vector<char> shaderCode;
+  if (FILE *fp = fopen(filename, "rb")) {
+    char buf[1024];
+    while (size_t len = fread(buf, 1, sizeof(buf), fp)) {
+      shaderCode.insert(shaderCode.end(), buf, buf + len);
+    }
+    fclose(fp);
+  }
+  return shaderCode;
+}
+
+// search for compatible memory properties and return the memory type index
+int32_t findMemoryTypeFromProperties(
+    uint32_t memoryTypeBits, VkPhysicalDeviceMemoryProperties properties,
+    VkMemoryPropertyFlags requiredProperties) {
+  assert(properties.memoryTypeCount < 32u);
+  for (uint32_t index = 0; index < properties.memoryTypeCount; ++index) {
+    if (memoryTypeBits & (1u << index) &&
+        // Find the first memory type that supports all the required flags.
+        ((properties.memoryTypes[index].propertyFlags & requiredProperties) ==
+         requiredProperties)) {
+      return (int32_t)index;
+    }
+  }
+  return -1;
+}
+
+// create a compute pipeline from a SPIR-V binary found in SHADER_PATH
+VkResult createComputePipeline(VkDevice device, VkPipelineLayout layout,
+                               const char *filename,
+                               const VkSpecializationInfo *specializationInfo,
+                               VkPipeline *pipeline) {
+  auto shaderCode =
+      loadShaderCode((std::string(SHADER_PATH) + filename).c_str());
+  if (shaderCode.empty()) {
+    fprintf(stderr, "failed to load '%s'\n", filename);
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
+  shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  shaderModuleCreateInfo.pCode =
+      reinterpret_cast<uint32_t *>(shaderCode.data());
+  shaderModuleCreateInfo.codeSize = shaderCode.size();
+  VkShaderModule shaderModule = VK_NULL_HANDLE;
+  VkResult error = vkCreateShaderModule(device, &shaderModuleCreateInfo,
+                                        nullptr, &shaderModule);
+  if (error) {
+    return error;
+  }
+  VkComputePipelineCreateInfo pipelineCreateInfo = {};
+  pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineCreateInfo.stage.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipelineCreateInfo.stage.module = shaderModule;
+  pipelineCreateInfo.stage.pName = "main";
+  pipelineCreateInfo.stage.pSpecializationInfo = specializationInfo;
+  pipelineCreateInfo.layout = layout;
+  error = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1,
+                                   &pipelineCreateInfo, nullptr, pipeline);
+  vkDestroyShaderModule(device, shaderModule, nullptr);
+  return error;
+}
+
+// the alignment of the input and output regions of the shared memory file,
+// a multiple of the page size and of the alignment host pointers are
+// imported at on common devices
+const uint64_t regionAlignment = 1 << 16;
+
+// a request sent over the socket, a job passes its shared memory file as
+// an SCM_RIGHTS file descriptor holding a, b and the result at offsets
+enum RequestType : uint32_t { JOB, SHUTDOWN };
+struct Request {
+  RequestType type;
+  uint32_t count;
+  uint64_t offsets[3];
+  uint64_t size;
+};
+
+struct Reply {
+  int32_t result;
+  // whether the file was imported with VK_EXT_external_memory_host, or
+  // copied to and from a staging buffer
+  uint32_t imported;
+  double milliseconds;
+};
+
+// the warm context the daemon keeps between jobs
+struct Context {
+  VkInstance instance;
+  VkPhysicalDevice physicalDevice;
+  VkDevice device;
+  VkQueue queue;
+  uint32_t queueFamilyIndex;
+  VkPhysicalDeviceMemoryProperties memoryProperties;
+  uint32_t maxGroupCount;
+  VkDeviceSize importAlignment;
+  PFN_vkGetMemoryHostPointerPropertiesEXT vkGetMemoryHostPointerPropertiesEXT;
+  VkDescriptorSetLayout setLayout;
+  VkPipelineLayout pipelineLayout;
+  VkPipeline pipeline;
+  VkDescriptorPool descriptorPool;
+  VkDescriptorSet descriptorSet;
+  VkCommandPool commandPool;
+  VkCommandBuffer commandBuffer;
+  // the staging buffer of jobs which are not imported, grown as needed
+  VkBuffer stagingBuffer;
+  VkDeviceMemory stagingMemory;
+  VkDeviceSize stagingSize;
+  char *stagingData;
+};
+
+uint32_t divideRoundUp(uint32_t value, uint32_t divisor) {
+  return (value + divisor - 1) / divisor;
+}
+
+uint32_t nextRandom(uint32_t &seed) {
+  seed = seed * 1664525u + 1013904223u;
+  return seed >> 8;
+}
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+// create the instance, device, pipeline and command buffer once, enabling
+// VK_EXT_external_memory_host when the device supports it
+VkResult createContext(Context *context) {
+  VkApplicationInfo applicationInfo = {};
+  applicationInfo.pApplicationName = "Vulkan compute daemon example";
+  // external memory buffers are core in Vulkan 1.1
+  applicationInfo.apiVersion = VK_API_VERSION_1_1;
+
+  VkInstanceCreateInfo instanceCreateInfo = {};
+  instanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+  instanceCreateInfo.pApplicationInfo = &applicationInfo;
+#ifdef ENABLE_LAYERS
+  // without a debug report callback, see vector_add, the validation layer
+  // prints its messages to stdout
+  std::vector<const char *> enabledLayerNames{"VK_LAYER_KHRONOS_validation"};
+  instanceCreateInfo.enabledLayerCount = enabledLayerNames.size();
+  instanceCreateInfo.ppEnabledLayerNames = enabledLayerNames.data();
+#endif
+
+  VkResult error =
+      vkCreateInstance(&instanceCreateInfo, nullptr, &context->instance);
+  if (error) {
+    return error;
+  }
+
+  uint32_t count;
+  error = vkEnumeratePhysicalDevices(context->instance, &count, nullptr);
+  if (error) {
+    return error;
+  }
+  std::vector<VkPhysicalDevice> physicalDevices(count);
+  error = vkEnumeratePhysicalDevices(context->instance, &count,
+                                     physicalDevices.data());
+  if (error) {
+    return error;
+  }
+
+  // find the first Vulkan 1.1 physical device with a compute queue
+  VkPhysicalDeviceProperties physicalDeviceProperties;
+  for (auto device : physicalDevices) {
+    vkGetPhysicalDeviceProperties(device, &physicalDeviceProperties);
+    if (physicalDeviceProperties.apiVersion < VK_API_VERSION_1_1) {
+      continue;
+    }
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilyProperties(count);
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count,
+                                             queueFamilyProperties.data());
+    for (uint32_t index = 0; index < count; index++) {
+      if (queueFamilyProperties[index].queueFlags & VK_QUEUE_COMPUTE_BIT) {
+        context->physicalDevice = device;
+        context->queueFamilyIndex = index;
+        break;
+      }
+    }
+    if (context->physicalDevice) {
+      break;
+    }
+  }
+  if (!context->physicalDevice) {
+    fprintf(stderr, "no Vulkan 1.1 device with a compute queue\n");
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+  }
+  vkGetPhysicalDeviceProperties(context->physicalDevice,
+                                &physicalDeviceProperties);
+  context->maxGroupCount =
+      physicalDeviceProperties.limits.maxComputeWorkGroupCount[0];
+  vkGetPhysicalDeviceMemoryProperties(context->physicalDevice,
+                                      &context->memoryProperties);
+
+  // importing the shared memory files is optional, without it the daemon
+  // copies each job to and from a staging buffer
+  error = vkEnumerateDeviceExtensionProperties(context->physicalDevice,
+                                               nullptr, &count, nullptr);
+  if (error) {
+    return error;
+  }
+  std::vector<VkExtensionProperties> extensionProperties(count);
+  error = vkEnumerateDeviceExtensionProperties(
+      context->physicalDevice, nullptr, &count, extensionProperties.data());
+  if (error) {
+    return error;
+  }
+  bool hasExternalMemoryHost = false;
+  for (auto &extension : extensionProperties) {
+    if (!strcmp(extension.extensionName,
+                VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME)) {
+      hasExternalMemoryHost = true;
+    }
+  }
+  if (hasExternalMemoryHost) {
+    VkPhysicalDeviceExternalMemoryHostPropertiesEXT hostProperties = {};
+    hostProperties.sType =
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_MEMORY_HOST_PROPERTIES_EXT;
+    VkPhysicalDeviceProperties2 properties = {};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &hostProperties;
+    vkGetPhysicalDeviceProperties2(context->physicalDevice, &properties);
+    context->importAlignment = hostProperties.minImportedHostPointerAlignment;
+  }
+
+  VkDeviceQueueCreateInfo queueCreateInfo = {};
+  queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+  queueCreateInfo.queueCount = 1;
+  queueCreateInfo.queueFamilyIndex = context->queueFamilyIndex;
+  float queuePriority = 1.0f;
+  queueCreateInfo.pQueuePriorities = &queuePriority;
+
+  VkDeviceCreateInfo deviceCreateInfo = {};
+  deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+  deviceCreateInfo.queueCreateInfoCount = 1;
+  deviceCreateInfo.pQueueCreateInfos = &queueCreateInfo;
+  const char *externalMemoryHostExtensionName =
+      VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME;
+  if (hasExternalMemoryHost) {
+    deviceCreateInfo.enabledExtensionCount = 1;
+    deviceCreateInfo.ppEnabledExtensionNames =
+        &externalMemoryHostExtensionName;
+  }
+  error = vkCreateDevice(context->physicalDevice, &deviceCreateInfo, nullptr,
+                         &context->device);
+  if (error) {
+    return error;
+  }
+  vkGetDeviceQueue(context->device, context->queueFamilyIndex, 0,
+                   &context->queue);
+  if (hasExternalMemoryHost) {
+    context->vkGetMemoryHostPointerPropertiesEXT =
+        reinterpret_cast<PFN_vkGetMemoryHostPointerPropertiesEXT>(
+            vkGetDeviceProcAddr(context->device,
+                                "vkGetMemoryHostPointerPropertiesEXT"));
+  }
+
+  // a, b and the result
+  std::vector<VkDescriptorSetLayoutBinding> layoutBindings;
+  VkDescriptorSetLayoutBinding layoutBinding = {};
+  layoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  layoutBinding.descriptorCount = 1;
+  layoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  for (uint32_t binding = 0; binding < 3; binding++) {
+    layoutBinding.binding = binding;
+    layoutBindings.push_back(layoutBinding);
+  }
+
+  VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo = {};
+  setLayoutCreateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  setLayoutCreateInfo.bindingCount = layoutBindings.size();
+  setLayoutCreateInfo.pBindings = layoutBindings.data();
+  error = vkCreateDescriptorSetLayout(context->device, &setLayoutCreateInfo,
+                                      nullptr, &context->setLayout);
+  if (error) {
+    return error;
+  }
+
+  VkPushConstantRange pushConstantRange = {};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(uint32_t);
+
+  VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+  pipelineLayoutCreateInfo.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutCreateInfo.setLayoutCount = 1;
+  pipelineLayoutCreateInfo.pSetLayouts = &context->setLayout;
+  pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+  pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+  error = vkCreatePipelineLayout(context->device, &pipelineLayoutCreateInfo,
+                                 nullptr, &context->pipelineLayout);
+  if (error) {
+    return error;
+  }
+  error = createComputePipeline(context->device, context->pipelineLayout,
+                                "vector_add.spv", nullptr, &context->pipeline);
+  if (error) {
+    return error;
+  }
+
+  VkDescriptorPoolSize poolSize = {};
+  poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  poolSize.descriptorCount = 3;
+  VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = {};
+  descriptorPoolCreateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  descriptorPoolCreateInfo.maxSets = 1;
+  descriptorPoolCreateInfo.poolSizeCount = 1;
+  descriptorPoolCreateInfo.pPoolSizes = &poolSize;
+  error = vkCreateDescriptorPool(context->device, &descriptorPoolCreateInfo,
+                                 nullptr, &context->descriptorPool);
+  if (error) {
+    return error;
+  }
+
+  VkDescriptorSetAllocateInfo descriptorSetAllocateInfo = {};
+  descriptorSetAllocateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  descriptorSetAllocateInfo.descriptorPool = context->descriptorPool;
+  descriptorSetAllocateInfo.descriptorSetCount = 1;
+  descriptorSetAllocateInfo.pSetLayouts = &context->setLayout;
+  error = vkAllocateDescriptorSets(context->device, &descriptorSetAllocateInfo,
+                                   &context->descriptorSet);
+  if (error) {
+    return error;
+  }
+
+  VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+  commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+  commandPoolCreateInfo.queueFamilyIndex = context->queueFamilyIndex;
+  error = vkCreateCommandPool(context->device, &commandPoolCreateInfo,
+                              nullptr, &context->commandPool);
+  if (error) {
+    return error;
+  }
+
+  VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
+  commandBufferAllocateInfo.sType =
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  commandBufferAllocateInfo.commandPool = context->commandPool;
+  commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  commandBufferAllocateInfo.commandBufferCount = 1;
+  return vkAllocateCommandBuffers(context->device, &commandBufferAllocateInfo,
+                                  &context->commandBuffer);
+}
+
+void destroyStaging(Context &context) {
+  if (context.stagingData) {
+    vkUnmapMemory(context.device, context.stagingMemory);
+  }
+  vkDestroyBuffer(context.device, context.stagingBuffer, nullptr);
+  vkFreeMemory(context.device, context.stagingMemory, nullptr);
+  context.stagingBuffer = VK_NULL_HANDLE;
+  context.stagingMemory = VK_NULL_HANDLE;
+  context.stagingSize = 0;
+  context.stagingData = nullptr;
+}
+
+void destroyContext(Context &context) {
+  if (context.device) {
+    destroyStaging(context);
+    vkDestroyCommandPool(context.device, context.commandPool, nullptr);
+    vkDestroyDescriptorPool(context.device, context.descriptorPool, nullptr);
+    vkDestroyPipeline(context.device, context.pipeline, nullptr);
+    vkDestroyPipelineLayout(context.device, context.pipelineLayout, nullptr);
+    vkDestroyDescriptorSetLayout(context.device, context.setLayout, nullptr);
+    vkDestroyDevice(context.device, nullptr);
+  }
+  if (context.instance) {
+    vkDestroyInstance(context.instance, nullptr);
+  }
+}
+
+// create a buffer of size bytes bound to memory, imported from pointer when
+// it is not null or allocated host visible otherwise
+VkResult createJobBuffer(Context &context, VkDeviceSize size, void *pointer,
+                         VkBuffer *buffer, VkDeviceMemory *memory) {
+  VkExternalMemoryBufferCreateInfo externalCreateInfo = {};
+  externalCreateInfo.sType =
+      VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_BUFFER_CREATE_INFO;
+  externalCreateInfo.handleTypes =
+      VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT;
+  VkBufferCreateInfo bufferCreateInfo = {};
+  bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  bufferCreateInfo.pNext = pointer ? &externalCreateInfo : nullptr;
+  bufferCreateInfo.size = size;
+  bufferCreateInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+  bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  bufferCreateInfo.queueFamilyIndexCount = 1;
+  bufferCreateInfo.pQueueFamilyIndices = &context.queueFamilyIndex;
+  VkResult error =
+      vkCreateBuffer(context.device, &bufferCreateInfo, nullptr, buffer);
+  if (error) {
+    return error;
+  }
+  VkMemoryRequirements memoryRequirements;
+  vkGetBufferMemoryRequirements(context.device, *buffer, &memoryRequirements);
+  uint32_t memoryTypeBits = memoryRequirements.memoryTypeBits;
+
+  VkImportMemoryHostPointerInfoEXT importInfo = {};
+  importInfo.sType = VK_STRUCTURE_TYPE_IMPORT_MEMORY_HOST_POINTER_INFO_EXT;
+  importInfo.handleType =
+      VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT;
+  importInfo.pHostPointer = pointer;
+  if (pointer) {
+    VkMemoryHostPointerPropertiesEXT pointerProperties = {};
+    pointerProperties.sType =
+        VK_STRUCTURE_TYPE_MEMORY_HOST_POINTER_PROPERTIES_EXT;
+    error = context.vkGetMemoryHostPointerPropertiesEXT(
+        context.device, importInfo.handleType, pointer, &pointerProperties);
+    if (error) {
+      return error;
+    }
+    memoryTypeBits &= pointerProperties.memoryTypeBits;
+  }
+  auto memoryTypeIndex = findMemoryTypeFromProperties(
+      memoryTypeBits, context.memoryProperties,
+      pointer ? 0
+              : VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                    VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  if (0 > memoryTypeIndex) {
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+  }
+  VkMemoryAllocateInfo allocateInfo = {};
+  allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocateInfo.pNext = pointer ? &importInfo : nullptr;
+  allocateInfo.allocationSize = pointer ? size : memoryRequirements.size;
+  allocateInfo.memoryTypeIndex = memoryTypeIndex;
+  error = vkAllocateMemory(context.device, &allocateInfo, nullptr, memory);
+  if (error) {
+    return error;
+  }
+  return vkBindBufferMemory(context.device, *buffer, *memory, 0);
+}
+
+// add a and b of the job into its result using buffer, which holds the
+// three regions at the offsets of the request
+VkResult dispatchJob(Context &context, const Request &request,
+                     VkBuffer buffer) {
+  const VkDeviceSize regionSize = sizeof(int32_t) * request.count;
+  VkDescriptorBufferInfo bufferInfos[3];
+  VkWriteDescriptorSet writeDescriptorSets[3];
+  for (uint32_t binding = 0; binding < 3; binding++) {
+    bufferInfos[binding] = {buffer, request.offsets[binding], regionSize};
+    writeDescriptorSets[binding] = {};
+    writeDescriptorSets[binding].sType =
+        VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writeDescriptorSets[binding].dstSet = context.descriptorSet;
+    writeDescriptorSets[binding].dstBinding = binding;
+    writeDescriptorSets[binding].descriptorCount = 1;
+    writeDescriptorSets[binding].descriptorType =
+        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    writeDescriptorSets[binding].pBufferInfo = &bufferInfos[binding];
+  }
+  vkUpdateDescriptorSets(context.device, 3, writeDescriptorSets, 0, nullptr);
+
+  VkResult error = vkResetCommandPool(context.device, context.commandPool, 0);
+  if (error) {
+    return error;
+  }
+  VkCommandBufferBeginInfo beginInfo = {};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  error = vkBeginCommandBuffer(context.commandBuffer, &beginInfo);
+  if (error) {
+    return error;
+  }
+  vkCmdBindPipeline(context.commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                    context.pipeline);
+  vkCmdBindDescriptorSets(context.commandBuffer,
+                          VK_PIPELINE_BIND_POINT_COMPUTE,
+                          context.pipelineLayout, 0, 1,
+                          &context.descriptorSet, 0, nullptr);
+  vkCmdPushConstants(context.commandBuffer, context.pipelineLayout,
+                     VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t),
+                     &request.count);
+  vkCmdDispatch(context.commandBuffer,
+                std::min(divideRoundUp(request.count, 256),
+                         context.maxGroupCount),
+                1, 1);
+  error = vkEndCommandBuffer(context.commandBuffer);
+  if (error) {
+    return error;
+  }
+  VkSubmitInfo submitInfo = {};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &context.commandBuffer;
+  error = vkQueueSubmit(context.queue, 1, &submitInfo, VK_NULL_HANDLE);
+  if (error) {
+    return error;
+  }
+  return vkQueueWaitIdle(context.queue);
+}
+
+// run a job on the shared memory file mapped at file, importing it when the
+// device and the alignment allow and copying it through the staging buffer
+// otherwise
+VkResult runJob(Context &context, char *file, const Request &request,
+                bool *imported) {
+  *imported = false;
+  if (context.vkGetMemoryHostPointerPropertiesEXT &&
+      request.size % context.importAlignment == 0 &&
+      reinterpret_cast<uintptr_t>(file) % context.importAlignment == 0) {
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkResult error =
+        createJobBuffer(context, request.size, file, &buffer, &memory);
+    if (!error) {
+      error = dispatchJob(context, request, buffer);
+    }
+    vkDestroyBuffer(context.device, buffer, nullptr);
+    vkFreeMemory(context.device, memory, nullptr);
+    // a driver may refuse to import a file mapping, then fall back to copying
+    if (!error) {
+      *imported = true;
+      return VK_SUCCESS;
+    }
+  }
+
+  if (context.stagingSize < request.size) {
+    destroyStaging(context);
+    VkResult error =
+        createJobBuffer(context, request.size, nullptr,
+                        &context.stagingBuffer, &context.stagingMemory);
+    if (error) {
+      return error;
+    }
+    error = vkMapMemory(context.device, context.stagingMemory, 0,
+                        VK_WHOLE_SIZE, 0,
+                        reinterpret_cast<void **>(&context.stagingData));
+    if (error) {
+      return error;
+    }
+    context.stagingSize = request.size;
+  }
+  const size_t regionSize = sizeof(int32_t) * request.count;
+  for (uint32_t input = 0; input < 2; input++) {
+    memcpy(context.stagingData + request.offsets[input],
+           file + request.offsets[input], regionSize);
+  }
+  VkResult error = dispatchJob(context, request, context.stagingBuffer);
+  if (error) {
+    return error;
+  }
+  memcpy(file + request.offsets[2], context.stagingData + request.offsets[2],
+         regionSize);
+  return VK_SUCCESS;
+}
+
+bool readAll(int socket, void *data, size_t size) {
+  char *bytes = static_cast<char *>(data);
+  while (size) {
+    ssize_t count = read(socket, bytes, size);
+    if (count <= 0) {
+      return false;
+    }
+    bytes += count;
+    size -= count;
+  }
+  return true;
+}
+
+bool writeAll(int socket, const void *data, size_t size) {
+  const char *bytes = static_cast<const char *>(data);
+  while (size) {
+    ssize_t count = write(socket, bytes, size);
+    if (count <= 0) {
+      return false;
+    }
+    bytes += count;
+    size -= count;
+  }
+  return true;
+}
+
+// send request with file, if it is not -1, attached as SCM_RIGHTS so the
+// daemon receives its own descriptor of the same shared memory
+bool sendRequest(int socket, const Request &request, int file) {
+  iovec data = {const_cast<Request *>(&request), sizeof(Request)};
+  msghdr message = {};
+  message.msg_iov = &data;
+  message.msg_iovlen = 1;
+  char control[CMSG_SPACE(sizeof(int))] = {};
+  if (file != -1) {
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    cmsghdr *header = CMSG_FIRSTHDR(&message);
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type = SCM_RIGHTS;
+    header->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(header), &file, sizeof(int));
+  }
+  return sendmsg(socket, &message, 0) == sizeof(Request);
+}
+
+// receive a request and its attached file, or -1 if there is none
+bool receiveRequest(int socket, Request *request, int *file) {
+  iovec data = {request, sizeof(Request)};
+  msghdr message = {};
+  message.msg_iov = &data;
+  message.msg_iovlen = 1;
+  char control[CMSG_SPACE(sizeof(int))];
+  message.msg_control = control;
+  message.msg_controllen = sizeof(control);
+  *file = -1;
+  if (recvmsg(socket, &message, MSG_CMSG_CLOEXEC) != sizeof(Request)) {
+    return false;
+  }
+  cmsghdr *header = CMSG_FIRSTHDR(&message);
+  if (header && header->cmsg_level == SOL_SOCKET &&
+      header->cmsg_type == SCM_RIGHTS) {
+    memcpy(file, CMSG_DATA(header), sizeof(int));
+  }
+  return true;
+}
+
+sockaddr_un socketAddress(const char *path) {
+  sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  strncpy(address.sun_path, path, sizeof(address.sun_path) - 1);
+  return address;
+}
+
+// whether the regions of request lie within file, which must be sealed so
+// the client cannot shrink it under the daemon's mapping and fault it
+bool validRequest(const Request &request, int file) {
+  struct stat status;
+  if (file == -1 || fstat(file, &status)) {
+    return false;
+  }
+  const int seals = fcntl(file, F_GET_SEALS);
+  if (seals == -1 || !(seals & F_SEAL_SHRINK)) {
+    return false;
+  }
+  const uint64_t regionSize = sizeof(int32_t) * uint64_t(request.count);
+  if (request.count == 0 || request.size == 0 ||
+      request.size > uint64_t(status.st_size)) {
+    return false;
+  }
+  for (auto offset : request.offsets) {
+    if (offset % sizeof(int32_t) || offset > request.size ||
+        regionSize > request.size - offset) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// create the context once then serve jobs from clients one at a time until
+// a shutdown request, writing a byte to ready once the socket listens
+int serve(const char *path, int ready) {
+  // a client which disconnects before its reply must not end the daemon
+  signal(SIGPIPE, SIG_IGN);
+  auto start = std::chrono::steady_clock::now();
+  Context context = {};
+  VkResult error = createContext(&context);
+  if (error) {
+    fprintf(stderr, "daemon: failed to create the context: %d\n", error);
+    destroyContext(context);
+    return 1;
+  }
+  printf("daemon: context created in %.3f ms, %s\n", millisecondsSince(start),
+         context.vkGetMemoryHostPointerPropertiesEXT
+             ? "importing shared memory"
+             : "copying shared memory");
+  fflush(stdout);
+
+  int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  sockaddr_un address = socketAddress(path);
+  unlink(path);
+  if (listener == -1 ||
+      bind(listener, reinterpret_cast<sockaddr *>(&address),
+           sizeof(address)) ||
+      listen(listener, 8)) {
+    perror("daemon");
+    destroyContext(context);
+    return 1;
+  }
+  if (ready != -1) {
+    writeAll(ready, "", 1);
+    close(ready);
+  }
+
+  bool running = true;
+  while (running) {
+    int connection = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+    if (connection == -1) {
+      perror("daemon");
+      break;
+    }
+    // jobs are served one at a time, so a client which never sends its
+    // request or reads its reply must not hold up the others
+    timeval timeout = {1, 0};
+    setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout,
+               sizeof(timeout));
+    setsockopt(connection, SOL_SOCKET, SO_SNDTIMEO, &timeout,
+               sizeof(timeout));
+    Request request;
+    int file;
+    if (!receiveRequest(connection, &request, &file)) {
+      close(connection);
+      continue;
+    }
+    Reply reply = {};
+    if (request.type == SHUTDOWN) {
+      running = false;
+    } else {
+      char *mapping = static_cast<char *>(MAP_FAILED);
+      if (validRequest(request, file)) {
+        mapping = static_cast<char *>(mmap(nullptr, request.size,
+                                           PROT_READ | PROT_WRITE, MAP_SHARED,
+                                           file, 0));
+      }
+      if (mapping == MAP_FAILED) {
+        reply.result = VK_ERROR_INITIALIZATION_FAILED;
+      } else {
+        start = std::chrono::steady_clock::now();
+        bool imported;
+        reply.result = runJob(context, mapping, request, &imported);
+        reply.imported = imported;
+        reply.milliseconds = millisecondsSince(start);
+        munmap(mapping, request.size);
+      }
+    }
+    if (file != -1) {
+      close(file);
+    }
+    writeAll(connection, &reply, sizeof(reply));
+    close(connection);
+  }
+
+  close(listener);
+  unlink(path);
+  destroyContext(context);
+  return 0;
+}
+
+// create a shared memory file holding a job of count elements, submit it to
+// the daemon listening on path and check the result
+int runClient(const char *path, uint32_t count, uint32_t seed) {
+  auto start = std::chrono::steady_clock::now();
+  const uint64_t regionSize =
+      (sizeof(int32_t) * uint64_t(count) + regionAlignment - 1) &
+      ~(regionAlignment - 1);
+  Request request = {};
+  request.type = JOB;
+  request.count = count;
+  for (uint32_t region = 0; region < 3; region++) {
+    request.offsets[region] = region * regionSize;
+  }
+  request.size = 3 * regionSize;
+
+  // the daemon only maps files sealed against shrinking
+  int file =
+      memfd_create("compute_daemon_job", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (file == -1 || ftruncate(file, request.size) ||
+      fcntl(file, F_ADD_SEALS, F_SEAL_SHRINK)) {
+    perror("client");
+    return 1;
+  }
+  char *mapping = static_cast<char *>(mmap(
+      nullptr, request.size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0));
+  if (mapping == MAP_FAILED) {
+    perror("client");
+    close(file);
+    return 1;
+  }
+  int32_t *a = reinterpret_cast<int32_t *>(mapping + request.offsets[0]);
+  int32_t *b = reinterpret_cast<int32_t *>(mapping + request.offsets[1]);
+  int32_t *result = reinterpret_cast<int32_t *>(mapping + request.offsets[2]);
+  for (uint32_t index = 0; index < count; index++) {
+    a[index] = nextRandom(seed) & 0xffff;
+    b[index] = nextRandom(seed) & 0xffff;
+  }
+
+  int connection = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  sockaddr_un address = socketAddress(path);
+  Reply reply = {};
+  bool sent = connection != -1 &&
+              !connect(connection, reinterpret_cast<sockaddr *>(&address),
+                       sizeof(address)) &&
+              sendRequest(connection, request, file) &&
+              readAll(connection, &reply, sizeof(reply));
+  if (connection != -1) {
+    close(connection);
+  }
+  close(file);
+  int status = 1;
+  if (!sent) {
+    perror("client");
+  } else if (reply.result) {
+    fprintf(stderr, "client: job failed: %d\n", reply.result);
+  } else {
+    status = 0;
+    for (uint32_t index = 0; index < count; index++) {
+      if (result[index] != a[index] + b[index]) {
+        fprintf(stderr, "client: result[%u] is %d expected %d\n", index,
+                result[index], a[index] + b[index]);
+        status = 1;
+        break;
+      }
+    }
+    printf("client %d: %u elements %s, %.3f ms in the daemon, %.3f ms "
+           "round trip\n",
+           getpid(), count, reply.imported ? "imported" : "copied",
+           reply.milliseconds, millisecondsSince(start));
+  }
+  munmap(mapping, request.size);
+  return status;
+}
+
+int shutdownDaemon(const char *path) {
+  int connection = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  sockaddr_un address = socketAddress(path);
+  Request request = {};
+  request.type = SHUTDOWN;
+  Reply reply;
+  bool sent = connection != -1 &&
+              !connect(connection, reinterpret_cast<sockaddr *>(&address),
+                       sizeof(address)) &&
+              sendRequest(connection, request, -1) &&
+              readAll(connection, &reply, sizeof(reply));
+  if (connection != -1) {
+    close(connection);
+  }
+  return sent ? 0 : 1;
+}
+
+// wait for the process and return 0 if it exited successfully
+int waitFor(pid_t process) {
+  int status;
+  if (waitpid(process, &status, 0) != process) {
+    return 1;
+  }
+  return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+}
+
+// usage: compute_daemon [serve <socket> | client <socket> [count] |
+//                        shutdown <socket>]
+//
+// without arguments start a daemon, run a series of clients against it as
+// separate processes then shut it down
+int main(int argc, char **argv) {
+  if (argc >= 3 && !strcmp(argv[1], "serve")) {
+    return serve(argv[2], -1);
+  }
+  if (argc >= 3 && !strcmp(argv[1], "client")) {
+    uint32_t count = argc >= 4 ? strtoul(argv[3], nullptr, 0) : 1 << 20;
+    return runClient(argv[2], count, getpid());
+  }
+  if (argc >= 3 && !strcmp(argv[1], "shutdown")) {
+    return shutdownDaemon(argv[2]);
+  }
+  if (argc != 1) {
+    fprintf(stderr, "usage: %s [serve|client|shutdown <socket> [count]]\n",
+            argv[0]);
+    return 1;
+  }
+
+  std::string path =
+      "/tmp/compute_daemon." + std::to_string(getpid()) + ".socket";
+  int ready[2];
+  if (pipe(ready)) {
+    perror("pipe");
+    return 1;
+  }
+  fflush(stdout);
+  pid_t daemon = fork();
+  if (daemon == -1) {
+    perror("fork");
+    return 1;
+  }
+  if (daemon == 0) {
+    close(ready[0]);
+    int status = serve(path.c_str(), ready[1]);
+    fflush(stdout);
+    _exit(status);
+  }
+  close(ready[1]);
+  char byte;
+  bool listening = readAll(ready[0], &byte, 1);
+  close(ready[0]);
+  if (!listening) {
+    waitFor(daemon);
+    return 1;
+  }
+
+  // each client is a new process, the daemon's context is already warm
+  int failures = 0;
+  const uint32_t counts[] = {1 << 10, 1 << 16, 1 << 20, 1 << 22};
+  for (uint32_t job = 0; job < 8; job++) {
+    fflush(stdout);
+    pid_t client = fork();
+    if (client == -1) {
+      perror("fork");
+      failures++;
+      break;
+    }
+    if (client == 0) {
+      int status = runClient(path.c_str(), counts[job % 4], job + 1);
+      fflush(stdout);
+      _exit(status);
+    }
+    failures += waitFor(client) != 0;
+  }
+
+  failures += shutdownDaemon(path.c_str());
+  failures += waitFor(daemon);
+  if (failures) {
+    return 1;
+  }
+
+  printf("success\n");
+
+  return 0;
+}
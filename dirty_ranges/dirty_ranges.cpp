@@ -0,0 +1,729 @@
+#include <vulkan/vulkan.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+// load a SPIR-V binary from disc
+std::vector<char> loadShaderCode(const char *filename) {
+  std::vector<char> shaderCode;
+  if (FILE *fp = fopen(filename, "rb")) {
+    char buf[1024];
+    while (size_t len = fread(buf, 1, sizeof(buf), fp)) {
+      shaderCode.insert(shaderCode.end(), buf, buf + len);
+    }
+    fclose(fp);
+  }
+  return shaderCode;
+}
+
+// search for compatible memory properties and return the memory type index
+int32_t findMemoryTypeFromProperties(
+    uint32_t memoryTypeBits, VkPhysicalDeviceMemoryProperties properties,
+    VkMemoryPropertyFlags requiredProperties) {
+  assert(properties.memoryTypeCount < 32u);
+  for (uint32_t index = 0; index < properties.memoryTypeCount; ++index) {
+    if (memoryTypeBits & (1u << index) &&
+        // Find the first memory type that supports all the required flags.
+        ((properties.memoryTypes[index].propertyFlags & requiredProperties) ==
+         requiredProperties)) {
+      return (int32_t)index;
+    }
+  }
+  return -1;
+}
+
+// create a compute pipeline from a SPIR-V binary found in SHADER_PATH
+VkResult createComputePipeline(VkDevice device, VkPipelineLayout layout,
+                               const char *filename,
+                               const VkSpecializationInfo *specializationInfo,
+                               VkPipeline *pipeline) {
+  auto shaderCode =
+      loadShaderCode((std::string(SHADER_PATH) + filename).c_str());
+  if (shaderCode.empty()) {
+    fprintf(stderr, "failed to load '%s'\n", filename);
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
+  shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  shaderModuleCreateInfo.pCode =
+      reinterpret_cast<uint32_t *>(shaderCode.data());
+  shaderModuleCreateInfo.codeSize = shaderCode.size();
+  VkShaderModule shaderModule = VK_NULL_HANDLE;
+  VkResult error = vkCreateShaderModule(device, &shaderModuleCreateInfo,
+                                        nullptr, &shaderModule);
+  if (error) {
+    return error;
+  }
+  VkComputePipelineCreateInfo pipelineCreateInfo = {};
+  pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineCreateInfo.stage.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipelineCreateInfo.stage.module = shaderModule;
+  pipelineCreateInfo.stage.pName = "main";
+  pipelineCreateInfo.stage.pSpecializationInfo = specializationInfo;
+  pipelineCreateInfo.layout = layout;
+  error = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1,
+                                   &pipelineCreateInfo, nullptr, pipeline);
+  vkDestroyShaderModule(device, shaderModule, nullptr);
+  return error;
+}
+
+// the pages of a buffer the host wrote since it was last uploaded, the host
+// writes a host visible copy of the buffer and only the dirty pages are
+// copied to the device local buffer
+struct DirtyPages {
+  VkDeviceSize bufferSize;
+  VkDeviceSize pageSize;
+  std::vector<uint8_t> dirty;
+};
+
+DirtyPages createDirtyPages(VkDeviceSize bufferSize, VkDeviceSize pageSize) {
+  DirtyPages pages = {};
+  pages.bufferSize = bufferSize;
+  pages.pageSize = pageSize;
+  pages.dirty.resize((bufferSize + pageSize - 1) / pageSize, 0);
+  return pages;
+}
+
+void markDirty(DirtyPages &pages, VkDeviceSize offset, VkDeviceSize size) {
+  if (!size) {
+    return;
+  }
+  const VkDeviceSize last = (offset + size - 1) / pages.pageSize;
+  for (VkDeviceSize page = offset / pages.pageSize; page <= last; page++) {
+    pages.dirty[page] = 1;
+  }
+}
+
+// return the dirty pages as copy regions, adjacent pages are coalesced into
+// a single region, and mark every page clean
+std::vector<VkBufferCopy> takeDirtyRegions(DirtyPages &pages) {
+  std::vector<VkBufferCopy> regions;
+  for (size_t page = 0; page < pages.dirty.size(); page++) {
+    if (!pages.dirty[page]) {
+      continue;
+    }
+    pages.dirty[page] = 0;
+    const VkDeviceSize offset = page * pages.pageSize;
+    const VkDeviceSize size =
+        std::min(pages.pageSize, pages.bufferSize - offset);
+    if (!regions.empty() &&
+        regions.back().srcOffset + regions.back().size == offset) {
+      regions.back().size += size;
+    } else {
+      regions.push_back({offset, offset, size});
+    }
+  }
+  return regions;
+}
+
+// the union of two sorted lists of disjoint regions, overlapping and
+// adjacent regions are merged
+std::vector<VkBufferCopy> mergeRegions(const std::vector<VkBufferCopy> &a,
+                                       const std::vector<VkBufferCopy> &b) {
+  std::vector<VkBufferCopy> sorted(a);
+  sorted.insert(sorted.end(), b.begin(), b.end());
+  std::sort(sorted.begin(), sorted.end(),
+            [](const VkBufferCopy &left, const VkBufferCopy &right) {
+              return left.srcOffset < right.srcOffset;
+            });
+  std::vector<VkBufferCopy> merged;
+  for (const VkBufferCopy &region : sorted) {
+    if (!merged.empty() &&
+        region.srcOffset <= merged.back().srcOffset + merged.back().size) {
+      merged.back().size =
+          std::max(merged.back().srcOffset + merged.back().size,
+                   region.srcOffset + region.size) -
+          merged.back().srcOffset;
+      merged.back().dstOffset = merged.back().srcOffset;
+    } else {
+      merged.push_back(region);
+    }
+  }
+  return merged;
+}
+
+struct RangePushConstants {
+  uint32_t first;
+  uint32_t count;
+};
+
+uint32_t divideRoundUp(uint32_t value, uint32_t divisor) {
+  return (value + divisor - 1) / divisor;
+}
+
+// add the elements of each region, given in bytes
+void recordAddRegions(VkCommandBuffer commandBuffer,
+                      VkPipelineLayout pipelineLayout, VkPipeline pipeline,
+                      VkDescriptorSet descriptorSet,
+                      const std::vector<VkBufferCopy> &regions,
+                      uint32_t maxGroupCount) {
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                          pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+  for (const VkBufferCopy &region : regions) {
+    RangePushConstants pushConstants = {
+        (uint32_t)(region.srcOffset / sizeof(int32_t)),
+        (uint32_t)(region.size / sizeof(int32_t))};
+    vkCmdPushConstants(commandBuffer, pipelineLayout,
+                       VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                       sizeof(RangePushConstants), &pushConstants);
+    vkCmdDispatch(commandBuffer,
+                  std::min(divideRoundUp(pushConstants.count, 256),
+                           maxGroupCount),
+                  1, 1);
+  }
+}
+
+void recordBarrier(VkCommandBuffer commandBuffer,
+                   VkPipelineStageFlags srcStageMask,
+                   VkAccessFlags srcAccessMask,
+                   VkPipelineStageFlags dstStageMask,
+                   VkAccessFlags dstAccessMask) {
+  VkMemoryBarrier memoryBarrier = {};
+  memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  memoryBarrier.srcAccessMask = srcAccessMask;
+  memoryBarrier.dstAccessMask = dstAccessMask;
+  vkCmdPipelineBarrier(commandBuffer, srcStageMask, dstStageMask, 0, 1,
+                       &memoryBarrier, 0, nullptr, 0, nullptr);
+}
+
+uint32_t nextRandom(uint32_t &seed) {
+  seed = seed * 1664525u + 1013904223u;
+  return seed >> 8;
+}
+
+// create the buffers with usage and bind them to a single allocation of a
+// memory type with the properties which every buffer supports
+VkResult createBuffers(VkDevice device,
+                       const VkPhysicalDeviceMemoryProperties &properties,
+                       VkMemoryPropertyFlags memoryPropertyFlags,
+                       const std::vector<VkDeviceSize> &sizes,
+                       VkBufferUsageFlags usage, uint32_t queueFamilyIndex,
+                       std::vector<VkBuffer> &buffers, VkDeviceMemory *memory,
+                       std::vector<VkDeviceSize> &offsets) {
+  VkDeviceSize requiredMemorySize = 0;
+  uint32_t memoryTypeBits = ~0u;
+  for (VkDeviceSize size : sizes) {
+    VkBufferCreateInfo bufferCreateInfo = {};
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.size = size;
+    bufferCreateInfo.usage = usage;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    bufferCreateInfo.queueFamilyIndexCount = 1;
+    bufferCreateInfo.pQueueFamilyIndices = &queueFamilyIndex;
+    VkBuffer buffer;
+    VkResult error =
+        vkCreateBuffer(device, &bufferCreateInfo, nullptr, &buffer);
+    if (error) {
+      return error;
+    }
+    buffers.push_back(buffer);
+    VkMemoryRequirements memoryRequirements;
+    vkGetBufferMemoryRequirements(device, buffer, &memoryRequirements);
+    memoryTypeBits &= memoryRequirements.memoryTypeBits;
+    const VkDeviceSize alignment = memoryRequirements.alignment;
+    requiredMemorySize =
+        (requiredMemorySize + alignment - 1) / alignment * alignment;
+    offsets.push_back(requiredMemorySize);
+    requiredMemorySize += memoryRequirements.size;
+  }
+
+  // falling back to another memory type could give memory the caller cannot
+  // map, or must flush, so fail instead
+  auto memoryTypeIndex = findMemoryTypeFromProperties(
+      memoryTypeBits, properties, memoryPropertyFlags);
+  if (0 > memoryTypeIndex) {
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+  }
+  VkMemoryAllocateInfo allocateInfo = {};
+  allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocateInfo.allocationSize = requiredMemorySize;
+  allocateInfo.memoryTypeIndex = memoryTypeIndex;
+  VkResult error = vkAllocateMemory(device, &allocateInfo, nullptr, memory);
+  if (error) {
+    return error;
+  }
+  for (size_t index = 0; index < buffers.size(); index++) {
+    error = vkBindBufferMemory(device, buffers[index], *memory,
+                               offsets[index]);
+    if (error) {
+      return error;
+    }
+  }
+  return VK_SUCCESS;
+}
+int main() {
+  VkApplicationInfo applicationInfo = {};
+  applicationInfo.pApplicationName = "Vulkan dirty ranges example";
+  applicationInfo.apiVersion = VK_MAKE_VERSION(1, 0, 0);
+
+  VkInstanceCreateInfo instanceCreateInfo = {};
+  instanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+  instanceCreateInfo.pApplicationInfo = &applicationInfo;
+#ifdef ENABLE_LAYERS
+  // without a debug report callback, see vector_add, the validation layer
+  // prints its messages to stdout
+  std::vector<const char *> enabledLayerNames{"VK_LAYER_KHRONOS_validation"};
+  instanceCreateInfo.enabledLayerCount = enabledLayerNames.size();
+  instanceCreateInfo.ppEnabledLayerNames = enabledLayerNames.data();
+#endif
+
+  VkInstance instance = VK_NULL_HANDLE;
+  VkResult error = vkCreateInstance(&instanceCreateInfo, nullptr, &instance);
+  if (error) {
+    return error;
+  }
+
+  uint32_t count;
+  error = vkEnumeratePhysicalDevices(instance, &count, nullptr);
+  if (error) {
+    return error;
+  }
+  std::vector<VkPhysicalDevice> physicalDevices(count);
+  error = vkEnumeratePhysicalDevices(instance, &count, physicalDevices.data());
+  if (error) {
+    return error;
+  }
+
+  // find the first physical device with a compute queue
+  VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+  uint32_t queueFamilyIndex = 0;
+  uint32_t timestampValidBits = 0;
+  for (auto device : physicalDevices) {
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilyProperties(count);
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count,
+                                             queueFamilyProperties.data());
+    for (uint32_t index = 0; index < count; index++) {
+      if (queueFamilyProperties[index].queueFlags & VK_QUEUE_COMPUTE_BIT) {
+        physicalDevice = device;
+        queueFamilyIndex = index;
+        timestampValidBits = queueFamilyProperties[index].timestampValidBits;
+        break;
+      }
+    }
+    if (physicalDevice) {
+      break;
+    }
+  }
+  if (!physicalDevice) {
+    fprintf(stderr, "no device with a compute queue\n");
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+  }
+
+  VkPhysicalDeviceProperties physicalDeviceProperties;
+  vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties);
+  const VkPhysicalDeviceLimits &limits = physicalDeviceProperties.limits;
+
+  VkDeviceQueueCreateInfo queueCreateInfo = {};
+  queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+  queueCreateInfo.queueCount = 1;
+  queueCreateInfo.queueFamilyIndex = queueFamilyIndex;
+  float queuePriority = 1.0f;
+  queueCreateInfo.pQueuePriorities = &queuePriority;
+
+  VkDeviceCreateInfo deviceCreateInfo = {};
+  deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+  deviceCreateInfo.queueCreateInfoCount = 1;
+  deviceCreateInfo.pQueueCreateInfos = &queueCreateInfo;
+  VkDevice device = VK_NULL_HANDLE;
+  error = vkCreateDevice(physicalDevice, &deviceCreateInfo, nullptr, &device);
+  if (error) {
+    return error;
+  }
+
+  VkQueue queue;
+  vkGetDeviceQueue(device, queueFamilyIndex, 0, &queue);
+
+  // a, b and the result
+  std::vector<VkDescriptorSetLayoutBinding> layoutBindings;
+  VkDescriptorSetLayoutBinding layoutBinding = {};
+  layoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  layoutBinding.descriptorCount = 1;
+  layoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  for (uint32_t binding = 0; binding < 3; binding++) {
+    layoutBinding.binding = binding;
+    layoutBindings.push_back(layoutBinding);
+  }
+
+  VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo = {};
+  setLayoutCreateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  setLayoutCreateInfo.bindingCount = layoutBindings.size();
+  setLayoutCreateInfo.pBindings = layoutBindings.data();
+  VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+  error = vkCreateDescriptorSetLayout(device, &setLayoutCreateInfo, nullptr,
+                                      &setLayout);
+  if (error) {
+    return error;
+  }
+
+  VkPushConstantRange pushConstantRange = {};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(RangePushConstants);
+
+  VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+  pipelineLayoutCreateInfo.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutCreateInfo.setLayoutCount = 1;
+  pipelineLayoutCreateInfo.pSetLayouts = &setLayout;
+  pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+  pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+  VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+  error = vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr,
+                                 &pipelineLayout);
+  if (error) {
+    return error;
+  }
+
+  VkPipeline pipeline = VK_NULL_HANDLE;
+  error = createComputePipeline(device, pipelineLayout,
+                                "vector_add_range.spv", nullptr, &pipeline);
+  if (error) {
+    return error;
+  }
+  const uint32_t maxGroupCount = limits.maxComputeWorkGroupCount[0];
+
+  // vectors of 16M integers tracked in 64KB pages
+  const uint32_t elementCount = 1 << 24;
+  const VkDeviceSize bufferSize = sizeof(int32_t) * elementCount;
+  const VkDeviceSize pageSize = 1 << 16;
+
+  VkPhysicalDeviceMemoryProperties memoryProperties;
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+  const VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                   VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+                                   VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+  // the host writes a and b in host visible memory and reads the result
+  // from it, the kernel uses copies of all three in device local memory
+  enum { A, B, RESULT, BUFFER_COUNT };
+  std::vector<VkBuffer> hostBuffers;
+  std::vector<VkDeviceSize> hostOffsets;
+  VkDeviceMemory hostMemory = VK_NULL_HANDLE;
+  error = createBuffers(device, memoryProperties,
+                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                        {bufferSize, bufferSize, bufferSize}, usage,
+                        queueFamilyIndex, hostBuffers, &hostMemory,
+                        hostOffsets);
+  if (error) {
+    return error;
+  }
+  std::vector<VkBuffer> deviceBuffers;
+  std::vector<VkDeviceSize> deviceOffsets;
+  VkDeviceMemory deviceMemory = VK_NULL_HANDLE;
+  error = createBuffers(device, memoryProperties,
+                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                        {bufferSize, bufferSize, bufferSize}, usage,
+                        queueFamilyIndex, deviceBuffers, &deviceMemory,
+                        deviceOffsets);
+  if (error) {
+    return error;
+  }
+
+  VkDescriptorPoolSize poolSize = {};
+  poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  poolSize.descriptorCount = 3;
+  VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = {};
+  descriptorPoolCreateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  descriptorPoolCreateInfo.maxSets = 1;
+  descriptorPoolCreateInfo.poolSizeCount = 1;
+  descriptorPoolCreateInfo.pPoolSizes = &poolSize;
+  VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+  error = vkCreateDescriptorPool(device, &descriptorPoolCreateInfo, nullptr,
+                                 &descriptorPool);
+  if (error) {
+    return error;
+  }
+
+  VkDescriptorSetAllocateInfo descriptorSetAllocateInfo = {};
+  descriptorSetAllocateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  descriptorSetAllocateInfo.descriptorPool = descriptorPool;
+  descriptorSetAllocateInfo.descriptorSetCount = 1;
+  descriptorSetAllocateInfo.pSetLayouts = &setLayout;
+  VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+  error = vkAllocateDescriptorSets(device, &descriptorSetAllocateInfo,
+                                   &descriptorSet);
+  if (error) {
+    return error;
+  }
+
+  VkDescriptorBufferInfo bufferInfos[BUFFER_COUNT];
+  std::vector<VkWriteDescriptorSet> descriptorSetWrites;
+  VkWriteDescriptorSet writeDescriptorSet = {};
+  writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  writeDescriptorSet.dstSet = descriptorSet;
+  writeDescriptorSet.dstArrayElement = 0;
+  writeDescriptorSet.descriptorCount = 1;
+  writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  for (uint32_t binding = 0; binding < BUFFER_COUNT; binding++) {
+    bufferInfos[binding] = {deviceBuffers[binding], 0, VK_WHOLE_SIZE};
+    writeDescriptorSet.dstBinding = binding;
+    writeDescriptorSet.pBufferInfo = &bufferInfos[binding];
+    descriptorSetWrites.push_back(writeDescriptorSet);
+  }
+  vkUpdateDescriptorSets(device, descriptorSetWrites.size(),
+                         descriptorSetWrites.data(), 0, nullptr);
+
+  char *data = nullptr;
+  error = vkMapMemory(device, hostMemory, 0, VK_WHOLE_SIZE, 0,
+                      reinterpret_cast<void **>(&data));
+  if (error) {
+    return error;
+  }
+  int32_t *inputData[2] = {
+      reinterpret_cast<int32_t *>(data + hostOffsets[A]),
+      reinterpret_cast<int32_t *>(data + hostOffsets[B])};
+  int32_t *resultData =
+      reinterpret_cast<int32_t *>(data + hostOffsets[RESULT]);
+  DirtyPages dirtyPages[2] = {createDirtyPages(bufferSize, pageSize),
+                              createDirtyPages(bufferSize, pageSize)};
+
+  // every write to a or b goes through here so its page is marked dirty
+  auto write = [&](uint32_t input, uint32_t index, int32_t value) {
+    inputData[input][index] = value;
+    markDirty(dirtyPages[input], sizeof(int32_t) * index, sizeof(int32_t));
+  };
+  VkQueryPool queryPool = VK_NULL_HANDLE;
+  if (timestampValidBits) {
+    VkQueryPoolCreateInfo queryPoolCreateInfo = {};
+    queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolCreateInfo.queryCount = 2;
+    error = vkCreateQueryPool(device, &queryPoolCreateInfo, nullptr,
+                              &queryPool);
+    if (error) {
+      return error;
+    }
+  }
+
+  VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+  commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+  commandPoolCreateInfo.queueFamilyIndex = queueFamilyIndex;
+  VkCommandPool commandPool = VK_NULL_HANDLE;
+  error = vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr,
+                              &commandPool);
+  if (error) {
+    return error;
+  }
+
+  VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
+  commandBufferAllocateInfo.sType =
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  commandBufferAllocateInfo.commandPool = commandPool;
+  commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  commandBufferAllocateInfo.commandBufferCount = 1;
+  VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+  error = vkAllocateCommandBuffers(device, &commandBufferAllocateInfo,
+                                   &commandBuffer);
+  if (error) {
+    return error;
+  }
+
+  // record the work of function into the command buffer, submit it, wait for
+  // it to complete and return the time between the timestamps in
+  // milliseconds, or 0 if timestamps are not supported
+  auto submit = [&](std::function<void()> function,
+                    double *milliseconds) -> VkResult {
+    VkResult result = vkResetCommandPool(device, commandPool, 0);
+    if (result) {
+      return result;
+    }
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    result = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    if (result) {
+      return result;
+    }
+    if (queryPool) {
+      vkCmdResetQueryPool(commandBuffer, queryPool, 0, 2);
+      vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                          queryPool, 0);
+    }
+    function();
+    if (queryPool) {
+      vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                          queryPool, 1);
+    }
+    result = vkEndCommandBuffer(commandBuffer);
+    if (result) {
+      return result;
+    }
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    result = vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+    if (result) {
+      return result;
+    }
+    vkQueueWaitIdle(queue);
+
+    *milliseconds = 0.0;
+    if (queryPool) {
+      uint64_t timestamps[2];
+      result = vkGetQueryPoolResults(
+          device, queryPool, 0, 2, sizeof(timestamps), timestamps,
+          sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+      if (result) {
+        return result;
+      }
+      *milliseconds =
+          (timestamps[1] - timestamps[0]) * limits.timestampPeriod * 1e-6;
+    }
+    return VK_SUCCESS;
+  };
+
+  // upload the regions of a and b, add the union of them and copy the same
+  // region of the result back
+  auto recordRegions = [&](const std::vector<VkBufferCopy> &regionsA,
+                           const std::vector<VkBufferCopy> &regionsB,
+                           const std::vector<VkBufferCopy> &regionsResult) {
+    if (!regionsA.empty()) {
+      vkCmdCopyBuffer(commandBuffer, hostBuffers[A], deviceBuffers[A],
+                      regionsA.size(), regionsA.data());
+    }
+    if (!regionsB.empty()) {
+      vkCmdCopyBuffer(commandBuffer, hostBuffers[B], deviceBuffers[B],
+                      regionsB.size(), regionsB.data());
+    }
+    recordBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                  VK_ACCESS_TRANSFER_WRITE_BIT,
+                  VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                  VK_ACCESS_SHADER_READ_BIT);
+    recordAddRegions(commandBuffer, pipelineLayout, pipeline, descriptorSet,
+                     regionsResult, maxGroupCount);
+    recordBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                  VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                  VK_ACCESS_TRANSFER_READ_BIT);
+    if (!regionsResult.empty()) {
+      vkCmdCopyBuffer(commandBuffer, deviceBuffers[RESULT],
+                      hostBuffers[RESULT], regionsResult.size(),
+                      regionsResult.data());
+    }
+  };
+
+  // the changes made between runs, the first writes everything
+  uint32_t seed = 42;
+  struct Update {
+    const char *name;
+    std::function<void()> apply;
+  };
+  const Update updates[] = {
+      {"initial values",
+       [&] {
+         for (uint32_t index = 0; index < elementCount; index++) {
+           write(0, index, nextRandom(seed) % 1000);
+           write(1, index, nextRandom(seed) % 1000);
+         }
+       }},
+      {"100 scattered values",
+       [&] {
+         for (uint32_t written = 0; written < 100; written++) {
+           write(written % 2, nextRandom(seed) % elementCount,
+                 nextRandom(seed) % 1000);
+         }
+       }},
+      {"1MB block of a",
+       [&] {
+         const uint32_t first = nextRandom(seed) % (elementCount - (1 << 18));
+         for (uint32_t index = first; index < first + (1 << 18); index++) {
+           write(0, index, nextRandom(seed) % 1000);
+         }
+       }},
+      {"every 4096th of b",
+       [&] {
+         for (uint32_t index = 0; index < elementCount; index += 4096) {
+           write(1, index, nextRandom(seed) % 1000);
+         }
+       }}};
+
+  printf("%-22s %8s %12s %16s %10s\n", "update", "regions", "uploaded MB",
+         "incremental ms", "full ms");
+  const std::vector<VkBufferCopy> wholeBuffer = {{0, 0, bufferSize}};
+  int failures = 0;
+  for (const Update &update : updates) {
+    update.apply();
+    const std::vector<VkBufferCopy> regionsA = takeDirtyRegions(dirtyPages[0]);
+    const std::vector<VkBufferCopy> regionsB = takeDirtyRegions(dirtyPages[1]);
+    const std::vector<VkBufferCopy> regionsResult =
+        mergeRegions(regionsA, regionsB);
+    VkDeviceSize uploadedSize = 0;
+    for (const VkBufferCopy &region : regionsA) {
+      uploadedSize += region.size;
+    }
+    for (const VkBufferCopy &region : regionsB) {
+      uploadedSize += region.size;
+    }
+
+    double incrementalMilliseconds;
+    error = submit([&] { recordRegions(regionsA, regionsB, regionsResult); },
+                   &incrementalMilliseconds);
+    if (error) {
+      return error;
+    }
+    // the result of the earlier runs is kept outside the recomputed regions
+    for (uint32_t index = 0; index < elementCount; index++) {
+      const int32_t expected = inputData[0][index] + inputData[1][index];
+      if (resultData[index] != expected) {
+        fprintf(stderr, "%s [%u] is '%d' not '%d'!\n", update.name, index,
+                resultData[index], expected);
+        failures++;
+        break;
+      }
+    }
+
+    // rewriting the whole of every buffer, as a run without tracking would
+    double fullMilliseconds;
+    error = submit(
+        [&] { recordRegions(wholeBuffer, wholeBuffer, wholeBuffer); },
+        &fullMilliseconds);
+    if (error) {
+      return error;
+    }
+    printf("%-22s %8zu %12.3f %16.3f %10.3f\n", update.name,
+           regionsA.size() + regionsB.size(), uploadedSize * 1e-6,
+           incrementalMilliseconds, fullMilliseconds);
+  }
+  vkUnmapMemory(device, hostMemory);
+
+  if (queryPool) {
+    vkDestroyQueryPool(device, queryPool, nullptr);
+  }
+  vkDestroyCommandPool(device, commandPool, nullptr);
+  vkFreeMemory(device, hostMemory, nullptr);
+  vkFreeMemory(device, deviceMemory, nullptr);
+  for (auto buffer : hostBuffers) {
+    vkDestroyBuffer(device, buffer, nullptr);
+  }
+  for (auto buffer : deviceBuffers) {
+    vkDestroyBuffer(device, buffer, nullptr);
+  }
+  vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+  vkDestroyPipeline(device, pipeline, nullptr);
+  vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+  vkDestroyDescriptorSetLayout(device, setLayout, nullptr);
+  vkDestroyDevice(device, nullptr);
+  vkDestroyInstance(instance, nullptr);
+
+  if (failures) {
+    return 1;
+  }
+  printf("success\n");
+
+  return 0;
+}
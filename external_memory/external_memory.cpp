@@ -0,0 +1,994 @@
+#include <vulkan/vulkan.h>
+
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// load a SPIR-V binary from disc
+std::vector<char> loadShaderCode(const char *filename) {
+  std::vector<char> shaderCode;
+  if (FILE *fp = fopen(filename, "rb")) {
+    char buf[1024];
+    while (size_t len = fread(buf, 1, sizeof(buf), fp)) {
+      shaderCode.insert(shaderCode.end(), buf, buf + len);
+    }
+    fclose(fp);
+  }
+  return shaderCode;
+}
+
+// search for compatible memory properties and return the memory type index
+int32_t findMemoryTypeFromProperties(
+    uint32_t memoryTypeBits, VkPhysicalDeviceMemoryProperties properties,
+    VkMemoryPropertyFlags requiredProperties) {
+  assert(properties.memoryTypeCount < 32u);
+  for (uint32_t index = 0; index < properties.memoryTypeCount; ++index) {
+    if (memoryTypeBits & (1u << index) &&
+        // Find the first memory type that supports all the required flags.
+        ((properties.memoryTypes[index].propertyFlags & requiredProperties) ==
+         requiredProperties)) {
+      return (int32_t)index;
+    }
+  }
+  return -1;
+}
+
+// create a compute pipeline from a SPIR-V binary found in SHADER_PATH
+VkResult createComputePipeline(VkDevice device, VkPipelineLayout layout,
+                               const char *filename,
+                               const VkSpecializationInfo *specializationInfo,
+                               VkPipeline *pipeline) {
+  auto shaderCode =
+      loadShaderCode((std::string(SHADER_PATH) + filename).c_str());
+  if (shaderCode.empty()) {
+    fprintf(stderr, "failed to load '%s'\n", filename);
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
+  shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  shaderModuleCreateInfo.pCode =
+      reinterpret_cast<uint32_t *>(shaderCode.data());
+  shaderModuleCreateInfo.codeSize = shaderCode.size();
+  VkShaderModule shaderModule = VK_NULL_HANDLE;
+  VkResult error = vkCreateShaderModule(device, &shaderModuleCreateInfo,
+                                        nullptr, &shaderModule);
+  if (error) {
+    return error;
+  }
+  VkComputePipelineCreateInfo pipelineCreateInfo = {};
+  pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineCreateInfo.stage.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipelineCreateInfo.stage.module = shaderModule;
+  pipelineCreateInfo.stage.pName = "main";
+  pipelineCreateInfo.stage.pSpecializationInfo = specializationInfo;
+  pipelineCreateInfo.layout = layout;
+  error = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1,
+                                   &pipelineCreateInfo, nullptr, pipeline);
+  vkDestroyShaderModule(device, shaderModule, nullptr);
+  return error;
+}
+
+const uint32_t elementCount = 1 << 24;
+const uint32_t seed = 12345;
+
+// sent from the producer to the consumer along with the memory and the
+// semaphore file descriptors, an opaque handle may only be imported by a
+// device with the same device and driver UUIDs, with the same allocation
+// size and memory type
+struct SharedBuffer {
+  uint8_t deviceUUID[VK_UUID_SIZE];
+  uint8_t driverUUID[VK_UUID_SIZE];
+  VkDeviceSize allocationSize;
+  uint32_t memoryTypeIndex;
+  uint32_t dedicated;
+};
+
+struct Device {
+  VkInstance instance;
+  VkPhysicalDevice physicalDevice;
+  VkDevice device;
+  VkQueue queue;
+  uint32_t queueFamilyIndex;
+  VkPhysicalDeviceMemoryProperties memoryProperties;
+  uint32_t maxGroupCount;
+  uint8_t deviceUUID[VK_UUID_SIZE];
+  uint8_t driverUUID[VK_UUID_SIZE];
+  // whether buffer memory must be a dedicated allocation to be exported
+  bool dedicatedOnly;
+  PFN_vkGetMemoryFdKHR vkGetMemoryFdKHR;
+  PFN_vkGetSemaphoreFdKHR vkGetSemaphoreFdKHR;
+  PFN_vkImportSemaphoreFdKHR vkImportSemaphoreFdKHR;
+};
+
+struct Kernel {
+  VkDescriptorSetLayout setLayout;
+  VkPipelineLayout pipelineLayout;
+  VkPipeline pipeline;
+  VkDescriptorPool descriptorPool;
+  VkDescriptorSet descriptorSet;
+};
+
+struct PushConstants {
+  uint32_t count;
+  uint32_t seed;
+};
+
+uint32_t divideRoundUp(uint32_t value, uint32_t divisor) {
+  return (value + divisor - 1) / divisor;
+}
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+bool hasExtension(const std::vector<VkExtensionProperties> &extensions,
+                  const char *name) {
+  for (auto &extension : extensions) {
+    if (!strcmp(extension.extensionName, name)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// whether physicalDevice can export and import storage buffers and
+// semaphores as opaque file descriptors
+bool supportsOpaqueFds(VkPhysicalDevice physicalDevice, bool *dedicatedOnly) {
+  uint32_t count;
+  if (vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &count,
+                                           nullptr)) {
+    return false;
+  }
+  std::vector<VkExtensionProperties> extensions(count);
+  if (vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &count,
+                                           extensions.data())) {
+    return false;
+  }
+  if (!hasExtension(extensions, VK_KHR_EXTERNAL_MEMORY_FD_EXTENSION_NAME) ||
+      !hasExtension(extensions, VK_KHR_EXTERNAL_SEMAPHORE_FD_EXTENSION_NAME)) {
+    return false;
+  }
+
+  VkPhysicalDeviceExternalBufferInfo bufferInfo = {};
+  bufferInfo.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_BUFFER_INFO;
+  bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+  bufferInfo.handleType = VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_FD_BIT;
+  VkExternalBufferProperties bufferProperties = {};
+  bufferProperties.sType = VK_STRUCTURE_TYPE_EXTERNAL_BUFFER_PROPERTIES;
+  vkGetPhysicalDeviceExternalBufferProperties(physicalDevice, &bufferInfo,
+                                              &bufferProperties);
+  const VkExternalMemoryFeatureFlags memoryFeatures =
+      bufferProperties.externalMemoryProperties.externalMemoryFeatures;
+  const VkExternalMemoryFeatureFlags requiredMemoryFeatures =
+      VK_EXTERNAL_MEMORY_FEATURE_EXPORTABLE_BIT |
+      VK_EXTERNAL_MEMORY_FEATURE_IMPORTABLE_BIT;
+  *dedicatedOnly =
+      memoryFeatures & VK_EXTERNAL_MEMORY_FEATURE_DEDICATED_ONLY_BIT;
+
+  VkPhysicalDeviceExternalSemaphoreInfo semaphoreInfo = {};
+  semaphoreInfo.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_SEMAPHORE_INFO;
+  semaphoreInfo.handleType = VK_EXTERNAL_SEMAPHORE_HANDLE_TYPE_OPAQUE_FD_BIT;
+  VkExternalSemaphoreProperties semaphoreProperties = {};
+  semaphoreProperties.sType = VK_STRUCTURE_TYPE_EXTERNAL_SEMAPHORE_PROPERTIES;
+  vkGetPhysicalDeviceExternalSemaphoreProperties(
+      physicalDevice, &semaphoreInfo, &semaphoreProperties);
+  const VkExternalSemaphoreFeatureFlags requiredSemaphoreFeatures =
+      VK_EXTERNAL_SEMAPHORE_FEATURE_EXPORTABLE_BIT |
+      VK_EXTERNAL_SEMAPHORE_FEATURE_IMPORTABLE_BIT;
+
+  return (memoryFeatures & requiredMemoryFeatures) == requiredMemoryFeatures &&
+         (semaphoreProperties.externalSemaphoreFeatures &
+          requiredSemaphoreFeatures) == requiredSemaphoreFeatures;
+}
+
+// create a device able to share buffers and semaphores as opaque file
+// descriptors, when shared is not null it must also be the device which
+// exported them
+VkResult createDevice(const SharedBuffer *shared, Device *device) {
+  VkApplicationInfo applicationInfo = {};
+  applicationInfo.pApplicationName = "Vulkan external memory example";
+  // external memory and semaphores are core in Vulkan 1.1, exporting them as
+  // file descriptors is not
+  applicationInfo.apiVersion = VK_API_VERSION_1_1;
+
+  VkInstanceCreateInfo instanceCreateInfo = {};
+  instanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+  instanceCreateInfo.pApplicationInfo = &applicationInfo;
+#ifdef ENABLE_LAYERS
+  // without a debug report callback, see vector_add, the validation layer
+  // prints its messages to stdout
+  std::vector<const char *> enabledLayerNames{"VK_LAYER_KHRONOS_validation"};
+  instanceCreateInfo.enabledLayerCount = enabledLayerNames.size();
+  instanceCreateInfo.ppEnabledLayerNames = enabledLayerNames.data();
+#endif
+
+  VkResult error =
+      vkCreateInstance(&instanceCreateInfo, nullptr, &device->instance);
+  if (error) {
+    return error;
+  }
+
+  uint32_t count;
+  error = vkEnumeratePhysicalDevices(device->instance, &count, nullptr);
+  if (error) {
+    return error;
+  }
+  std::vector<VkPhysicalDevice> physicalDevices(count);
+  error = vkEnumeratePhysicalDevices(device->instance, &count,
+                                     physicalDevices.data());
+  if (error) {
+    return error;
+  }
+
+  for (auto physicalDevice : physicalDevices) {
+    VkPhysicalDeviceIDProperties idProperties = {};
+    idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+    VkPhysicalDeviceProperties2 properties = {};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &idProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties.properties);
+    if (properties.properties.apiVersion < VK_API_VERSION_1_1) {
+      continue;
+    }
+    vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+    if (shared &&
+        (memcmp(idProperties.deviceUUID, shared->deviceUUID, VK_UUID_SIZE) ||
+         memcmp(idProperties.driverUUID, shared->driverUUID, VK_UUID_SIZE))) {
+      continue;
+    }
+    bool dedicatedOnly;
+    if (!supportsOpaqueFds(physicalDevice, &dedicatedOnly)) {
+      continue;
+    }
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &count, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilyProperties(count);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &count,
+                                             queueFamilyProperties.data());
+    for (uint32_t index = 0; index < count; index++) {
+      if (queueFamilyProperties[index].queueFlags & VK_QUEUE_COMPUTE_BIT) {
+        device->physicalDevice = physicalDevice;
+        device->queueFamilyIndex = index;
+        break;
+      }
+    }
+    if (device->physicalDevice) {
+      device->maxGroupCount =
+          properties.properties.limits.maxComputeWorkGroupCount[0];
+      memcpy(device->deviceUUID, idProperties.deviceUUID, VK_UUID_SIZE);
+      memcpy(device->driverUUID, idProperties.driverUUID, VK_UUID_SIZE);
+      device->dedicatedOnly = dedicatedOnly;
+      break;
+    }
+  }
+  if (!device->physicalDevice) {
+    fprintf(stderr, "no Vulkan 1.1 device sharing buffers and semaphores as "
+                    "opaque file descriptors\n");
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+  }
+  vkGetPhysicalDeviceMemoryProperties(device->physicalDevice,
+                                      &device->memoryProperties);
+
+  VkDeviceQueueCreateInfo queueCreateInfo = {};
+  queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+  queueCreateInfo.queueCount = 1;
+  queueCreateInfo.queueFamilyIndex = device->queueFamilyIndex;
+  float queuePriority = 1.0f;
+  queueCreateInfo.pQueuePriorities = &queuePriority;
+
+  std::vector<const char *> extensionNames{
+      VK_KHR_EXTERNAL_MEMORY_FD_EXTENSION_NAME,
+      VK_KHR_EXTERNAL_SEMAPHORE_FD_EXTENSION_NAME};
+  VkDeviceCreateInfo deviceCreateInfo = {};
+  deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+  deviceCreateInfo.queueCreateInfoCount = 1;
+  deviceCreateInfo.pQueueCreateInfos = &queueCreateInfo;
+  deviceCreateInfo.enabledExtensionCount = extensionNames.size();
+  deviceCreateInfo.ppEnabledExtensionNames = extensionNames.data();
+  error = vkCreateDevice(device->physicalDevice, &deviceCreateInfo, nullptr,
+                         &device->device);
+  if (error) {
+    return error;
+  }
+  vkGetDeviceQueue(device->device, device->queueFamilyIndex, 0,
+                   &device->queue);
+
+  device->vkGetMemoryFdKHR = reinterpret_cast<PFN_vkGetMemoryFdKHR>(
+      vkGetDeviceProcAddr(device->device, "vkGetMemoryFdKHR"));
+  device->vkGetSemaphoreFdKHR = reinterpret_cast<PFN_vkGetSemaphoreFdKHR>(
+      vkGetDeviceProcAddr(device->device, "vkGetSemaphoreFdKHR"));
+  device->vkImportSemaphoreFdKHR =
+      reinterpret_cast<PFN_vkImportSemaphoreFdKHR>(
+          vkGetDeviceProcAddr(device->device, "vkImportSemaphoreFdKHR"));
+  if (!device->vkGetMemoryFdKHR || !device->vkGetSemaphoreFdKHR ||
+      !device->vkImportSemaphoreFdKHR) {
+    return VK_ERROR_EXTENSION_NOT_PRESENT;
+  }
+  return VK_SUCCESS;
+}
+
+void destroyDevice(Device &device) {
+  if (device.device) {
+    vkDestroyDevice(device.device, nullptr);
+  }
+  if (device.instance) {
+    vkDestroyInstance(device.instance, nullptr);
+  }
+}
+
+// create the pipeline of the shader in filename, whose storage buffers are
+// bound to the first bindingCount bindings of its descriptor set
+VkResult createKernel(VkDevice device, const char *filename,
+                      uint32_t bindingCount, Kernel *kernel) {
+  std::vector<VkDescriptorSetLayoutBinding> layoutBindings;
+  VkDescriptorSetLayoutBinding layoutBinding = {};
+  layoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  layoutBinding.descriptorCount = 1;
+  layoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  for (uint32_t binding = 0; binding < bindingCount; binding++) {
+    layoutBinding.binding = binding;
+    layoutBindings.push_back(layoutBinding);
+  }
+
+  VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo = {};
+  setLayoutCreateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  setLayoutCreateInfo.bindingCount = layoutBindings.size();
+  setLayoutCreateInfo.pBindings = layoutBindings.data();
+  VkResult error = vkCreateDescriptorSetLayout(device, &setLayoutCreateInfo,
+                                               nullptr, &kernel->setLayout);
+  if (error) {
+    return error;
+  }
+
+  VkPushConstantRange pushConstantRange = {};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(PushConstants);
+
+  VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+  pipelineLayoutCreateInfo.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutCreateInfo.setLayoutCount = 1;
+  pipelineLayoutCreateInfo.pSetLayouts = &kernel->setLayout;
+  pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+  pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+  error = vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr,
+                                 &kernel->pipelineLayout);
+  if (error) {
+    return error;
+  }
+  error = createComputePipeline(device, kernel->pipelineLayout, filename,
+                                nullptr, &kernel->pipeline);
+  if (error) {
+    return error;
+  }
+
+  VkDescriptorPoolSize poolSize = {};
+  poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  poolSize.descriptorCount = bindingCount;
+  VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = {};
+  descriptorPoolCreateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  descriptorPoolCreateInfo.maxSets = 1;
+  descriptorPoolCreateInfo.poolSizeCount = 1;
+  descriptorPoolCreateInfo.pPoolSizes = &poolSize;
+  error = vkCreateDescriptorPool(device, &descriptorPoolCreateInfo, nullptr,
+                                 &kernel->descriptorPool);
+  if (error) {
+    return error;
+  }
+
+  VkDescriptorSetAllocateInfo descriptorSetAllocateInfo = {};
+  descriptorSetAllocateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  descriptorSetAllocateInfo.descriptorPool = kernel->descriptorPool;
+  descriptorSetAllocateInfo.descriptorSetCount = 1;
+  descriptorSetAllocateInfo.pSetLayouts = &kernel->setLayout;
+  return vkAllocateDescriptorSets(device, &descriptorSetAllocateInfo,
+                                  &kernel->descriptorSet);
+}
+
+void destroyKernel(VkDevice device, Kernel &kernel) {
+  vkDestroyDescriptorPool(device, kernel.descriptorPool, nullptr);
+  vkDestroyPipeline(device, kernel.pipeline, nullptr);
+  vkDestroyPipelineLayout(device, kernel.pipelineLayout, nullptr);
+  vkDestroyDescriptorSetLayout(device, kernel.setLayout, nullptr);
+}
+
+// bind buffers to the kernel and record its dispatch over count elements
+void recordKernel(VkCommandBuffer commandBuffer, VkDevice device,
+                  const Kernel &kernel, const std::vector<VkBuffer> &buffers,
+                  uint32_t count, uint32_t maxGroupCount) {
+  std::vector<VkDescriptorBufferInfo> bufferInfos(buffers.size());
+  std::vector<VkWriteDescriptorSet> writeDescriptorSets(buffers.size());
+  for (uint32_t binding = 0; binding < buffers.size(); binding++) {
+    bufferInfos[binding] = {buffers[binding], 0, VK_WHOLE_SIZE};
+    writeDescriptorSets[binding] = {};
+    writeDescriptorSets[binding].sType =
+        VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writeDescriptorSets[binding].dstSet = kernel.descriptorSet;
+    writeDescriptorSets[binding].dstBinding = binding;
+    writeDescriptorSets[binding].descriptorCount = 1;
+    writeDescriptorSets[binding].descriptorType =
+        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    writeDescriptorSets[binding].pBufferInfo = &bufferInfos[binding];
+  }
+  vkUpdateDescriptorSets(device, writeDescriptorSets.size(),
+                         writeDescriptorSets.data(), 0, nullptr);
+
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                    kernel.pipeline);
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                          kernel.pipelineLayout, 0, 1, &kernel.descriptorSet,
+                          0, nullptr);
+  PushConstants pushConstants = {count, seed};
+  vkCmdPushConstants(commandBuffer, kernel.pipelineLayout,
+                     VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pushConstants),
+                     &pushConstants);
+  vkCmdDispatch(commandBuffer,
+                std::min(divideRoundUp(count, 256), maxGroupCount), 1, 1);
+}
+
+// create a storage buffer of size bytes which may be bound to memory shared
+// as an opaque file descriptor
+VkResult createSharedBuffer(const Device &device, VkDeviceSize size,
+                            VkBuffer *buffer) {
+  VkExternalMemoryBufferCreateInfo externalCreateInfo = {};
+  externalCreateInfo.sType =
+      VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_BUFFER_CREATE_INFO;
+  externalCreateInfo.handleTypes =
+      VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_FD_BIT;
+  VkBufferCreateInfo bufferCreateInfo = {};
+  bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  bufferCreateInfo.pNext = &externalCreateInfo;
+  bufferCreateInfo.size = size;
+  bufferCreateInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+  bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  bufferCreateInfo.queueFamilyIndexCount = 1;
+  bufferCreateInfo.pQueueFamilyIndices = &device.queueFamilyIndex;
+  return vkCreateBuffer(device.device, &bufferCreateInfo, nullptr, buffer);
+}
+
+// the queue family ownership transfer of a shared buffer to or from the
+// external queue family, which is the other process
+VkBufferMemoryBarrier sharedBufferBarrier(VkBuffer buffer, bool release,
+                                          uint32_t queueFamilyIndex) {
+  VkBufferMemoryBarrier barrier = {};
+  barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  barrier.srcAccessMask = release ? VK_ACCESS_SHADER_WRITE_BIT : 0;
+  barrier.dstAccessMask = release ? 0 : VK_ACCESS_SHADER_READ_BIT;
+  barrier.srcQueueFamilyIndex =
+      release ? queueFamilyIndex : VK_QUEUE_FAMILY_EXTERNAL;
+  barrier.dstQueueFamilyIndex =
+      release ? VK_QUEUE_FAMILY_EXTERNAL : queueFamilyIndex;
+  barrier.buffer = buffer;
+  barrier.offset = 0;
+  barrier.size = VK_WHOLE_SIZE;
+  return barrier;
+}
+
+// send data with files attached as SCM_RIGHTS, the receiver gets its own
+// descriptors of the same memory and semaphore payloads
+bool sendWithFiles(int socket, const void *data, size_t size,
+                   const int *files, uint32_t fileCount) {
+  iovec vector = {const_cast<void *>(data), size};
+  msghdr message = {};
+  message.msg_iov = &vector;
+  message.msg_iovlen = 1;
+  char control[CMSG_SPACE(2 * sizeof(int))] = {};
+  if (fileCount) {
+    assert(fileCount <= 2);
+    message.msg_control = control;
+    message.msg_controllen = CMSG_SPACE(fileCount * sizeof(int));
+    cmsghdr *header = CMSG_FIRSTHDR(&message);
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type = SCM_RIGHTS;
+    header->cmsg_len = CMSG_LEN(fileCount * sizeof(int));
+    memcpy(CMSG_DATA(header), files, fileCount * sizeof(int));
+  }
+  return sendmsg(socket, &message, MSG_NOSIGNAL) == ssize_t(size);
+}
+
+// receive size bytes of data and up to two attached files, missing files
+// are -1
+bool receiveWithFiles(int socket, void *data, size_t size, int *files,
+                      uint32_t fileCount) {
+  iovec vector = {data, size};
+  msghdr message = {};
+  message.msg_iov = &vector;
+  message.msg_iovlen = 1;
+  char control[CMSG_SPACE(2 * sizeof(int))];
+  message.msg_control = control;
+  message.msg_controllen = sizeof(control);
+  for (uint32_t index = 0; index < fileCount; index++) {
+    files[index] = -1;
+  }
+  if (recvmsg(socket, &message, MSG_WAITALL | MSG_CMSG_CLOEXEC) !=
+      ssize_t(size)) {
+    return false;
+  }
+  cmsghdr *header = CMSG_FIRSTHDR(&message);
+  if (header && header->cmsg_level == SOL_SOCKET &&
+      header->cmsg_type == SCM_RIGHTS) {
+    const uint32_t received =
+        (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    memcpy(files, CMSG_DATA(header),
+           std::min(received, fileCount) * sizeof(int));
+  }
+  return true;
+}
+
+// the producer writes its result into device local memory it exports, then
+// signals an exported semaphore the consumer waits on
+VkResult runProducer(int socket) {
+  Device device = {};
+  VkResult error = createDevice(nullptr, &device);
+  if (error) {
+    return error;
+  }
+
+  const VkDeviceSize size = sizeof(uint32_t) * elementCount;
+  VkBuffer buffer;
+  error = createSharedBuffer(device, size, &buffer);
+  if (error) {
+    return error;
+  }
+  VkMemoryRequirements memoryRequirements;
+  vkGetBufferMemoryRequirements(device.device, buffer, &memoryRequirements);
+  auto memoryTypeIndex = findMemoryTypeFromProperties(
+      memoryRequirements.memoryTypeBits, device.memoryProperties,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  if (0 > memoryTypeIndex) {
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+  }
+
+  VkMemoryDedicatedAllocateInfo dedicatedInfo = {};
+  dedicatedInfo.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+  dedicatedInfo.buffer = buffer;
+  VkExportMemoryAllocateInfo exportMemoryInfo = {};
+  exportMemoryInfo.sType = VK_STRUCTURE_TYPE_EXPORT_MEMORY_ALLOCATE_INFO;
+  exportMemoryInfo.pNext = device.dedicatedOnly ? &dedicatedInfo : nullptr;
+  exportMemoryInfo.handleTypes = VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_FD_BIT;
+  VkMemoryAllocateInfo allocateInfo = {};
+  allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocateInfo.pNext = &exportMemoryInfo;
+  allocateInfo.allocationSize = memoryRequirements.size;
+  allocateInfo.memoryTypeIndex = memoryTypeIndex;
+  VkDeviceMemory memory;
+  error = vkAllocateMemory(device.device, &allocateInfo, nullptr, &memory);
+  if (error) {
+    return error;
+  }
+  error = vkBindBufferMemory(device.device, buffer, memory, 0);
+  if (error) {
+    return error;
+  }
+
+  VkExportSemaphoreCreateInfo exportSemaphoreInfo = {};
+  exportSemaphoreInfo.sType = VK_STRUCTURE_TYPE_EXPORT_SEMAPHORE_CREATE_INFO;
+  exportSemaphoreInfo.handleTypes =
+      VK_EXTERNAL_SEMAPHORE_HANDLE_TYPE_OPAQUE_FD_BIT;
+  VkSemaphoreCreateInfo semaphoreCreateInfo = {};
+  semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+  semaphoreCreateInfo.pNext = &exportSemaphoreInfo;
+  VkSemaphore semaphore;
+  error = vkCreateSemaphore(device.device, &semaphoreCreateInfo, nullptr,
+                            &semaphore);
+  if (error) {
+    return error;
+  }
+
+  // each export creates a new file descriptor referencing the payload
+  int files[2];
+  VkMemoryGetFdInfoKHR memoryGetFdInfo = {};
+  memoryGetFdInfo.sType = VK_STRUCTURE_TYPE_MEMORY_GET_FD_INFO_KHR;
+  memoryGetFdInfo.memory = memory;
+  memoryGetFdInfo.handleType = VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_FD_BIT;
+  error = device.vkGetMemoryFdKHR(device.device, &memoryGetFdInfo, &files[0]);
+  if (error) {
+    return error;
+  }
+  VkSemaphoreGetFdInfoKHR semaphoreGetFdInfo = {};
+  semaphoreGetFdInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_GET_FD_INFO_KHR;
+  semaphoreGetFdInfo.semaphore = semaphore;
+  semaphoreGetFdInfo.handleType =
+      VK_EXTERNAL_SEMAPHORE_HANDLE_TYPE_OPAQUE_FD_BIT;
+  error = device.vkGetSemaphoreFdKHR(device.device, &semaphoreGetFdInfo,
+                                     &files[1]);
+  if (error) {
+    return error;
+  }
+
+  Kernel kernel;
+  error = createKernel(device.device, "produce.spv", 1, &kernel);
+  if (error) {
+    return error;
+  }
+
+  VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+  commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  commandPoolCreateInfo.queueFamilyIndex = device.queueFamilyIndex;
+  VkCommandPool commandPool;
+  error = vkCreateCommandPool(device.device, &commandPoolCreateInfo, nullptr,
+                              &commandPool);
+  if (error) {
+    return error;
+  }
+  VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
+  commandBufferAllocateInfo.sType =
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  commandBufferAllocateInfo.commandPool = commandPool;
+  commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  commandBufferAllocateInfo.commandBufferCount = 1;
+  VkCommandBuffer commandBuffer;
+  error = vkAllocateCommandBuffers(device.device, &commandBufferAllocateInfo,
+                                   &commandBuffer);
+  if (error) {
+    return error;
+  }
+  VkCommandBufferBeginInfo beginInfo = {};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  error = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+  if (error) {
+    return error;
+  }
+  recordKernel(commandBuffer, device.device, kernel, {buffer}, elementCount,
+               device.maxGroupCount);
+  // release the buffer to the consumer, the semaphore signal makes the
+  // writes available to it
+  auto barrier = sharedBufferBarrier(buffer, true, device.queueFamilyIndex);
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 1,
+                       &barrier, 0, nullptr);
+  error = vkEndCommandBuffer(commandBuffer);
+  if (error) {
+    return error;
+  }
+
+  SharedBuffer shared = {};
+  memcpy(shared.deviceUUID, device.deviceUUID, VK_UUID_SIZE);
+  memcpy(shared.driverUUID, device.driverUUID, VK_UUID_SIZE);
+  shared.allocationSize = allocateInfo.allocationSize;
+  shared.memoryTypeIndex = allocateInfo.memoryTypeIndex;
+  shared.dedicated = device.dedicatedOnly;
+  bool sent = sendWithFiles(socket, &shared, sizeof(shared), files, 2);
+  // the consumer received its own descriptors
+  close(files[0]);
+  close(files[1]);
+  if (!sent) {
+    perror("producer");
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+
+  // a binary semaphore's signal must be submitted before a wait on it, so
+  // the consumer imports while the producer submits then waits for the
+  // second message
+  auto start = std::chrono::steady_clock::now();
+  VkSubmitInfo submitInfo = {};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &commandBuffer;
+  submitInfo.signalSemaphoreCount = 1;
+  submitInfo.pSignalSemaphores = &semaphore;
+  error = vkQueueSubmit(device.queue, 1, &submitInfo, VK_NULL_HANDLE);
+  if (error) {
+    return error;
+  }
+  const char submitted = 1;
+  if (!sendWithFiles(socket, &submitted, 1, nullptr, 0)) {
+    perror("producer");
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  error = vkQueueWaitIdle(device.queue);
+  if (error) {
+    return error;
+  }
+  printf("producer: wrote %.0f MB to exported memory in %.3f ms\n",
+         size / (1024.0 * 1024.0), millisecondsSince(start));
+  fflush(stdout);
+
+  // the imported payload outlives the producer's memory object, waiting for
+  // the consumer only keeps the output in order
+  char done;
+  if (!receiveWithFiles(socket, &done, 1, nullptr, 0)) {
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+
+  vkDestroyCommandPool(device.device, commandPool, nullptr);
+  destroyKernel(device.device, kernel);
+  vkDestroySemaphore(device.device, semaphore, nullptr);
+  vkFreeMemory(device.device, memory, nullptr);
+  vkDestroyBuffer(device.device, buffer, nullptr);
+  destroyDevice(device);
+  return VK_SUCCESS;
+}
+
+// the consumer imports the producer's memory and semaphore then reads the
+// buffer in its own kernel, the data never leaves device memory
+VkResult runConsumer(int socket) {
+  SharedBuffer shared;
+  int files[2];
+  if (!receiveWithFiles(socket, &shared, sizeof(shared), files, 2) ||
+      files[0] == -1 || files[1] == -1) {
+    perror("consumer");
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+
+  Device device = {};
+  VkResult error = createDevice(&shared, &device);
+  if (error) {
+    return error;
+  }
+
+  // the imported buffer must be created as the exported one was
+  const VkDeviceSize size = sizeof(uint32_t) * elementCount;
+  VkBuffer buffer;
+  error = createSharedBuffer(device, size, &buffer);
+  if (error) {
+    return error;
+  }
+  VkMemoryRequirements memoryRequirements;
+  vkGetBufferMemoryRequirements(device.device, buffer, &memoryRequirements);
+  if (memoryRequirements.size > shared.allocationSize ||
+      !(memoryRequirements.memoryTypeBits & (1u << shared.memoryTypeIndex))) {
+    fprintf(stderr, "consumer: the shared memory does not fit the buffer\n");
+    return VK_ERROR_INVALID_EXTERNAL_HANDLE;
+  }
+
+  VkMemoryDedicatedAllocateInfo dedicatedInfo = {};
+  dedicatedInfo.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+  dedicatedInfo.buffer = buffer;
+  VkImportMemoryFdInfoKHR importMemoryInfo = {};
+  importMemoryInfo.sType = VK_STRUCTURE_TYPE_IMPORT_MEMORY_FD_INFO_KHR;
+  importMemoryInfo.pNext = shared.dedicated ? &dedicatedInfo : nullptr;
+  importMemoryInfo.handleType = VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_FD_BIT;
+  importMemoryInfo.fd = files[0];
+  VkMemoryAllocateInfo allocateInfo = {};
+  allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocateInfo.pNext = &importMemoryInfo;
+  allocateInfo.allocationSize = shared.allocationSize;
+  allocateInfo.memoryTypeIndex = shared.memoryTypeIndex;
+  // a successful import takes ownership of the file descriptor
+  VkDeviceMemory memory;
+  error = vkAllocateMemory(device.device, &allocateInfo, nullptr, &memory);
+  if (error) {
+    return error;
+  }
+  error = vkBindBufferMemory(device.device, buffer, memory, 0);
+  if (error) {
+    return error;
+  }
+
+  VkSemaphoreCreateInfo semaphoreCreateInfo = {};
+  semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+  VkSemaphore semaphore;
+  error = vkCreateSemaphore(device.device, &semaphoreCreateInfo, nullptr,
+                            &semaphore);
+  if (error) {
+    return error;
+  }
+  // a permanent import, the semaphore now shares the producer's payload
+  VkImportSemaphoreFdInfoKHR importSemaphoreInfo = {};
+  importSemaphoreInfo.sType = VK_STRUCTURE_TYPE_IMPORT_SEMAPHORE_FD_INFO_KHR;
+  importSemaphoreInfo.semaphore = semaphore;
+  importSemaphoreInfo.handleType =
+      VK_EXTERNAL_SEMAPHORE_HANDLE_TYPE_OPAQUE_FD_BIT;
+  importSemaphoreInfo.fd = files[1];
+  error = device.vkImportSemaphoreFdKHR(device.device, &importSemaphoreInfo);
+  if (error) {
+    return error;
+  }
+
+  // only the check of the result goes through host memory
+  VkBufferCreateInfo bufferCreateInfo = {};
+  bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  bufferCreateInfo.size = size;
+  bufferCreateInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+  bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  bufferCreateInfo.queueFamilyIndexCount = 1;
+  bufferCreateInfo.pQueueFamilyIndices = &device.queueFamilyIndex;
+  VkBuffer resultBuffer;
+  error = vkCreateBuffer(device.device, &bufferCreateInfo, nullptr,
+                         &resultBuffer);
+  if (error) {
+    return error;
+  }
+  vkGetBufferMemoryRequirements(device.device, resultBuffer,
+                                &memoryRequirements);
+  auto memoryTypeIndex = findMemoryTypeFromProperties(
+      memoryRequirements.memoryTypeBits, device.memoryProperties,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  if (0 > memoryTypeIndex) {
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+  }
+  VkMemoryAllocateInfo resultAllocateInfo = {};
+  resultAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  resultAllocateInfo.allocationSize = memoryRequirements.size;
+  resultAllocateInfo.memoryTypeIndex = memoryTypeIndex;
+  VkDeviceMemory resultMemory;
+  error = vkAllocateMemory(device.device, &resultAllocateInfo, nullptr,
+                           &resultMemory);
+  if (error) {
+    return error;
+  }
+  error = vkBindBufferMemory(device.device, resultBuffer, resultMemory, 0);
+  if (error) {
+    return error;
+  }
+
+  Kernel kernel;
+  error = createKernel(device.device, "consume.spv", 2, &kernel);
+  if (error) {
+    return error;
+  }
+
+  VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+  commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  commandPoolCreateInfo.queueFamilyIndex = device.queueFamilyIndex;
+  VkCommandPool commandPool;
+  error = vkCreateCommandPool(device.device, &commandPoolCreateInfo, nullptr,
+                              &commandPool);
+  if (error) {
+    return error;
+  }
+  VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
+  commandBufferAllocateInfo.sType =
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  commandBufferAllocateInfo.commandPool = commandPool;
+  commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  commandBufferAllocateInfo.commandBufferCount = 1;
+  VkCommandBuffer commandBuffer;
+  error = vkAllocateCommandBuffers(device.device, &commandBufferAllocateInfo,
+                                   &commandBuffer);
+  if (error) {
+    return error;
+  }
+  VkCommandBufferBeginInfo beginInfo = {};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  error = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+  if (error) {
+    return error;
+  }
+  // acquire the buffer released by the producer
+  auto barrier = sharedBufferBarrier(buffer, false, device.queueFamilyIndex);
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 1,
+                       &barrier, 0, nullptr);
+  recordKernel(commandBuffer, device.device, kernel, {buffer, resultBuffer},
+               elementCount, device.maxGroupCount);
+  VkMemoryBarrier hostBarrier = {};
+  hostBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  hostBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &hostBarrier, 0,
+                       nullptr, 0, nullptr);
+  error = vkEndCommandBuffer(commandBuffer);
+  if (error) {
+    return error;
+  }
+
+  char submitted;
+  if (!receiveWithFiles(socket, &submitted, 1, nullptr, 0)) {
+    perror("consumer");
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  auto start = std::chrono::steady_clock::now();
+  VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+  VkSubmitInfo submitInfo = {};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.waitSemaphoreCount = 1;
+  submitInfo.pWaitSemaphores = &semaphore;
+  submitInfo.pWaitDstStageMask = &waitStage;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &commandBuffer;
+  error = vkQueueSubmit(device.queue, 1, &submitInfo, VK_NULL_HANDLE);
+  if (error) {
+    return error;
+  }
+  error = vkQueueWaitIdle(device.queue);
+  if (error) {
+    return error;
+  }
+  printf("consumer: read %.0f MB of imported memory in %.3f ms\n",
+         size / (1024.0 * 1024.0), millisecondsSince(start));
+
+  uint32_t *result;
+  error = vkMapMemory(device.device, resultMemory, 0, VK_WHOLE_SIZE, 0,
+                      reinterpret_cast<void **>(&result));
+  if (error) {
+    return error;
+  }
+  for (uint32_t index = 0; index < elementCount; index++) {
+    const uint32_t expected = (index * 3 + seed) * 2;
+    if (result[index] != expected) {
+      fprintf(stderr, "consumer: result[%u] is %u expected %u\n", index,
+              result[index], expected);
+      error = VK_ERROR_UNKNOWN;
+      break;
+    }
+  }
+  vkUnmapMemory(device.device, resultMemory);
+  fflush(stdout);
+
+  const char done = 1;
+  if (!sendWithFiles(socket, &done, 1, nullptr, 0)) {
+    perror("consumer");
+  }
+
+  vkDestroyCommandPool(device.device, commandPool, nullptr);
+  destroyKernel(device.device, kernel);
+  vkFreeMemory(device.device, resultMemory, nullptr);
+  vkDestroyBuffer(device.device, resultBuffer, nullptr);
+  vkDestroySemaphore(device.device, semaphore, nullptr);
+  vkFreeMemory(device.device, memory, nullptr);
+  vkDestroyBuffer(device.device, buffer, nullptr);
+  destroyDevice(device);
+  return error;
+}
+
+// run one of the processes in a child on its end of the socket, returning its
+// process id, the child closes the other end so it sees the socket close if
+// the other process exits early instead of waiting on it forever
+template <class Process> pid_t spawn(Process process, int socket, int peer) {
+  fflush(stdout);
+  pid_t child = fork();
+  if (child == 0) {
+    close(peer);
+    VkResult error = process(socket);
+    if (error) {
+      fprintf(stderr, "failed with %d\n", error);
+    }
+    fflush(stdout);
+    _exit(error ? 1 : 0);
+  }
+  return child;
+}
+
+// wait for the process and return 0 if it exited successfully
+int waitFor(pid_t process) {
+  int status;
+  if (process == -1 || waitpid(process, &status, 0) != process) {
+    return 1;
+  }
+  return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+}
+
+int main() {
+  // each process creates its own instance and device, so fork first
+  int sockets[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets)) {
+    perror("socketpair");
+    return 1;
+  }
+  pid_t producer = spawn(runProducer, sockets[0], sockets[1]);
+  pid_t consumer = spawn(runConsumer, sockets[1], sockets[0]);
+  close(sockets[0]);
+  close(sockets[1]);
+
+  int failures = waitFor(producer);
+  failures += waitFor(consumer);
+  if (failures) {
+    return 1;
+  }
+
+  printf("success\n");
+
+  return 0;
+}
@@ -0,0 +1,746 @@
+#include <vulkan/vulkan.h>
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+// load a SPIR-V binary from disc
+std::vector<char> loadShaderCode(const char *filename) {
+  std::vector<char> shaderCode;
+  if (FILE *fp = fopen(filename, "rb")) {
+    char buf[1024];
+    while (size_t len = fread(buf, 1, sizeof(buf), fp)) {
+      shaderCode.insert(shaderCode.end(), buf, buf + len);
+    }
+    fclose(fp);
+  }
+  return shaderCode;
+}
+
+// search for compatible memory properties and return the memory type index
+int32_t findMemoryTypeFromProperties(
+    uint32_t memoryTypeBits, VkPhysicalDeviceMemoryProperties properties,
+    VkMemoryPropertyFlags requiredProperties) {
+  assert(properties.memoryTypeCount < 32u);
+  for (uint32_t index = 0; index < properties.memoryTypeCount; ++index) {
+    if (memoryTypeBits & (1u << index) &&
+        // Find the first memory type that supports all the required flags.
+        ((properties.memoryTypes[index].propertyFlags & requiredProperties) ==
+         requiredProperties)) {
+      return (int32_t)index;
+    }
+  }
+  return -1;
+}
+
+// create a compute pipeline from a SPIR-V binary found in SHADER_PATH
+VkResult createComputePipeline(VkDevice device, VkPipelineLayout layout,
+                               const char *filename,
+                               const VkSpecializationInfo *specializationInfo,
+                               VkPipeline *pipeline) {
+  auto shaderCode =
+      loadShaderCode((std::string(SHADER_PATH) + filename).c_str());
+  if (shaderCode.empty()) {
+    fprintf(stderr, "failed to load '%s'\n", filename);
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
+  shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  shaderModuleCreateInfo.pCode =
+      reinterpret_cast<uint32_t *>(shaderCode.data());
+  shaderModuleCreateInfo.codeSize = shaderCode.size();
+  VkShaderModule shaderModule = VK_NULL_HANDLE;
+  VkResult error = vkCreateShaderModule(device, &shaderModuleCreateInfo,
+                                        nullptr, &shaderModule);
+  if (error) {
+    return error;
+  }
+  VkComputePipelineCreateInfo pipelineCreateInfo = {};
+  pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineCreateInfo.stage.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipelineCreateInfo.stage.module = shaderModule;
+  pipelineCreateInfo.stage.pName = "main";
+  pipelineCreateInfo.stage.pSpecializationInfo = specializationInfo;
+  pipelineCreateInfo.layout = layout;
+  error = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1,
+                                   &pipelineCreateInfo, nullptr, pipeline);
+  vkDestroyShaderModule(device, shaderModule, nullptr);
+  return error;
+}
+
+// create the buffers with usage and bind them to a single allocation of a
+// memory type with the properties which every buffer supports
+VkResult createBuffers(VkDevice device,
+                       const VkPhysicalDeviceMemoryProperties &properties,
+                       VkMemoryPropertyFlags memoryPropertyFlags,
+                       const std::vector<VkDeviceSize> &sizes,
+                       VkBufferUsageFlags usage, uint32_t queueFamilyIndex,
+                       std::vector<VkBuffer> &buffers, VkDeviceMemory *memory,
+                       std::vector<VkDeviceSize> &offsets) {
+  VkDeviceSize requiredMemorySize = 0;
+  uint32_t memoryTypeBits = ~0u;
+  for (VkDeviceSize size : sizes) {
+    VkBufferCreateInfo bufferCreateInfo = {};
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.size = size;
+    bufferCreateInfo.usage = usage;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    bufferCreateInfo.queueFamilyIndexCount = 1;
+    bufferCreateInfo.pQueueFamilyIndices = &queueFamilyIndex;
+    VkBuffer buffer;
+    VkResult error =
+        vkCreateBuffer(device, &bufferCreateInfo, nullptr, &buffer);
+    if (error) {
+      return error;
+    }
+    buffers.push_back(buffer);
+    VkMemoryRequirements memoryRequirements;
+    vkGetBufferMemoryRequirements(device, buffer, &memoryRequirements);
+    memoryTypeBits &= memoryRequirements.memoryTypeBits;
+    const VkDeviceSize alignment = memoryRequirements.alignment;
+    requiredMemorySize =
+        (requiredMemorySize + alignment - 1) / alignment * alignment;
+    offsets.push_back(requiredMemorySize);
+    requiredMemorySize += memoryRequirements.size;
+  }
+
+  // falling back to another memory type could give memory the caller cannot
+  // map, or must flush, so fail instead
+  auto memoryTypeIndex = findMemoryTypeFromProperties(
+      memoryTypeBits, properties, memoryPropertyFlags);
+  if (0 > memoryTypeIndex) {
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+  }
+  VkMemoryAllocateInfo allocateInfo = {};
+  allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocateInfo.allocationSize = requiredMemorySize;
+  allocateInfo.memoryTypeIndex = memoryTypeIndex;
+  VkResult error = vkAllocateMemory(device, &allocateInfo, nullptr, memory);
+  if (error) {
+    return error;
+  }
+  for (size_t index = 0; index < buffers.size(); index++) {
+    error = vkBindBufferMemory(device, buffers[index], *memory,
+                               offsets[index]);
+    if (error) {
+      return error;
+    }
+  }
+  return VK_SUCCESS;
+}
+
+// a job queued by a tenant, its estimate is taken when it is admitted
+struct Job {
+  uint32_t tenant;
+  // the virtual time at which the job would finish if the device were shared
+  // by weight between every tenant with queued jobs
+  double finishTag;
+  double estimatedMilliseconds;
+};
+
+struct Tenant {
+  const char *name;
+  // the share of the device the tenant gets while others have work queued
+  double weight;
+  // the shape of the tenant's jobs and how many it submits
+  uint32_t count;
+  uint32_t iterations;
+  uint32_t jobCount;
+  // history of the device time of the tenant's jobs, an exponential moving
+  // average of the milliseconds for each element iteration
+  double millisecondsPerUnit;
+  std::deque<Job> queue;
+  double lastFinishTag;
+  double queuedMilliseconds;
+  // jobs admission control rejected, and of those the ones waiting to be
+  // resubmitted as the tenant's queue drains
+  uint32_t rejected;
+  uint32_t deferred;
+  std::vector<double> latencies;
+};
+
+Tenant makeTenant(const char *name, double weight, uint32_t count,
+                  uint32_t iterations, uint32_t jobCount) {
+  Tenant tenant = {};
+  tenant.name = name;
+  tenant.weight = weight;
+  tenant.count = count;
+  tenant.iterations = iterations;
+  tenant.jobCount = jobCount;
+  return tenant;
+}
+
+enum Policy { FIFO, FAIR };
+
+// either a single queue in arrival order, or self-clocked weighted fair
+// queuing over a queue for each tenant with admission control
+struct Scheduler {
+  Policy policy;
+  std::vector<Tenant> tenants;
+  std::deque<Job> arrivals;
+  double virtualTime;
+  // a tenant's job is rejected if the estimated device time already queued
+  // for it would exceed this, scaled by its weight
+  double admissionMilliseconds;
+};
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+double jobUnits(const Tenant &tenant) {
+  return double(tenant.count) * tenant.iterations;
+}
+
+// queue a job for the tenant, returning false if admission control rejects
+// it, a tenant with nothing queued is always admitted so it makes progress
+bool submitJob(Scheduler &scheduler, uint32_t tenantIndex) {
+  Tenant &tenant = scheduler.tenants[tenantIndex];
+  Job job = {};
+  job.tenant = tenantIndex;
+  job.estimatedMilliseconds = jobUnits(tenant) * tenant.millisecondsPerUnit;
+  if (scheduler.policy == FIFO) {
+    scheduler.arrivals.push_back(job);
+    return true;
+  }
+  if (!tenant.queue.empty() &&
+      tenant.queuedMilliseconds + job.estimatedMilliseconds >
+          scheduler.admissionMilliseconds * tenant.weight) {
+    return false;
+  }
+  // a tenant which was idle starts from the current virtual time, so it
+  // cannot bank credit while it has nothing queued
+  job.finishTag = std::max(scheduler.virtualTime, tenant.lastFinishTag) +
+                  job.estimatedMilliseconds / tenant.weight;
+  tenant.lastFinishTag = job.finishTag;
+  tenant.queuedMilliseconds += job.estimatedMilliseconds;
+  tenant.queue.push_back(job);
+  return true;
+}
+
+// take the next job to run, the oldest arrival or the queued job with the
+// smallest finish tag, returning false when there is none
+bool nextJob(Scheduler &scheduler, Job *job) {
+  if (scheduler.policy == FIFO) {
+    if (scheduler.arrivals.empty()) {
+      return false;
+    }
+    *job = scheduler.arrivals.front();
+    scheduler.arrivals.pop_front();
+    return true;
+  }
+  Tenant *next = nullptr;
+  for (auto &tenant : scheduler.tenants) {
+    if (!tenant.queue.empty() &&
+        (!next ||
+         tenant.queue.front().finishTag < next->queue.front().finishTag)) {
+      next = &tenant;
+    }
+  }
+  if (!next) {
+    return false;
+  }
+  *job = next->queue.front();
+  next->queue.pop_front();
+  // self-clocked, virtual time is the finish tag of the job in service
+  scheduler.virtualTime = job->finishTag;
+  return true;
+}
+
+// update the tenant's history with the measured device time of its job
+void completeJob(Scheduler &scheduler, const Job &job,
+                 double measuredMilliseconds, double latencyMilliseconds) {
+  Tenant &tenant = scheduler.tenants[job.tenant];
+  tenant.millisecondsPerUnit = 0.75 * tenant.millisecondsPerUnit +
+                               0.25 * measuredMilliseconds / jobUnits(tenant);
+  tenant.queuedMilliseconds -= job.estimatedMilliseconds;
+  tenant.latencies.push_back(latencyMilliseconds);
+}
+
+uint32_t hostWork(uint32_t index, uint32_t iterations) {
+  uint32_t value = index;
+  for (uint32_t iteration = 0; iteration < iterations; iteration++) {
+    value = value * 1664525u + 1013904223u;
+  }
+  return value;
+}
+
+int main() {
+  VkApplicationInfo applicationInfo = {};
+  applicationInfo.pApplicationName = "Vulkan fair scheduler example";
+  applicationInfo.apiVersion = VK_MAKE_VERSION(1, 0, 0);
+
+  VkInstanceCreateInfo instanceCreateInfo = {};
+  instanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+  instanceCreateInfo.pApplicationInfo = &applicationInfo;
+#ifdef ENABLE_LAYERS
+  // without a debug report callback, see vector_add, the validation layer
+  // prints its messages to stdout
+  std::vector<const char *> enabledLayerNames{"VK_LAYER_KHRONOS_validation"};
+  instanceCreateInfo.enabledLayerCount = enabledLayerNames.size();
+  instanceCreateInfo.ppEnabledLayerNames = enabledLayerNames.data();
+#endif
+
+  VkInstance instance = VK_NULL_HANDLE;
+  VkResult error = vkCreateInstance(&instanceCreateInfo, nullptr, &instance);
+  if (error) {
+    return error;
+  }
+
+  uint32_t count;
+  error = vkEnumeratePhysicalDevices(instance, &count, nullptr);
+  if (error) {
+    return error;
+  }
+  std::vector<VkPhysicalDevice> physicalDevices(count);
+  error = vkEnumeratePhysicalDevices(instance, &count, physicalDevices.data());
+  if (error) {
+    return error;
+  }
+
+  // find the first physical device with a compute queue
+  VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+  uint32_t queueFamilyIndex = 0;
+  uint32_t timestampValidBits = 0;
+  for (auto device : physicalDevices) {
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilyProperties(count);
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count,
+                                             queueFamilyProperties.data());
+    for (uint32_t index = 0; index < count; index++) {
+      if (queueFamilyProperties[index].queueFlags & VK_QUEUE_COMPUTE_BIT) {
+        physicalDevice = device;
+        queueFamilyIndex = index;
+        timestampValidBits = queueFamilyProperties[index].timestampValidBits;
+        break;
+      }
+    }
+    if (physicalDevice) {
+      break;
+    }
+  }
+  if (!physicalDevice) {
+    fprintf(stderr, "no device with a compute queue\n");
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+  }
+
+  VkPhysicalDeviceProperties physicalDeviceProperties;
+  vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties);
+  const VkPhysicalDeviceLimits &limits = physicalDeviceProperties.limits;
+
+  VkDeviceQueueCreateInfo queueCreateInfo = {};
+  queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+  queueCreateInfo.queueCount = 1;
+  queueCreateInfo.queueFamilyIndex = queueFamilyIndex;
+  float queuePriority = 1.0f;
+  queueCreateInfo.pQueuePriorities = &queuePriority;
+
+  VkDeviceCreateInfo deviceCreateInfo = {};
+  deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+  deviceCreateInfo.queueCreateInfoCount = 1;
+  deviceCreateInfo.pQueueCreateInfos = &queueCreateInfo;
+  VkDevice device = VK_NULL_HANDLE;
+  error = vkCreateDevice(physicalDevice, &deviceCreateInfo, nullptr, &device);
+  if (error) {
+    return error;
+  }
+
+  VkQueue queue;
+  vkGetDeviceQueue(device, queueFamilyIndex, 0, &queue);
+
+  VkPhysicalDeviceMemoryProperties memoryProperties;
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+  VkDescriptorSetLayoutBinding layoutBinding = {};
+  layoutBinding.binding = 0;
+  layoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  layoutBinding.descriptorCount = 1;
+  layoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+  VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo = {};
+  setLayoutCreateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  setLayoutCreateInfo.bindingCount = 1;
+  setLayoutCreateInfo.pBindings = &layoutBinding;
+  VkDescriptorSetLayout setLayout;
+  error = vkCreateDescriptorSetLayout(device, &setLayoutCreateInfo, nullptr,
+                                      &setLayout);
+  if (error) {
+    return error;
+  }
+
+  VkPushConstantRange pushConstantRange = {};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = 2 * sizeof(uint32_t);
+
+  VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+  pipelineLayoutCreateInfo.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutCreateInfo.setLayoutCount = 1;
+  pipelineLayoutCreateInfo.pSetLayouts = &setLayout;
+  pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+  pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+  VkPipelineLayout pipelineLayout;
+  error = vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr,
+                                 &pipelineLayout);
+  if (error) {
+    return error;
+  }
+
+  VkPipeline pipeline;
+  error = createComputePipeline(device, pipelineLayout, "work.spv", nullptr,
+                                &pipeline);
+  if (error) {
+    return error;
+  }
+
+  // the tenants share the device, a batch tenant with large jobs floods it
+  // while two others submit small jobs
+  Scheduler scheduler = {};
+  scheduler.tenants = {
+      makeTenant("batch", 1.0, 1 << 20, 512, 24),
+      makeTenant("interactive", 2.0, 1 << 14, 128, 12),
+      makeTenant("reports", 1.0, 1 << 17, 128, 12),
+  };
+  uint32_t maxCount = 0;
+  for (auto &tenant : scheduler.tenants) {
+    maxCount = std::max(maxCount, tenant.count);
+  }
+
+  // every job writes the same host visible buffer, jobs run one at a time
+  std::vector<VkBuffer> buffers;
+  VkDeviceMemory memory;
+  std::vector<VkDeviceSize> offsets;
+  error = createBuffers(device, memoryProperties,
+                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                        {sizeof(uint32_t) * maxCount},
+                        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, queueFamilyIndex,
+                        buffers, &memory, offsets);
+  if (error) {
+    return error;
+  }
+  uint32_t *values;
+  error = vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0,
+                      reinterpret_cast<void **>(&values));
+  if (error) {
+    return error;
+  }
+
+  VkDescriptorPoolSize poolSize = {};
+  poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  poolSize.descriptorCount = 1;
+  VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = {};
+  descriptorPoolCreateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  descriptorPoolCreateInfo.maxSets = 1;
+  descriptorPoolCreateInfo.poolSizeCount = 1;
+  descriptorPoolCreateInfo.pPoolSizes = &poolSize;
+  VkDescriptorPool descriptorPool;
+  error = vkCreateDescriptorPool(device, &descriptorPoolCreateInfo, nullptr,
+                                 &descriptorPool);
+  if (error) {
+    return error;
+  }
+
+  VkDescriptorSetAllocateInfo descriptorSetAllocateInfo = {};
+  descriptorSetAllocateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  descriptorSetAllocateInfo.descriptorPool = descriptorPool;
+  descriptorSetAllocateInfo.descriptorSetCount = 1;
+  descriptorSetAllocateInfo.pSetLayouts = &setLayout;
+  VkDescriptorSet descriptorSet;
+  error = vkAllocateDescriptorSets(device, &descriptorSetAllocateInfo,
+                                   &descriptorSet);
+  if (error) {
+    return error;
+  }
+
+  VkDescriptorBufferInfo bufferInfo = {buffers[0], 0, VK_WHOLE_SIZE};
+  VkWriteDescriptorSet writeDescriptorSet = {};
+  writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  writeDescriptorSet.dstSet = descriptorSet;
+  writeDescriptorSet.dstBinding = 0;
+  writeDescriptorSet.descriptorCount = 1;
+  writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  writeDescriptorSet.pBufferInfo = &bufferInfo;
+  vkUpdateDescriptorSets(device, 1, &writeDescriptorSet, 0, nullptr);
+
+  VkQueryPool queryPool = VK_NULL_HANDLE;
+  if (timestampValidBits) {
+    VkQueryPoolCreateInfo queryPoolCreateInfo = {};
+    queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolCreateInfo.queryCount = 2;
+    error = vkCreateQueryPool(device, &queryPoolCreateInfo, nullptr,
+                              &queryPool);
+    if (error) {
+      return error;
+    }
+  }
+
+  VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+  commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+  commandPoolCreateInfo.queueFamilyIndex = queueFamilyIndex;
+  VkCommandPool commandPool = VK_NULL_HANDLE;
+  error = vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr,
+                              &commandPool);
+  if (error) {
+    return error;
+  }
+
+  VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
+  commandBufferAllocateInfo.sType =
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  commandBufferAllocateInfo.commandPool = commandPool;
+  commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  commandBufferAllocateInfo.commandBufferCount = 1;
+  VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+  error = vkAllocateCommandBuffers(device, &commandBufferAllocateInfo,
+                                   &commandBuffer);
+  if (error) {
+    return error;
+  }
+
+  // record the work of function into the command buffer, submit it, wait for
+  // it to complete and return the time between the timestamps in
+  // milliseconds, or 0 if timestamps are not supported
+  auto submit = [&](std::function<void()> function,
+                    double *milliseconds) -> VkResult {
+    *milliseconds = 0.0;
+    VkResult result = vkResetCommandPool(device, commandPool, 0);
+    if (result) {
+      return result;
+    }
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    result = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    if (result) {
+      return result;
+    }
+    if (queryPool) {
+      vkCmdResetQueryPool(commandBuffer, queryPool, 0, 2);
+      vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                          queryPool, 0);
+    }
+    function();
+    if (queryPool) {
+      vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                          queryPool, 1);
+    }
+    result = vkEndCommandBuffer(commandBuffer);
+    if (result) {
+      return result;
+    }
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    result = vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+    if (result) {
+      return result;
+    }
+    vkQueueWaitIdle(queue);
+
+    if (queryPool) {
+      uint64_t timestamps[2];
+      result = vkGetQueryPoolResults(
+          device, queryPool, 0, 2, sizeof(timestamps), timestamps,
+          sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+      if (result) {
+        return result;
+      }
+      // only the low timestampValidBits bits of a timestamp are valid
+      const uint64_t mask = timestampValidBits < 64
+                                ? (uint64_t(1) << timestampValidBits) - 1
+                                : ~uint64_t(0);
+      *milliseconds = ((timestamps[1] - timestamps[0]) & mask) *
+                      limits.timestampPeriod * 1e-6;
+    }
+    return VK_SUCCESS;
+  };
+
+  // run a job of the tenant, returning its device time measured with
+  // timestamps or on the host if the queue has none
+  auto runJob = [&](const Tenant &tenant, double *milliseconds) -> VkResult {
+    auto start = std::chrono::steady_clock::now();
+    VkResult result = submit(
+        [&]() {
+          vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                            pipeline);
+          vkCmdBindDescriptorSets(commandBuffer,
+                                  VK_PIPELINE_BIND_POINT_COMPUTE,
+                                  pipelineLayout, 0, 1, &descriptorSet, 0,
+                                  nullptr);
+          uint32_t pushConstants[2] = {tenant.count, tenant.iterations};
+          vkCmdPushConstants(commandBuffer, pipelineLayout,
+                             VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                             sizeof(pushConstants), pushConstants);
+          vkCmdDispatch(commandBuffer,
+                        std::min((tenant.count + 255) / 256,
+                                 limits.maxComputeWorkGroupCount[0]),
+                        1, 1);
+          VkMemoryBarrier memoryBarrier = {};
+          memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+          memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+          memoryBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+          vkCmdPipelineBarrier(commandBuffer,
+                               VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                               VK_PIPELINE_STAGE_HOST_BIT, 0, 1,
+                               &memoryBarrier, 0, nullptr, 0, nullptr);
+        },
+        milliseconds);
+    if (result) {
+      return result;
+    }
+    // host time includes the submission, so it only stands in when there are
+    // no timestamps rather than mixing two measures in the history
+    if (!queryPool) {
+      *milliseconds = millisecondsSince(start);
+    }
+    return VK_SUCCESS;
+  };
+
+  // seed each tenant's history with one job, which also warms up the
+  // pipeline before anything is timed
+  double totalMilliseconds = 0;
+  for (auto &tenant : scheduler.tenants) {
+    double milliseconds;
+    error = runJob(tenant, &milliseconds);
+    if (error) {
+      return error;
+    }
+    tenant.millisecondsPerUnit = milliseconds / jobUnits(tenant);
+    totalMilliseconds += milliseconds * tenant.jobCount;
+  }
+  // allow a tenant to queue half of the whole load for each unit of weight,
+  // so the batch tenant cannot queue all of its jobs
+  scheduler.admissionMilliseconds = totalMilliseconds / 2;
+  printf("admission limit %.3f ms of queued device time per unit of "
+         "weight\n",
+         scheduler.admissionMilliseconds);
+
+  // the interactive tenant's mean latency under first in first out, which
+  // weighted fair queuing must improve on
+  const uint32_t interactive = 1;
+  double fifoLatency = 0;
+  for (Policy policy : {FIFO, FAIR}) {
+    scheduler.policy = policy;
+    scheduler.virtualTime = 0;
+    for (auto &tenant : scheduler.tenants) {
+      tenant.lastFinishTag = 0;
+      tenant.queuedMilliseconds = 0;
+      tenant.rejected = 0;
+      tenant.deferred = 0;
+      tenant.latencies.clear();
+    }
+
+    // every tenant submits all of its jobs at once, the batch tenant first,
+    // and each job's latency is the time until it completes, rejected jobs
+    // are resubmitted later so both policies run the same work
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t index = 0; index < scheduler.tenants.size(); index++) {
+      Tenant &tenant = scheduler.tenants[index];
+      for (uint32_t job = 0; job < tenant.jobCount; job++) {
+        if (!submitJob(scheduler, index)) {
+          tenant.rejected++;
+          tenant.deferred++;
+        }
+      }
+    }
+    Job job;
+    double lastFinishTag = 0;
+    while (nextJob(scheduler, &job)) {
+      // self-clocked fair queuing serves jobs in finish tag order
+      if (job.finishTag < lastFinishTag) {
+        fprintf(stderr, "job with finish tag %.3f served after %.3f\n",
+                job.finishTag, lastFinishTag);
+        return 1;
+      }
+      lastFinishTag = job.finishTag;
+      const Tenant &tenant = scheduler.tenants[job.tenant];
+      double milliseconds;
+      error = runJob(tenant, &milliseconds);
+      if (error) {
+        return error;
+      }
+      completeJob(scheduler, job, milliseconds, millisecondsSince(start));
+      for (uint32_t index = 0; index < scheduler.tenants.size(); index++) {
+        Tenant &deferring = scheduler.tenants[index];
+        while (deferring.deferred && submitJob(scheduler, index)) {
+          deferring.deferred--;
+        }
+      }
+
+      for (uint32_t index = 0; index < std::min(tenant.count, 1024u);
+           index++) {
+        if (values[index] != hostWork(index, tenant.iterations)) {
+          fprintf(stderr, "%s job: values[%u] is %u expected %u\n",
+                  tenant.name, index, values[index],
+                  hostWork(index, tenant.iterations));
+          return 1;
+        }
+      }
+    }
+
+    printf("%s\n", policy == FIFO ? "first in first out"
+                                  : "weighted fair queuing");
+    for (auto &tenant : scheduler.tenants) {
+      double meanLatency = 0;
+      double maxLatency = 0;
+      for (double latency : tenant.latencies) {
+        meanLatency += latency / tenant.latencies.size();
+        maxLatency = std::max(maxLatency, latency);
+      }
+      printf("  %-12s weight %.0f: %2zu jobs, %2u rejected, latency mean "
+             "%9.3f ms max %9.3f ms\n",
+             tenant.name, tenant.weight, tenant.latencies.size(),
+             tenant.rejected, meanLatency, maxLatency);
+    }
+
+    double meanLatency = 0;
+    for (double latency : scheduler.tenants[interactive].latencies) {
+      meanLatency += latency / scheduler.tenants[interactive].latencies.size();
+    }
+    if (policy == FIFO) {
+      fifoLatency = meanLatency;
+    } else if (meanLatency >= fifoLatency) {
+      fprintf(stderr, "%s latency %.3f ms is no better than %.3f ms\n",
+              scheduler.tenants[interactive].name, meanLatency, fifoLatency);
+      return 1;
+    }
+  }
+
+  vkUnmapMemory(device, memory);
+  if (queryPool) {
+    vkDestroyQueryPool(device, queryPool, nullptr);
+  }
+  vkDestroyCommandPool(device, commandPool, nullptr);
+  vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+  vkFreeMemory(device, memory, nullptr);
+  for (auto buffer : buffers) {
+    vkDestroyBuffer(device, buffer, nullptr);
+  }
+  vkDestroyPipeline(device, pipeline, nullptr);
+  vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+  vkDestroyDescriptorSetLayout(device, setLayout, nullptr);
+  vkDestroyDevice(device, nullptr);
+  vkDestroyInstance(instance, nullptr);
+
+  printf("success\n");
+
+  return 0;
+}
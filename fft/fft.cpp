@@ -0,0 +1,740 @@
+#include <vulkan/vulkan.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+// load a SPIR-V binary from disc
+std::vector<char> loadShaderCode(const char *filename) {
+  std::vector<char> shaderCode;
+  if (FILE *fp = fopen(filename, "rb")) {
+    char buf[1024];
+    while (size_t len = fread(buf, 1, sizeof(buf), fp)) {
+      shaderCode.insert(shaderCode.end(), buf, buf + len);
+    }
+    fclose(fp);
+  }
+  return shaderCode;
+}
+
+// search for compatible memory properties and return the memory type index
+int32_t findMemoryTypeFromProperties(
+    uint32_t memoryTypeBits, VkPhysicalDeviceMemoryProperties properties,
+    VkMemoryPropertyFlags requiredProperties) {
+  assert(properties.memoryTypeCount < 32u);
+  for (uint32_t index = 0; index < properties.memoryTypeCount; ++index) {
+    if (memoryTypeBits & (1u << index) &&
+        // Find the first memory type that supports all the required flags.
+        ((properties.memoryTypes[index].propertyFlags & requiredProperties) ==
+         requiredProperties)) {
+      return (int32_t)index;
+    }
+  }
+  return -1;
+}
+
+// create a compute pipeline from a SPIR-V binary found in SHADER_PATH
+VkResult createComputePipeline(VkDevice device, VkPipelineLayout layout,
+                               const char *filename,
+                               const VkSpecializationInfo *specializationInfo,
+                               VkPipeline *pipeline) {
+  auto shaderCode =
+      loadShaderCode((std::string(SHADER_PATH) + filename).c_str());
+  if (shaderCode.empty()) {
+    fprintf(stderr, "failed to load '%s'\n", filename);
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
+  shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  shaderModuleCreateInfo.pCode =
+      reinterpret_cast<uint32_t *>(shaderCode.data());
+  shaderModuleCreateInfo.codeSize = shaderCode.size();
+  VkShaderModule shaderModule = VK_NULL_HANDLE;
+  VkResult error = vkCreateShaderModule(device, &shaderModuleCreateInfo,
+                                        nullptr, &shaderModule);
+  if (error) {
+    return error;
+  }
+  VkComputePipelineCreateInfo pipelineCreateInfo = {};
+  pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineCreateInfo.stage.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipelineCreateInfo.stage.module = shaderModule;
+  pipelineCreateInfo.stage.pName = "main";
+  pipelineCreateInfo.stage.pSpecializationInfo = specializationInfo;
+  pipelineCreateInfo.layout = layout;
+  error = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1,
+                                   &pipelineCreateInfo, nullptr, pipeline);
+  vkDestroyShaderModule(device, shaderModule, nullptr);
+  return error;
+}
+
+// the radices and twiddle factors for one transform size
+struct FftPlan {
+  uint32_t size;
+  std::vector<uint32_t> radices;
+  uint32_t twiddleOffset;
+};
+
+// mirrors the push constant block of fft.comp
+struct FftParams {
+  uint32_t size;
+  uint32_t batchCount;
+  uint32_t twiddleOffset;
+  float direction;
+  float scale;
+  uint32_t radix;
+  uint32_t stride;
+  uint32_t toScratch;
+  uint32_t passCount;
+  uint32_t radices;
+};
+
+// transforms the data buffer in place using the scratch buffer, both hold at
+// least size * batchCount complex values, the descriptor set binds data,
+// scratch and the twiddle buffer in that order, plans are created on first
+// use of a size and kept along with their twiddle factors
+struct Fft {
+  VkPipelineLayout pipelineLayout;
+  VkPipeline pass;
+  VkPipeline staged;
+  VkBuffer data;
+  VkBuffer scratch;
+  float *twiddles;  // mapped, interleaved real and imaginary
+  uint32_t twiddleCapacity;
+  uint32_t twiddleCount;
+  uint32_t maxGroupCount[2];
+  std::map<uint32_t, FftPlan> plans;
+};
+
+const uint32_t localSize = 256;
+// limited by the 16KB of shared memory every device provides, two stages of
+// complex floats, and by the 4 bits given to each radix in the push constants
+const uint32_t maxStagedSize = 1024;
+const uint32_t maxStagedPasses = 8;
+
+uint32_t divideRoundUp(uint32_t value, uint32_t divisor) {
+  return (value + divisor - 1) / divisor;
+}
+
+// factor size into radices of 4, 2, 3 and 5, preferring 4 as it needs the
+// fewest passes and no multiplies in the butterfly, returns false if size has
+// any other prime factor
+bool factorize(uint32_t size, std::vector<uint32_t> &radices) {
+  radices.clear();
+  while (size % 4 == 0) {
+    radices.push_back(4);
+    size /= 4;
+  }
+  for (uint32_t radix : {2u, 3u, 5u}) {
+    while (size % radix == 0) {
+      radices.push_back(radix);
+      size /= radix;
+    }
+  }
+  return size == 1;
+}
+
+// find or create the plan for size, returns nullptr if the size is not
+// supported or the twiddle buffer is full
+const FftPlan *getFftPlan(Fft &fft, uint32_t size) {
+  auto found = fft.plans.find(size);
+  if (found != fft.plans.end()) {
+    return &found->second;
+  }
+  FftPlan plan;
+  plan.size = size;
+  if (size < 2 || !factorize(size, plan.radices) ||
+      fft.twiddleCapacity - fft.twiddleCount < size) {
+    return nullptr;
+  }
+  // unstaged passes alternate between data and scratch, an even number of
+  // them ends in data, splitting a radix 4 pass in two saves a copy
+  if (size > maxStagedSize && plan.radices.size() % 2) {
+    auto four = std::find(plan.radices.begin(), plan.radices.end(), 4u);
+    if (four != plan.radices.end()) {
+      *four = 2;
+      plan.radices.insert(four, 2);
+    }
+  }
+  plan.twiddleOffset = fft.twiddleCount;
+  const double pi = 3.14159265358979323846;
+  for (uint32_t t = 0; t < size; t++) {
+    const double angle = 2.0 * pi * t / size;
+    fft.twiddles[2 * (plan.twiddleOffset + t)] = cos(angle);
+    fft.twiddles[2 * (plan.twiddleOffset + t) + 1] = -sin(angle);
+  }
+  fft.twiddleCount += size;
+  return &(fft.plans[size] = plan);
+}
+
+void recordComputeBarrier(VkCommandBuffer commandBuffer) {
+  VkMemoryBarrier memoryBarrier = {};
+  memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  memoryBarrier.dstAccessMask =
+      VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1,
+                       &memoryBarrier, 0, nullptr, 0, nullptr);
+}
+
+// transform batchCount contiguous sequences in place, the inverse is scaled
+// by 1 / size so that a forward then inverse transform is the identity, the
+// descriptor set must be bound
+void recordFft(VkCommandBuffer commandBuffer, const Fft &fft,
+               const FftPlan &plan, uint32_t batchCount, bool inverse) {
+  FftParams params = {};
+  params.size = plan.size;
+  params.batchCount = batchCount;
+  params.twiddleOffset = plan.twiddleOffset;
+  params.direction = inverse ? -1.0f : 1.0f;
+  const float scale = inverse ? 1.0f / plan.size : 1.0f;
+  const uint32_t passCount = plan.radices.size();
+
+  // small transforms make a single round trip to global memory
+  if (plan.size <= maxStagedSize && passCount <= maxStagedPasses) {
+    params.scale = scale;
+    params.passCount = passCount;
+    for (uint32_t pass = 0; pass < passCount; pass++) {
+      params.radices |= plan.radices[pass] << (4 * pass);
+    }
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                      fft.staged);
+    vkCmdPushConstants(commandBuffer, fft.pipelineLayout,
+                       VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(FftParams),
+                       &params);
+    vkCmdDispatch(commandBuffer, std::min(batchCount, fft.maxGroupCount[0]),
+                  1, 1);
+    return;
+  }
+
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, fft.pass);
+  params.stride = 1;
+  for (uint32_t pass = 0; pass < passCount; pass++) {
+    if (pass) {
+      recordComputeBarrier(commandBuffer);
+    }
+    params.radix = plan.radices[pass];
+    params.toScratch = pass % 2 == 0;
+    params.scale = pass + 1 == passCount ? scale : 1.0f;
+    vkCmdPushConstants(commandBuffer, fft.pipelineLayout,
+                       VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(FftParams),
+                       &params);
+    vkCmdDispatch(commandBuffer,
+                  std::min(divideRoundUp(plan.size / params.radix, localSize),
+                           fft.maxGroupCount[0]),
+                  std::min(batchCount, fft.maxGroupCount[1]), 1);
+    params.stride *= params.radix;
+  }
+  if (passCount % 2 == 0) {
+    return;
+  }
+
+  // an odd number of passes, such as for powers of 5, left the result in
+  // scratch
+  VkMemoryBarrier memoryBarrier = {};
+  memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  memoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &memoryBarrier, 0,
+                       nullptr, 0, nullptr);
+  VkBufferCopy region = {};
+  region.size = sizeof(float) * 2 * plan.size * batchCount;
+  vkCmdCopyBuffer(commandBuffer, fft.scratch, fft.data, 1, &region);
+  memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  memoryBarrier.dstAccessMask =
+      VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1,
+                       &memoryBarrier, 0, nullptr, 0, nullptr);
+}
+
+int main() {
+  VkApplicationInfo applicationInfo = {};
+  applicationInfo.pApplicationName = "Vulkan FFT example";
+  applicationInfo.apiVersion = VK_MAKE_VERSION(1, 0, 0);
+
+  VkInstanceCreateInfo instanceCreateInfo = {};
+  instanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+  instanceCreateInfo.pApplicationInfo = &applicationInfo;
+#ifdef ENABLE_LAYERS
+  // without a debug report callback, see vector_add, the validation layer
+  // prints its messages to stdout
+  std::vector<const char *> enabledLayerNames{"VK_LAYER_KHRONOS_validation"};
+  instanceCreateInfo.enabledLayerCount = enabledLayerNames.size();
+  instanceCreateInfo.ppEnabledLayerNames = enabledLayerNames.data();
+#endif
+
+  VkInstance instance = VK_NULL_HANDLE;
+  VkResult error = vkCreateInstance(&instanceCreateInfo, nullptr, &instance);
+  if (error) {
+    return error;
+  }
+
+  uint32_t count;
+  error = vkEnumeratePhysicalDevices(instance, &count, nullptr);
+  if (error) {
+    return error;
+  }
+  std::vector<VkPhysicalDevice> physicalDevices(count);
+  error = vkEnumeratePhysicalDevices(instance, &count, physicalDevices.data());
+  if (error) {
+    return error;
+  }
+
+  // find the first physical device with a compute queue
+  VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+  uint32_t queueFamilyIndex = 0;
+  uint32_t timestampValidBits = 0;
+  for (auto device : physicalDevices) {
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilyProperties(count);
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count,
+                                             queueFamilyProperties.data());
+    for (uint32_t index = 0; index < count; index++) {
+      if (queueFamilyProperties[index].queueFlags & VK_QUEUE_COMPUTE_BIT) {
+        physicalDevice = device;
+        queueFamilyIndex = index;
+        timestampValidBits = queueFamilyProperties[index].timestampValidBits;
+        break;
+      }
+    }
+    if (physicalDevice) {
+      break;
+    }
+  }
+  if (!physicalDevice) {
+    fprintf(stderr, "no device with a compute queue\n");
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+  }
+
+  VkPhysicalDeviceProperties physicalDeviceProperties;
+  vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties);
+  const VkPhysicalDeviceLimits &limits = physicalDeviceProperties.limits;
+
+  VkDeviceQueueCreateInfo queueCreateInfo = {};
+  queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+  queueCreateInfo.queueCount = 1;
+  queueCreateInfo.queueFamilyIndex = queueFamilyIndex;
+  float queuePriority = 1.0f;
+  queueCreateInfo.pQueuePriorities = &queuePriority;
+
+  VkDeviceCreateInfo deviceCreateInfo = {};
+  deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+  deviceCreateInfo.queueCreateInfoCount = 1;
+  deviceCreateInfo.pQueueCreateInfos = &queueCreateInfo;
+  VkDevice device = VK_NULL_HANDLE;
+  error = vkCreateDevice(physicalDevice, &deviceCreateInfo, nullptr, &device);
+  if (error) {
+    return error;
+  }
+
+  VkQueue queue;
+  vkGetDeviceQueue(device, queueFamilyIndex, 0, &queue);
+
+  // data, scratch and twiddles
+  std::vector<VkDescriptorSetLayoutBinding> layoutBindings;
+  VkDescriptorSetLayoutBinding layoutBinding = {};
+  layoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  layoutBinding.descriptorCount = 1;
+  layoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  for (uint32_t binding = 0; binding < 3; binding++) {
+    layoutBinding.binding = binding;
+    layoutBindings.push_back(layoutBinding);
+  }
+
+  VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo = {};
+  setLayoutCreateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  setLayoutCreateInfo.bindingCount = layoutBindings.size();
+  setLayoutCreateInfo.pBindings = layoutBindings.data();
+  VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+  error = vkCreateDescriptorSetLayout(device, &setLayoutCreateInfo, nullptr,
+                                      &setLayout);
+  if (error) {
+    return error;
+  }
+
+  VkPushConstantRange pushConstantRange = {};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(FftParams);
+
+  Fft fft;
+  fft.maxGroupCount[0] = limits.maxComputeWorkGroupCount[0];
+  fft.maxGroupCount[1] = limits.maxComputeWorkGroupCount[1];
+  VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+  pipelineLayoutCreateInfo.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutCreateInfo.setLayoutCount = 1;
+  pipelineLayoutCreateInfo.pSetLayouts = &setLayout;
+  pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+  pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+  error = vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr,
+                                 &fft.pipelineLayout);
+  if (error) {
+    return error;
+  }
+
+  VkSpecializationMapEntry specializationMapEntry = {};
+  specializationMapEntry.constantID = 0;
+  specializationMapEntry.offset = 0;
+  specializationMapEntry.size = sizeof(VkBool32);
+  VkPipeline *pipelines[2] = {&fft.pass, &fft.staged};
+  for (VkBool32 staged = VK_FALSE; staged <= VK_TRUE; staged++) {
+    VkSpecializationInfo specializationInfo = {};
+    specializationInfo.mapEntryCount = 1;
+    specializationInfo.pMapEntries = &specializationMapEntry;
+    specializationInfo.dataSize = sizeof(VkBool32);
+    specializationInfo.pData = &staged;
+    error = createComputePipeline(device, fft.pipelineLayout, "fft.spv",
+                                  &specializationInfo, pipelines[staged]);
+    if (error) {
+      return error;
+    }
+  }
+
+  // every size is run with as many transforms as fit in the data buffer, the
+  // twiddle buffer has room for all of their plans
+  const uint32_t elementCount = 1 << 20;
+  fft.twiddleCapacity = 1 << 21;
+  fft.twiddleCount = 0;
+  enum { DATA, SCRATCH, TWIDDLES, BUFFER_COUNT };
+  const VkDeviceSize bufferSizes[BUFFER_COUNT] = {
+      2 * sizeof(float) * elementCount, 2 * sizeof(float) * elementCount,
+      2 * sizeof(float) * fft.twiddleCapacity};
+  VkBuffer buffers[BUFFER_COUNT];
+  for (uint32_t index = 0; index < BUFFER_COUNT; index++) {
+    VkBufferCreateInfo bufferCreateInfo = {};
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.size = bufferSizes[index];
+    // the result of an odd number of passes is copied from scratch to data
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                             VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+                             VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    bufferCreateInfo.queueFamilyIndexCount = 1;
+    bufferCreateInfo.pQueueFamilyIndices = &queueFamilyIndex;
+    error = vkCreateBuffer(device, &bufferCreateInfo, nullptr, &buffers[index]);
+    if (error) {
+      return error;
+    }
+  }
+  fft.data = buffers[DATA];
+  fft.scratch = buffers[SCRATCH];
+
+  VkDeviceSize bufferOffsets[BUFFER_COUNT];
+  VkDeviceSize requiredMemorySize = 0;
+  VkMemoryRequirements memoryRequirements;
+  for (uint32_t index = 0; index < BUFFER_COUNT; index++) {
+    vkGetBufferMemoryRequirements(device, buffers[index], &memoryRequirements);
+    const VkDeviceSize alignment = memoryRequirements.alignment;
+    requiredMemorySize =
+        (requiredMemorySize + alignment - 1) / alignment * alignment;
+    bufferOffsets[index] = requiredMemorySize;
+    requiredMemorySize += memoryRequirements.size;
+  }
+
+  VkPhysicalDeviceMemoryProperties memoryProperties;
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+  auto memoryTypeIndex = findMemoryTypeFromProperties(
+      memoryRequirements.memoryTypeBits, memoryProperties,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  if (0 > memoryTypeIndex) {
+    return ~42;  // returns -43
+  }
+
+  VkMemoryAllocateInfo allocateInfo = {};
+  allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocateInfo.allocationSize = requiredMemorySize;
+  allocateInfo.memoryTypeIndex = memoryTypeIndex;
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  error = vkAllocateMemory(device, &allocateInfo, nullptr, &memory);
+  if (error) {
+    return error;
+  }
+  for (uint32_t index = 0; index < BUFFER_COUNT; index++) {
+    error = vkBindBufferMemory(device, buffers[index], memory,
+                               bufferOffsets[index]);
+    if (error) {
+      return error;
+    }
+  }
+
+  VkDescriptorPoolSize poolSize = {};
+  poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  poolSize.descriptorCount = layoutBindings.size();
+  VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = {};
+  descriptorPoolCreateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  descriptorPoolCreateInfo.maxSets = 1;
+  descriptorPoolCreateInfo.poolSizeCount = 1;
+  descriptorPoolCreateInfo.pPoolSizes = &poolSize;
+  VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+  error = vkCreateDescriptorPool(device, &descriptorPoolCreateInfo, nullptr,
+                                 &descriptorPool);
+  if (error) {
+    return error;
+  }
+
+  VkDescriptorSetAllocateInfo descriptorSetAllocateInfo = {};
+  descriptorSetAllocateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  descriptorSetAllocateInfo.descriptorPool = descriptorPool;
+  descriptorSetAllocateInfo.descriptorSetCount = 1;
+  descriptorSetAllocateInfo.pSetLayouts = &setLayout;
+  VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+  error = vkAllocateDescriptorSets(device, &descriptorSetAllocateInfo,
+                                   &descriptorSet);
+  if (error) {
+    return error;
+  }
+
+  VkDescriptorBufferInfo bufferInfos[BUFFER_COUNT];
+  std::vector<VkWriteDescriptorSet> descriptorSetWrites;
+  VkWriteDescriptorSet writeDescriptorSet = {};
+  writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  writeDescriptorSet.dstSet = descriptorSet;
+  writeDescriptorSet.dstArrayElement = 0;
+  writeDescriptorSet.descriptorCount = 1;
+  writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  for (uint32_t index = 0; index < BUFFER_COUNT; index++) {
+    bufferInfos[index].buffer = buffers[index];
+    bufferInfos[index].offset = 0;
+    bufferInfos[index].range = VK_WHOLE_SIZE;
+    writeDescriptorSet.dstBinding = index;
+    writeDescriptorSet.pBufferInfo = &bufferInfos[index];
+    descriptorSetWrites.push_back(writeDescriptorSet);
+  }
+  vkUpdateDescriptorSets(device, descriptorSetWrites.size(),
+                         descriptorSetWrites.data(), 0, nullptr);
+
+  char *mapped = nullptr;
+  error = vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0,
+                      reinterpret_cast<void **>(&mapped));
+  if (error) {
+    return error;
+  }
+  float *data = reinterpret_cast<float *>(mapped + bufferOffsets[DATA]);
+  fft.twiddles = reinterpret_cast<float *>(mapped + bufferOffsets[TWIDDLES]);
+
+  VkQueryPool queryPool = VK_NULL_HANDLE;
+  if (timestampValidBits) {
+    VkQueryPoolCreateInfo queryPoolCreateInfo = {};
+    queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolCreateInfo.queryCount = 2;
+    error = vkCreateQueryPool(device, &queryPoolCreateInfo, nullptr,
+                              &queryPool);
+    if (error) {
+      return error;
+    }
+  }
+
+  VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+  commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+  commandPoolCreateInfo.queueFamilyIndex = queueFamilyIndex;
+  VkCommandPool commandPool = VK_NULL_HANDLE;
+  error = vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr,
+                              &commandPool);
+  if (error) {
+    return error;
+  }
+
+  VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
+  commandBufferAllocateInfo.sType =
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  commandBufferAllocateInfo.commandPool = commandPool;
+  commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  commandBufferAllocateInfo.commandBufferCount = 1;
+  VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+  error = vkAllocateCommandBuffers(device, &commandBufferAllocateInfo,
+                                   &commandBuffer);
+  if (error) {
+    return error;
+  }
+
+  // record the work of function into the command buffer, submit it, wait for
+  // it to complete and return the time between the timestamps in
+  // milliseconds, or 0 if timestamps are not supported
+  auto submit = [&](std::function<void()> function,
+                    double *milliseconds) -> VkResult {
+    VkResult result = vkResetCommandPool(device, commandPool, 0);
+    if (result) {
+      return result;
+    }
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    result = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    if (result) {
+      return result;
+    }
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                            fft.pipelineLayout, 0, 1, &descriptorSet, 0,
+                            nullptr);
+    if (queryPool) {
+      vkCmdResetQueryPool(commandBuffer, queryPool, 0, 2);
+      vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                          queryPool, 0);
+    }
+    function();
+    if (queryPool) {
+      vkCmdWriteTimestamp(commandBuffer,
+                          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, queryPool, 1);
+    }
+    result = vkEndCommandBuffer(commandBuffer);
+    if (result) {
+      return result;
+    }
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    result = vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+    if (result) {
+      return result;
+    }
+    vkQueueWaitIdle(queue);
+
+    *milliseconds = 0.0;
+    if (queryPool) {
+      uint64_t timestamps[2];
+      result = vkGetQueryPoolResults(
+          device, queryPool, 0, 2, sizeof(timestamps), timestamps,
+          sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+      if (result) {
+        return result;
+      }
+      *milliseconds =
+          (timestamps[1] - timestamps[0]) * limits.timestampPeriod * 1e-6;
+    }
+    return VK_SUCCESS;
+  };
+
+  // powers of two, of 5 which need an odd number of passes, and mixed radix
+  // sizes, both staged in shared memory and not
+  const uint32_t sizes[] = {8,    60,   256,   1000,    1024,
+                            3125, 4096, 61440, 1 << 16, 1 << 20};
+  printf("%8s %-16s %6s %8s %10s %10s\n", "size", "radices", "staged",
+         "batch", "device ms", "GFLOP/s");
+  int failures = 0;
+  uint32_t seed = 5;
+  for (uint32_t size : sizes) {
+    const FftPlan *plan = getFftPlan(fft, size);
+    if (!plan) {
+      fprintf(stderr, "no plan for size %u\n", size);
+      return VK_ERROR_FEATURE_NOT_PRESENT;
+    }
+    // a second request is served from the cache
+    if (plan != getFftPlan(fft, size)) {
+      fprintf(stderr, "size %u plan was not cached!\n", size);
+      failures++;
+    }
+    const uint32_t batchCount = elementCount / size;
+    std::vector<float> original(2 * size * batchCount);
+    for (auto &value : original) {
+      seed = seed * 1664525u + 1013904223u;
+      value = (float)(seed >> 8) / (float)(1 << 23) - 1.0f;
+    }
+    memcpy(data, original.data(), sizeof(float) * original.size());
+
+    double milliseconds;
+    error = submit([&] { recordFft(commandBuffer, fft, *plan, batchCount,
+                                   false); },
+                   &milliseconds);
+    if (error) {
+      return error;
+    }
+    std::string radices;
+    for (uint32_t radix : plan->radices) {
+      radices += (radices.empty() ? "" : "x") + std::to_string(radix);
+    }
+    const bool staged =
+        size <= maxStagedSize && plan->radices.size() <= maxStagedPasses;
+    // the customary 5 N log2(N) flops per transform
+    const double flops = 5.0 * size * log2((double)size) * batchCount;
+    printf("%8u %-16s %6s %8u %10.3f %10.1f\n", size, radices.c_str(),
+           staged ? "yes" : "no", batchCount, milliseconds,
+           milliseconds > 0.0 ? flops / milliseconds * 1e-6 : 0.0);
+
+    // compare a few bins of the first and last transform with a direct DFT
+    const double pi = 3.14159265358979323846;
+    const double tolerance = 1e-4 * sqrt((double)size);
+    const uint32_t bins[] = {0, 1, size / 3, size / 2, size - 1};
+    for (uint32_t batch : {0u, batchCount - 1}) {
+      const float *input = original.data() + 2 * size * batch;
+      const float *output = data + 2 * size * batch;
+      for (uint32_t bin : bins) {
+        double real = 0.0;
+        double imaginary = 0.0;
+        for (uint32_t t = 0; t < size; t++) {
+          const double angle = -2.0 * pi * ((uint64_t)t * bin % size) / size;
+          real += input[2 * t] * cos(angle) - input[2 * t + 1] * sin(angle);
+          imaginary +=
+              input[2 * t] * sin(angle) + input[2 * t + 1] * cos(angle);
+        }
+        if (!(fabs(output[2 * bin] - real) <= tolerance &&
+              fabs(output[2 * bin + 1] - imaginary) <= tolerance)) {
+          fprintf(stderr, "size %u bin %u is '%f%+fi' not '%f%+fi'!\n", size,
+                  bin, output[2 * bin], output[2 * bin + 1], real, imaginary);
+          failures++;
+        }
+      }
+    }
+
+    // the inverse transform recovers the input
+    error = submit([&] { recordFft(commandBuffer, fft, *plan, batchCount,
+                                   true); },
+                   &milliseconds);
+    if (error) {
+      return error;
+    }
+    for (uint32_t index = 0; index < original.size(); index++) {
+      if (!(fabs(data[index] - original[index]) <= 1e-4)) {
+        fprintf(stderr, "size %u round trip [%u] is '%f' not '%f'!\n", size,
+                index, data[index], original[index]);
+        failures++;
+        break;
+      }
+    }
+  }
+  printf("%zu plans cached using %u twiddle factors\n", fft.plans.size(),
+         fft.twiddleCount);
+  vkUnmapMemory(device, memory);
+
+  if (queryPool) {
+    vkDestroyQueryPool(device, queryPool, nullptr);
+  }
+  vkDestroyCommandPool(device, commandPool, nullptr);
+  vkFreeMemory(device, memory, nullptr);
+  for (auto buffer : buffers) {
+    vkDestroyBuffer(device, buffer, nullptr);
+  }
+  vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+  vkDestroyPipeline(device, fft.staged, nullptr);
+  vkDestroyPipeline(device, fft.pass, nullptr);
+  vkDestroyPipelineLayout(device, fft.pipelineLayout, nullptr);
+  vkDestroyDescriptorSetLayout(device, setLayout, nullptr);
+  vkDestroyDevice(device, nullptr);
+  vkDestroyInstance(instance, nullptr);
+
+  if (failures) {
+    return 1;
+  }
+  printf("success\n");
+
+  return 0;
+}
@@ -0,0 +1,790 @@
+#include <vulkan/vulkan.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+// load a SPIR-V binary from disc
+std::vector<char> loadShaderCode(const char *filename) {
+  std::vector<char> shaderCode;
+  if (FILE *fp = fopen(filename, "rb")) {
+    char buf[1024];
+    while (size_t len = fread(buf, 1, sizeof(buf), fp)) {
+      shaderCode.insert(shaderCode.end(), buf, buf + len);
+    }
+    fclose(fp);
+  }
+  return shaderCode;
+}
+
+// search for compatible memory properties and return the memory type index
+int32_t findMemoryTypeFromProperties(
+    uint32_t memoryTypeBits, VkPhysicalDeviceMemoryProperties properties,
+    VkMemoryPropertyFlags requiredProperties) {
+  assert(properties.memoryTypeCount < 32u);
+  for (uint32_t index = 0; index < properties.memoryTypeCount; ++index) {
+    if (memoryTypeBits & (1u << index) &&
+        // Find the first memory type that supports all the required flags.
+        ((properties.memoryTypes[index].propertyFlags & requiredProperties) ==
+         requiredProperties)) {
+      return (int32_t)index;
+    }
+  }
+  return -1;
+}
+
+// create a compute pipeline from a SPIR-V binary found in SHADER_PATH
+VkResult createComputePipeline(VkDevice device, VkPipelineLayout layout,
+                               const char *filename,
+                               const VkSpecializationInfo *specializationInfo,
+                               VkPipeline *pipeline) {
+  auto shaderCode =
+      loadShaderCode((std::string(SHADER_PATH) + filename).c_str());
+  if (shaderCode.empty()) {
+    fprintf(stderr, "failed to load '%s'\n", filename);
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
+  shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  shaderModuleCreateInfo.pCode =
+      reinterpret_cast<uint32_t *>(shaderCode.data());
+  shaderModuleCreateInfo.codeSize = shaderCode.size();
+  VkShaderModule shaderModule = VK_NULL_HANDLE;
+  VkResult error = vkCreateShaderModule(device, &shaderModuleCreateInfo,
+                                        nullptr, &shaderModule);
+  if (error) {
+    return error;
+  }
+  VkComputePipelineCreateInfo pipelineCreateInfo = {};
+  pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineCreateInfo.stage.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipelineCreateInfo.stage.module = shaderModule;
+  pipelineCreateInfo.stage.pName = "main";
+  pipelineCreateInfo.stage.pSpecializationInfo = specializationInfo;
+  pipelineCreateInfo.layout = layout;
+  error = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1,
+                                   &pipelineCreateInfo, nullptr, pipeline);
+  vkDestroyShaderModule(device, shaderModule, nullptr);
+  return error;
+}
+
+// mirror the push constant block shared by the shaders
+struct GatherScatterParams {
+  uint32_t count;
+  uint32_t width;
+  uint32_t rowCount;
+};
+
+// the shaders share a pipeline layout whose descriptor set binds the indices,
+// the input then the output, scatterAddFloat is only created when the device
+// supports atomic float addition on storage buffers, otherwise or when
+// useAtomicFloat is false float scatter-add falls back to a compare and swap
+// loop
+struct GatherScatter {
+  VkPipelineLayout pipelineLayout;
+  VkPipeline gather;
+  VkPipeline scatter;
+  VkPipeline scatterAddInteger;
+  VkPipeline scatterAddCompareAndSwap;
+  VkPipeline scatterAddFloat;
+  bool useAtomicFloat;
+  uint32_t maxGroupCount;
+};
+
+uint32_t divideRoundUp(uint32_t value, uint32_t divisor) {
+  return (value + divisor - 1) / divisor;
+}
+
+void recordDispatch(VkCommandBuffer commandBuffer,
+                    const GatherScatter &gatherScatter, VkPipeline pipeline,
+                    VkDescriptorSet descriptorSet, uint32_t count,
+                    uint32_t width, uint32_t rowCount) {
+  GatherScatterParams params = {count, width, rowCount};
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                          gatherScatter.pipelineLayout, 0, 1, &descriptorSet,
+                          0, nullptr);
+  vkCmdPushConstants(commandBuffer, gatherScatter.pipelineLayout,
+                     VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                     sizeof(GatherScatterParams), &params);
+  // each invocation handles one word at a time and strides over the rest
+  vkCmdDispatch(commandBuffer,
+                std::min(divideRoundUp(count * width, 256),
+                         gatherScatter.maxGroupCount),
+                1, 1);
+}
+
+// gather count rows of width words from the rowCount rows of the input at
+// the indices to the output
+void recordGather(VkCommandBuffer commandBuffer,
+                  const GatherScatter &gatherScatter,
+                  VkDescriptorSet descriptorSet, uint32_t count,
+                  uint32_t width, uint32_t rowCount) {
+  recordDispatch(commandBuffer, gatherScatter, gatherScatter.gather,
+                 descriptorSet, count, width, rowCount);
+}
+
+// scatter count rows of width words from the input to the rows of the output
+// at the indices, the output has rowCount rows
+void recordScatter(VkCommandBuffer commandBuffer,
+                   const GatherScatter &gatherScatter,
+                   VkDescriptorSet descriptorSet, uint32_t count,
+                   uint32_t width, uint32_t rowCount) {
+  recordDispatch(commandBuffer, gatherScatter, gatherScatter.scatter,
+                 descriptorSet, count, width, rowCount);
+}
+
+// add count rows of width 32 bit integers, or floats, from the input to the
+// rows of the output at the indices, the output has rowCount rows
+void recordScatterAdd(VkCommandBuffer commandBuffer,
+                      const GatherScatter &gatherScatter,
+                      VkDescriptorSet descriptorSet, bool integer,
+                      uint32_t count, uint32_t width, uint32_t rowCount) {
+  VkPipeline pipeline = gatherScatter.scatterAddInteger;
+  if (!integer) {
+    pipeline = gatherScatter.useAtomicFloat && gatherScatter.scatterAddFloat
+                   ? gatherScatter.scatterAddFloat
+                   : gatherScatter.scatterAddCompareAndSwap;
+  }
+  recordDispatch(commandBuffer, gatherScatter, pipeline, descriptorSet, count,
+                 width, rowCount);
+}
+
+uint32_t nextRandom(uint32_t &seed) {
+  seed = seed * 1664525u + 1013904223u;
+  return seed >> 8;
+}
+
+// an embedding lookup, the cube of a uniform value in [0, 1) makes low rows
+// far more frequent so the scatter-adds contend on them, every 1024th index
+// is out of range
+std::vector<uint32_t> makeSkewedIndices(uint32_t count, uint32_t rowCount,
+                                        uint32_t &seed) {
+  std::vector<uint32_t> indices(count);
+  for (uint32_t index = 0; index < count; index++) {
+    const double uniform = nextRandom(seed) / (double)(1 << 24);
+    indices[index] = index % 1024 == 1023
+                         ? rowCount + index
+                         : (uint32_t)(uniform * uniform * uniform * rowCount);
+  }
+  return indices;
+}
+
+int main() {
+  VkApplicationInfo applicationInfo = {};
+  applicationInfo.pApplicationName = "Vulkan gather scatter example";
+  // vkGetPhysicalDeviceFeatures2 is core in Vulkan 1.1
+  applicationInfo.apiVersion = VK_API_VERSION_1_1;
+
+  VkInstanceCreateInfo instanceCreateInfo = {};
+  instanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+  instanceCreateInfo.pApplicationInfo = &applicationInfo;
+#ifdef ENABLE_LAYERS
+  // without a debug report callback, see vector_add, the validation layer
+  // prints its messages to stdout
+  std::vector<const char *> enabledLayerNames{"VK_LAYER_KHRONOS_validation"};
+  instanceCreateInfo.enabledLayerCount = enabledLayerNames.size();
+  instanceCreateInfo.ppEnabledLayerNames = enabledLayerNames.data();
+#endif
+
+  VkInstance instance = VK_NULL_HANDLE;
+  VkResult error = vkCreateInstance(&instanceCreateInfo, nullptr, &instance);
+  if (error) {
+    return error;
+  }
+
+  uint32_t count;
+  error = vkEnumeratePhysicalDevices(instance, &count, nullptr);
+  if (error) {
+    return error;
+  }
+  std::vector<VkPhysicalDevice> physicalDevices(count);
+  error = vkEnumeratePhysicalDevices(instance, &count, physicalDevices.data());
+  if (error) {
+    return error;
+  }
+
+  // find the first Vulkan 1.1 physical device with a compute queue
+  VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+  uint32_t queueFamilyIndex = 0;
+  uint32_t timestampValidBits = 0;
+  VkPhysicalDeviceProperties physicalDeviceProperties;
+  for (auto device : physicalDevices) {
+    vkGetPhysicalDeviceProperties(device, &physicalDeviceProperties);
+    if (physicalDeviceProperties.apiVersion < VK_API_VERSION_1_1) {
+      continue;
+    }
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilyProperties(count);
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count,
+                                             queueFamilyProperties.data());
+    for (uint32_t index = 0; index < count; index++) {
+      if (queueFamilyProperties[index].queueFlags & VK_QUEUE_COMPUTE_BIT) {
+        physicalDevice = device;
+        queueFamilyIndex = index;
+        timestampValidBits = queueFamilyProperties[index].timestampValidBits;
+        break;
+      }
+    }
+    if (physicalDevice) {
+      break;
+    }
+  }
+  if (!physicalDevice) {
+    fprintf(stderr, "no Vulkan 1.1 device with a compute queue\n");
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+  }
+  const VkPhysicalDeviceLimits &limits = physicalDeviceProperties.limits;
+
+  // atomic float addition on storage buffers is optional, enable it when the
+  // device exposes VK_EXT_shader_atomic_float and the feature
+  error = vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &count,
+                                               nullptr);
+  if (error) {
+    return error;
+  }
+  std::vector<VkExtensionProperties> extensionProperties(count);
+  error = vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &count,
+                                               extensionProperties.data());
+  if (error) {
+    return error;
+  }
+  bool hasAtomicFloat = false;
+  for (auto &extension : extensionProperties) {
+    if (!strcmp(extension.extensionName,
+                VK_EXT_SHADER_ATOMIC_FLOAT_EXTENSION_NAME)) {
+      hasAtomicFloat = true;
+    }
+  }
+  VkPhysicalDeviceShaderAtomicFloatFeaturesEXT atomicFloatFeatures = {};
+  atomicFloatFeatures.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_ATOMIC_FLOAT_FEATURES_EXT;
+  if (hasAtomicFloat) {
+    VkPhysicalDeviceFeatures2 features = {};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &atomicFloatFeatures;
+    vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+    hasAtomicFloat = atomicFloatFeatures.shaderBufferFloat32AtomicAdd;
+  }
+
+  VkDeviceQueueCreateInfo queueCreateInfo = {};
+  queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+  queueCreateInfo.queueCount = 1;
+  queueCreateInfo.queueFamilyIndex = queueFamilyIndex;
+  float queuePriority = 1.0f;
+  queueCreateInfo.pQueuePriorities = &queuePriority;
+
+  VkDeviceCreateInfo deviceCreateInfo = {};
+  deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+  deviceCreateInfo.queueCreateInfoCount = 1;
+  deviceCreateInfo.pQueueCreateInfos = &queueCreateInfo;
+  const char *atomicFloatExtensionName =
+      VK_EXT_SHADER_ATOMIC_FLOAT_EXTENSION_NAME;
+  if (hasAtomicFloat) {
+    // only request the feature used, leave the rest as queried
+    VkPhysicalDeviceShaderAtomicFloatFeaturesEXT enabledFeatures = {};
+    enabledFeatures.sType = atomicFloatFeatures.sType;
+    enabledFeatures.shaderBufferFloat32AtomicAdd = VK_TRUE;
+    atomicFloatFeatures = enabledFeatures;
+    deviceCreateInfo.pNext = &atomicFloatFeatures;
+    deviceCreateInfo.enabledExtensionCount = 1;
+    deviceCreateInfo.ppEnabledExtensionNames = &atomicFloatExtensionName;
+  }
+  VkDevice device = VK_NULL_HANDLE;
+  error = vkCreateDevice(physicalDevice, &deviceCreateInfo, nullptr, &device);
+  if (error) {
+    return error;
+  }
+
+  VkQueue queue;
+  vkGetDeviceQueue(device, queueFamilyIndex, 0, &queue);
+
+  // indices, input and output
+  std::vector<VkDescriptorSetLayoutBinding> layoutBindings;
+  VkDescriptorSetLayoutBinding layoutBinding = {};
+  layoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  layoutBinding.descriptorCount = 1;
+  layoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  for (uint32_t binding = 0; binding < 3; binding++) {
+    layoutBinding.binding = binding;
+    layoutBindings.push_back(layoutBinding);
+  }
+
+  VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo = {};
+  setLayoutCreateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  setLayoutCreateInfo.bindingCount = layoutBindings.size();
+  setLayoutCreateInfo.pBindings = layoutBindings.data();
+  VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+  error = vkCreateDescriptorSetLayout(device, &setLayoutCreateInfo, nullptr,
+                                      &setLayout);
+  if (error) {
+    return error;
+  }
+
+  VkPushConstantRange pushConstantRange = {};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(GatherScatterParams);
+
+  GatherScatter gatherScatter = {};
+  gatherScatter.maxGroupCount = limits.maxComputeWorkGroupCount[0];
+  VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+  pipelineLayoutCreateInfo.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutCreateInfo.setLayoutCount = 1;
+  pipelineLayoutCreateInfo.pSetLayouts = &setLayout;
+  pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+  pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+  error = vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr,
+                                 &gatherScatter.pipelineLayout);
+  if (error) {
+    return error;
+  }
+
+  error = createComputePipeline(device, gatherScatter.pipelineLayout,
+                                "gather.spv", nullptr, &gatherScatter.gather);
+  if (error) {
+    return error;
+  }
+  error = createComputePipeline(device, gatherScatter.pipelineLayout,
+                                "scatter.spv", nullptr,
+                                &gatherScatter.scatter);
+  if (error) {
+    return error;
+  }
+  for (VkBool32 integer : {VK_TRUE, VK_FALSE}) {
+    VkSpecializationMapEntry specializationMapEntry = {};
+    specializationMapEntry.constantID = 0;
+    specializationMapEntry.offset = 0;
+    specializationMapEntry.size = sizeof(VkBool32);
+    VkSpecializationInfo specializationInfo = {};
+    specializationInfo.mapEntryCount = 1;
+    specializationInfo.pMapEntries = &specializationMapEntry;
+    specializationInfo.dataSize = sizeof(VkBool32);
+    specializationInfo.pData = &integer;
+    error = createComputePipeline(
+        device, gatherScatter.pipelineLayout, "scatter_add.spv",
+        &specializationInfo,
+        integer ? &gatherScatter.scatterAddInteger
+                : &gatherScatter.scatterAddCompareAndSwap);
+    if (error) {
+      return error;
+    }
+  }
+  if (hasAtomicFloat) {
+    error = createComputePipeline(device, gatherScatter.pipelineLayout,
+                                  "scatter_add_float.spv", nullptr,
+                                  &gatherScatter.scatterAddFloat);
+    if (error) {
+      return error;
+    }
+    gatherScatter.useAtomicFloat = true;
+  }
+
+  // a table of 64K rows of 32 words and a batch of 256K rows looked up in it
+  const uint32_t rowCount = 1 << 16;
+  const uint32_t width = 32;
+  const uint32_t batchCount = 1 << 18;
+  enum { INDICES, TABLE, BATCH, BUFFER_COUNT };
+  const VkDeviceSize bufferSizes[BUFFER_COUNT] = {
+      sizeof(uint32_t) * batchCount, sizeof(float) * rowCount * width,
+      sizeof(float) * batchCount * width};
+  VkBuffer buffers[BUFFER_COUNT];
+  for (uint32_t index = 0; index < BUFFER_COUNT; index++) {
+    VkBufferCreateInfo bufferCreateInfo = {};
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.size = bufferSizes[index];
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    bufferCreateInfo.queueFamilyIndexCount = 1;
+    bufferCreateInfo.pQueueFamilyIndices = &queueFamilyIndex;
+    error = vkCreateBuffer(device, &bufferCreateInfo, nullptr, &buffers[index]);
+    if (error) {
+      return error;
+    }
+  }
+  VkDeviceSize bufferOffsets[BUFFER_COUNT];
+  VkDeviceSize requiredMemorySize = 0;
+  VkMemoryRequirements memoryRequirements;
+  for (uint32_t index = 0; index < BUFFER_COUNT; index++) {
+    vkGetBufferMemoryRequirements(device, buffers[index], &memoryRequirements);
+    const VkDeviceSize alignment = memoryRequirements.alignment;
+    requiredMemorySize =
+        (requiredMemorySize + alignment - 1) / alignment * alignment;
+    bufferOffsets[index] = requiredMemorySize;
+    requiredMemorySize += memoryRequirements.size;
+  }
+
+  VkPhysicalDeviceMemoryProperties memoryProperties;
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+  auto memoryTypeIndex = findMemoryTypeFromProperties(
+      memoryRequirements.memoryTypeBits, memoryProperties,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  if (0 > memoryTypeIndex) {
+    return ~42;  // returns -43
+  }
+
+  VkMemoryAllocateInfo allocateInfo = {};
+  allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocateInfo.allocationSize = requiredMemorySize;
+  allocateInfo.memoryTypeIndex = memoryTypeIndex;
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  error = vkAllocateMemory(device, &allocateInfo, nullptr, &memory);
+  if (error) {
+    return error;
+  }
+  for (uint32_t index = 0; index < BUFFER_COUNT; index++) {
+    error = vkBindBufferMemory(device, buffers[index], memory,
+                               bufferOffsets[index]);
+    if (error) {
+      return error;
+    }
+  }
+
+  // gather from the table into the batch, and scatter from the batch back
+  enum { GATHER, SCATTER, SET_COUNT };
+  const uint32_t setBuffers[SET_COUNT][3] = {{INDICES, TABLE, BATCH},
+                                              {INDICES, BATCH, TABLE}};
+
+  VkDescriptorPoolSize poolSize = {};
+  poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  poolSize.descriptorCount = 3 * SET_COUNT;
+  VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = {};
+  descriptorPoolCreateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  descriptorPoolCreateInfo.maxSets = SET_COUNT;
+  descriptorPoolCreateInfo.poolSizeCount = 1;
+  descriptorPoolCreateInfo.pPoolSizes = &poolSize;
+  VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+  error = vkCreateDescriptorPool(device, &descriptorPoolCreateInfo, nullptr,
+                                 &descriptorPool);
+  if (error) {
+    return error;
+  }
+
+  std::vector<VkDescriptorSetLayout> setLayouts(SET_COUNT, setLayout);
+  VkDescriptorSetAllocateInfo descriptorSetAllocateInfo = {};
+  descriptorSetAllocateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  descriptorSetAllocateInfo.descriptorPool = descriptorPool;
+  descriptorSetAllocateInfo.descriptorSetCount = SET_COUNT;
+  descriptorSetAllocateInfo.pSetLayouts = setLayouts.data();
+  VkDescriptorSet descriptorSets[SET_COUNT];
+  error = vkAllocateDescriptorSets(device, &descriptorSetAllocateInfo,
+                                   descriptorSets);
+  if (error) {
+    return error;
+  }
+
+  VkDescriptorBufferInfo bufferInfos[SET_COUNT][3];
+  std::vector<VkWriteDescriptorSet> descriptorSetWrites;
+  VkWriteDescriptorSet writeDescriptorSet = {};
+  writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  writeDescriptorSet.dstArrayElement = 0;
+  writeDescriptorSet.descriptorCount = 1;
+  writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  for (uint32_t set = 0; set < SET_COUNT; set++) {
+    for (uint32_t binding = 0; binding < 3; binding++) {
+      bufferInfos[set][binding].buffer = buffers[setBuffers[set][binding]];
+      bufferInfos[set][binding].offset = 0;
+      bufferInfos[set][binding].range = VK_WHOLE_SIZE;
+      writeDescriptorSet.dstSet = descriptorSets[set];
+      writeDescriptorSet.dstBinding = binding;
+      writeDescriptorSet.pBufferInfo = &bufferInfos[set][binding];
+      descriptorSetWrites.push_back(writeDescriptorSet);
+    }
+  }
+  vkUpdateDescriptorSets(device, descriptorSetWrites.size(),
+                         descriptorSetWrites.data(), 0, nullptr);
+
+  char *data = nullptr;
+  error = vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0,
+                      reinterpret_cast<void **>(&data));
+  if (error) {
+    return error;
+  }
+  uint32_t *indexData =
+      reinterpret_cast<uint32_t *>(data + bufferOffsets[INDICES]);
+  float *tableData = reinterpret_cast<float *>(data + bufferOffsets[TABLE]);
+  float *batchData = reinterpret_cast<float *>(data + bufferOffsets[BATCH]);
+
+  VkQueryPool queryPool = VK_NULL_HANDLE;
+  if (timestampValidBits) {
+    VkQueryPoolCreateInfo queryPoolCreateInfo = {};
+    queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolCreateInfo.queryCount = 2;
+    error = vkCreateQueryPool(device, &queryPoolCreateInfo, nullptr,
+                              &queryPool);
+    if (error) {
+      return error;
+    }
+  }
+
+  VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+  commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+  commandPoolCreateInfo.queueFamilyIndex = queueFamilyIndex;
+  VkCommandPool commandPool = VK_NULL_HANDLE;
+  error = vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr,
+                              &commandPool);
+  if (error) {
+    return error;
+  }
+
+  VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
+  commandBufferAllocateInfo.sType =
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  commandBufferAllocateInfo.commandPool = commandPool;
+  commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  commandBufferAllocateInfo.commandBufferCount = 1;
+  VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+  error = vkAllocateCommandBuffers(device, &commandBufferAllocateInfo,
+                                   &commandBuffer);
+  if (error) {
+    return error;
+  }
+
+  // record the work of function into the command buffer, submit it, wait for
+  // it to complete and return the time between the timestamps in
+  // milliseconds, or 0 if timestamps are not supported
+  auto submit = [&](std::function<void()> function,
+                    double *milliseconds) -> VkResult {
+    VkResult result = vkResetCommandPool(device, commandPool, 0);
+    if (result) {
+      return result;
+    }
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    result = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    if (result) {
+      return result;
+    }
+    if (queryPool) {
+      vkCmdResetQueryPool(commandBuffer, queryPool, 0, 2);
+      vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                          queryPool, 0);
+    }
+    function();
+    if (queryPool) {
+      vkCmdWriteTimestamp(commandBuffer,
+                          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, queryPool, 1);
+    }
+    result = vkEndCommandBuffer(commandBuffer);
+    if (result) {
+      return result;
+    }
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    result = vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+    if (result) {
+      return result;
+    }
+    vkQueueWaitIdle(queue);
+
+    *milliseconds = 0.0;
+    if (queryPool) {
+      uint64_t timestamps[2];
+      result = vkGetQueryPoolResults(
+          device, queryPool, 0, 2, sizeof(timestamps), timestamps,
+          sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+      if (result) {
+        return result;
+      }
+      *milliseconds =
+          (timestamps[1] - timestamps[0]) * limits.timestampPeriod * 1e-6;
+    }
+    return VK_SUCCESS;
+  };
+
+  printf("%-28s %10s %10s\n", "kernel", "device ms", "GB/s");
+  auto report = [&](const char *name, double milliseconds, double bytes) {
+    printf("%-28s %10.3f %10.1f\n", name, milliseconds,
+           milliseconds > 0.0 ? bytes / milliseconds * 1e-6 : 0.0);
+  };
+  const double rowBytes = sizeof(float) * width;
+  int failures = 0;
+  uint32_t seed = 42;
+
+  // gather a skewed batch of embedding rows, out of range rows are zero
+  const std::vector<uint32_t> skewedIndices =
+      makeSkewedIndices(batchCount, rowCount, seed);
+  memcpy(indexData, skewedIndices.data(), sizeof(uint32_t) * batchCount);
+  for (uint32_t index = 0; index < rowCount * width; index++) {
+    tableData[index] = (float)index;
+  }
+  double milliseconds;
+  error = submit(
+      [&] {
+        recordGather(commandBuffer, gatherScatter, descriptorSets[GATHER],
+                     batchCount, width, rowCount);
+      },
+      &milliseconds);
+  if (error) {
+    return error;
+  }
+  report("gather", milliseconds, 2.0 * rowBytes * batchCount);
+  for (uint32_t index = 0; index < batchCount * width; index++) {
+    const uint32_t row = skewedIndices[index / width];
+    const float expected =
+        row < rowCount ? tableData[row * width + index % width] : 0.0f;
+    if (batchData[index] != expected) {
+      fprintf(stderr, "gather [%u] is '%f' not '%f'!\n", index,
+              batchData[index], expected);
+      failures++;
+      break;
+    }
+  }
+
+  // scatter the rows back to a shuffled table, a permutation so every row is
+  // written exactly once
+  std::vector<uint32_t> permutation(rowCount);
+  for (uint32_t index = 0; index < rowCount; index++) {
+    permutation[index] = index;
+  }
+  for (uint32_t index = rowCount - 1; index > 0; index--) {
+    std::swap(permutation[index], permutation[nextRandom(seed) % (index + 1)]);
+  }
+  memcpy(indexData, permutation.data(), sizeof(uint32_t) * rowCount);
+  for (uint32_t index = 0; index < rowCount * width; index++) {
+    batchData[index] = (float)index;
+  }
+  error = submit(
+      [&] {
+        recordScatter(commandBuffer, gatherScatter, descriptorSets[SCATTER],
+                      rowCount, width, rowCount);
+      },
+      &milliseconds);
+  if (error) {
+    return error;
+  }
+  report("scatter", milliseconds, 2.0 * rowBytes * rowCount);
+  for (uint32_t index = 0; index < rowCount * width; index++) {
+    const float actual =
+        tableData[permutation[index / width] * width + index % width];
+    if (actual != batchData[index]) {
+      fprintf(stderr, "scatter [%u] is '%f' not '%f'!\n", index, actual,
+              batchData[index]);
+      failures++;
+      break;
+    }
+  }
+
+  // accumulate gradients of the skewed batch into the table, they are
+  // multiples of 1/1024 in [-1, 1) and the hottest row is hit fewer than 8K
+  // times, so every partial sum is exact in a float and the result does not
+  // depend on the order of the atomic additions
+  memcpy(indexData, skewedIndices.data(), sizeof(uint32_t) * batchCount);
+  for (uint32_t index = 0; index < batchCount * width; index++) {
+    batchData[index] = (float)(nextRandom(seed) % 2048) / 1024.0f - 1.0f;
+  }
+  std::vector<float> sums(rowCount * width, 0.0f);
+  for (uint32_t index = 0; index < batchCount * width; index++) {
+    const uint32_t row = skewedIndices[index / width];
+    if (row < rowCount) {
+      sums[row * width + index % width] += batchData[index];
+    }
+  }
+  for (bool atomicFloat : {true, false}) {
+    if (atomicFloat && !gatherScatter.scatterAddFloat) {
+      printf("%-28s %10s\n", "scatter-add float atomic", "unsupported");
+      continue;
+    }
+    gatherScatter.useAtomicFloat = atomicFloat;
+    memset(tableData, 0, sizeof(float) * rowCount * width);
+    error = submit(
+        [&] {
+          recordScatterAdd(commandBuffer, gatherScatter,
+                           descriptorSets[SCATTER], false, batchCount, width,
+                           rowCount);
+        },
+        &milliseconds);
+    if (error) {
+      return error;
+    }
+    const std::string name = std::string("scatter-add float ") +
+                             (atomicFloat ? "atomic" : "compare and swap");
+    report(name.c_str(), milliseconds, 3.0 * rowBytes * batchCount);
+    for (uint32_t index = 0; index < rowCount * width; index++) {
+      if (tableData[index] != sums[index]) {
+        fprintf(stderr, "%s [%u] is '%f' not '%f'!\n", name.c_str(), index,
+                tableData[index], sums[index]);
+        failures++;
+        break;
+      }
+    }
+  }
+
+  // integer addition is associative so the counts must match exactly
+  uint32_t *batchWords = reinterpret_cast<uint32_t *>(batchData);
+  uint32_t *tableWords = reinterpret_cast<uint32_t *>(tableData);
+  std::vector<uint32_t> totals(rowCount * width, 0);
+  for (uint32_t index = 0; index < batchCount * width; index++) {
+    batchWords[index] = nextRandom(seed);
+    const uint32_t row = skewedIndices[index / width];
+    if (row < rowCount) {
+      totals[row * width + index % width] += batchWords[index];
+    }
+  }
+  memset(tableWords, 0, sizeof(uint32_t) * rowCount * width);
+  error = submit(
+      [&] {
+        recordScatterAdd(commandBuffer, gatherScatter,
+                         descriptorSets[SCATTER], true, batchCount, width,
+                         rowCount);
+      },
+      &milliseconds);
+  if (error) {
+    return error;
+  }
+  report("scatter-add integer", milliseconds, 3.0 * rowBytes * batchCount);
+  for (uint32_t index = 0; index < rowCount * width; index++) {
+    if (tableWords[index] != totals[index]) {
+      fprintf(stderr, "scatter-add integer [%u] is '%u' not '%u'!\n", index,
+              tableWords[index], totals[index]);
+      failures++;
+      break;
+    }
+  }
+  vkUnmapMemory(device, memory);
+
+  if (queryPool) {
+    vkDestroyQueryPool(device, queryPool, nullptr);
+  }
+  vkDestroyCommandPool(device, commandPool, nullptr);
+  vkFreeMemory(device, memory, nullptr);
+  for (auto buffer : buffers) {
+    vkDestroyBuffer(device, buffer, nullptr);
+  }
+  vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+  if (gatherScatter.scatterAddFloat) {
+    vkDestroyPipeline(device, gatherScatter.scatterAddFloat, nullptr);
+  }
+  vkDestroyPipeline(device, gatherScatter.scatterAddCompareAndSwap, nullptr);
+  vkDestroyPipeline(device, gatherScatter.scatterAddInteger, nullptr);
+  vkDestroyPipeline(device, gatherScatter.scatter, nullptr);
+  vkDestroyPipeline(device, gatherScatter.gather, nullptr);
+  vkDestroyPipelineLayout(device, gatherScatter.pipelineLayout, nullptr);
+  vkDestroyDescriptorSetLayout(device, setLayout, nullptr);
+  vkDestroyDevice(device, nullptr);
+  vkDestroyInstance(instance, nullptr);
+
+  if (failures) {
+    return 1;
+  }
+  printf("success\n");
+
+  return 0;
+}
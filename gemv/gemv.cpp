@@ -0,0 +1,679 @@
+#include <vulkan/vulkan.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <string>
+#include <vector>
+
+// load a SPIR-V binary from disc
+std::vector<char> loadShaderCode(const char *filename) {
+  std::vector<char> shaderCode;
+  if (FILE *fp = fopen(filename, "rb")) {
+    char buf[1024];
+    while (size_t len = fread(buf, 1, sizeof(buf), fp)) {
+      shaderCode.insert(shaderCode.end(), buf, buf + len);
+    }
+    fclose(fp);
+  }
+  return shaderCode;
+}
+
+// search for compatible memory properties and return the memory type index
+int32_t findMemoryTypeFromProperties(
+    uint32_t memoryTypeBits, VkPhysicalDeviceMemoryProperties properties,
+    VkMemoryPropertyFlags requiredProperties) {
+  assert(properties.memoryTypeCount < 32u);
+  for (uint32_t index = 0; index < properties.memoryTypeCount; ++index) {
+    if (memoryTypeBits & (1u << index) &&
+        // Find the first memory type that supports all the required flags.
+        ((properties.memoryTypes[index].propertyFlags & requiredProperties) ==
+         requiredProperties)) {
+      return (int32_t)index;
+    }
+  }
+  return -1;
+}
+
+// create a compute pipeline from a SPIR-V binary found in SHADER_PATH
+VkResult createComputePipeline(VkDevice device, VkPipelineLayout layout,
+                               const char *filename,
+                               const VkSpecializationInfo *specializationInfo,
+                               VkPipeline *pipeline) {
+  auto shaderCode =
+      loadShaderCode((std::string(SHADER_PATH) + filename).c_str());
+  if (shaderCode.empty()) {
+    fprintf(stderr, "failed to load '%s'\n", filename);
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
+  shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  shaderModuleCreateInfo.pCode =
+      reinterpret_cast<uint32_t *>(shaderCode.data());
+  shaderModuleCreateInfo.codeSize = shaderCode.size();
+  VkShaderModule shaderModule = VK_NULL_HANDLE;
+  VkResult error = vkCreateShaderModule(device, &shaderModuleCreateInfo,
+                                        nullptr, &shaderModule);
+  if (error) {
+    return error;
+  }
+  VkComputePipelineCreateInfo pipelineCreateInfo = {};
+  pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineCreateInfo.stage.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipelineCreateInfo.stage.module = shaderModule;
+  pipelineCreateInfo.stage.pName = "main";
+  pipelineCreateInfo.stage.pSpecializationInfo = specializationInfo;
+  pipelineCreateInfo.layout = layout;
+  error = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1,
+                                   &pipelineCreateInfo, nullptr, pipeline);
+  vkDestroyShaderModule(device, shaderModule, nullptr);
+  return error;
+}
+
+enum GemvLayout { ROW_MAJOR, COLUMN_MAJOR };
+
+// mirrors the push constant block shared by both shaders
+struct GemvParams {
+  uint32_t rows;
+  uint32_t columns;
+  uint32_t lda;
+  float alpha;
+  float beta;
+  uint32_t lanesPerRow;
+  uint32_t splits;
+};
+
+// the shaders share a pipeline layout whose descriptor set binds A, x, y and
+// the workspace for split reductions in that order
+struct Gemv {
+  VkPipelineLayout pipelineLayout;
+  VkPipeline rows[2];     // indexed by the workgroupPerRow constant
+  VkPipeline columns[2];  // indexed by the combine constant
+  uint32_t subgroupSize;
+  uint32_t maxGroupCount[2];
+  uint32_t workspaceSize;  // in floats
+};
+
+// both shaders use 256 invocations per workgroup, gemv_columns.comp arranges
+// them as 64 outputs by 4 slices
+const uint32_t localSize = 256;
+const uint32_t columnsLocalSizeX = 64;
+// a rough count of the invocations which need to be in flight to saturate
+// memory bandwidth on current desktop GPUs, when a matrix offers fewer rows
+// than this the reduction of each row is spread across more invocations
+const uint32_t saturatingInvocations = 64 * 1024;
+
+uint32_t divideRoundUp(uint32_t value, uint32_t divisor) {
+  return (value + divisor - 1) / divisor;
+}
+
+uint32_t nextPowerOfTwo(uint32_t value) {
+  uint32_t power = 1;
+  while (power < value) {
+    power *= 2;
+  }
+  return power;
+}
+
+// y = alpha * op(A) * x + beta * y, where A is an m by n matrix with leading
+// dimension lda and op(A) is A or its transpose, x and y are contiguous
+//
+// whichever the layout and transpose the reduction either runs along
+// contiguous memory, handled by gemv_rows.comp, or across it, handled by
+// gemv_columns.comp, when there are too few outputs to keep the device busy
+// the reduction is split across workgroups and a second dispatch combines
+// the partials
+void recordGemv(VkCommandBuffer commandBuffer, const Gemv &gemv,
+                GemvLayout layout, bool transpose, uint32_t m, uint32_t n,
+                uint32_t lda, float alpha, float beta) {
+  GemvParams params = {};
+  params.rows = transpose ? n : m;
+  params.columns = transpose ? m : n;
+  params.lda = lda;
+  params.alpha = alpha;
+  params.beta = beta;
+  params.lanesPerRow = 1;
+  params.splits = 1;
+  // there is no output to write, and the split below divides by the rows
+  if (params.rows == 0) {
+    return;
+  }
+
+  VkPipeline pipeline;
+  uint32_t groupCount;
+  if ((layout == ROW_MAJOR) != transpose) {
+    const bool workgroupPerRow =
+        params.columns > gemv.subgroupSize &&
+        params.rows * gemv.subgroupSize < saturatingInvocations;
+    pipeline = gemv.rows[workgroupPerRow];
+    if (workgroupPerRow) {
+      groupCount = params.rows;
+      params.splits = divideRoundUp(saturatingInvocations,
+                                    params.rows * localSize);
+      params.splits = std::min(
+          params.splits, divideRoundUp(params.columns, localSize));
+    } else {
+      // short rows share a subgroup rather than leave lanes idle
+      params.lanesPerRow =
+          std::min(nextPowerOfTwo(params.columns), gemv.subgroupSize);
+      groupCount =
+          divideRoundUp(params.rows, localSize / params.lanesPerRow);
+    }
+  } else {
+    pipeline = gemv.columns[0];
+    groupCount = divideRoundUp(params.rows, columnsLocalSizeX);
+    params.splits = divideRoundUp(saturatingInvocations,
+                                  groupCount * localSize);
+    params.splits = std::min(
+        params.splits, divideRoundUp(params.columns, localSize));
+  }
+  groupCount = std::min(groupCount, gemv.maxGroupCount[0]);
+  params.splits = std::min(params.splits, gemv.maxGroupCount[1]);
+  params.splits = std::min(params.splits, gemv.workspaceSize / params.rows);
+  params.splits = std::max(params.splits, 1u);
+
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+  vkCmdPushConstants(commandBuffer, gemv.pipelineLayout,
+                     VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(GemvParams),
+                     &params);
+  vkCmdDispatch(commandBuffer, groupCount, params.splits, 1);
+  if (params.splits == 1) {
+    return;
+  }
+
+  VkMemoryBarrier memoryBarrier = {};
+  memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1,
+                       &memoryBarrier, 0, nullptr, 0, nullptr);
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                    gemv.columns[1]);
+  vkCmdDispatch(commandBuffer,
+                std::min(divideRoundUp(params.rows, columnsLocalSizeX),
+                         gemv.maxGroupCount[0]),
+                1, 1);
+}
+
+int main() {
+  VkApplicationInfo applicationInfo = {};
+  applicationInfo.pApplicationName = "Vulkan GEMV example";
+  // subgroup operations are core in Vulkan 1.1
+  applicationInfo.apiVersion = VK_API_VERSION_1_1;
+
+  VkInstanceCreateInfo instanceCreateInfo = {};
+  instanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+  instanceCreateInfo.pApplicationInfo = &applicationInfo;
+#ifdef ENABLE_LAYERS
+  // without a debug report callback, see vector_add, the validation layer
+  // prints its messages to stdout
+  std::vector<const char *> enabledLayerNames{"VK_LAYER_KHRONOS_validation"};
+  instanceCreateInfo.enabledLayerCount = enabledLayerNames.size();
+  instanceCreateInfo.ppEnabledLayerNames = enabledLayerNames.data();
+#endif
+
+  VkInstance instance = VK_NULL_HANDLE;
+  VkResult error = vkCreateInstance(&instanceCreateInfo, nullptr, &instance);
+  if (error) {
+    return error;
+  }
+
+  uint32_t count;
+  error = vkEnumeratePhysicalDevices(instance, &count, nullptr);
+  if (error) {
+    return error;
+  }
+  std::vector<VkPhysicalDevice> physicalDevices(count);
+  error = vkEnumeratePhysicalDevices(instance, &count, physicalDevices.data());
+  if (error) {
+    return error;
+  }
+
+  // find a Vulkan 1.1 physical device with a compute queue which supports
+  // subgroup arithmetic and shuffles in compute shaders
+  const VkSubgroupFeatureFlags requiredSubgroupOperations =
+      VK_SUBGROUP_FEATURE_BASIC_BIT | VK_SUBGROUP_FEATURE_ARITHMETIC_BIT |
+      VK_SUBGROUP_FEATURE_SHUFFLE_BIT;
+  VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+  uint32_t queueFamilyIndex = 0;
+  uint32_t timestampValidBits = 0;
+  VkPhysicalDeviceSubgroupProperties subgroupProperties = {};
+  subgroupProperties.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES;
+  VkPhysicalDeviceProperties2 properties = {};
+  properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+  properties.pNext = &subgroupProperties;
+  for (auto device : physicalDevices) {
+    vkGetPhysicalDeviceProperties(device, &properties.properties);
+    if (properties.properties.apiVersion < VK_API_VERSION_1_1) {
+      continue;
+    }
+    vkGetPhysicalDeviceProperties2(device, &properties);
+    if (!(subgroupProperties.supportedStages & VK_SHADER_STAGE_COMPUTE_BIT) ||
+        (subgroupProperties.supportedOperations &
+         requiredSubgroupOperations) != requiredSubgroupOperations) {
+      continue;
+    }
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilyProperties(count);
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count,
+                                             queueFamilyProperties.data());
+    for (uint32_t index = 0; index < count; index++) {
+      if (queueFamilyProperties[index].queueFlags & VK_QUEUE_COMPUTE_BIT) {
+        physicalDevice = device;
+        queueFamilyIndex = index;
+        timestampValidBits = queueFamilyProperties[index].timestampValidBits;
+        break;
+      }
+    }
+    if (physicalDevice) {
+      break;
+    }
+  }
+  if (!physicalDevice) {
+    fprintf(stderr, "no device supports subgroup arithmetic and shuffles\n");
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+  }
+  const VkPhysicalDeviceLimits &limits = properties.properties.limits;
+
+  VkDeviceQueueCreateInfo queueCreateInfo = {};
+  queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+  queueCreateInfo.queueCount = 1;
+  queueCreateInfo.queueFamilyIndex = queueFamilyIndex;
+  float queuePriority = 1.0f;
+  queueCreateInfo.pQueuePriorities = &queuePriority;
+
+  VkDeviceCreateInfo deviceCreateInfo = {};
+  deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+  deviceCreateInfo.queueCreateInfoCount = 1;
+  deviceCreateInfo.pQueueCreateInfos = &queueCreateInfo;
+  VkDevice device = VK_NULL_HANDLE;
+  error = vkCreateDevice(physicalDevice, &deviceCreateInfo, nullptr, &device);
+  if (error) {
+    return error;
+  }
+
+  VkQueue queue;
+  vkGetDeviceQueue(device, queueFamilyIndex, 0, &queue);
+
+  // A, x, y and workspace
+  std::vector<VkDescriptorSetLayoutBinding> layoutBindings;
+  VkDescriptorSetLayoutBinding layoutBinding = {};
+  layoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  layoutBinding.descriptorCount = 1;
+  layoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  for (uint32_t binding = 0; binding < 4; binding++) {
+    layoutBinding.binding = binding;
+    layoutBindings.push_back(layoutBinding);
+  }
+
+  VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo = {};
+  setLayoutCreateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  setLayoutCreateInfo.bindingCount = layoutBindings.size();
+  setLayoutCreateInfo.pBindings = layoutBindings.data();
+  VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+  error = vkCreateDescriptorSetLayout(device, &setLayoutCreateInfo, nullptr,
+                                      &setLayout);
+  if (error) {
+    return error;
+  }
+
+  VkPushConstantRange pushConstantRange = {};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(GemvParams);
+
+  // the matrix is used as 65536 by 256 and as 256 by 65536
+  const uint32_t longDimension = 1 << 16;
+  const uint32_t shortDimension = 256;
+  const uint32_t elementCount = longDimension * shortDimension;
+
+  Gemv gemv = {};
+  gemv.subgroupSize = subgroupProperties.subgroupSize;
+  gemv.maxGroupCount[0] = limits.maxComputeWorkGroupCount[0];
+  gemv.maxGroupCount[1] = limits.maxComputeWorkGroupCount[1];
+  gemv.workspaceSize = 1 << 20;
+  VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+  pipelineLayoutCreateInfo.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutCreateInfo.setLayoutCount = 1;
+  pipelineLayoutCreateInfo.pSetLayouts = &setLayout;
+  pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+  pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+  error = vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr,
+                                 &gemv.pipelineLayout);
+  if (error) {
+    return error;
+  }
+
+  // both shaders take a single boolean specialization constant
+  VkSpecializationMapEntry specializationMapEntry = {};
+  specializationMapEntry.constantID = 0;
+  specializationMapEntry.offset = 0;
+  specializationMapEntry.size = sizeof(VkBool32);
+  for (VkBool32 value = VK_FALSE; value <= VK_TRUE; value++) {
+    VkSpecializationInfo specializationInfo = {};
+    specializationInfo.mapEntryCount = 1;
+    specializationInfo.pMapEntries = &specializationMapEntry;
+    specializationInfo.dataSize = sizeof(VkBool32);
+    specializationInfo.pData = &value;
+    error = createComputePipeline(device, gemv.pipelineLayout,
+                                  "gemv_rows.spv", &specializationInfo,
+                                  &gemv.rows[value]);
+    if (error) {
+      return error;
+    }
+    error = createComputePipeline(device, gemv.pipelineLayout,
+                                  "gemv_columns.spv", &specializationInfo,
+                                  &gemv.columns[value]);
+    if (error) {
+      return error;
+    }
+  }
+
+  enum { A, X, Y, WORKSPACE, BUFFER_COUNT };
+  const VkDeviceSize bufferSizes[BUFFER_COUNT] = {
+      sizeof(float) * elementCount, sizeof(float) * longDimension,
+      sizeof(float) * longDimension, sizeof(float) * gemv.workspaceSize};
+  VkBuffer buffers[BUFFER_COUNT];
+  for (uint32_t index = 0; index < BUFFER_COUNT; index++) {
+    VkBufferCreateInfo bufferCreateInfo = {};
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.size = bufferSizes[index];
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    bufferCreateInfo.queueFamilyIndexCount = 1;
+    bufferCreateInfo.pQueueFamilyIndices = &queueFamilyIndex;
+    error = vkCreateBuffer(device, &bufferCreateInfo, nullptr, &buffers[index]);
+    if (error) {
+      return error;
+    }
+  }
+
+  VkDeviceSize bufferOffsets[BUFFER_COUNT];
+  VkDeviceSize requiredMemorySize = 0;
+  VkMemoryRequirements memoryRequirements;
+  for (uint32_t index = 0; index < BUFFER_COUNT; index++) {
+    vkGetBufferMemoryRequirements(device, buffers[index], &memoryRequirements);
+    const VkDeviceSize alignment = memoryRequirements.alignment;
+    requiredMemorySize =
+        (requiredMemorySize + alignment - 1) / alignment * alignment;
+    bufferOffsets[index] = requiredMemorySize;
+    requiredMemorySize += memoryRequirements.size;
+  }
+
+  VkPhysicalDeviceMemoryProperties memoryProperties;
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+  auto memoryTypeIndex = findMemoryTypeFromProperties(
+      memoryRequirements.memoryTypeBits, memoryProperties,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  if (0 > memoryTypeIndex) {
+    return ~42;  // returns -43
+  }
+
+  VkMemoryAllocateInfo allocateInfo = {};
+  allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocateInfo.allocationSize = requiredMemorySize;
+  allocateInfo.memoryTypeIndex = memoryTypeIndex;
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  error = vkAllocateMemory(device, &allocateInfo, nullptr, &memory);
+  if (error) {
+    return error;
+  }
+  for (uint32_t index = 0; index < BUFFER_COUNT; index++) {
+    error = vkBindBufferMemory(device, buffers[index], memory,
+                               bufferOffsets[index]);
+    if (error) {
+      return error;
+    }
+  }
+
+  VkDescriptorPoolSize poolSize = {};
+  poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  poolSize.descriptorCount = layoutBindings.size();
+  VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = {};
+  descriptorPoolCreateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  descriptorPoolCreateInfo.maxSets = 1;
+  descriptorPoolCreateInfo.poolSizeCount = 1;
+  descriptorPoolCreateInfo.pPoolSizes = &poolSize;
+  VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+  error = vkCreateDescriptorPool(device, &descriptorPoolCreateInfo, nullptr,
+                                 &descriptorPool);
+  if (error) {
+    return error;
+  }
+
+  VkDescriptorSetAllocateInfo descriptorSetAllocateInfo = {};
+  descriptorSetAllocateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  descriptorSetAllocateInfo.descriptorPool = descriptorPool;
+  descriptorSetAllocateInfo.descriptorSetCount = 1;
+  descriptorSetAllocateInfo.pSetLayouts = &setLayout;
+  VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+  error = vkAllocateDescriptorSets(device, &descriptorSetAllocateInfo,
+                                   &descriptorSet);
+  if (error) {
+    return error;
+  }
+
+  VkDescriptorBufferInfo bufferInfos[BUFFER_COUNT];
+  std::vector<VkWriteDescriptorSet> descriptorSetWrites;
+  VkWriteDescriptorSet writeDescriptorSet = {};
+  writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  writeDescriptorSet.dstSet = descriptorSet;
+  writeDescriptorSet.dstArrayElement = 0;
+  writeDescriptorSet.descriptorCount = 1;
+  writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  for (uint32_t index = 0; index < BUFFER_COUNT; index++) {
+    bufferInfos[index].buffer = buffers[index];
+    bufferInfos[index].offset = 0;
+    bufferInfos[index].range = VK_WHOLE_SIZE;
+    writeDescriptorSet.dstBinding = index;
+    writeDescriptorSet.pBufferInfo = &bufferInfos[index];
+    descriptorSetWrites.push_back(writeDescriptorSet);
+  }
+  vkUpdateDescriptorSets(device, descriptorSetWrites.size(),
+                         descriptorSetWrites.data(), 0, nullptr);
+
+  char *data = nullptr;
+  error = vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0,
+                      reinterpret_cast<void **>(&data));
+  if (error) {
+    return error;
+  }
+  float *aData = reinterpret_cast<float *>(data + bufferOffsets[A]);
+  float *xData = reinterpret_cast<float *>(data + bufferOffsets[X]);
+  float *yData = reinterpret_cast<float *>(data + bufferOffsets[Y]);
+  uint32_t seed = 7;
+  for (uint32_t index = 0; index < elementCount; index++) {
+    seed = seed * 1664525u + 1013904223u;
+    aData[index] = (float)(seed >> 8) / (float)(1 << 23) - 1.0f;
+  }
+  std::vector<float> initialY(longDimension);
+  for (uint32_t index = 0; index < longDimension; index++) {
+    seed = seed * 1664525u + 1013904223u;
+    xData[index] = (float)(seed >> 8) / (float)(1 << 23) - 1.0f;
+    seed = seed * 1664525u + 1013904223u;
+    initialY[index] = (float)(seed >> 8) / (float)(1 << 23) - 1.0f;
+  }
+
+  VkQueryPool queryPool = VK_NULL_HANDLE;
+  if (timestampValidBits) {
+    VkQueryPoolCreateInfo queryPoolCreateInfo = {};
+    queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolCreateInfo.queryCount = 2;
+    error = vkCreateQueryPool(device, &queryPoolCreateInfo, nullptr,
+                              &queryPool);
+    if (error) {
+      return error;
+    }
+  }
+
+  VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+  commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+  commandPoolCreateInfo.queueFamilyIndex = queueFamilyIndex;
+  VkCommandPool commandPool = VK_NULL_HANDLE;
+  error = vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr,
+                              &commandPool);
+  if (error) {
+    return error;
+  }
+
+  VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
+  commandBufferAllocateInfo.sType =
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  commandBufferAllocateInfo.commandPool = commandPool;
+  commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  commandBufferAllocateInfo.commandBufferCount = 1;
+  VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+  error = vkAllocateCommandBuffers(device, &commandBufferAllocateInfo,
+                                   &commandBuffer);
+  if (error) {
+    return error;
+  }
+
+  // run every layout and transpose on a tall and a wide matrix, between them
+  // these cover short rows sharing a subgroup, a workgroup per row, and the
+  // split reduction when only 256 outputs lie across contiguous memory
+  const float alpha = 1.5f;
+  printf("%-8s %-6s %-9s %12s %10s\n", "shape", "layout", "transpose",
+         "device ms", "GB/s");
+  int failures = 0;
+  for (uint32_t test = 0; test < 8; test++) {
+    const bool wide = test & 4;
+    const GemvLayout layout = (test & 2) ? COLUMN_MAJOR : ROW_MAJOR;
+    const bool transpose = test & 1;
+    const uint32_t m = wide ? shortDimension : longDimension;
+    const uint32_t n = wide ? longDimension : shortDimension;
+    const uint32_t lda = layout == ROW_MAJOR ? n : m;
+    const uint32_t outputs = transpose ? n : m;
+    const uint32_t length = transpose ? m : n;
+    // y is not read when beta is zero, fill it with NaN to prove it
+    const float beta = transpose ? 0.0f : 0.5f;
+    for (uint32_t index = 0; index < outputs; index++) {
+      yData[index] = beta == 0.0f ? std::numeric_limits<float>::quiet_NaN()
+                                  : initialY[index];
+    }
+
+    error = vkResetCommandPool(device, commandPool, 0);
+    if (error) {
+      return error;
+    }
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    error = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    if (error) {
+      return error;
+    }
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                            gemv.pipelineLayout, 0, 1, &descriptorSet, 0,
+                            nullptr);
+    if (queryPool) {
+      vkCmdResetQueryPool(commandBuffer, queryPool, 0, 2);
+      vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                          queryPool, 0);
+    }
+    recordGemv(commandBuffer, gemv, layout, transpose, m, n, lda, alpha,
+               beta);
+    if (queryPool) {
+      vkCmdWriteTimestamp(commandBuffer,
+                          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, queryPool, 1);
+    }
+    error = vkEndCommandBuffer(commandBuffer);
+    if (error) {
+      return error;
+    }
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    error = vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+    if (error) {
+      return error;
+    }
+    vkQueueWaitIdle(queue);
+
+    double milliseconds = 0.0;
+    if (queryPool) {
+      uint64_t timestamps[2];
+      error = vkGetQueryPoolResults(
+          device, queryPool, 0, 2, sizeof(timestamps), timestamps,
+          sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+      if (error) {
+        return error;
+      }
+      milliseconds =
+          (timestamps[1] - timestamps[0]) * limits.timestampPeriod * 1e-6;
+    }
+    // the matrix dominates the memory traffic
+    const double bytes = sizeof(float) * ((double)elementCount + length +
+                                          (beta == 0.0f ? 1 : 2) * outputs);
+    printf("%-8s %-6s %-9s %12.3f %10.1f\n", wide ? "wide" : "tall",
+           layout == ROW_MAJOR ? "row" : "column", transpose ? "yes" : "no",
+           milliseconds,
+           milliseconds > 0.0 ? bytes / milliseconds * 1e-6 : 0.0);
+
+    for (uint32_t row = 0; row < outputs; row++) {
+      double sum = 0.0;
+      double magnitude = 0.0;
+      for (uint32_t column = 0; column < length; column++) {
+        const uint32_t i = transpose ? column : row;
+        const uint32_t j = transpose ? row : column;
+        const float element =
+            layout == ROW_MAJOR ? aData[i * lda + j] : aData[i + j * lda];
+        sum += (double)element * xData[column];
+        magnitude += fabs((double)element * xData[column]);
+      }
+      double expected = alpha * sum;
+      if (beta != 0.0f) {
+        expected += (double)beta * initialY[row];
+      }
+      // float accumulation error grows with the sum of the magnitudes
+      const double tolerance = 1e-5 * (alpha * magnitude + 1.0);
+      if (!(fabs(yData[row] - expected) <= tolerance)) {
+        fprintf(stderr, "y[%u] is '%f' not '%f'!\n", row, yData[row],
+                expected);
+        failures++;
+        break;
+      }
+    }
+  }
+  vkUnmapMemory(device, memory);
+
+  if (queryPool) {
+    vkDestroyQueryPool(device, queryPool, nullptr);
+  }
+  vkDestroyCommandPool(device, commandPool, nullptr);
+  vkFreeMemory(device, memory, nullptr);
+  for (auto buffer : buffers) {
+    vkDestroyBuffer(device, buffer, nullptr);
+  }
+  vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+  for (uint32_t index = 0; index < 2; index++) {
+    vkDestroyPipeline(device, gemv.rows[index], nullptr);
+    vkDestroyPipeline(device, gemv.columns[index], nullptr);
+  }
+  vkDestroyPipelineLayout(device, gemv.pipelineLayout, nullptr);
+  vkDestroyDescriptorSetLayout(device, setLayout, nullptr);
+  vkDestroyDevice(device, nullptr);
+  vkDestroyInstance(instance, nullptr);
+
+  if (failures) {
+    return 1;
+  }
+  printf("success\n");
+
+  return 0;
+}
@@ -0,0 +1,722 @@
+#include <vulkan/vulkan.h>
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// load a SPIR-V binary from disc
+std::vector<char> loadShaderCode(const char *filename) {
+  std::vector<char> shaderCode;
+  if (FILE *fp = fopen(filename, "rb")) {
+    char buf[1024];
+    while (size_t len = fread(buf, 1, sizeof(buf), fp)) {
+      shaderCode.insert(shaderCode.end(), buf, buf + len);
+    }
+    fclose(fp);
+  }
+  return shaderCode;
+}
+
+// search for compatible memory properties and return the memory type index
+int32_t findMemoryTypeFromProperties(
+    uint32_t memoryTypeBits, VkPhysicalDeviceMemoryProperties properties,
+    VkMemoryPropertyFlags requiredProperties) {
+  assert(properties.memoryTypeCount < 32u);
+  for (uint32_t index = 0; index < properties.memoryTypeCount; ++index) {
+    if (memoryTypeBits & (1u << index) &&
+        // Find the first memory type that supports all the required flags.
+        ((properties.memoryTypes[index].propertyFlags & requiredProperties) ==
+         requiredProperties)) {
+      return (int32_t)index;
+    }
+  }
+  return -1;
+}
+
+// create a compute pipeline from a SPIR-V binary found in SHADER_PATH
+VkResult createComputePipeline(VkDevice device, VkPipelineLayout layout,
+                               const char *filename,
+                               const VkSpecializationInfo *specializationInfo,
+                               VkPipeline *pipeline) {
+  auto shaderCode =
+      loadShaderCode((std::string(SHADER_PATH) + filename).c_str());
+  if (shaderCode.empty()) {
+    fprintf(stderr, "failed to load '%s'\n", filename);
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
+  shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  shaderModuleCreateInfo.pCode =
+      reinterpret_cast<uint32_t *>(shaderCode.data());
+  shaderModuleCreateInfo.codeSize = shaderCode.size();
+  VkShaderModule shaderModule = VK_NULL_HANDLE;
+  VkResult error = vkCreateShaderModule(device, &shaderModuleCreateInfo,
+                                        nullptr, &shaderModule);
+  if (error) {
+    return error;
+  }
+  VkComputePipelineCreateInfo pipelineCreateInfo = {};
+  pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineCreateInfo.stage.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipelineCreateInfo.stage.module = shaderModule;
+  pipelineCreateInfo.stage.pName = "main";
+  pipelineCreateInfo.stage.pSpecializationInfo = specializationInfo;
+  pipelineCreateInfo.layout = layout;
+  error = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1,
+                                   &pipelineCreateInfo, nullptr, pipeline);
+  vkDestroyShaderModule(device, shaderModule, nullptr);
+  return error;
+}
+
+// mirror the push constant block of hash_table.comp and hash_table64.comp
+struct HashTableParams {
+  uint32_t count;
+  uint32_t capacityMask;
+};
+
+// the values of the operation specialization constant
+enum Operation { INSERT, LOOKUP, COUNT, OPERATION_COUNT };
+
+// a device resident table of capacity slots, the slot keys are 64 bit when
+// wideKeys is true and 32 bit otherwise, status is set when an insert found
+// the table full
+struct HashTable {
+  VkBuffer keys;
+  VkBuffer values;
+  VkBuffer counts;
+  VkBuffer status;
+  uint32_t capacity;
+  bool wideKeys;
+};
+
+// the shaders share a pipeline layout whose descriptor set binds the slot
+// keys, values and counts, the keys and values operated on, the results and
+// the status, the pipelines for 64 bit keys are only created when the device
+// supports 64 bit integer atomics on buffers
+struct HashTableKernels {
+  VkPipelineLayout pipelineLayout;
+  VkPipeline pipelines[2][OPERATION_COUNT];
+  uint32_t maxGroupCount;
+};
+
+uint32_t divideRoundUp(uint32_t value, uint32_t divisor) {
+  return (value + divisor - 1) / divisor;
+}
+
+// the smallest power of two which keeps the table at most half full, longer
+// probe sequences at higher loads cost more than the memory saved
+uint32_t capacityFor(uint32_t count) {
+  uint32_t capacity = 1;
+  while (capacity < 2 * count) {
+    capacity *= 2;
+  }
+  return capacity;
+}
+
+// empty every slot and clear the status, the keys and values are filled with
+// ~0 which marks an empty slot and a missing value
+void recordReset(VkCommandBuffer commandBuffer, const HashTable &table) {
+  vkCmdFillBuffer(commandBuffer, table.keys, 0, VK_WHOLE_SIZE, ~0u);
+  vkCmdFillBuffer(commandBuffer, table.values, 0, VK_WHOLE_SIZE, ~0u);
+  vkCmdFillBuffer(commandBuffer, table.counts, 0, VK_WHOLE_SIZE, 0);
+  vkCmdFillBuffer(commandBuffer, table.status, 0, VK_WHOLE_SIZE, 0);
+  VkMemoryBarrier memoryBarrier = {};
+  memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  memoryBarrier.dstAccessMask =
+      VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1,
+                       &memoryBarrier, 0, nullptr, 0, nullptr);
+}
+
+// insert, look up or count count keys of the table bound by descriptorSet
+void recordHashTable(VkCommandBuffer commandBuffer,
+                     const HashTableKernels &kernels, const HashTable &table,
+                     VkDescriptorSet descriptorSet, Operation operation,
+                     uint32_t count) {
+  HashTableParams params = {count, table.capacity - 1};
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                    kernels.pipelines[table.wideKeys][operation]);
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                          kernels.pipelineLayout, 0, 1, &descriptorSet, 0,
+                          nullptr);
+  vkCmdPushConstants(commandBuffer, kernels.pipelineLayout,
+                     VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(HashTableParams),
+                     &params);
+  vkCmdDispatch(commandBuffer,
+                std::min(divideRoundUp(count, 256), kernels.maxGroupCount), 1,
+                1);
+}
+
+uint32_t nextRandom(uint32_t &seed) {
+  seed = seed * 1664525u + 1013904223u;
+  return seed >> 8;
+}
+
+// spread the small integer id over every bit of a key, multiplying by an odd
+// constant is a bijection so distinct ids give distinct keys, none of the ids
+// used maps to the empty key ~0
+uint64_t keyOf(uint32_t id, bool wideKeys) {
+  return wideKeys ? (id + 1) * 0x9e3779b97f4a7c15ull
+                  : (uint32_t)((id + 1) * 2654435761u);
+}
+
+// milliseconds elapsed since start
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+int main() {
+  VkApplicationInfo applicationInfo = {};
+  applicationInfo.pApplicationName = "Vulkan hash table example";
+  // 64 bit integer atomics are core, although optional, in Vulkan 1.2
+  applicationInfo.apiVersion = VK_API_VERSION_1_2;
+
+  VkInstanceCreateInfo instanceCreateInfo = {};
+  instanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+  instanceCreateInfo.pApplicationInfo = &applicationInfo;
+#ifdef ENABLE_LAYERS
+  // without a debug report callback, see vector_add, the validation layer
+  // prints its messages to stdout
+  std::vector<const char *> enabledLayerNames{"VK_LAYER_KHRONOS_validation"};
+  instanceCreateInfo.enabledLayerCount = enabledLayerNames.size();
+  instanceCreateInfo.ppEnabledLayerNames = enabledLayerNames.data();
+#endif
+
+  VkInstance instance = VK_NULL_HANDLE;
+  VkResult error = vkCreateInstance(&instanceCreateInfo, nullptr, &instance);
+  if (error) {
+    return error;
+  }
+
+  uint32_t count;
+  error = vkEnumeratePhysicalDevices(instance, &count, nullptr);
+  if (error) {
+    return error;
+  }
+  std::vector<VkPhysicalDevice> physicalDevices(count);
+  error = vkEnumeratePhysicalDevices(instance, &count, physicalDevices.data());
+  if (error) {
+    return error;
+  }
+
+  // find the first Vulkan 1.1 physical device with a compute queue
+  VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+  uint32_t queueFamilyIndex = 0;
+  uint32_t timestampValidBits = 0;
+  VkPhysicalDeviceProperties physicalDeviceProperties;
+  for (auto device : physicalDevices) {
+    vkGetPhysicalDeviceProperties(device, &physicalDeviceProperties);
+    if (physicalDeviceProperties.apiVersion < VK_API_VERSION_1_1) {
+      continue;
+    }
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilyProperties(count);
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count,
+                                             queueFamilyProperties.data());
+    for (uint32_t index = 0; index < count; index++) {
+      if (queueFamilyProperties[index].queueFlags & VK_QUEUE_COMPUTE_BIT) {
+        physicalDevice = device;
+        queueFamilyIndex = index;
+        timestampValidBits = queueFamilyProperties[index].timestampValidBits;
+        break;
+      }
+    }
+    if (physicalDevice) {
+      break;
+    }
+  }
+  if (!physicalDevice) {
+    fprintf(stderr, "no Vulkan 1.1 device with a compute queue\n");
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+  }
+  const VkPhysicalDeviceLimits &limits = physicalDeviceProperties.limits;
+
+  // 64 bit keys need 64 bit integers in shaders and 64 bit atomics on
+  // storage buffers
+  VkPhysicalDeviceShaderAtomicInt64Features atomicInt64Features = {};
+  atomicInt64Features.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_ATOMIC_INT64_FEATURES;
+  VkPhysicalDeviceFeatures2 features = {};
+  features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+  features.pNext = &atomicInt64Features;
+  bool hasWideKeys = false;
+  if (physicalDeviceProperties.apiVersion >= VK_API_VERSION_1_2) {
+    vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+    hasWideKeys = features.features.shaderInt64 &&
+                  atomicInt64Features.shaderBufferInt64Atomics;
+  }
+
+  VkDeviceQueueCreateInfo queueCreateInfo = {};
+  queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+  queueCreateInfo.queueCount = 1;
+  queueCreateInfo.queueFamilyIndex = queueFamilyIndex;
+  float queuePriority = 1.0f;
+  queueCreateInfo.pQueuePriorities = &queuePriority;
+
+  // only enable the features used, leave the rest as queried
+  VkPhysicalDeviceFeatures enabledFeatures = {};
+  enabledFeatures.shaderInt64 = VK_TRUE;
+  VkPhysicalDeviceShaderAtomicInt64Features enabledAtomicInt64Features = {};
+  enabledAtomicInt64Features.sType = atomicInt64Features.sType;
+  enabledAtomicInt64Features.shaderBufferInt64Atomics = VK_TRUE;
+
+  VkDeviceCreateInfo deviceCreateInfo = {};
+  deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+  deviceCreateInfo.queueCreateInfoCount = 1;
+  deviceCreateInfo.pQueueCreateInfos = &queueCreateInfo;
+  if (hasWideKeys) {
+    deviceCreateInfo.pNext = &enabledAtomicInt64Features;
+    deviceCreateInfo.pEnabledFeatures = &enabledFeatures;
+  }
+  VkDevice device = VK_NULL_HANDLE;
+  error = vkCreateDevice(physicalDevice, &deviceCreateInfo, nullptr, &device);
+  if (error) {
+    return error;
+  }
+
+  VkQueue queue;
+  vkGetDeviceQueue(device, queueFamilyIndex, 0, &queue);
+
+  // slot keys, slot values, slot counts, keys, values, results and status
+  std::vector<VkDescriptorSetLayoutBinding> layoutBindings;
+  VkDescriptorSetLayoutBinding layoutBinding = {};
+  layoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  layoutBinding.descriptorCount = 1;
+  layoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  for (uint32_t binding = 0; binding < 7; binding++) {
+    layoutBinding.binding = binding;
+    layoutBindings.push_back(layoutBinding);
+  }
+
+  VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo = {};
+  setLayoutCreateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  setLayoutCreateInfo.bindingCount = layoutBindings.size();
+  setLayoutCreateInfo.pBindings = layoutBindings.data();
+  VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+  error = vkCreateDescriptorSetLayout(device, &setLayoutCreateInfo, nullptr,
+                                      &setLayout);
+  if (error) {
+    return error;
+  }
+
+  VkPushConstantRange pushConstantRange = {};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(HashTableParams);
+
+  HashTableKernels kernels = {};
+  kernels.maxGroupCount = limits.maxComputeWorkGroupCount[0];
+  VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+  pipelineLayoutCreateInfo.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutCreateInfo.setLayoutCount = 1;
+  pipelineLayoutCreateInfo.pSetLayouts = &setLayout;
+  pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+  pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+  error = vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr,
+                                 &kernels.pipelineLayout);
+  if (error) {
+    return error;
+  }
+
+  for (uint32_t wideKeys = 0; wideKeys < (hasWideKeys ? 2u : 1u);
+       wideKeys++) {
+    for (uint32_t operation = 0; operation < OPERATION_COUNT; operation++) {
+      VkSpecializationMapEntry specializationMapEntry = {};
+      specializationMapEntry.constantID = 0;
+      specializationMapEntry.offset = 0;
+      specializationMapEntry.size = sizeof(uint32_t);
+      VkSpecializationInfo specializationInfo = {};
+      specializationInfo.mapEntryCount = 1;
+      specializationInfo.pMapEntries = &specializationMapEntry;
+      specializationInfo.dataSize = sizeof(uint32_t);
+      specializationInfo.pData = &operation;
+      error = createComputePipeline(
+          device, kernels.pipelineLayout,
+          wideKeys ? "hash_table64.spv" : "hash_table.spv",
+          &specializationInfo, &kernels.pipelines[wideKeys][operation]);
+      if (error) {
+        return error;
+      }
+    }
+  }
+
+  // build a table from 1M keys, three quarters of them distinct, then probe
+  // it with 2M keys of which about half were inserted
+  const uint32_t buildCount = 1 << 20;
+  const uint32_t probeCount = 1 << 21;
+  const uint32_t distinctCount = buildCount / 4 * 3;
+  const uint32_t capacity = capacityFor(buildCount);
+  enum {
+    SLOT_KEYS,
+    SLOT_VALUES,
+    SLOT_COUNTS,
+    KEYS,
+    VALUES,
+    RESULTS,
+    STATUS,
+    BUFFER_COUNT
+  };
+  // sized for 64 bit keys, 32 bit keys use the first half
+  const VkDeviceSize bufferSizes[BUFFER_COUNT] = {
+      sizeof(uint64_t) * capacity, sizeof(uint32_t) * capacity,
+      sizeof(uint32_t) * capacity, sizeof(uint64_t) * probeCount,
+      sizeof(uint32_t) * buildCount, sizeof(uint32_t) * probeCount,
+      sizeof(uint32_t)};
+  VkBuffer buffers[BUFFER_COUNT];
+  for (uint32_t index = 0; index < BUFFER_COUNT; index++) {
+    VkBufferCreateInfo bufferCreateInfo = {};
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.size = bufferSizes[index];
+    // the table is reset on the device with vkCmdFillBuffer
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                             VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    bufferCreateInfo.queueFamilyIndexCount = 1;
+    bufferCreateInfo.pQueueFamilyIndices = &queueFamilyIndex;
+    error = vkCreateBuffer(device, &bufferCreateInfo, nullptr, &buffers[index]);
+    if (error) {
+      return error;
+    }
+  }
+  VkDeviceSize bufferOffsets[BUFFER_COUNT];
+  VkDeviceSize requiredMemorySize = 0;
+  VkMemoryRequirements memoryRequirements;
+  for (uint32_t index = 0; index < BUFFER_COUNT; index++) {
+    vkGetBufferMemoryRequirements(device, buffers[index], &memoryRequirements);
+    const VkDeviceSize alignment = memoryRequirements.alignment;
+    requiredMemorySize =
+        (requiredMemorySize + alignment - 1) / alignment * alignment;
+    bufferOffsets[index] = requiredMemorySize;
+    requiredMemorySize += memoryRequirements.size;
+  }
+
+  VkPhysicalDeviceMemoryProperties memoryProperties;
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+  auto memoryTypeIndex = findMemoryTypeFromProperties(
+      memoryRequirements.memoryTypeBits, memoryProperties,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  if (0 > memoryTypeIndex) {
+    return ~42;  // returns -43
+  }
+
+  VkMemoryAllocateInfo allocateInfo = {};
+  allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocateInfo.allocationSize = requiredMemorySize;
+  allocateInfo.memoryTypeIndex = memoryTypeIndex;
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  error = vkAllocateMemory(device, &allocateInfo, nullptr, &memory);
+  if (error) {
+    return error;
+  }
+  for (uint32_t index = 0; index < BUFFER_COUNT; index++) {
+    error = vkBindBufferMemory(device, buffers[index], memory,
+                               bufferOffsets[index]);
+    if (error) {
+      return error;
+    }
+  }
+
+  VkDescriptorPoolSize poolSize = {};
+  poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  poolSize.descriptorCount = BUFFER_COUNT;
+  VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = {};
+  descriptorPoolCreateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  descriptorPoolCreateInfo.maxSets = 1;
+  descriptorPoolCreateInfo.poolSizeCount = 1;
+  descriptorPoolCreateInfo.pPoolSizes = &poolSize;
+  VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+  error = vkCreateDescriptorPool(device, &descriptorPoolCreateInfo, nullptr,
+                                 &descriptorPool);
+  if (error) {
+    return error;
+  }
+
+  VkDescriptorSetAllocateInfo descriptorSetAllocateInfo = {};
+  descriptorSetAllocateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  descriptorSetAllocateInfo.descriptorPool = descriptorPool;
+  descriptorSetAllocateInfo.descriptorSetCount = 1;
+  descriptorSetAllocateInfo.pSetLayouts = &setLayout;
+  VkDescriptorSet descriptorSet;
+  error = vkAllocateDescriptorSets(device, &descriptorSetAllocateInfo,
+                                   &descriptorSet);
+  if (error) {
+    return error;
+  }
+
+  VkDescriptorBufferInfo bufferInfos[BUFFER_COUNT];
+  std::vector<VkWriteDescriptorSet> descriptorSetWrites;
+  VkWriteDescriptorSet writeDescriptorSet = {};
+  writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  writeDescriptorSet.dstSet = descriptorSet;
+  writeDescriptorSet.dstArrayElement = 0;
+  writeDescriptorSet.descriptorCount = 1;
+  writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  for (uint32_t binding = 0; binding < BUFFER_COUNT; binding++) {
+    bufferInfos[binding].buffer = buffers[binding];
+    bufferInfos[binding].offset = 0;
+    bufferInfos[binding].range = VK_WHOLE_SIZE;
+    writeDescriptorSet.dstBinding = binding;
+    writeDescriptorSet.pBufferInfo = &bufferInfos[binding];
+    descriptorSetWrites.push_back(writeDescriptorSet);
+  }
+  vkUpdateDescriptorSets(device, descriptorSetWrites.size(),
+                         descriptorSetWrites.data(), 0, nullptr);
+
+  char *data = nullptr;
+  error = vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0,
+                      reinterpret_cast<void **>(&data));
+  if (error) {
+    return error;
+  }
+  void *keyData = data + bufferOffsets[KEYS];
+  uint32_t *valueData =
+      reinterpret_cast<uint32_t *>(data + bufferOffsets[VALUES]);
+  uint32_t *resultData =
+      reinterpret_cast<uint32_t *>(data + bufferOffsets[RESULTS]);
+  uint32_t *statusData =
+      reinterpret_cast<uint32_t *>(data + bufferOffsets[STATUS]);
+
+  VkQueryPool queryPool = VK_NULL_HANDLE;
+  if (timestampValidBits) {
+    VkQueryPoolCreateInfo queryPoolCreateInfo = {};
+    queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolCreateInfo.queryCount = 2;
+    error = vkCreateQueryPool(device, &queryPoolCreateInfo, nullptr,
+                              &queryPool);
+    if (error) {
+      return error;
+    }
+  }
+
+  VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+  commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+  commandPoolCreateInfo.queueFamilyIndex = queueFamilyIndex;
+  VkCommandPool commandPool = VK_NULL_HANDLE;
+  error = vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr,
+                              &commandPool);
+  if (error) {
+    return error;
+  }
+
+  VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
+  commandBufferAllocateInfo.sType =
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  commandBufferAllocateInfo.commandPool = commandPool;
+  commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  commandBufferAllocateInfo.commandBufferCount = 1;
+  VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+  error = vkAllocateCommandBuffers(device, &commandBufferAllocateInfo,
+                                   &commandBuffer);
+  if (error) {
+    return error;
+  }
+
+  // record the work of function into the command buffer, submit it, wait for
+  // it to complete and return the time between the timestamps in
+  // milliseconds, or 0 if timestamps are not supported
+  auto submit = [&](std::function<void()> function,
+                    double *milliseconds) -> VkResult {
+    VkResult result = vkResetCommandPool(device, commandPool, 0);
+    if (result) {
+      return result;
+    }
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    result = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    if (result) {
+      return result;
+    }
+    if (queryPool) {
+      vkCmdResetQueryPool(commandBuffer, queryPool, 0, 2);
+      vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                          queryPool, 0);
+    }
+    function();
+    if (queryPool) {
+      vkCmdWriteTimestamp(commandBuffer,
+                          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, queryPool, 1);
+    }
+    result = vkEndCommandBuffer(commandBuffer);
+    if (result) {
+      return result;
+    }
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    result = vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+    if (result) {
+      return result;
+    }
+    vkQueueWaitIdle(queue);
+
+    *milliseconds = 0.0;
+    if (queryPool) {
+      uint64_t timestamps[2];
+      result = vkGetQueryPoolResults(
+          device, queryPool, 0, 2, sizeof(timestamps), timestamps,
+          sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+      if (result) {
+        return result;
+      }
+      *milliseconds =
+          (timestamps[1] - timestamps[0]) * limits.timestampPeriod * 1e-6;
+    }
+    return VK_SUCCESS;
+  };
+
+  printf("%-20s %10s %10s %10s\n", "operation", "device ms", "Mkeys/s",
+         "host ms");
+  auto report = [](const std::string &name, double milliseconds,
+                   uint32_t keyCount, double hostMilliseconds) {
+    printf("%-20s %10.3f %10.1f %10.3f\n", name.c_str(), milliseconds,
+           milliseconds > 0.0 ? keyCount / milliseconds * 1e-3 : 0.0,
+           hostMilliseconds);
+  };
+  int failures = 0;
+  for (bool wideKeys : {false, true}) {
+    const std::string width = wideKeys ? "64 bit " : "32 bit ";
+    if (wideKeys && !hasWideKeys) {
+      printf("%-20s %10s\n", (width + "keys").c_str(), "unsupported");
+      continue;
+    }
+    HashTable table = {buffers[SLOT_KEYS], buffers[SLOT_VALUES],
+                       buffers[SLOT_COUNTS], buffers[STATUS], capacity,
+                       wideKeys};
+    auto setKey = [&](uint32_t index, uint64_t key) {
+      if (wideKeys) {
+        static_cast<uint64_t *>(keyData)[index] = key;
+      } else {
+        static_cast<uint32_t *>(keyData)[index] = (uint32_t)key;
+      }
+    };
+
+    // the value of each key is the first row it appears in, as a join build
+    // would record, and the host table is the reference
+    uint32_t seed = 42;
+    std::vector<uint64_t> buildKeys(buildCount);
+    for (uint32_t index = 0; index < buildCount; index++) {
+      buildKeys[index] = keyOf(nextRandom(seed) % distinctCount, wideKeys);
+      setKey(index, buildKeys[index]);
+      valueData[index] = index;
+    }
+    auto start = std::chrono::steady_clock::now();
+    std::unordered_map<uint64_t, std::pair<uint32_t, uint32_t>> reference;
+    reference.reserve(buildCount);
+    for (uint32_t index = 0; index < buildCount; index++) {
+      auto inserted = reference.insert(
+          std::make_pair(buildKeys[index], std::make_pair(index, 0u)));
+      inserted.first->second.second++;
+    }
+    double hostMilliseconds = millisecondsSince(start);
+
+    double milliseconds;
+    error = submit(
+        [&] {
+          recordReset(commandBuffer, table);
+          recordHashTable(commandBuffer, kernels, table, descriptorSet,
+                          INSERT, buildCount);
+        },
+        &milliseconds);
+    if (error) {
+      return error;
+    }
+    report(width + "insert", milliseconds, buildCount, hostMilliseconds);
+    if (*statusData) {
+      fprintf(stderr, "%sinsert found the table full!\n", width.c_str());
+      failures++;
+    }
+
+    std::vector<uint64_t> probeKeys(probeCount);
+    for (uint32_t index = 0; index < probeCount; index++) {
+      probeKeys[index] = keyOf(nextRandom(seed) % (2 * distinctCount),
+                               wideKeys);
+      setKey(index, probeKeys[index]);
+    }
+    for (Operation operation : {LOOKUP, COUNT}) {
+      const bool lookup = operation == LOOKUP;
+      std::vector<uint32_t> expected(probeCount);
+      start = std::chrono::steady_clock::now();
+      for (uint32_t index = 0; index < probeCount; index++) {
+        auto found = reference.find(probeKeys[index]);
+        if (found == reference.end()) {
+          expected[index] = lookup ? ~0u : 0;
+        } else {
+          expected[index] =
+              lookup ? found->second.first : found->second.second;
+        }
+      }
+      hostMilliseconds = millisecondsSince(start);
+
+      error = submit(
+          [&] {
+            recordHashTable(commandBuffer, kernels, table, descriptorSet,
+                            operation, probeCount);
+          },
+          &milliseconds);
+      if (error) {
+        return error;
+      }
+      const std::string name = width + (lookup ? "lookup" : "count");
+      report(name, milliseconds, probeCount, hostMilliseconds);
+      for (uint32_t index = 0; index < probeCount; index++) {
+        if (resultData[index] != expected[index]) {
+          fprintf(stderr, "%s [%u] is '%u' not '%u'!\n", name.c_str(), index,
+                  resultData[index], expected[index]);
+          failures++;
+          break;
+        }
+      }
+    }
+  }
+  vkUnmapMemory(device, memory);
+
+  if (queryPool) {
+    vkDestroyQueryPool(device, queryPool, nullptr);
+  }
+  vkDestroyCommandPool(device, commandPool, nullptr);
+  vkFreeMemory(device, memory, nullptr);
+  for (auto buffer : buffers) {
+    vkDestroyBuffer(device, buffer, nullptr);
+  }
+  vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+  for (auto &pipelines : kernels.pipelines) {
+    for (auto pipeline : pipelines) {
+      if (pipeline) {
+        vkDestroyPipeline(device, pipeline, nullptr);
+      }
+    }
+  }
+  vkDestroyPipelineLayout(device, kernels.pipelineLayout, nullptr);
+  vkDestroyDescriptorSetLayout(device, setLayout, nullptr);
+  vkDestroyDevice(device, nullptr);
+  vkDestroyInstance(instance, nullptr);
+
+  if (failures) {
+    return 1;
+  }
+  printf("success\n");
+
+  return 0;
+}
@@ -0,0 +1,897 @@
+#include <vulkan/vulkan.h>
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+// load a SPIR-V binary from disc
+std::vector<char> loadShaderCode(const char *filename) {
+  std::vector<char> shaderCode;
+  if (FILE *fp = fopen(filename, "rb")) {
+    char buf[1024];
+    while (size_t len = fread(buf, 1, sizeof(buf), fp)) {
+      shaderCode.insert(shaderCode.end(), buf, buf + len);
+    }
+    fclose(fp);
+  }
+  return shaderCode;
+}
+
+// search for compatible memory properties and return the memory type index
+int32_t findMemoryTypeFromProperties(
+    uint32_t memoryTypeBits, VkPhysicalDeviceMemoryProperties properties,
+    VkMemoryPropertyFlags requiredProperties) {
+  assert(properties.memoryTypeCount < 32u);
+  for (uint32_t index = 0; index < properties.memoryTypeCount; ++index) {
+    if (memoryTypeBits & (1u << index) &&
+        // Find the first memory type that supports all the required flags.
+        ((properties.memoryTypes[index].propertyFlags & requiredProperties) ==
+         requiredProperties)) {
+      return (int32_t)index;
+    }
+  }
+  return -1;
+}
+
+// create a compute pipeline from a SPIR-V binary found in SHADER_PATH
+VkResult createComputePipeline(VkDevice device, VkPipelineLayout layout,
+                               const char *filename,
+                               const VkSpecializationInfo *specializationInfo,
+                               VkPipeline *pipeline) {
+  auto shaderCode =
+      loadShaderCode((std::string(SHADER_PATH) + filename).c_str());
+  if (shaderCode.empty()) {
+    fprintf(stderr, "failed to load '%s'\n", filename);
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
+  shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  shaderModuleCreateInfo.pCode =
+      reinterpret_cast<uint32_t *>(shaderCode.data());
+  shaderModuleCreateInfo.codeSize = shaderCode.size();
+  VkShaderModule shaderModule = VK_NULL_HANDLE;
+  VkResult error = vkCreateShaderModule(device, &shaderModuleCreateInfo,
+                                        nullptr, &shaderModule);
+  if (error) {
+    return error;
+  }
+  VkComputePipelineCreateInfo pipelineCreateInfo = {};
+  pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineCreateInfo.stage.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipelineCreateInfo.stage.module = shaderModule;
+  pipelineCreateInfo.stage.pName = "main";
+  pipelineCreateInfo.stage.pSpecializationInfo = specializationInfo;
+  pipelineCreateInfo.layout = layout;
+  error = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1,
+                                   &pipelineCreateInfo, nullptr, pipeline);
+  vkDestroyShaderModule(device, shaderModule, nullptr);
+  return error;
+}
+
+// the size of each uncompressed block, LZ4 offsets reach back at most 64KB
+const uint32_t blockSize = 1 << 16;
+
+// a compressed block and where it decompresses to, see lz4.comp
+struct Block {
+  uint32_t sourceOffset;
+  uint32_t sourceSize;
+  uint32_t destinationOffset;
+  uint32_t destinationCapacity;
+};
+
+// the size lz4.comp reports for a malformed block
+const uint32_t malformed = 0xffffffff;
+
+uint32_t divideRoundUp(uint32_t value, uint32_t divisor) {
+  return (value + divisor - 1) / divisor;
+}
+
+uint32_t nextRandom(uint32_t &seed) {
+  seed = seed * 1664525u + 1013904223u;
+  return seed >> 8;
+}
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+// append a length which did not fit in its 4 bits of the token
+void appendLength(std::vector<uint8_t> &output, uint32_t length) {
+  for (; length >= 255; length -= 255) {
+    output.push_back(255);
+  }
+  output.push_back(length);
+}
+
+// append a sequence of literals followed by a match, or only the literals
+// if matchLength is 0
+void appendSequence(std::vector<uint8_t> &output, const uint8_t *literals,
+                    uint32_t literalLength, uint32_t offset,
+                    uint32_t matchLength) {
+  const uint32_t matchCode = matchLength ? matchLength - 4 : 0;
+  output.push_back(std::min(literalLength, 15u) << 4 |
+                   std::min(matchCode, 15u));
+  if (literalLength >= 15) {
+    appendLength(output, literalLength - 15);
+  }
+  output.insert(output.end(), literals, literals + literalLength);
+  if (matchLength) {
+    output.push_back(offset & 0xff);
+    output.push_back(offset >> 8);
+    if (matchCode >= 15) {
+      appendLength(output, matchCode - 15);
+    }
+  }
+}
+
+// compress a block in the LZ4 block format with a greedy search of a hash
+// table of 4 byte sequences, the format requires the last 5 bytes to be
+// literals and the last match to start at least 12 bytes from the end
+void compressBlock(const uint8_t *input, uint32_t size,
+                   std::vector<uint8_t> &output) {
+  const uint32_t lastLiterals = 5;
+  const uint32_t matchLimit = 12;
+  // marks a hash table slot with no earlier position
+  const uint32_t none = 0xffffffff;
+  std::vector<uint32_t> table(1 << 12, none);
+  uint32_t anchor = 0;
+  uint32_t position = 0;
+  while (position + matchLimit <= size) {
+    uint32_t sequence;
+    memcpy(&sequence, input + position, sizeof(sequence));
+    const uint32_t hash = (sequence * 2654435761u) >> 20;
+    const uint32_t candidate = table[hash];
+    table[hash] = position;
+    if (candidate == none || position - candidate > 0xffff ||
+        memcmp(input + candidate, input + position, 4)) {
+      position++;
+      continue;
+    }
+    uint32_t length = 4;
+    while (position + length < size - lastLiterals &&
+           input[candidate + length] == input[position + length]) {
+      length++;
+    }
+    appendSequence(output, input + anchor, position - anchor,
+                   position - candidate, length);
+    position += length;
+    anchor = position;
+  }
+  appendSequence(output, input + anchor, size - anchor, 0, 0);
+}
+
+// decompress a block on the host in the same way as lz4.comp, returning the
+// decompressed size or malformed
+uint32_t decompressBlock(const uint8_t *input, uint32_t size,
+                         uint8_t *output, uint32_t capacity) {
+  uint32_t cursor = 0;
+  uint32_t written = 0;
+  auto readLength = [&](uint32_t length) {
+    if (length == 15) {
+      uint32_t next = 255;
+      while (next == 255 && cursor < size) {
+        next = input[cursor++];
+        length += next;
+      }
+    }
+    return length;
+  };
+  while (cursor < size) {
+    const uint32_t token = input[cursor++];
+    const uint32_t literals = readLength(token >> 4);
+    if (cursor + literals > size || written + literals > capacity) {
+      return malformed;
+    }
+    memcpy(output + written, input + cursor, literals);
+    written += literals;
+    cursor += literals;
+    if (cursor == size) {
+      return written;
+    }
+    if (cursor + 2 > size) {
+      return malformed;
+    }
+    const uint32_t offset = input[cursor] | input[cursor + 1] << 8;
+    cursor += 2;
+    const uint32_t length = readLength(token & 15) + 4;
+    if (offset == 0 || offset > written || written + length > capacity) {
+      return malformed;
+    }
+    // overlapping matches repeat the last offset bytes, so copy bytewise
+    for (uint32_t index = 0; index < length; index++, written++) {
+      output[written] = output[written - offset];
+    }
+  }
+  return malformed;
+}
+
+// create the buffers with usage and bind them to a single allocation of a
+// memory type with the properties which every buffer supports
+VkResult createBuffers(VkDevice device,
+                       const VkPhysicalDeviceMemoryProperties &properties,
+                       VkMemoryPropertyFlags memoryPropertyFlags,
+                       const std::vector<VkDeviceSize> &sizes,
+                       VkBufferUsageFlags usage, uint32_t queueFamilyIndex,
+                       std::vector<VkBuffer> &buffers, VkDeviceMemory *memory,
+                       std::vector<VkDeviceSize> &offsets) {
+  VkDeviceSize requiredMemorySize = 0;
+  uint32_t memoryTypeBits = ~0u;
+  for (VkDeviceSize size : sizes) {
+    VkBufferCreateInfo bufferCreateInfo = {};
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.size = size;
+    bufferCreateInfo.usage = usage;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    bufferCreateInfo.queueFamilyIndexCount = 1;
+    bufferCreateInfo.pQueueFamilyIndices = &queueFamilyIndex;
+    VkBuffer buffer;
+    VkResult error =
+        vkCreateBuffer(device, &bufferCreateInfo, nullptr, &buffer);
+    if (error) {
+      return error;
+    }
+    buffers.push_back(buffer);
+    VkMemoryRequirements memoryRequirements;
+    vkGetBufferMemoryRequirements(device, buffer, &memoryRequirements);
+    memoryTypeBits &= memoryRequirements.memoryTypeBits;
+    const VkDeviceSize alignment = memoryRequirements.alignment;
+    requiredMemorySize =
+        (requiredMemorySize + alignment - 1) / alignment * alignment;
+    offsets.push_back(requiredMemorySize);
+    requiredMemorySize += memoryRequirements.size;
+  }
+
+  // falling back to another memory type could give memory the caller cannot
+  // map, or must flush, so fail instead
+  auto memoryTypeIndex = findMemoryTypeFromProperties(
+      memoryTypeBits, properties, memoryPropertyFlags);
+  if (0 > memoryTypeIndex) {
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+  }
+  VkMemoryAllocateInfo allocateInfo = {};
+  allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocateInfo.allocationSize = requiredMemorySize;
+  allocateInfo.memoryTypeIndex = memoryTypeIndex;
+  VkResult error = vkAllocateMemory(device, &allocateInfo, nullptr, memory);
+  if (error) {
+    return error;
+  }
+  for (size_t index = 0; index < buffers.size(); index++) {
+    error = vkBindBufferMemory(device, buffers[index], *memory,
+                               offsets[index]);
+    if (error) {
+      return error;
+    }
+  }
+  return VK_SUCCESS;
+}
+
+int main() {
+  VkApplicationInfo applicationInfo = {};
+  applicationInfo.pApplicationName = "Vulkan LZ4 decompression example";
+  // 8-bit storage is core in Vulkan 1.2
+  applicationInfo.apiVersion = VK_API_VERSION_1_2;
+
+  VkInstanceCreateInfo instanceCreateInfo = {};
+  instanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+  instanceCreateInfo.pApplicationInfo = &applicationInfo;
+#ifdef ENABLE_LAYERS
+  // without a debug report callback, see vector_add, the validation layer
+  // prints its messages to stdout
+  std::vector<const char *> enabledLayerNames{"VK_LAYER_KHRONOS_validation"};
+  instanceCreateInfo.enabledLayerCount = enabledLayerNames.size();
+  instanceCreateInfo.ppEnabledLayerNames = enabledLayerNames.data();
+#endif
+
+  VkInstance instance = VK_NULL_HANDLE;
+  VkResult error = vkCreateInstance(&instanceCreateInfo, nullptr, &instance);
+  if (error) {
+    return error;
+  }
+
+  uint32_t count;
+  error = vkEnumeratePhysicalDevices(instance, &count, nullptr);
+  if (error) {
+    return error;
+  }
+  std::vector<VkPhysicalDevice> physicalDevices(count);
+  error = vkEnumeratePhysicalDevices(instance, &count, physicalDevices.data());
+  if (error) {
+    return error;
+  }
+
+  // find a Vulkan 1.2 physical device with a compute queue which supports
+  // shaders accessing storage buffers a byte at a time
+  VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+  uint32_t queueFamilyIndex = 0;
+  uint32_t timestampValidBits = 0;
+  for (auto device : physicalDevices) {
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(device, &properties);
+    if (properties.apiVersion < VK_API_VERSION_1_2) {
+      continue;
+    }
+    VkPhysicalDevice8BitStorageFeatures storageFeatures = {};
+    storageFeatures.sType =
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_8BIT_STORAGE_FEATURES;
+    VkPhysicalDeviceFeatures2 features = {};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &storageFeatures;
+    vkGetPhysicalDeviceFeatures2(device, &features);
+    if (!storageFeatures.storageBuffer8BitAccess) {
+      continue;
+    }
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilyProperties(count);
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count,
+                                             queueFamilyProperties.data());
+    for (uint32_t index = 0; index < count; index++) {
+      if (queueFamilyProperties[index].queueFlags & VK_QUEUE_COMPUTE_BIT) {
+        physicalDevice = device;
+        queueFamilyIndex = index;
+        timestampValidBits = queueFamilyProperties[index].timestampValidBits;
+        break;
+      }
+    }
+    if (physicalDevice) {
+      break;
+    }
+  }
+  if (!physicalDevice) {
+    fprintf(stderr, "no device supports storageBuffer8BitAccess\n");
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+  }
+
+  VkPhysicalDeviceProperties physicalDeviceProperties;
+  vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties);
+  const VkPhysicalDeviceLimits &limits = physicalDeviceProperties.limits;
+
+  VkDeviceQueueCreateInfo queueCreateInfo = {};
+  queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+  queueCreateInfo.queueCount = 1;
+  queueCreateInfo.queueFamilyIndex = queueFamilyIndex;
+  float queuePriority = 1.0f;
+  queueCreateInfo.pQueuePriorities = &queuePriority;
+
+  VkPhysicalDevice8BitStorageFeatures storageFeatures = {};
+  storageFeatures.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_8BIT_STORAGE_FEATURES;
+  storageFeatures.storageBuffer8BitAccess = VK_TRUE;
+
+  VkDeviceCreateInfo deviceCreateInfo = {};
+  deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+  deviceCreateInfo.pNext = &storageFeatures;
+  deviceCreateInfo.queueCreateInfoCount = 1;
+  deviceCreateInfo.pQueueCreateInfos = &queueCreateInfo;
+  VkDevice device = VK_NULL_HANDLE;
+  error = vkCreateDevice(physicalDevice, &deviceCreateInfo, nullptr, &device);
+  if (error) {
+    return error;
+  }
+
+  VkQueue queue;
+  vkGetDeviceQueue(device, queueFamilyIndex, 0, &queue);
+
+  // the compressed bytes, the block table, the decompressed bytes and the
+  // decompressed size of each block
+  std::vector<VkDescriptorSetLayoutBinding> layoutBindings;
+  VkDescriptorSetLayoutBinding layoutBinding = {};
+  layoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  layoutBinding.descriptorCount = 1;
+  layoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  for (uint32_t binding = 0; binding < 4; binding++) {
+    layoutBinding.binding = binding;
+    layoutBindings.push_back(layoutBinding);
+  }
+
+  VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo = {};
+  setLayoutCreateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  setLayoutCreateInfo.bindingCount = layoutBindings.size();
+  setLayoutCreateInfo.pBindings = layoutBindings.data();
+  VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+  error = vkCreateDescriptorSetLayout(device, &setLayoutCreateInfo, nullptr,
+                                      &setLayout);
+  if (error) {
+    return error;
+  }
+
+  VkPushConstantRange pushConstantRange = {};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(uint32_t);
+
+  VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+  pipelineLayoutCreateInfo.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutCreateInfo.setLayoutCount = 1;
+  pipelineLayoutCreateInfo.pSetLayouts = &setLayout;
+  pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+  pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+  VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+  error = vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr,
+                                 &pipelineLayout);
+  if (error) {
+    return error;
+  }
+
+  VkPipeline pipeline = VK_NULL_HANDLE;
+  error = createComputePipeline(device, pipelineLayout, "lz4.spv", nullptr,
+                                &pipeline);
+  if (error) {
+    return error;
+  }
+
+  // a 32MB column of sensor readings which hold their value for a while,
+  // compressed in independent blocks as an input file would be, each block
+  // decompresses to its place in a single column so the elementwise kernels
+  // can bind the result as they would an uploaded one
+  const uint32_t valueCount = 1 << 23;
+  const uint32_t columnSize = sizeof(int32_t) * valueCount;
+  std::vector<int32_t> column(valueCount);
+  uint32_t seed = 42;
+  int32_t reading = 1000;
+  for (uint32_t index = 0; index < valueCount; index++) {
+    if (nextRandom(seed) % 16 == 0) {
+      reading += (int32_t)(nextRandom(seed) % 33) - 16;
+    }
+    column[index] = reading;
+  }
+  const uint8_t *columnBytes = reinterpret_cast<uint8_t *>(column.data());
+  const uint32_t blockCount = divideRoundUp(columnSize, blockSize);
+  std::vector<Block> blocks(blockCount);
+  std::vector<uint8_t> compressed;
+  for (uint32_t index = 0; index < blockCount; index++) {
+    Block &block = blocks[index];
+    block.sourceOffset = compressed.size();
+    block.destinationOffset = index * blockSize;
+    block.destinationCapacity =
+        std::min(blockSize, columnSize - block.destinationOffset);
+    compressBlock(columnBytes + block.destinationOffset,
+                  block.destinationCapacity, compressed);
+    block.sourceSize = compressed.size() - block.sourceOffset;
+  }
+  // the compressed size of a storage buffer must be a multiple of 4
+  compressed.resize((compressed.size() + 3) / 4 * 4);
+
+  // decompress on the host to compare with
+  std::vector<uint8_t> hostDecompressed(columnSize);
+  auto start = std::chrono::steady_clock::now();
+  for (const Block &block : blocks) {
+    decompressBlock(compressed.data() + block.sourceOffset, block.sourceSize,
+                    hostDecompressed.data() + block.destinationOffset,
+                    block.destinationCapacity);
+  }
+  const double hostMilliseconds = millisecondsSince(start);
+  if (memcmp(hostDecompressed.data(), columnBytes, columnSize)) {
+    fprintf(stderr, "host decompression does not match the column!\n");
+    return 1;
+  }
+
+  VkPhysicalDeviceMemoryProperties memoryProperties;
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+  const VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                   VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+                                   VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+  // the uploads and the read backs are in host visible memory, the column
+  // the kernels consume in device local memory
+  enum { RAW, COMPRESSED, BLOCKS, SIZES, RESULT, HOST_BUFFER_COUNT };
+  const VkDeviceSize blocksSize = sizeof(Block) * blockCount;
+  const VkDeviceSize sizesSize = sizeof(uint32_t) * blockCount;
+  std::vector<VkBuffer> hostBuffers;
+  std::vector<VkDeviceSize> hostOffsets;
+  VkDeviceMemory hostMemory = VK_NULL_HANDLE;
+  error = createBuffers(device, memoryProperties,
+                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                        {columnSize, compressed.size(), blocksSize, sizesSize,
+                         columnSize},
+                        usage, queueFamilyIndex, hostBuffers, &hostMemory,
+                        hostOffsets);
+  if (error) {
+    return error;
+  }
+  std::vector<VkBuffer> deviceBuffers;
+  std::vector<VkDeviceSize> deviceOffsets;
+  VkDeviceMemory deviceMemory = VK_NULL_HANDLE;
+  error = createBuffers(device, memoryProperties,
+                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, {columnSize},
+                        usage, queueFamilyIndex, deviceBuffers, &deviceMemory,
+                        deviceOffsets);
+  if (error) {
+    return error;
+  }
+  const VkBuffer decompressedBuffer = deviceBuffers[0];
+
+  VkDescriptorPoolSize poolSize = {};
+  poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  poolSize.descriptorCount = 4;
+  VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = {};
+  descriptorPoolCreateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  descriptorPoolCreateInfo.maxSets = 1;
+  descriptorPoolCreateInfo.poolSizeCount = 1;
+  descriptorPoolCreateInfo.pPoolSizes = &poolSize;
+  VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+  error = vkCreateDescriptorPool(device, &descriptorPoolCreateInfo, nullptr,
+                                 &descriptorPool);
+  if (error) {
+    return error;
+  }
+
+  VkDescriptorSetAllocateInfo descriptorSetAllocateInfo = {};
+  descriptorSetAllocateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  descriptorSetAllocateInfo.descriptorPool = descriptorPool;
+  descriptorSetAllocateInfo.descriptorSetCount = 1;
+  descriptorSetAllocateInfo.pSetLayouts = &setLayout;
+  VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+  error = vkAllocateDescriptorSets(device, &descriptorSetAllocateInfo,
+                                   &descriptorSet);
+  if (error) {
+    return error;
+  }
+
+  const VkDescriptorBufferInfo bufferInfos[] = {
+      {hostBuffers[COMPRESSED], 0, VK_WHOLE_SIZE},
+      {hostBuffers[BLOCKS], 0, VK_WHOLE_SIZE},
+      {decompressedBuffer, 0, VK_WHOLE_SIZE},
+      {hostBuffers[SIZES], 0, VK_WHOLE_SIZE}};
+  std::vector<VkWriteDescriptorSet> descriptorSetWrites;
+  VkWriteDescriptorSet writeDescriptorSet = {};
+  writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  writeDescriptorSet.dstSet = descriptorSet;
+  writeDescriptorSet.dstArrayElement = 0;
+  writeDescriptorSet.descriptorCount = 1;
+  writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  for (uint32_t binding = 0; binding < 4; binding++) {
+    writeDescriptorSet.dstBinding = binding;
+    writeDescriptorSet.pBufferInfo = &bufferInfos[binding];
+    descriptorSetWrites.push_back(writeDescriptorSet);
+  }
+  vkUpdateDescriptorSets(device, descriptorSetWrites.size(),
+                         descriptorSetWrites.data(), 0, nullptr);
+
+  char *data = nullptr;
+  error = vkMapMemory(device, hostMemory, 0, VK_WHOLE_SIZE, 0,
+                      reinterpret_cast<void **>(&data));
+  if (error) {
+    return error;
+  }
+  memcpy(data + hostOffsets[RAW], columnBytes, columnSize);
+  memcpy(data + hostOffsets[COMPRESSED], compressed.data(),
+         compressed.size());
+  memcpy(data + hostOffsets[BLOCKS], blocks.data(), blocksSize);
+  uint32_t *sizesData =
+      reinterpret_cast<uint32_t *>(data + hostOffsets[SIZES]);
+  uint8_t *resultData = reinterpret_cast<uint8_t *>(data + hostOffsets[RESULT]);
+
+  VkQueryPool queryPool = VK_NULL_HANDLE;
+  if (timestampValidBits) {
+    VkQueryPoolCreateInfo queryPoolCreateInfo = {};
+    queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolCreateInfo.queryCount = 2;
+    error = vkCreateQueryPool(device, &queryPoolCreateInfo, nullptr,
+                              &queryPool);
+    if (error) {
+      return error;
+    }
+  }
+
+  VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+  commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+  commandPoolCreateInfo.queueFamilyIndex = queueFamilyIndex;
+  VkCommandPool commandPool = VK_NULL_HANDLE;
+  error = vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr,
+                              &commandPool);
+  if (error) {
+    return error;
+  }
+
+  VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
+  commandBufferAllocateInfo.sType =
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  commandBufferAllocateInfo.commandPool = commandPool;
+  commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  commandBufferAllocateInfo.commandBufferCount = 1;
+  VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+  error = vkAllocateCommandBuffers(device, &commandBufferAllocateInfo,
+                                   &commandBuffer);
+  if (error) {
+    return error;
+  }
+
+  // record the work of function into the command buffer, submit it, wait for
+  // it to complete and return the time between the timestamps in
+  // milliseconds, or 0 if timestamps are not supported
+  auto submit = [&](std::function<void()> function,
+                    double *milliseconds) -> VkResult {
+    VkResult result = vkResetCommandPool(device, commandPool, 0);
+    if (result) {
+      return result;
+    }
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    result = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    if (result) {
+      return result;
+    }
+    if (queryPool) {
+      vkCmdResetQueryPool(commandBuffer, queryPool, 0, 2);
+      vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                          queryPool, 0);
+    }
+    function();
+    if (queryPool) {
+      vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                          queryPool, 1);
+    }
+    result = vkEndCommandBuffer(commandBuffer);
+    if (result) {
+      return result;
+    }
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    result = vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+    if (result) {
+      return result;
+    }
+    vkQueueWaitIdle(queue);
+
+    *milliseconds = 0.0;
+    if (queryPool) {
+      uint64_t timestamps[2];
+      result = vkGetQueryPoolResults(
+          device, queryPool, 0, 2, sizeof(timestamps), timestamps,
+          sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+      if (result) {
+        return result;
+      }
+      *milliseconds =
+          (timestamps[1] - timestamps[0]) * limits.timestampPeriod * 1e-6;
+    }
+    return VK_SUCCESS;
+  };
+
+  // the column is only timed reaching device local memory, it is copied back
+  // to be checked in a separate submission
+  struct Path {
+    const char *name;
+    VkDeviceSize uploadedBytes;
+    std::function<void()> record;
+  };
+  const Path paths[] = {
+      {"copy raw column", columnSize,
+       [&] {
+         VkBufferCopy region = {0, 0, columnSize};
+         vkCmdCopyBuffer(commandBuffer, hostBuffers[RAW], decompressedBuffer,
+                         1, &region);
+       }},
+      {"decompress blocks", compressed.size(),
+       [&] {
+         // the shader reads the compressed blocks straight from host visible
+         // memory, one workgroup decompresses each block
+         vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                           pipeline);
+         vkCmdBindDescriptorSets(commandBuffer,
+                                 VK_PIPELINE_BIND_POINT_COMPUTE,
+                                 pipelineLayout, 0, 1, &descriptorSet, 0,
+                                 nullptr);
+         vkCmdPushConstants(commandBuffer, pipelineLayout,
+                            VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t),
+                            &blockCount);
+         vkCmdDispatch(commandBuffer,
+                       std::min(blockCount, limits.maxComputeWorkGroupCount[0]),
+                       1, 1);
+       }}};
+  auto readBack = [&] {
+    VkMemoryBarrier memoryBarrier = {};
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask =
+        VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    memoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT |
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &memoryBarrier,
+                         0, nullptr, 0, nullptr);
+    VkBufferCopy region = {0, 0, columnSize};
+    vkCmdCopyBuffer(commandBuffer, decompressedBuffer, hostBuffers[RESULT], 1,
+                    &region);
+  };
+
+  printf("%-20s %12s %8s %10s %10s\n", "path", "uploaded MB", "ratio",
+         "device ms", "GB/s");
+  int failures = 0;
+  for (const Path &path : paths) {
+    memset(sizesData, 0, sizesSize);
+    memset(resultData, 0, columnSize);
+    double milliseconds;
+    error = submit(path.record, &milliseconds);
+    if (error) {
+      return error;
+    }
+    double readBackMilliseconds;
+    error = submit(readBack, &readBackMilliseconds);
+    if (error) {
+      return error;
+    }
+    // the throughput counts the uncompressed bytes produced
+    printf("%-20s %12.2f %8.2f %10.3f %10.1f\n", path.name,
+           path.uploadedBytes * 1e-6,
+           (double)columnSize / path.uploadedBytes, milliseconds,
+           milliseconds > 0.0 ? columnSize / milliseconds * 1e-6 : 0.0);
+    if (path.uploadedBytes != columnSize) {
+      for (uint32_t index = 0; index < blockCount; index++) {
+        if (sizesData[index] != blocks[index].destinationCapacity) {
+          fprintf(stderr, "block %u decompressed to '%u' bytes not '%u'!\n",
+                  index, sizesData[index], blocks[index].destinationCapacity);
+          failures++;
+          break;
+        }
+      }
+    }
+    for (uint32_t index = 0; index < columnSize; index++) {
+      if (resultData[index] != columnBytes[index]) {
+        fprintf(stderr, "%s byte [%u] is '%u' not '%u'!\n", path.name, index,
+                resultData[index], columnBytes[index]);
+        failures++;
+        break;
+      }
+    }
+  }
+  printf("%-20s %12s %8s %10.3f %10.1f\n", "host decompress", "", "",
+         hostMilliseconds, columnSize / hostMilliseconds * 1e-6);
+  vkUnmapMemory(device, hostMemory);
+
+  // corrupted blocks must be reported malformed rather than read or written
+  // out of bounds, the first two are cut from the first compressed block
+  struct CorruptBlock {
+    const char *name;
+    std::vector<uint8_t> bytes;
+    uint32_t capacity;
+  };
+  const std::vector<uint8_t> firstBlock(
+      compressed.begin() + blocks[0].sourceOffset,
+      compressed.begin() + blocks[0].sourceOffset + blocks[0].sourceSize);
+  const CorruptBlock corruptBlocks[] = {
+      {"truncated block",
+       {firstBlock.begin(), firstBlock.end() - 1},
+       blocks[0].destinationCapacity},
+      {"capacity overrun", firstBlock, blocks[0].destinationCapacity - 1},
+      // a literal followed by a match
+      {"zero offset", {0x10, 'a', 0, 0, 0x10, 'b'}, blockSize},
+      {"offset before output", {0x10, 'a', 2, 0, 0x10, 'b'}, blockSize},
+      // lengths and offsets cut off by the end of the block
+      {"truncated literals", {0xf0, 255}, blockSize},
+      {"truncated offset", {0x10, 'a', 1}, blockSize},
+      {"truncated match", {0x1f, 'a', 1, 0, 255}, blockSize},
+  };
+  const uint32_t corruptCount =
+      sizeof(corruptBlocks) / sizeof(corruptBlocks[0]);
+  std::vector<uint8_t> corruptData;
+  std::vector<Block> corruptInfos(corruptCount);
+  for (uint32_t index = 0; index < corruptCount; index++) {
+    corruptInfos[index].sourceOffset = corruptData.size();
+    corruptInfos[index].sourceSize = corruptBlocks[index].bytes.size();
+    corruptInfos[index].destinationOffset = index * blockSize;
+    corruptInfos[index].destinationCapacity = corruptBlocks[index].capacity;
+    corruptData.insert(corruptData.end(), corruptBlocks[index].bytes.begin(),
+                       corruptBlocks[index].bytes.end());
+  }
+  corruptData.resize((corruptData.size() + 3) / 4 * 4);
+
+  std::vector<VkBuffer> corruptBuffers;
+  std::vector<VkDeviceSize> corruptOffsets;
+  VkDeviceMemory corruptMemory = VK_NULL_HANDLE;
+  error = createBuffers(device, memoryProperties,
+                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                        {corruptData.size(), sizeof(Block) * corruptCount,
+                         sizeof(uint32_t) * corruptCount},
+                        usage, queueFamilyIndex, corruptBuffers,
+                        &corruptMemory, corruptOffsets);
+  if (error) {
+    return error;
+  }
+  error = vkMapMemory(device, corruptMemory, 0, VK_WHOLE_SIZE, 0,
+                      reinterpret_cast<void **>(&data));
+  if (error) {
+    return error;
+  }
+  memcpy(data + corruptOffsets[0], corruptData.data(), corruptData.size());
+  memcpy(data + corruptOffsets[1], corruptInfos.data(),
+         sizeof(Block) * corruptCount);
+  sizesData = reinterpret_cast<uint32_t *>(data + corruptOffsets[2]);
+  memset(sizesData, 0, sizeof(uint32_t) * corruptCount);
+
+  // the decompressed buffer is still the destination
+  const VkDescriptorBufferInfo corruptBufferInfos[] = {
+      {corruptBuffers[0], 0, VK_WHOLE_SIZE},
+      {corruptBuffers[1], 0, VK_WHOLE_SIZE},
+      {corruptBuffers[2], 0, VK_WHOLE_SIZE}};
+  const uint32_t corruptBindings[] = {0, 1, 3};
+  for (uint32_t index = 0; index < 3; index++) {
+    descriptorSetWrites[corruptBindings[index]].pBufferInfo =
+        &corruptBufferInfos[index];
+  }
+  vkUpdateDescriptorSets(device, descriptorSetWrites.size(),
+                         descriptorSetWrites.data(), 0, nullptr);
+  double corruptMilliseconds;
+  error = submit(
+      [&] {
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                          pipeline);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                                pipelineLayout, 0, 1, &descriptorSet, 0,
+                                nullptr);
+        vkCmdPushConstants(commandBuffer, pipelineLayout,
+                           VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t),
+                           &corruptCount);
+        vkCmdDispatch(commandBuffer, corruptCount, 1, 1);
+      },
+      &corruptMilliseconds);
+  if (error) {
+    return error;
+  }
+  for (uint32_t index = 0; index < corruptCount; index++) {
+    const CorruptBlock &block = corruptBlocks[index];
+    std::vector<uint8_t> scratch(block.capacity);
+    const uint32_t hostSize =
+        decompressBlock(block.bytes.data(), block.bytes.size(),
+                        scratch.data(), block.capacity);
+    if (hostSize != malformed || sizesData[index] != malformed) {
+      fprintf(stderr, "%s decompressed to '%u' bytes on the host and '%u' "
+                      "on the device, not malformed!\n",
+              block.name, hostSize, sizesData[index]);
+      failures++;
+    }
+  }
+  vkUnmapMemory(device, corruptMemory);
+
+  if (queryPool) {
+    vkDestroyQueryPool(device, queryPool, nullptr);
+  }
+  vkDestroyCommandPool(device, commandPool, nullptr);
+  vkFreeMemory(device, corruptMemory, nullptr);
+  vkFreeMemory(device, hostMemory, nullptr);
+  vkFreeMemory(device, deviceMemory, nullptr);
+  for (auto buffer : corruptBuffers) {
+    vkDestroyBuffer(device, buffer, nullptr);
+  }
+  for (auto buffer : hostBuffers) {
+    vkDestroyBuffer(device, buffer, nullptr);
+  }
+  for (auto buffer : deviceBuffers) {
+    vkDestroyBuffer(device, buffer, nullptr);
+  }
+  vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+  vkDestroyPipeline(device, pipeline, nullptr);
+  vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+  vkDestroyDescriptorSetLayout(device, setLayout, nullptr);
+  vkDestroyDevice(device, nullptr);
+  vkDestroyInstance(instance, nullptr);
+
+  if (failures) {
+    return 1;
+  }
+  printf("success\n");
+
+  return 0;
+}
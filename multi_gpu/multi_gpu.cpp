@@ -0,0 +1,830 @@
+#include <vulkan/vulkan.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// load a SPIR-V binary from disc
+std::vector<char> loadShaderCode(const char *filename) {
+  std::vector<char> shaderCode;
+  if (FILE *fp = fopen(filename, "rb")) {
+    char buf[1024];
+    while (size_t len = fread(buf, 1, sizeof(buf), fp)) {
+      shaderCode.insert(shaderCode.end(), buf, buf + len);
+    }
+    fclose(fp);
+  }
+  return shaderCode;
+}
+
+// search for compatible memory properties and return the memory type index
+int32_t findMemoryTypeFromProperties(
+    uint32_t memoryTypeBits, VkPhysicalDeviceMemoryProperties properties,
+    VkMemoryPropertyFlags requiredProperties) {
+  assert(properties.memoryTypeCount < 32u);
+  for (uint32_t index = 0; index < properties.memoryTypeCount; ++index) {
+    if (memoryTypeBits & (1u << index) &&
+        // Find the first memory type that supports all the required flags.
+        ((properties.memoryTypes[index].propertyFlags & requiredProperties) ==
+         requiredProperties)) {
+      return (int32_t)index;
+    }
+  }
+  return -1;
+}
+
+// create a compute pipeline from a SPIR-V binary found in SHADER_PATH
+VkResult createComputePipeline(VkDevice device, VkPipelineLayout layout,
+                               const char *filename,
+                               const VkSpecializationInfo *specializationInfo,
+                               VkPipeline *pipeline) {
+  auto shaderCode =
+      loadShaderCode((std::string(SHADER_PATH) + filename).c_str());
+  if (shaderCode.empty()) {
+    fprintf(stderr, "failed to load '%s'\n", filename);
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
+  shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  shaderModuleCreateInfo.pCode =
+      reinterpret_cast<uint32_t *>(shaderCode.data());
+  shaderModuleCreateInfo.codeSize = shaderCode.size();
+  VkShaderModule shaderModule = VK_NULL_HANDLE;
+  VkResult error = vkCreateShaderModule(device, &shaderModuleCreateInfo,
+                                        nullptr, &shaderModule);
+  if (error) {
+    return error;
+  }
+  VkComputePipelineCreateInfo pipelineCreateInfo = {};
+  pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineCreateInfo.stage.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipelineCreateInfo.stage.module = shaderModule;
+  pipelineCreateInfo.stage.pName = "main";
+  pipelineCreateInfo.stage.pSpecializationInfo = specializationInfo;
+  pipelineCreateInfo.layout = layout;
+  error = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1,
+                                   &pipelineCreateInfo, nullptr, pipeline);
+  vkDestroyShaderModule(device, shaderModule, nullptr);
+  return error;
+}
+
+const uint32_t elementCount = 1 << 24;
+
+// a range of the job sent to a worker along with the shared memory file
+// holding a, b and the result at offsets
+struct Shard {
+  uint32_t first;
+  uint32_t count;
+  uint64_t offsets[3];
+  uint64_t size;
+};
+
+// sent by a worker once its device is ready and after each shard
+struct Reply {
+  int32_t result;
+  double milliseconds;
+};
+
+// the state each worker process keeps for its device
+struct Worker {
+  VkInstance instance;
+  VkDevice device;
+  VkQueue queue;
+  uint32_t queueFamilyIndex;
+  VkPhysicalDeviceMemoryProperties memoryProperties;
+  uint32_t maxGroupCount;
+  VkDescriptorSetLayout setLayout;
+  VkPipelineLayout pipelineLayout;
+  VkPipeline pipeline;
+  VkDescriptorPool descriptorPool;
+  VkDescriptorSet descriptorSet;
+  VkCommandPool commandPool;
+  VkCommandBuffer commandBuffer;
+  // holds a, b and the result of a shard, grown as needed
+  VkBuffer buffer;
+  VkDeviceMemory memory;
+  VkDeviceSize bufferSize;
+  char *data;
+};
+
+uint32_t divideRoundUp(uint32_t value, uint32_t divisor) {
+  return (value + divisor - 1) / divisor;
+}
+
+uint32_t nextRandom(uint32_t &seed) {
+  seed = seed * 1664525u + 1013904223u;
+  return seed >> 8;
+}
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+VkResult createInstance(VkInstance *instance) {
+  VkApplicationInfo applicationInfo = {};
+  applicationInfo.pApplicationName = "Vulkan multi GPU example";
+  applicationInfo.apiVersion = VK_API_VERSION_1_1;
+
+  VkInstanceCreateInfo instanceCreateInfo = {};
+  instanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+  instanceCreateInfo.pApplicationInfo = &applicationInfo;
+#ifdef ENABLE_LAYERS
+  // without a debug report callback, see vector_add, the validation layer
+  // prints its messages to stdout
+  std::vector<const char *> enabledLayerNames{"VK_LAYER_KHRONOS_validation"};
+  instanceCreateInfo.enabledLayerCount = enabledLayerNames.size();
+  instanceCreateInfo.ppEnabledLayerNames = enabledLayerNames.data();
+#endif
+
+  return vkCreateInstance(&instanceCreateInfo, nullptr, instance);
+}
+
+// the Vulkan 1.1 physical devices with a compute queue, the compute queue
+// family of each and its deviceUUID in hex, which unlike the enumeration order
+// identifies the device in every process on the node
+VkResult enumerateComputeDevices(VkInstance instance,
+                                 std::vector<VkPhysicalDevice> *devices,
+                                 std::vector<uint32_t> *queueFamilyIndices,
+                                 std::vector<std::string> *deviceUUIDs) {
+  uint32_t count;
+  VkResult error = vkEnumeratePhysicalDevices(instance, &count, nullptr);
+  if (error) {
+    return error;
+  }
+  std::vector<VkPhysicalDevice> physicalDevices(count);
+  error = vkEnumeratePhysicalDevices(instance, &count, physicalDevices.data());
+  if (error) {
+    return error;
+  }
+  for (auto device : physicalDevices) {
+    VkPhysicalDeviceIDProperties idProperties = {};
+    idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+    VkPhysicalDeviceProperties2 properties = {};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &idProperties;
+    vkGetPhysicalDeviceProperties(device, &properties.properties);
+    if (properties.properties.apiVersion < VK_API_VERSION_1_1) {
+      continue;
+    }
+    vkGetPhysicalDeviceProperties2(device, &properties);
+    std::string deviceUUID;
+    for (uint32_t index = 0; index < VK_UUID_SIZE; index++) {
+      char digits[3];
+      snprintf(digits, sizeof(digits), "%02x", idProperties.deviceUUID[index]);
+      deviceUUID += digits;
+    }
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilyProperties(count);
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count,
+                                             queueFamilyProperties.data());
+    for (uint32_t index = 0; index < count; index++) {
+      if (queueFamilyProperties[index].queueFlags & VK_QUEUE_COMPUTE_BIT) {
+        devices->push_back(device);
+        queueFamilyIndices->push_back(index);
+        deviceUUIDs->push_back(deviceUUID);
+        break;
+      }
+    }
+  }
+  return VK_SUCCESS;
+}
+
+// create the device, pipeline and command buffer of a worker on the compute
+// device the launcher chose by deviceUUID, there may be more workers than
+// devices
+VkResult createWorker(const char *deviceUUID, Worker *worker) {
+  VkResult error = createInstance(&worker->instance);
+  if (error) {
+    return error;
+  }
+  std::vector<VkPhysicalDevice> physicalDevices;
+  std::vector<uint32_t> queueFamilyIndices;
+  std::vector<std::string> deviceUUIDs;
+  error = enumerateComputeDevices(worker->instance, &physicalDevices,
+                                  &queueFamilyIndices, &deviceUUIDs);
+  if (error) {
+    return error;
+  }
+  const size_t deviceIndex =
+      std::find(deviceUUIDs.begin(), deviceUUIDs.end(), deviceUUID) -
+      deviceUUIDs.begin();
+  if (deviceIndex == deviceUUIDs.size()) {
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+  }
+  VkPhysicalDevice physicalDevice = physicalDevices[deviceIndex];
+  worker->queueFamilyIndex = queueFamilyIndices[deviceIndex];
+
+  VkPhysicalDeviceProperties physicalDeviceProperties;
+  vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties);
+  worker->maxGroupCount =
+      physicalDeviceProperties.limits.maxComputeWorkGroupCount[0];
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice,
+                                      &worker->memoryProperties);
+
+  VkDeviceQueueCreateInfo queueCreateInfo = {};
+  queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+  queueCreateInfo.queueCount = 1;
+  queueCreateInfo.queueFamilyIndex = worker->queueFamilyIndex;
+  float queuePriority = 1.0f;
+  queueCreateInfo.pQueuePriorities = &queuePriority;
+
+  VkDeviceCreateInfo deviceCreateInfo = {};
+  deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+  deviceCreateInfo.queueCreateInfoCount = 1;
+  deviceCreateInfo.pQueueCreateInfos = &queueCreateInfo;
+  error = vkCreateDevice(physicalDevice, &deviceCreateInfo, nullptr,
+                         &worker->device);
+  if (error) {
+    return error;
+  }
+  vkGetDeviceQueue(worker->device, worker->queueFamilyIndex, 0,
+                   &worker->queue);
+
+  // a, b and the result
+  std::vector<VkDescriptorSetLayoutBinding> layoutBindings;
+  VkDescriptorSetLayoutBinding layoutBinding = {};
+  layoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  layoutBinding.descriptorCount = 1;
+  layoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  for (uint32_t binding = 0; binding < 3; binding++) {
+    layoutBinding.binding = binding;
+    layoutBindings.push_back(layoutBinding);
+  }
+
+  VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo = {};
+  setLayoutCreateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  setLayoutCreateInfo.bindingCount = layoutBindings.size();
+  setLayoutCreateInfo.pBindings = layoutBindings.data();
+  error = vkCreateDescriptorSetLayout(worker->device, &setLayoutCreateInfo,
+                                      nullptr, &worker->setLayout);
+  if (error) {
+    return error;
+  }
+
+  VkPushConstantRange pushConstantRange = {};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(uint32_t);
+
+  VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+  pipelineLayoutCreateInfo.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutCreateInfo.setLayoutCount = 1;
+  pipelineLayoutCreateInfo.pSetLayouts = &worker->setLayout;
+  pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+  pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+  error = vkCreatePipelineLayout(worker->device, &pipelineLayoutCreateInfo,
+                                 nullptr, &worker->pipelineLayout);
+  if (error) {
+    return error;
+  }
+  error = createComputePipeline(worker->device, worker->pipelineLayout,
+                                "vector_add.spv", nullptr, &worker->pipeline);
+  if (error) {
+    return error;
+  }
+
+  VkDescriptorPoolSize poolSize = {};
+  poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  poolSize.descriptorCount = 3;
+  VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = {};
+  descriptorPoolCreateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  descriptorPoolCreateInfo.maxSets = 1;
+  descriptorPoolCreateInfo.poolSizeCount = 1;
+  descriptorPoolCreateInfo.pPoolSizes = &poolSize;
+  error = vkCreateDescriptorPool(worker->device, &descriptorPoolCreateInfo,
+                                 nullptr, &worker->descriptorPool);
+  if (error) {
+    return error;
+  }
+
+  VkDescriptorSetAllocateInfo descriptorSetAllocateInfo = {};
+  descriptorSetAllocateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  descriptorSetAllocateInfo.descriptorPool = worker->descriptorPool;
+  descriptorSetAllocateInfo.descriptorSetCount = 1;
+  descriptorSetAllocateInfo.pSetLayouts = &worker->setLayout;
+  error = vkAllocateDescriptorSets(worker->device, &descriptorSetAllocateInfo,
+                                   &worker->descriptorSet);
+  if (error) {
+    return error;
+  }
+
+  VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+  commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+  commandPoolCreateInfo.queueFamilyIndex = worker->queueFamilyIndex;
+  error = vkCreateCommandPool(worker->device, &commandPoolCreateInfo, nullptr,
+                              &worker->commandPool);
+  if (error) {
+    return error;
+  }
+
+  VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
+  commandBufferAllocateInfo.sType =
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  commandBufferAllocateInfo.commandPool = worker->commandPool;
+  commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  commandBufferAllocateInfo.commandBufferCount = 1;
+  return vkAllocateCommandBuffers(worker->device, &commandBufferAllocateInfo,
+                                  &worker->commandBuffer);
+}
+
+void destroyBuffer(Worker &worker) {
+  if (worker.data) {
+    vkUnmapMemory(worker.device, worker.memory);
+  }
+  vkDestroyBuffer(worker.device, worker.buffer, nullptr);
+  vkFreeMemory(worker.device, worker.memory, nullptr);
+  worker.buffer = VK_NULL_HANDLE;
+  worker.memory = VK_NULL_HANDLE;
+  worker.bufferSize = 0;
+  worker.data = nullptr;
+}
+
+void destroyWorker(Worker &worker) {
+  if (worker.device) {
+    destroyBuffer(worker);
+    vkDestroyCommandPool(worker.device, worker.commandPool, nullptr);
+    vkDestroyDescriptorPool(worker.device, worker.descriptorPool, nullptr);
+    vkDestroyPipeline(worker.device, worker.pipeline, nullptr);
+    vkDestroyPipelineLayout(worker.device, worker.pipelineLayout, nullptr);
+    vkDestroyDescriptorSetLayout(worker.device, worker.setLayout, nullptr);
+    vkDestroyDevice(worker.device, nullptr);
+  }
+  if (worker.instance) {
+    vkDestroyInstance(worker.instance, nullptr);
+  }
+}
+
+// grow the worker's host visible buffer to hold size bytes
+VkResult reserveBuffer(Worker &worker, VkDeviceSize size) {
+  if (worker.bufferSize >= size) {
+    return VK_SUCCESS;
+  }
+  destroyBuffer(worker);
+  VkBufferCreateInfo bufferCreateInfo = {};
+  bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  bufferCreateInfo.size = size;
+  bufferCreateInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+  bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  bufferCreateInfo.queueFamilyIndexCount = 1;
+  bufferCreateInfo.pQueueFamilyIndices = &worker.queueFamilyIndex;
+  VkResult error = vkCreateBuffer(worker.device, &bufferCreateInfo, nullptr,
+                                  &worker.buffer);
+  if (error) {
+    return error;
+  }
+  VkMemoryRequirements memoryRequirements;
+  vkGetBufferMemoryRequirements(worker.device, worker.buffer,
+                                &memoryRequirements);
+  auto memoryTypeIndex = findMemoryTypeFromProperties(
+      memoryRequirements.memoryTypeBits, worker.memoryProperties,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  if (0 > memoryTypeIndex) {
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+  }
+  VkMemoryAllocateInfo allocateInfo = {};
+  allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocateInfo.allocationSize = memoryRequirements.size;
+  allocateInfo.memoryTypeIndex = memoryTypeIndex;
+  error = vkAllocateMemory(worker.device, &allocateInfo, nullptr,
+                           &worker.memory);
+  if (error) {
+    return error;
+  }
+  error = vkBindBufferMemory(worker.device, worker.buffer, worker.memory, 0);
+  if (error) {
+    return error;
+  }
+  error = vkMapMemory(worker.device, worker.memory, 0, VK_WHOLE_SIZE, 0,
+                      reinterpret_cast<void **>(&worker.data));
+  if (error) {
+    return error;
+  }
+  worker.bufferSize = size;
+  return VK_SUCCESS;
+}
+
+// add the shard of a and b in the shared memory file mapped at file into its
+// result
+VkResult runShard(Worker &worker, char *file, const Shard &shard) {
+  // each region of the buffer is aligned for any storage buffer offset
+  const VkDeviceSize regionSize =
+      (sizeof(int32_t) * VkDeviceSize(shard.count) + 255) & ~VkDeviceSize(255);
+  VkResult error = reserveBuffer(worker, 3 * regionSize);
+  if (error) {
+    return error;
+  }
+  const size_t shardSize = sizeof(int32_t) * shard.count;
+  const size_t shardOffset = sizeof(int32_t) * size_t(shard.first);
+  for (uint32_t input = 0; input < 2; input++) {
+    memcpy(worker.data + input * regionSize,
+           file + shard.offsets[input] + shardOffset, shardSize);
+  }
+
+  VkDescriptorBufferInfo bufferInfos[3];
+  VkWriteDescriptorSet writeDescriptorSets[3];
+  for (uint32_t binding = 0; binding < 3; binding++) {
+    bufferInfos[binding] = {worker.buffer, binding * regionSize, shardSize};
+    writeDescriptorSets[binding] = {};
+    writeDescriptorSets[binding].sType =
+        VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writeDescriptorSets[binding].dstSet = worker.descriptorSet;
+    writeDescriptorSets[binding].dstBinding = binding;
+    writeDescriptorSets[binding].descriptorCount = 1;
+    writeDescriptorSets[binding].descriptorType =
+        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    writeDescriptorSets[binding].pBufferInfo = &bufferInfos[binding];
+  }
+  vkUpdateDescriptorSets(worker.device, 3, writeDescriptorSets, 0, nullptr);
+
+  error = vkResetCommandPool(worker.device, worker.commandPool, 0);
+  if (error) {
+    return error;
+  }
+  VkCommandBufferBeginInfo beginInfo = {};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  error = vkBeginCommandBuffer(worker.commandBuffer, &beginInfo);
+  if (error) {
+    return error;
+  }
+  vkCmdBindPipeline(worker.commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                    worker.pipeline);
+  vkCmdBindDescriptorSets(worker.commandBuffer,
+                          VK_PIPELINE_BIND_POINT_COMPUTE,
+                          worker.pipelineLayout, 0, 1, &worker.descriptorSet,
+                          0, nullptr);
+  vkCmdPushConstants(worker.commandBuffer, worker.pipelineLayout,
+                     VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t),
+                     &shard.count);
+  vkCmdDispatch(worker.commandBuffer,
+                std::min(divideRoundUp(shard.count, 256),
+                         worker.maxGroupCount),
+                1, 1);
+  VkMemoryBarrier memoryBarrier = {};
+  memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  memoryBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+  vkCmdPipelineBarrier(worker.commandBuffer,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &memoryBarrier, 0,
+                       nullptr, 0, nullptr);
+  error = vkEndCommandBuffer(worker.commandBuffer);
+  if (error) {
+    return error;
+  }
+  VkSubmitInfo submitInfo = {};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &worker.commandBuffer;
+  error = vkQueueSubmit(worker.queue, 1, &submitInfo, VK_NULL_HANDLE);
+  if (error) {
+    return error;
+  }
+  error = vkQueueWaitIdle(worker.queue);
+  if (error) {
+    return error;
+  }
+
+  memcpy(file + shard.offsets[2] + shardOffset, worker.data + 2 * regionSize,
+         shardSize);
+  return VK_SUCCESS;
+}
+
+bool readAll(int socket, void *data, size_t size) {
+  char *bytes = static_cast<char *>(data);
+  while (size) {
+    ssize_t count = read(socket, bytes, size);
+    if (count <= 0) {
+      return false;
+    }
+    bytes += count;
+    size -= count;
+  }
+  return true;
+}
+
+bool writeAll(int socket, const void *data, size_t size) {
+  const char *bytes = static_cast<const char *>(data);
+  while (size) {
+    ssize_t count = send(socket, bytes, size, MSG_NOSIGNAL);
+    if (count <= 0) {
+      return false;
+    }
+    bytes += count;
+    size -= count;
+  }
+  return true;
+}
+
+// send shard with file attached as SCM_RIGHTS
+bool sendShard(int socket, const Shard &shard, int file) {
+  iovec data = {const_cast<Shard *>(&shard), sizeof(Shard)};
+  msghdr message = {};
+  message.msg_iov = &data;
+  message.msg_iovlen = 1;
+  char control[CMSG_SPACE(sizeof(int))] = {};
+  message.msg_control = control;
+  message.msg_controllen = sizeof(control);
+  cmsghdr *header = CMSG_FIRSTHDR(&message);
+  header->cmsg_level = SOL_SOCKET;
+  header->cmsg_type = SCM_RIGHTS;
+  header->cmsg_len = CMSG_LEN(sizeof(int));
+  memcpy(CMSG_DATA(header), &file, sizeof(int));
+  return sendmsg(socket, &message, MSG_NOSIGNAL) == sizeof(Shard);
+}
+
+// receive a shard and its attached file, or -1 if there is none
+bool receiveShard(int socket, Shard *shard, int *file) {
+  iovec data = {shard, sizeof(Shard)};
+  msghdr message = {};
+  message.msg_iov = &data;
+  message.msg_iovlen = 1;
+  char control[CMSG_SPACE(sizeof(int))];
+  message.msg_control = control;
+  message.msg_controllen = sizeof(control);
+  *file = -1;
+  if (recvmsg(socket, &message, MSG_WAITALL | MSG_CMSG_CLOEXEC) !=
+      sizeof(Shard)) {
+    return false;
+  }
+  cmsghdr *header = CMSG_FIRSTHDR(&message);
+  if (header && header->cmsg_level == SOL_SOCKET &&
+      header->cmsg_type == SCM_RIGHTS) {
+    memcpy(file, CMSG_DATA(header), sizeof(int));
+  }
+  return true;
+}
+
+// whether the shard lies within a file of size bytes
+bool validShard(const Shard &shard, off_t size) {
+  const uint64_t end = sizeof(int32_t) * (uint64_t(shard.first) + shard.count);
+  if (shard.count == 0 || shard.size > uint64_t(size)) {
+    return false;
+  }
+  for (auto offset : shard.offsets) {
+    if (offset > shard.size || end > shard.size - offset) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// the worker process, it replies once its device is ready then runs the
+// shards it receives until the launcher closes the socket
+int runWorker(int socket, const char *deviceUUID) {
+  Worker worker = {};
+  Reply reply = {};
+  auto start = std::chrono::steady_clock::now();
+  reply.result = createWorker(deviceUUID, &worker);
+  reply.milliseconds = millisecondsSince(start);
+  if (!writeAll(socket, &reply, sizeof(reply)) || reply.result) {
+    destroyWorker(worker);
+    return 1;
+  }
+
+  Shard shard;
+  int file;
+  while (receiveShard(socket, &shard, &file)) {
+    struct stat status;
+    char *mapping = static_cast<char *>(MAP_FAILED);
+    if (file != -1 && !fstat(file, &status) &&
+        validShard(shard, status.st_size)) {
+      mapping = static_cast<char *>(mmap(
+          nullptr, shard.size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0));
+    }
+    if (file != -1) {
+      close(file);
+    }
+    reply = {};
+    if (mapping == MAP_FAILED) {
+      reply.result = VK_ERROR_INITIALIZATION_FAILED;
+    } else {
+      start = std::chrono::steady_clock::now();
+      reply.result = runShard(worker, mapping, shard);
+      reply.milliseconds = millisecondsSince(start);
+      munmap(mapping, shard.size);
+    }
+    if (!writeAll(socket, &reply, sizeof(reply))) {
+      break;
+    }
+  }
+
+  destroyWorker(worker);
+  return 0;
+}
+
+// start a worker for the device with deviceUUID as a new process running
+// this executable, so it does not inherit the launcher's state, returning the
+// launcher's end of its socket
+int spawnWorker(const std::string &deviceUUID, pid_t *process) {
+  int sockets[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets)) {
+    return -1;
+  }
+  fflush(stdout);
+  *process = fork();
+  if (*process == 0) {
+    // only the worker's end survives exec
+    fcntl(sockets[1], F_SETFD, 0);
+    std::string socket = std::to_string(sockets[1]);
+    execl("/proc/self/exe", "multi_gpu", "worker", socket.c_str(),
+          deviceUUID.c_str(), static_cast<char *>(nullptr));
+    perror("exec");
+    _exit(1);
+  }
+  close(sockets[1]);
+  if (*process == -1) {
+    close(sockets[0]);
+    return -1;
+  }
+  return sockets[0];
+}
+
+// split the job into one range for each of the first workerCount workers,
+// send every shard before waiting for any reply so the workers run
+// concurrently
+bool runSharded(const std::vector<int> &sockets, uint32_t workerCount,
+                int file, const Shard &job) {
+  for (uint32_t worker = 0; worker < workerCount; worker++) {
+    Shard shard = job;
+    shard.first = uint64_t(job.count) * worker / workerCount;
+    shard.count = uint64_t(job.count) * (worker + 1) / workerCount -
+                  shard.first;
+    if (!sendShard(sockets[worker], shard, file)) {
+      return false;
+    }
+  }
+  bool success = true;
+  for (uint32_t worker = 0; worker < workerCount; worker++) {
+    Reply reply;
+    if (!readAll(sockets[worker], &reply, sizeof(reply))) {
+      return false;
+    }
+    if (reply.result) {
+      fprintf(stderr, "worker %u failed: %d\n", worker, reply.result);
+      success = false;
+    }
+  }
+  return success;
+}
+
+// usage: multi_gpu [workers]
+//
+// start one worker process for each compute device, or the given number of
+// workers spread across the devices, then compare the job run by one worker
+// against the job sharded across all of them
+int main(int argc, char **argv) {
+  if (argc == 4 && !strcmp(argv[1], "worker")) {
+    return runWorker(atoi(argv[2]), argv[3]);
+  }
+
+  // the launcher only enumerates the devices, each worker creates its own
+  // instance and device
+  VkInstance instance = VK_NULL_HANDLE;
+  VkResult error = createInstance(&instance);
+  if (error) {
+    return error;
+  }
+  std::vector<VkPhysicalDevice> physicalDevices;
+  std::vector<uint32_t> queueFamilyIndices;
+  std::vector<std::string> deviceUUIDs;
+  error = enumerateComputeDevices(instance, &physicalDevices,
+                                  &queueFamilyIndices, &deviceUUIDs);
+  if (error) {
+    return error;
+  }
+  for (uint32_t index = 0; index < physicalDevices.size(); index++) {
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevices[index], &properties);
+    printf("device %u: %s\n", index, properties.deviceName);
+  }
+  vkDestroyInstance(instance, nullptr);
+  if (physicalDevices.empty()) {
+    fprintf(stderr, "no Vulkan 1.1 device with a compute queue\n");
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+  }
+  const uint32_t workerCount =
+      argc > 1 ? std::max(1ul, strtoul(argv[1], nullptr, 0))
+               : physicalDevices.size();
+
+  // a, b and the result share one file every worker maps
+  const uint64_t regionSize = sizeof(int32_t) * uint64_t(elementCount);
+  Shard job = {};
+  job.count = elementCount;
+  for (uint32_t region = 0; region < 3; region++) {
+    job.offsets[region] = region * regionSize;
+  }
+  job.size = 3 * regionSize;
+  int file = memfd_create("multi_gpu_job", MFD_CLOEXEC);
+  if (file == -1 || ftruncate(file, job.size)) {
+    perror("memfd");
+    return 1;
+  }
+  char *mapping = static_cast<char *>(
+      mmap(nullptr, job.size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0));
+  if (mapping == MAP_FAILED) {
+    perror("mmap");
+    return 1;
+  }
+  int32_t *a = reinterpret_cast<int32_t *>(mapping + job.offsets[0]);
+  int32_t *b = reinterpret_cast<int32_t *>(mapping + job.offsets[1]);
+  int32_t *result = reinterpret_cast<int32_t *>(mapping + job.offsets[2]);
+  uint32_t seed = 42;
+  for (uint32_t index = 0; index < elementCount; index++) {
+    a[index] = nextRandom(seed) & 0xffff;
+    b[index] = nextRandom(seed) & 0xffff;
+  }
+
+  std::vector<int> sockets;
+  std::vector<pid_t> processes;
+  bool success = true;
+  for (uint32_t worker = 0; worker < workerCount; worker++) {
+    pid_t process;
+    int socket =
+        spawnWorker(deviceUUIDs[worker % physicalDevices.size()], &process);
+    if (socket == -1) {
+      perror("spawn");
+      success = false;
+      break;
+    }
+    sockets.push_back(socket);
+    processes.push_back(process);
+  }
+  // wait for every device before timing
+  for (uint32_t worker = 0; success && worker < sockets.size(); worker++) {
+    Reply reply;
+    if (!readAll(sockets[worker], &reply, sizeof(reply)) || reply.result) {
+      fprintf(stderr, "worker %u failed to start\n", worker);
+      success = false;
+    } else {
+      printf("worker %u: device %zu ready in %.3f ms\n", worker,
+             worker % physicalDevices.size(), reply.milliseconds);
+    }
+  }
+
+  double singleMilliseconds = 0;
+  for (uint32_t shards : {1u, workerCount}) {
+    if (!success) {
+      break;
+    }
+    memset(result, 0, regionSize);
+    auto start = std::chrono::steady_clock::now();
+    success = runSharded(sockets, shards, file, job);
+    const double milliseconds = millisecondsSince(start);
+    for (uint32_t index = 0; success && index < elementCount; index++) {
+      if (result[index] != a[index] + b[index]) {
+        fprintf(stderr, "result[%u] is %d expected %d\n", index,
+                result[index], a[index] + b[index]);
+        success = false;
+      }
+    }
+    if (shards == 1) {
+      singleMilliseconds = milliseconds;
+    }
+    printf("%u worker%s: %.3f ms, %.2fx\n", shards, shards == 1 ? "" : "s",
+           milliseconds, singleMilliseconds / milliseconds);
+  }
+
+  // closing the sockets ends the workers
+  for (auto socket : sockets) {
+    close(socket);
+  }
+  for (auto process : processes) {
+    int status;
+    if (waitpid(process, &status, 0) != process || !WIFEXITED(status) ||
+        WEXITSTATUS(status)) {
+      success = false;
+    }
+  }
+  munmap(mapping, job.size);
+  close(file);
+  if (!success) {
+    return 1;
+  }
+
+  printf("success\n");
+
+  return 0;
+}
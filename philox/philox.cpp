@@ -0,0 +1,672 @@
+#include <vulkan/vulkan.h>
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+// load a SPIR-V binary from disc
+std::vector<char> loadShaderCode(const char *filename) {
+  std::vector<char> shaderCode;
+  if (FILE *fp = fopen(filename, "rb")) {
+    char buf[1024];
+    while (size_t len = fread(buf, 1, sizeof(buf), fp)) {
+      shaderCode.insert(shaderCode.end(), buf, buf + len);
+    }
+    fclose(fp);
+  }
+  return shaderCode;
+}
+
+// search for compatible memory properties and return the memory type index
+int32_t findMemoryTypeFromProperties(
+    uint32_t memoryTypeBits, VkPhysicalDeviceMemoryProperties properties,
+    VkMemoryPropertyFlags requiredProperties) {
+  assert(properties.memoryTypeCount < 32u);
+  for (uint32_t index = 0; index < properties.memoryTypeCount; ++index) {
+    if (memoryTypeBits & (1u << index) &&
+        // Find the first memory type that supports all the required flags.
+        ((properties.memoryTypes[index].propertyFlags & requiredProperties) ==
+         requiredProperties)) {
+      return (int32_t)index;
+    }
+  }
+  return -1;
+}
+
+// create a compute pipeline from a SPIR-V binary found in SHADER_PATH
+VkResult createComputePipeline(VkDevice device, VkPipelineLayout layout,
+                               const char *filename,
+                               const VkSpecializationInfo *specializationInfo,
+                               VkPipeline *pipeline) {
+  auto shaderCode =
+      loadShaderCode((std::string(SHADER_PATH) + filename).c_str());
+  if (shaderCode.empty()) {
+    fprintf(stderr, "failed to load '%s'\n", filename);
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
+  shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  shaderModuleCreateInfo.pCode =
+      reinterpret_cast<uint32_t *>(shaderCode.data());
+  shaderModuleCreateInfo.codeSize = shaderCode.size();
+  VkShaderModule shaderModule = VK_NULL_HANDLE;
+  VkResult error = vkCreateShaderModule(device, &shaderModuleCreateInfo,
+                                        nullptr, &shaderModule);
+  if (error) {
+    return error;
+  }
+  VkComputePipelineCreateInfo pipelineCreateInfo = {};
+  pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineCreateInfo.stage.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipelineCreateInfo.stage.module = shaderModule;
+  pipelineCreateInfo.stage.pName = "main";
+  pipelineCreateInfo.stage.pSpecializationInfo = specializationInfo;
+  pipelineCreateInfo.layout = layout;
+  error = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1,
+                                   &pipelineCreateInfo, nullptr, pipeline);
+  vkDestroyShaderModule(device, shaderModule, nullptr);
+  return error;
+}
+
+// mirror the push constant block of philox.comp
+struct PhiloxParams {
+  uint32_t seed[2];
+  uint32_t counter[2];
+  uint32_t count;
+  uint32_t bound;
+  float a;
+  float b;
+};
+
+// the values of the distribution specialization constant
+enum Distribution { BITS, BOUNDED, UNIFORM, NORMAL, DISTRIBUTION_COUNT };
+
+// a pipeline for each distribution, sharing a layout with the output buffer
+// as the only binding
+struct Philox {
+  VkPipelineLayout pipelineLayout;
+  VkPipeline pipelines[DISTRIBUTION_COUNT];
+  uint32_t maxGroupCount;
+};
+
+uint32_t divideRoundUp(uint32_t value, uint32_t divisor) {
+  return (value + divisor - 1) / divisor;
+}
+
+// fill count values of the buffer bound by descriptorSet from seed and
+// counter, bound is the exclusive upper bound of BOUNDED integers, a and b
+// the range of UNIFORM or the mean and standard deviation of NORMAL floats
+void recordRandom(VkCommandBuffer commandBuffer, const Philox &philox,
+                  VkDescriptorSet descriptorSet, Distribution distribution,
+                  uint32_t count, uint64_t seed, uint64_t counter,
+                  uint32_t bound, float a, float b) {
+  PhiloxParams params = {{(uint32_t)seed, (uint32_t)(seed >> 32)},
+                         {(uint32_t)counter, (uint32_t)(counter >> 32)},
+                         count,
+                         bound,
+                         a,
+                         b};
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                    philox.pipelines[distribution]);
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                          philox.pipelineLayout, 0, 1, &descriptorSet, 0,
+                          nullptr);
+  vkCmdPushConstants(commandBuffer, philox.pipelineLayout,
+                     VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PhiloxParams),
+                     &params);
+  // each invocation generates blocks of 4 values
+  vkCmdDispatch(
+      commandBuffer,
+      std::min(divideRoundUp(count, 4 * 256), philox.maxGroupCount), 1, 1);
+}
+
+void recordComputeBarrier(VkCommandBuffer commandBuffer) {
+  VkMemoryBarrier memoryBarrier = {};
+  memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  memoryBarrier.dstAccessMask =
+      VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1,
+                       &memoryBarrier, 0, nullptr, 0, nullptr);
+}
+
+// the host reference of philox.comp, ten rounds of Philox4x32 on block
+void philox4x32(uint32_t block[4], const uint32_t seed[2]) {
+  uint32_t key[2] = {seed[0], seed[1]};
+  for (uint32_t round = 0; round < 10; round++) {
+    const uint64_t product0 = 0xd2511f53ull * block[0];
+    const uint64_t product1 = 0xcd9e8d57ull * block[2];
+    block[0] = (uint32_t)(product1 >> 32) ^ block[1] ^ key[0];
+    block[1] = (uint32_t)product1;
+    block[2] = (uint32_t)(product0 >> 32) ^ block[3] ^ key[1];
+    block[3] = (uint32_t)product0;
+    key[0] += 0x9e3779b9u;
+    key[1] += 0xbb67ae85u;
+  }
+}
+
+// the top 24 bits as a float in [0, 1)
+float toUnit(uint32_t word) { return (float)(word >> 8) / 16777216.0f; }
+
+// the host reference of the values of philox.comp
+void hostRandom(uint32_t *values, Distribution distribution, uint32_t count,
+                uint64_t seed, uint64_t counter, uint32_t bound, float a,
+                float b) {
+  const uint32_t key[2] = {(uint32_t)seed, (uint32_t)(seed >> 32)};
+  for (uint32_t index = 0; index < count; index += 4) {
+    const uint64_t position = counter + index / 4;
+    uint32_t block[4] = {(uint32_t)position, (uint32_t)(position >> 32), 0,
+                         0};
+    philox4x32(block, key);
+    float floats[4];
+    switch (distribution) {
+      case BITS:
+        break;
+      case BOUNDED:
+        for (auto &word : block) {
+          word = (uint32_t)(((uint64_t)word * bound) >> 32);
+        }
+        break;
+      case UNIFORM:
+        for (uint32_t word = 0; word < 4; word++) {
+          floats[word] = a + (b - a) * toUnit(block[word]);
+        }
+        memcpy(block, floats, sizeof(block));
+        break;
+      default:
+        for (uint32_t pair = 0; pair < 2; pair++) {
+          const float radius = std::sqrt(
+              -2.0f *
+              std::log(toUnit(block[2 * pair]) + 1.0f / 16777216.0f));
+          const float angle = 3.14159265358979f *
+                              (2.0f * toUnit(block[2 * pair + 1]) - 1.0f);
+          floats[2 * pair] = a + b * radius * std::cos(angle);
+          floats[2 * pair + 1] = a + b * radius * std::sin(angle);
+        }
+        memcpy(block, floats, sizeof(block));
+        break;
+    }
+    memcpy(values + index, block,
+           sizeof(uint32_t) * std::min(4u, count - index));
+  }
+}
+
+// milliseconds elapsed since start
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+int main() {
+  // check the host reference against the known answers of the Random123
+  // test vectors
+  const uint32_t answers[3][10] = {
+      {0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+       0x00000000, 0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8},
+      {0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+       0xffffffff, 0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd},
+      {0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344, 0xa4093822,
+       0x299f31d0, 0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}};
+  for (auto &answer : answers) {
+    uint32_t block[4];
+    memcpy(block, answer, sizeof(block));
+    philox4x32(block, answer + 4);
+    if (memcmp(block, answer + 6, sizeof(block))) {
+      fprintf(stderr, "Philox4x32-10 known answer test failed!\n");
+      return 1;
+    }
+  }
+
+  VkApplicationInfo applicationInfo = {};
+  applicationInfo.pApplicationName = "Vulkan Philox example";
+  applicationInfo.apiVersion = VK_MAKE_VERSION(1, 0, 0);
+
+  VkInstanceCreateInfo instanceCreateInfo = {};
+  instanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+  instanceCreateInfo.pApplicationInfo = &applicationInfo;
+#ifdef ENABLE_LAYERS
+  // without a debug report callback, see vector_add, the validation layer
+  // prints its messages to stdout
+  std::vector<const char *> enabledLayerNames{"VK_LAYER_KHRONOS_validation"};
+  instanceCreateInfo.enabledLayerCount = enabledLayerNames.size();
+  instanceCreateInfo.ppEnabledLayerNames = enabledLayerNames.data();
+#endif
+
+  VkInstance instance = VK_NULL_HANDLE;
+  VkResult error = vkCreateInstance(&instanceCreateInfo, nullptr, &instance);
+  if (error) {
+    return error;
+  }
+
+  uint32_t count;
+  error = vkEnumeratePhysicalDevices(instance, &count, nullptr);
+  if (error) {
+    return error;
+  }
+  std::vector<VkPhysicalDevice> physicalDevices(count);
+  error = vkEnumeratePhysicalDevices(instance, &count, physicalDevices.data());
+  if (error) {
+    return error;
+  }
+
+  // find the first physical device with a compute queue
+  VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+  uint32_t queueFamilyIndex = 0;
+  uint32_t timestampValidBits = 0;
+  for (auto device : physicalDevices) {
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilyProperties(count);
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count,
+                                             queueFamilyProperties.data());
+    for (uint32_t index = 0; index < count; index++) {
+      if (queueFamilyProperties[index].queueFlags & VK_QUEUE_COMPUTE_BIT) {
+        physicalDevice = device;
+        queueFamilyIndex = index;
+        timestampValidBits = queueFamilyProperties[index].timestampValidBits;
+        break;
+      }
+    }
+    if (physicalDevice) {
+      break;
+    }
+  }
+  if (!physicalDevice) {
+    fprintf(stderr, "no device with a compute queue\n");
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+  }
+
+  VkPhysicalDeviceProperties physicalDeviceProperties;
+  vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties);
+  const VkPhysicalDeviceLimits &limits = physicalDeviceProperties.limits;
+
+  VkDeviceQueueCreateInfo queueCreateInfo = {};
+  queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+  queueCreateInfo.queueCount = 1;
+  queueCreateInfo.queueFamilyIndex = queueFamilyIndex;
+  float queuePriority = 1.0f;
+  queueCreateInfo.pQueuePriorities = &queuePriority;
+
+  VkDeviceCreateInfo deviceCreateInfo = {};
+  deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+  deviceCreateInfo.queueCreateInfoCount = 1;
+  deviceCreateInfo.pQueueCreateInfos = &queueCreateInfo;
+  VkDevice device = VK_NULL_HANDLE;
+  error = vkCreateDevice(physicalDevice, &deviceCreateInfo, nullptr, &device);
+  if (error) {
+    return error;
+  }
+
+  VkQueue queue;
+  vkGetDeviceQueue(device, queueFamilyIndex, 0, &queue);
+
+  VkDescriptorSetLayoutBinding layoutBinding = {};
+  layoutBinding.binding = 0;
+  layoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  layoutBinding.descriptorCount = 1;
+  layoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+  VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo = {};
+  setLayoutCreateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  setLayoutCreateInfo.bindingCount = 1;
+  setLayoutCreateInfo.pBindings = &layoutBinding;
+  VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+  error = vkCreateDescriptorSetLayout(device, &setLayoutCreateInfo, nullptr,
+                                      &setLayout);
+  if (error) {
+    return error;
+  }
+
+  VkPushConstantRange pushConstantRange = {};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(PhiloxParams);
+
+  Philox philox;
+  philox.maxGroupCount = limits.maxComputeWorkGroupCount[0];
+  VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+  pipelineLayoutCreateInfo.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutCreateInfo.setLayoutCount = 1;
+  pipelineLayoutCreateInfo.pSetLayouts = &setLayout;
+  pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+  pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+  error = vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr,
+                                 &philox.pipelineLayout);
+  if (error) {
+    return error;
+  }
+
+  VkSpecializationMapEntry specializationMapEntry = {};
+  specializationMapEntry.constantID = 0;
+  specializationMapEntry.offset = 0;
+  specializationMapEntry.size = sizeof(uint32_t);
+  VkSpecializationInfo specializationInfo = {};
+  specializationInfo.mapEntryCount = 1;
+  specializationInfo.pMapEntries = &specializationMapEntry;
+  specializationInfo.dataSize = sizeof(uint32_t);
+  for (uint32_t distribution = 0; distribution < DISTRIBUTION_COUNT;
+       distribution++) {
+    specializationInfo.pData = &distribution;
+    error = createComputePipeline(device, philox.pipelineLayout,
+                                  "philox.spv", &specializationInfo,
+                                  &philox.pipelines[distribution]);
+    if (error) {
+      return error;
+    }
+  }
+
+  // 16M values, not a multiple of 4 so the last block is partial
+  const uint32_t valueCount = (1 << 24) - 3;
+  VkBufferCreateInfo bufferCreateInfo = {};
+  bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  bufferCreateInfo.size = sizeof(uint32_t) * valueCount;
+  bufferCreateInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+  bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  bufferCreateInfo.queueFamilyIndexCount = 1;
+  bufferCreateInfo.pQueueFamilyIndices = &queueFamilyIndex;
+  VkBuffer buffer = VK_NULL_HANDLE;
+  error = vkCreateBuffer(device, &bufferCreateInfo, nullptr, &buffer);
+  if (error) {
+    return error;
+  }
+
+  VkMemoryRequirements memoryRequirements;
+  vkGetBufferMemoryRequirements(device, buffer, &memoryRequirements);
+
+  VkPhysicalDeviceMemoryProperties memoryProperties;
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+  auto memoryTypeIndex = findMemoryTypeFromProperties(
+      memoryRequirements.memoryTypeBits, memoryProperties,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  if (0 > memoryTypeIndex) {
+    return ~42;  // returns -43
+  }
+
+  VkMemoryAllocateInfo allocateInfo = {};
+  allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocateInfo.allocationSize = memoryRequirements.size;
+  allocateInfo.memoryTypeIndex = memoryTypeIndex;
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  error = vkAllocateMemory(device, &allocateInfo, nullptr, &memory);
+  if (error) {
+    return error;
+  }
+  error = vkBindBufferMemory(device, buffer, memory, 0);
+  if (error) {
+    return error;
+  }
+
+  VkDescriptorPoolSize poolSize = {};
+  poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  poolSize.descriptorCount = 1;
+  VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = {};
+  descriptorPoolCreateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  descriptorPoolCreateInfo.maxSets = 1;
+  descriptorPoolCreateInfo.poolSizeCount = 1;
+  descriptorPoolCreateInfo.pPoolSizes = &poolSize;
+  VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+  error = vkCreateDescriptorPool(device, &descriptorPoolCreateInfo, nullptr,
+                                 &descriptorPool);
+  if (error) {
+    return error;
+  }
+
+  VkDescriptorSetAllocateInfo descriptorSetAllocateInfo = {};
+  descriptorSetAllocateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  descriptorSetAllocateInfo.descriptorPool = descriptorPool;
+  descriptorSetAllocateInfo.descriptorSetCount = 1;
+  descriptorSetAllocateInfo.pSetLayouts = &setLayout;
+  VkDescriptorSet descriptorSet;
+  error = vkAllocateDescriptorSets(device, &descriptorSetAllocateInfo,
+                                   &descriptorSet);
+  if (error) {
+    return error;
+  }
+
+  VkDescriptorBufferInfo bufferInfo = {};
+  bufferInfo.buffer = buffer;
+  bufferInfo.offset = 0;
+  bufferInfo.range = VK_WHOLE_SIZE;
+  VkWriteDescriptorSet writeDescriptorSet = {};
+  writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  writeDescriptorSet.dstSet = descriptorSet;
+  writeDescriptorSet.dstBinding = 0;
+  writeDescriptorSet.dstArrayElement = 0;
+  writeDescriptorSet.descriptorCount = 1;
+  writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  writeDescriptorSet.pBufferInfo = &bufferInfo;
+  vkUpdateDescriptorSets(device, 1, &writeDescriptorSet, 0, nullptr);
+
+  uint32_t *data = nullptr;
+  error = vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0,
+                      reinterpret_cast<void **>(&data));
+  if (error) {
+    return error;
+  }
+
+  VkQueryPool queryPool = VK_NULL_HANDLE;
+  if (timestampValidBits) {
+    VkQueryPoolCreateInfo queryPoolCreateInfo = {};
+    queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolCreateInfo.queryCount = 2;
+    error = vkCreateQueryPool(device, &queryPoolCreateInfo, nullptr,
+                              &queryPool);
+    if (error) {
+      return error;
+    }
+  }
+
+  VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+  commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+  commandPoolCreateInfo.queueFamilyIndex = queueFamilyIndex;
+  VkCommandPool commandPool = VK_NULL_HANDLE;
+  error = vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr,
+                              &commandPool);
+  if (error) {
+    return error;
+  }
+
+  VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
+  commandBufferAllocateInfo.sType =
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  commandBufferAllocateInfo.commandPool = commandPool;
+  commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  commandBufferAllocateInfo.commandBufferCount = 1;
+  VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+  error = vkAllocateCommandBuffers(device, &commandBufferAllocateInfo,
+                                   &commandBuffer);
+  if (error) {
+    return error;
+  }
+
+  // record the work of function into the command buffer, submit it, wait for
+  // it to complete and return the time between the timestamps in
+  // milliseconds, or 0 if timestamps are not supported
+  auto submit = [&](std::function<void()> function,
+                    double *milliseconds) -> VkResult {
+    VkResult result = vkResetCommandPool(device, commandPool, 0);
+    if (result) {
+      return result;
+    }
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    result = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    if (result) {
+      return result;
+    }
+    if (queryPool) {
+      vkCmdResetQueryPool(commandBuffer, queryPool, 0, 2);
+      vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                          queryPool, 0);
+    }
+    function();
+    if (queryPool) {
+      vkCmdWriteTimestamp(commandBuffer,
+                          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, queryPool, 1);
+    }
+    result = vkEndCommandBuffer(commandBuffer);
+    if (result) {
+      return result;
+    }
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    result = vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+    if (result) {
+      return result;
+    }
+    vkQueueWaitIdle(queue);
+
+    *milliseconds = 0.0;
+    if (queryPool) {
+      uint64_t timestamps[2];
+      result = vkGetQueryPoolResults(
+          device, queryPool, 0, 2, sizeof(timestamps), timestamps,
+          sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+      if (result) {
+        return result;
+      }
+      *milliseconds =
+          (timestamps[1] - timestamps[0]) * limits.timestampPeriod * 1e-6;
+    }
+    return VK_SUCCESS;
+  };
+
+  // each distribution with its parameters and expected mean and variance,
+  // the integers are rolls of a die
+  struct Test {
+    const char *name;
+    Distribution distribution;
+    uint32_t bound;
+    float a;
+    float b;
+    double mean;
+    double variance;
+  };
+  const Test tests[] = {
+      {"bits", BITS, 0, 0.0f, 0.0f, 2147483647.5,
+       18446744073709551616.0 / 12.0},
+      {"bounded [0, 6)", BOUNDED, 6, 0.0f, 0.0f, 2.5, 35.0 / 12.0},
+      {"uniform [-1, 1)", UNIFORM, 0, -1.0f, 1.0f, 0.0, 1.0 / 3.0},
+      {"normal (0, 1)", NORMAL, 0, 0.0f, 1.0f, 0.0, 1.0}};
+
+  // a sequence of fills, each continuing from the counter the last one
+  // stopped at, the last fill is compared to the host reference
+  const uint64_t seed = 0x0123456789abcdefull;
+  const uint32_t fillCount = 10;
+  const uint64_t blocksPerFill = (valueCount + 3) / 4;
+  const uint64_t lastCounter = (fillCount - 1) * blocksPerFill;
+  printf("%-16s %10s %10s %10s %14s %14s\n", "distribution", "device ms",
+         "Gvalues/s", "host ms", "mean", "variance");
+  int failures = 0;
+  std::vector<uint32_t> expected(valueCount);
+  for (const Test &test : tests) {
+    double milliseconds;
+    error = submit(
+        [&] {
+          for (uint32_t fill = 0; fill < fillCount; fill++) {
+            if (fill) {
+              recordComputeBarrier(commandBuffer);
+            }
+            recordRandom(commandBuffer, philox, descriptorSet,
+                         test.distribution, valueCount, seed,
+                         fill * blocksPerFill, test.bound, test.a, test.b);
+          }
+        },
+        &milliseconds);
+    if (error) {
+      return error;
+    }
+    milliseconds /= fillCount;
+    auto start = std::chrono::steady_clock::now();
+    hostRandom(expected.data(), test.distribution, valueCount, seed,
+               lastCounter, test.bound, test.a, test.b);
+    const double hostMilliseconds = millisecondsSince(start);
+
+    const bool isFloat =
+        test.distribution == UNIFORM || test.distribution == NORMAL;
+    double sum = 0.0;
+    double sumOfSquares = 0.0;
+    for (uint32_t index = 0; index < valueCount; index++) {
+      float value;
+      memcpy(&value, &data[index], sizeof(float));
+      const double x = isFloat ? value : data[index];
+      sum += x;
+      sumOfSquares += x * x;
+    }
+    const double mean = sum / valueCount;
+    const double variance = sumOfSquares / valueCount - mean * mean;
+    printf("%-16s %10.3f %10.2f %10.3f %14.6g %14.6g\n", test.name,
+           milliseconds,
+           milliseconds > 0.0 ? valueCount / milliseconds * 1e-6 : 0.0,
+           hostMilliseconds, mean, variance);
+    // within 10 standard errors of the mean, and 1% of the variance
+    if (std::fabs(mean - test.mean) >
+            10.0 * std::sqrt(test.variance / valueCount) ||
+        std::fabs(variance / test.variance - 1.0) > 0.01) {
+      fprintf(stderr, "%s has the wrong moments!\n", test.name);
+      failures++;
+    }
+
+    // the integers must match exactly, the transcendental functions of the
+    // normal transform are only accurate to around 2^-11 on the device
+    for (uint32_t index = 0; index < valueCount; index++) {
+      float actual, reference;
+      memcpy(&actual, &data[index], sizeof(float));
+      memcpy(&reference, &expected[index], sizeof(float));
+      const bool matches =
+          !isFloat ? data[index] == expected[index]
+                   : std::fabs(actual - reference) <=
+                         (test.distribution == UNIFORM ? 1e-6f : 4e-3f) *
+                             (1.0f + std::fabs(reference));
+      if (!matches) {
+        fprintf(stderr, "%s [%u] is '%08x' not '%08x'!\n", test.name, index,
+                data[index], expected[index]);
+        failures++;
+        break;
+      }
+    }
+  }
+  vkUnmapMemory(device, memory);
+
+  if (queryPool) {
+    vkDestroyQueryPool(device, queryPool, nullptr);
+  }
+  vkDestroyCommandPool(device, commandPool, nullptr);
+  vkFreeMemory(device, memory, nullptr);
+  vkDestroyBuffer(device, buffer, nullptr);
+  vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+  for (auto pipeline : philox.pipelines) {
+    vkDestroyPipeline(device, pipeline, nullptr);
+  }
+  vkDestroyPipelineLayout(device, philox.pipelineLayout, nullptr);
+  vkDestroyDescriptorSetLayout(device, setLayout, nullptr);
+  vkDestroyDevice(device, nullptr);
+  vkDestroyInstance(instance, nullptr);
+
+  if (failures) {
+    return 1;
+  }
+  printf("success\n");
+
+  return 0;
+}
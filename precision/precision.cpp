@@ -0,0 +1,890 @@
+#include <vulkan/vulkan.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+// load a SPIR-V binary from disc
+std::vector<char> loadShaderCode(const char *filename) {
+  std::vector<char> shaderCode;
+  if (FILE *fp = fopen(filename, "rb")) {
+    char buf[1024];
+    while (size_t len = fread(buf, 1, sizeof(buf), fp)) {
+      shaderCode.insert(shaderCode.end(), buf, buf + len);
+    }
+    fclose(fp);
+  }
+  return shaderCode;
+}
+
+// search for compatible memory properties and return the memory type index
+int32_t findMemoryTypeFromProperties(
+    uint32_t memoryTypeBits, VkPhysicalDeviceMemoryProperties properties,
+    VkMemoryPropertyFlags requiredProperties) {
+  assert(properties.memoryTypeCount < 32u);
+  for (uint32_t index = 0; index < properties.memoryTypeCount; ++index) {
+    if (memoryTypeBits & (1u << index) &&
+        // Find the first memory type that supports all the required flags.
+        ((properties.memoryTypes[index].propertyFlags & requiredProperties) ==
+         requiredProperties)) {
+      return (int32_t)index;
+    }
+  }
+  return -1;
+}
+
+// create a compute pipeline from a SPIR-V binary found in SHADER_PATH
+VkResult createComputePipeline(VkDevice device, VkPipelineLayout layout,
+                               const char *filename,
+                               const VkSpecializationInfo *specializationInfo,
+                               VkPipeline *pipeline) {
+  auto shaderCode =
+      loadShaderCode((std::string(SHADER_PATH) + filename).c_str());
+  if (shaderCode.empty()) {
+    fprintf(stderr, "failed to load '%s'\n", filename);
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
+  shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  shaderModuleCreateInfo.pCode =
+      reinterpret_cast<uint32_t *>(shaderCode.data());
+  shaderModuleCreateInfo.codeSize = shaderCode.size();
+  VkShaderModule shaderModule = VK_NULL_HANDLE;
+  VkResult error = vkCreateShaderModule(device, &shaderModuleCreateInfo,
+                                        nullptr, &shaderModule);
+  if (error) {
+    return error;
+  }
+  VkComputePipelineCreateInfo pipelineCreateInfo = {};
+  pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineCreateInfo.stage.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipelineCreateInfo.stage.module = shaderModule;
+  pipelineCreateInfo.stage.pName = "main";
+  pipelineCreateInfo.stage.pSpecializationInfo = specializationInfo;
+  pipelineCreateInfo.layout = layout;
+  error = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1,
+                                   &pipelineCreateInfo, nullptr, pipeline);
+  vkDestroyShaderModule(device, shaderModule, nullptr);
+  return error;
+}
+
+// the operations and formats of precision.comp
+enum Operation { NARROW, WIDEN, ADD, OPERATION_COUNT };
+enum Format { FLOAT, HALF, BFLOAT16, INT8, FORMAT_COUNT };
+const char *formatNames[FORMAT_COUNT] = {"float", "half", "bfloat16", "int8"};
+const uint32_t valuesPerWord[FORMAT_COUNT] = {1, 2, 2, 4};
+
+struct PushConstants {
+  uint32_t count;
+  uint32_t seed;
+  float scale;
+  float inverseScale;
+};
+
+// the pipelines of each operation and format, only narrowing rounds so the
+// other operations have no stochastic pipeline
+struct Precision {
+  VkDescriptorSetLayout setLayout;
+  VkPipelineLayout pipelineLayout;
+  VkPipeline pipelines[OPERATION_COUNT][FORMAT_COUNT][2];
+  uint32_t maxGroupCount;
+};
+
+uint32_t divideRoundUp(uint32_t value, uint32_t divisor) {
+  return (value + divisor - 1) / divisor;
+}
+
+void recordPrecision(VkCommandBuffer commandBuffer, const Precision &precision,
+                     VkDescriptorSet descriptorSet, Operation operation,
+                     Format format, bool stochastic,
+                     const PushConstants &pushConstants) {
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                    precision.pipelines[operation][format][stochastic]);
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                          precision.pipelineLayout, 0, 1, &descriptorSet, 0,
+                          nullptr);
+  vkCmdPushConstants(commandBuffer, precision.pipelineLayout,
+                     VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushConstants),
+                     &pushConstants);
+  const uint32_t wordCount =
+      divideRoundUp(pushConstants.count, valuesPerWord[format]);
+  vkCmdDispatch(commandBuffer,
+                std::min(divideRoundUp(wordCount, 256),
+                         precision.maxGroupCount),
+                1, 1);
+}
+
+void recordBarrier(VkCommandBuffer commandBuffer,
+                   VkPipelineStageFlags srcStageMask,
+                   VkAccessFlags srcAccessMask,
+                   VkPipelineStageFlags dstStageMask,
+                   VkAccessFlags dstAccessMask) {
+  VkMemoryBarrier memoryBarrier = {};
+  memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  memoryBarrier.srcAccessMask = srcAccessMask;
+  memoryBarrier.dstAccessMask = dstAccessMask;
+  vkCmdPipelineBarrier(commandBuffer, srcStageMask, dstStageMask, 0, 1,
+                       &memoryBarrier, 0, nullptr, 0, nullptr);
+}
+
+uint32_t nextRandom(uint32_t &seed) {
+  seed = seed * 1664525u + 1013904223u;
+  return seed >> 8;
+}
+
+uint32_t floatBits(float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+float bitsFloat(uint32_t bits) {
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+// the host reference of precision.comp, conversions are bit exact
+
+uint32_t hash(uint32_t key) {
+  key ^= key >> 16;
+  key *= 0x85ebca6bu;
+  key ^= key >> 13;
+  key *= 0xc2b2ae35u;
+  key ^= key >> 16;
+  return key;
+}
+
+uint32_t roundShift(uint32_t bits, uint32_t shift, uint32_t noise,
+                    bool stochastic) {
+  const uint32_t mask = (1u << shift) - 1;
+  const uint32_t bias =
+      stochastic ? noise & mask : (mask >> 1) + ((bits >> shift) & 1);
+  return (bits + bias) >> shift;
+}
+
+uint32_t floatToHalf(float value, uint32_t noise, bool stochastic) {
+  const uint32_t bits = floatBits(value);
+  const uint32_t sign = (bits >> 16) & 0x8000;
+  const uint32_t mantissa = bits & 0x7fffff;
+  const int32_t exponent = (int32_t)((bits >> 23) & 0xff) - 127 + 15;
+  if (exponent == 128 + 15) {
+    return sign | 0x7c00 | (mantissa ? 0x200 : 0);
+  }
+  if (exponent >= 31) {
+    return sign | 0x7c00;
+  }
+  if (exponent > 0) {
+    return sign | roundShift((uint32_t)exponent << 23 | mantissa, 13, noise,
+                             stochastic);
+  }
+  const uint32_t shift = 14 - exponent;
+  if (shift > 24) {
+    return sign;
+  }
+  return sign | roundShift(mantissa | 0x800000, shift, noise, stochastic);
+}
+
+uint32_t floatToBfloat16(float value, uint32_t noise, bool stochastic) {
+  const uint32_t bits = floatBits(value);
+  if ((bits & 0x7fffffff) > 0x7f800000) {
+    return (bits >> 16) | 0x40;
+  }
+  return roundShift(bits, 16, noise, stochastic);
+}
+
+uint32_t floatToInt8(float value, float inverseScale, uint32_t noise,
+                     bool stochastic) {
+  const float quantized = value * inverseScale;
+  const float rounded =
+      stochastic ? std::floor(quantized + (noise >> 8) * (1.0f / 16777216.0f))
+                 : std::nearbyint(quantized);
+  return (uint32_t)(int32_t)std::min(std::max(rounded, -127.0f), 127.0f) &
+         0xff;
+}
+
+float halfToFloat(uint32_t half) {
+  const uint32_t sign = (half & 0x8000) << 16;
+  uint32_t exponent = (half >> 10) & 0x1f;
+  uint32_t mantissa = half & 0x3ff;
+  if (exponent == 0x1f) {
+    return bitsFloat(sign | 0x7f800000 | mantissa << 13);
+  }
+  if (exponent) {
+    return bitsFloat(sign | (exponent + 127 - 15) << 23 | mantissa << 13);
+  }
+  if (!mantissa) {
+    return bitsFloat(sign);
+  }
+  // normalize a subnormal
+  exponent = 127 - 14;
+  while (!(mantissa & 0x400)) {
+    mantissa <<= 1;
+    exponent--;
+  }
+  return bitsFloat(sign | exponent << 23 | (mantissa & 0x3ff) << 13);
+}
+
+// pack values into words as the narrow operation does
+std::vector<uint32_t> narrowValues(const std::vector<float> &values,
+                                   Format format, bool stochastic,
+                                   const PushConstants &pushConstants) {
+  const uint32_t perWord = valuesPerWord[format];
+  const uint32_t bits = 32 / perWord;
+  std::vector<uint32_t> words(divideRoundUp(values.size(), perWord), 0);
+  const uint32_t seedHash = hash(pushConstants.seed);
+  for (uint32_t index = 0; index < values.size(); index++) {
+    const uint32_t noise = stochastic ? hash(index ^ seedHash) : 0;
+    uint32_t narrowed = floatBits(values[index]);
+    switch (format) {
+    case HALF:
+      narrowed = floatToHalf(values[index], noise, stochastic);
+      break;
+    case BFLOAT16:
+      narrowed = floatToBfloat16(values[index], noise, stochastic);
+      break;
+    case INT8:
+      narrowed = floatToInt8(values[index], pushConstants.inverseScale, noise,
+                             stochastic);
+      break;
+    default:
+      break;
+    }
+    words[index / perWord] |= narrowed << (bits * (index % perWord));
+  }
+  return words;
+}
+
+// the value at index of a packed column, as the widen operation does
+float widenValue(const uint32_t *words, uint32_t index, Format format,
+                 float scale) {
+  const uint32_t perWord = valuesPerWord[format];
+  const uint32_t shift = 32 / perWord * (index % perWord);
+  const uint32_t word = words[index / perWord];
+  switch (format) {
+  case HALF:
+    return halfToFloat((word >> shift) & 0xffff);
+  case BFLOAT16:
+    return bitsFloat((word >> shift) << 16);
+  case INT8:
+    return (float)(int8_t)(word >> shift) * scale;
+  default:
+    return bitsFloat(word);
+  }
+}
+
+// create the buffers with usage and bind them to a single allocation of a
+// memory type with the properties which every buffer supports
+VkResult createBuffers(VkDevice device,
+                       const VkPhysicalDeviceMemoryProperties &properties,
+                       VkMemoryPropertyFlags memoryPropertyFlags,
+                       const std::vector<VkDeviceSize> &sizes,
+                       VkBufferUsageFlags usage, uint32_t queueFamilyIndex,
+                       std::vector<VkBuffer> &buffers, VkDeviceMemory *memory,
+                       std::vector<VkDeviceSize> &offsets) {
+  VkDeviceSize requiredMemorySize = 0;
+  uint32_t memoryTypeBits = ~0u;
+  for (VkDeviceSize size : sizes) {
+    VkBufferCreateInfo bufferCreateInfo = {};
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.size = size;
+    bufferCreateInfo.usage = usage;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    bufferCreateInfo.queueFamilyIndexCount = 1;
+    bufferCreateInfo.pQueueFamilyIndices = &queueFamilyIndex;
+    VkBuffer buffer;
+    VkResult error =
+        vkCreateBuffer(device, &bufferCreateInfo, nullptr, &buffer);
+    if (error) {
+      return error;
+    }
+    buffers.push_back(buffer);
+    VkMemoryRequirements memoryRequirements;
+    vkGetBufferMemoryRequirements(device, buffer, &memoryRequirements);
+    memoryTypeBits &= memoryRequirements.memoryTypeBits;
+    const VkDeviceSize alignment = memoryRequirements.alignment;
+    requiredMemorySize =
+        (requiredMemorySize + alignment - 1) / alignment * alignment;
+    offsets.push_back(requiredMemorySize);
+    requiredMemorySize += memoryRequirements.size;
+  }
+
+  // falling back to another memory type could give memory the caller cannot
+  // map, or must flush, so fail instead
+  auto memoryTypeIndex = findMemoryTypeFromProperties(
+      memoryTypeBits, properties, memoryPropertyFlags);
+  if (0 > memoryTypeIndex) {
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+  }
+  VkMemoryAllocateInfo allocateInfo = {};
+  allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocateInfo.allocationSize = requiredMemorySize;
+  allocateInfo.memoryTypeIndex = memoryTypeIndex;
+  VkResult error = vkAllocateMemory(device, &allocateInfo, nullptr, memory);
+  if (error) {
+    return error;
+  }
+  for (size_t index = 0; index < buffers.size(); index++) {
+    error = vkBindBufferMemory(device, buffers[index], *memory,
+                               offsets[index]);
+    if (error) {
+      return error;
+    }
+  }
+  return VK_SUCCESS;
+}
+
+int main() {
+  VkApplicationInfo applicationInfo = {};
+  applicationInfo.pApplicationName = "Vulkan precision example";
+  applicationInfo.apiVersion = VK_MAKE_VERSION(1, 0, 0);
+
+  VkInstanceCreateInfo instanceCreateInfo = {};
+  instanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+  instanceCreateInfo.pApplicationInfo = &applicationInfo;
+#ifdef ENABLE_LAYERS
+  // without a debug report callback, see vector_add, the validation layer
+  // prints its messages to stdout
+  std::vector<const char *> enabledLayerNames{"VK_LAYER_KHRONOS_validation"};
+  instanceCreateInfo.enabledLayerCount = enabledLayerNames.size();
+  instanceCreateInfo.ppEnabledLayerNames = enabledLayerNames.data();
+#endif
+
+  VkInstance instance = VK_NULL_HANDLE;
+  VkResult error = vkCreateInstance(&instanceCreateInfo, nullptr, &instance);
+  if (error) {
+    return error;
+  }
+
+  uint32_t count;
+  error = vkEnumeratePhysicalDevices(instance, &count, nullptr);
+  if (error) {
+    return error;
+  }
+  std::vector<VkPhysicalDevice> physicalDevices(count);
+  error = vkEnumeratePhysicalDevices(instance, &count, physicalDevices.data());
+  if (error) {
+    return error;
+  }
+
+  // find the first physical device with a compute queue
+  VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+  uint32_t queueFamilyIndex = 0;
+  uint32_t timestampValidBits = 0;
+  for (auto device : physicalDevices) {
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilyProperties(count);
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count,
+                                             queueFamilyProperties.data());
+    for (uint32_t index = 0; index < count; index++) {
+      if (queueFamilyProperties[index].queueFlags & VK_QUEUE_COMPUTE_BIT) {
+        physicalDevice = device;
+        queueFamilyIndex = index;
+        timestampValidBits = queueFamilyProperties[index].timestampValidBits;
+        break;
+      }
+    }
+    if (physicalDevice) {
+      break;
+    }
+  }
+  if (!physicalDevice) {
+    fprintf(stderr, "no device with a compute queue\n");
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+  }
+
+  VkPhysicalDeviceProperties physicalDeviceProperties;
+  vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties);
+  const VkPhysicalDeviceLimits &limits = physicalDeviceProperties.limits;
+
+  VkDeviceQueueCreateInfo queueCreateInfo = {};
+  queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+  queueCreateInfo.queueCount = 1;
+  queueCreateInfo.queueFamilyIndex = queueFamilyIndex;
+  float queuePriority = 1.0f;
+  queueCreateInfo.pQueuePriorities = &queuePriority;
+
+  VkDeviceCreateInfo deviceCreateInfo = {};
+  deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+  deviceCreateInfo.queueCreateInfoCount = 1;
+  deviceCreateInfo.pQueueCreateInfos = &queueCreateInfo;
+  VkDevice device = VK_NULL_HANDLE;
+  error = vkCreateDevice(physicalDevice, &deviceCreateInfo, nullptr, &device);
+  if (error) {
+    return error;
+  }
+
+  VkQueue queue;
+  vkGetDeviceQueue(device, queueFamilyIndex, 0, &queue);
+
+  Precision precision = {};
+  precision.maxGroupCount = limits.maxComputeWorkGroupCount[0];
+
+  // every operation binds two inputs and a result
+  std::vector<VkDescriptorSetLayoutBinding> layoutBindings;
+  VkDescriptorSetLayoutBinding layoutBinding = {};
+  layoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  layoutBinding.descriptorCount = 1;
+  layoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  for (uint32_t binding = 0; binding < 3; binding++) {
+    layoutBinding.binding = binding;
+    layoutBindings.push_back(layoutBinding);
+  }
+
+  VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo = {};
+  setLayoutCreateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  setLayoutCreateInfo.bindingCount = layoutBindings.size();
+  setLayoutCreateInfo.pBindings = layoutBindings.data();
+  error = vkCreateDescriptorSetLayout(device, &setLayoutCreateInfo, nullptr,
+                                      &precision.setLayout);
+  if (error) {
+    return error;
+  }
+
+  VkPushConstantRange pushConstantRange = {};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(PushConstants);
+
+  VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+  pipelineLayoutCreateInfo.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutCreateInfo.setLayoutCount = 1;
+  pipelineLayoutCreateInfo.pSetLayouts = &precision.setLayout;
+  pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+  pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+  error = vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr,
+                                 &precision.pipelineLayout);
+  if (error) {
+    return error;
+  }
+
+  // the operation, format and rounding are specialization constants
+  const VkSpecializationMapEntry mapEntries[] = {
+      {0, 0, sizeof(uint32_t)},
+      {1, sizeof(uint32_t), sizeof(uint32_t)},
+      {2, 2 * sizeof(uint32_t), sizeof(VkBool32)}};
+  for (uint32_t operation = 0; operation < OPERATION_COUNT; operation++) {
+    for (uint32_t format = 0; format < FORMAT_COUNT; format++) {
+      for (uint32_t stochastic = 0; stochastic < 2; stochastic++) {
+        if (stochastic && operation != NARROW) {
+          continue;
+        }
+        const uint32_t specializationData[] = {operation, format, stochastic};
+        VkSpecializationInfo specializationInfo = {};
+        specializationInfo.mapEntryCount = 3;
+        specializationInfo.pMapEntries = mapEntries;
+        specializationInfo.dataSize = sizeof(specializationData);
+        specializationInfo.pData = specializationData;
+        error = createComputePipeline(
+            device, precision.pipelineLayout, "precision.spv",
+            &specializationInfo,
+            &precision.pipelines[operation][format][stochastic]);
+        if (error) {
+          return error;
+        }
+      }
+    }
+  }
+
+  // values over the whole range of half, from below its smallest subnormal
+  // to above its largest value, checking every conversion against the host
+  const uint32_t valueCount = 1 << 22;
+  const VkDeviceSize columnSize = sizeof(float) * valueCount;
+  std::vector<float> values(valueCount);
+  uint32_t seed = 42;
+  for (uint32_t index = 0; index < valueCount; index++) {
+    const float mantissa = 1.0f + nextRandom(seed) * (1.0f / 16777216.0f);
+    const int exponent = (int)(nextRandom(seed) % 46) - 28;
+    values[index] = (nextRandom(seed) & 1 ? -1.0f : 1.0f) *
+                    std::ldexp(mantissa, exponent);
+  }
+  // two columns of readings in [0, 1) to add in reduced precision
+  std::vector<float> columnA(valueCount);
+  std::vector<float> columnB(valueCount);
+  for (uint32_t index = 0; index < valueCount; index++) {
+    columnA[index] = nextRandom(seed) * (1.0f / 16777216.0f);
+    columnB[index] = nextRandom(seed) * (1.0f / 16777216.0f);
+  }
+
+  VkPhysicalDeviceMemoryProperties memoryProperties;
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+  const VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                   VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+                                   VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+  // the conversions read and write host visible memory directly, the
+  // columns are uploaded in reduced precision to device local memory where
+  // they are added, a packed column is never larger than a float column
+  enum { VALUES, PACKED, WIDENED, UPLOAD_A, UPLOAD_B, SUM, HOST_BUFFER_COUNT };
+  std::vector<VkBuffer> hostBuffers;
+  std::vector<VkDeviceSize> hostOffsets;
+  VkDeviceMemory hostMemory = VK_NULL_HANDLE;
+  error = createBuffers(device, memoryProperties,
+                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                        std::vector<VkDeviceSize>(HOST_BUFFER_COUNT,
+                                                  columnSize),
+                        usage, queueFamilyIndex, hostBuffers, &hostMemory,
+                        hostOffsets);
+  if (error) {
+    return error;
+  }
+  enum { A, B, C, DEVICE_BUFFER_COUNT };
+  std::vector<VkBuffer> deviceBuffers;
+  std::vector<VkDeviceSize> deviceOffsets;
+  VkDeviceMemory deviceMemory = VK_NULL_HANDLE;
+  error = createBuffers(device, memoryProperties,
+                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                        {columnSize, columnSize, columnSize}, usage,
+                        queueFamilyIndex, deviceBuffers, &deviceMemory,
+                        deviceOffsets);
+  if (error) {
+    return error;
+  }
+
+  // narrow the values, widen them back, and add the uploaded columns, the
+  // unused second input of narrow and widen is bound to their first
+  enum { NARROW_SET, WIDEN_SET, ADD_SET, SET_COUNT };
+  VkDescriptorPoolSize poolSize = {};
+  poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  poolSize.descriptorCount = 3 * SET_COUNT;
+  VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = {};
+  descriptorPoolCreateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  descriptorPoolCreateInfo.maxSets = SET_COUNT;
+  descriptorPoolCreateInfo.poolSizeCount = 1;
+  descriptorPoolCreateInfo.pPoolSizes = &poolSize;
+  VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+  error = vkCreateDescriptorPool(device, &descriptorPoolCreateInfo, nullptr,
+                                 &descriptorPool);
+  if (error) {
+    return error;
+  }
+
+  const VkDescriptorSetLayout setLayouts[SET_COUNT] = {
+      precision.setLayout, precision.setLayout, precision.setLayout};
+  VkDescriptorSetAllocateInfo descriptorSetAllocateInfo = {};
+  descriptorSetAllocateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  descriptorSetAllocateInfo.descriptorPool = descriptorPool;
+  descriptorSetAllocateInfo.descriptorSetCount = SET_COUNT;
+  descriptorSetAllocateInfo.pSetLayouts = setLayouts;
+  VkDescriptorSet descriptorSets[SET_COUNT];
+  error = vkAllocateDescriptorSets(device, &descriptorSetAllocateInfo,
+                                   descriptorSets);
+  if (error) {
+    return error;
+  }
+
+  const VkBuffer boundBuffers[SET_COUNT][3] = {
+      {hostBuffers[VALUES], hostBuffers[VALUES], hostBuffers[PACKED]},
+      {hostBuffers[PACKED], hostBuffers[PACKED], hostBuffers[WIDENED]},
+      {deviceBuffers[A], deviceBuffers[B], deviceBuffers[C]}};
+  VkDescriptorBufferInfo bufferInfos[SET_COUNT][3];
+  std::vector<VkWriteDescriptorSet> descriptorSetWrites;
+  VkWriteDescriptorSet writeDescriptorSet = {};
+  writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  writeDescriptorSet.dstArrayElement = 0;
+  writeDescriptorSet.descriptorCount = 1;
+  writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  for (uint32_t set = 0; set < SET_COUNT; set++) {
+    for (uint32_t binding = 0; binding < 3; binding++) {
+      bufferInfos[set][binding] = {boundBuffers[set][binding], 0,
+                                   VK_WHOLE_SIZE};
+      writeDescriptorSet.dstSet = descriptorSets[set];
+      writeDescriptorSet.dstBinding = binding;
+      writeDescriptorSet.pBufferInfo = &bufferInfos[set][binding];
+      descriptorSetWrites.push_back(writeDescriptorSet);
+    }
+  }
+  vkUpdateDescriptorSets(device, descriptorSetWrites.size(),
+                         descriptorSetWrites.data(), 0, nullptr);
+
+  char *data = nullptr;
+  error = vkMapMemory(device, hostMemory, 0, VK_WHOLE_SIZE, 0,
+                      reinterpret_cast<void **>(&data));
+  if (error) {
+    return error;
+  }
+  memcpy(data + hostOffsets[VALUES], values.data(), columnSize);
+  uint32_t *packedData =
+      reinterpret_cast<uint32_t *>(data + hostOffsets[PACKED]);
+  float *widenedData = reinterpret_cast<float *>(data + hostOffsets[WIDENED]);
+  float *sumData = reinterpret_cast<float *>(data + hostOffsets[SUM]);
+
+  VkQueryPool queryPool = VK_NULL_HANDLE;
+  if (timestampValidBits) {
+    VkQueryPoolCreateInfo queryPoolCreateInfo = {};
+    queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolCreateInfo.queryCount = 2;
+    error = vkCreateQueryPool(device, &queryPoolCreateInfo, nullptr,
+                              &queryPool);
+    if (error) {
+      return error;
+    }
+  }
+
+  VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+  commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+  commandPoolCreateInfo.queueFamilyIndex = queueFamilyIndex;
+  VkCommandPool commandPool = VK_NULL_HANDLE;
+  error = vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr,
+                              &commandPool);
+  if (error) {
+    return error;
+  }
+
+  VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
+  commandBufferAllocateInfo.sType =
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  commandBufferAllocateInfo.commandPool = commandPool;
+  commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  commandBufferAllocateInfo.commandBufferCount = 1;
+  VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+  error = vkAllocateCommandBuffers(device, &commandBufferAllocateInfo,
+                                   &commandBuffer);
+  if (error) {
+    return error;
+  }
+
+  // record the work of function into the command buffer, submit it, wait for
+  // it to complete and return the time between the timestamps in
+  // milliseconds, or 0 if timestamps are not supported
+  auto submit = [&](std::function<void()> function,
+                    double *milliseconds) -> VkResult {
+    VkResult result = vkResetCommandPool(device, commandPool, 0);
+    if (result) {
+      return result;
+    }
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    result = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    if (result) {
+      return result;
+    }
+    if (queryPool) {
+      vkCmdResetQueryPool(commandBuffer, queryPool, 0, 2);
+      vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                          queryPool, 0);
+    }
+    function();
+    if (queryPool) {
+      vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                          queryPool, 1);
+    }
+    result = vkEndCommandBuffer(commandBuffer);
+    if (result) {
+      return result;
+    }
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    result = vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+    if (result) {
+      return result;
+    }
+    vkQueueWaitIdle(queue);
+
+    *milliseconds = 0.0;
+    if (queryPool) {
+      uint64_t timestamps[2];
+      result = vkGetQueryPoolResults(
+          device, queryPool, 0, 2, sizeof(timestamps), timestamps,
+          sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+      if (result) {
+        return result;
+      }
+      *milliseconds =
+          (timestamps[1] - timestamps[0]) * limits.timestampPeriod * 1e-6;
+    }
+    return VK_SUCCESS;
+  };
+
+  const char *roundingNames[2] = {"nearest even", "stochastic"};
+  int failures = 0;
+
+  // narrow the values on the device, as they would be for a download, then
+  // widen them again, both must match the host bit for bit
+  printf("%-10s %-14s %10s %10s\n", "format", "rounding", "narrow ms",
+         "widen ms");
+  for (uint32_t format = HALF; format < FORMAT_COUNT; format++) {
+    for (uint32_t stochastic = 0; stochastic < 2; stochastic++) {
+      // integers cover [-8, 8] so small values quantize to zero and large
+      // ones saturate
+      PushConstants pushConstants = {valueCount, 7 + stochastic, 8.0f / 127,
+                                     127 / 8.0f};
+      memset(packedData, 0, columnSize);
+      memset(widenedData, 0, columnSize);
+      double narrowMilliseconds;
+      error = submit(
+          [&] {
+            recordPrecision(commandBuffer, precision,
+                            descriptorSets[NARROW_SET], NARROW,
+                            (Format)format, stochastic, pushConstants);
+          },
+          &narrowMilliseconds);
+      if (error) {
+        return error;
+      }
+      double widenMilliseconds;
+      error = submit(
+          [&] {
+            recordPrecision(commandBuffer, precision,
+                            descriptorSets[WIDEN_SET], WIDEN, (Format)format,
+                            false, pushConstants);
+          },
+          &widenMilliseconds);
+      if (error) {
+        return error;
+      }
+      printf("%-10s %-14s %10.3f %10.3f\n", formatNames[format],
+             roundingNames[stochastic], narrowMilliseconds,
+             widenMilliseconds);
+
+      const std::vector<uint32_t> expected =
+          narrowValues(values, (Format)format, stochastic, pushConstants);
+      for (uint32_t word = 0; word < expected.size(); word++) {
+        if (packedData[word] != expected[word]) {
+          fprintf(stderr, "%s %s word [%u] is '%08x' not '%08x'!\n",
+                  formatNames[format], roundingNames[stochastic], word,
+                  packedData[word], expected[word]);
+          failures++;
+          break;
+        }
+      }
+      for (uint32_t index = 0; index < valueCount; index++) {
+        const float widened = widenValue(packedData, index, (Format)format,
+                                         pushConstants.scale);
+        if (floatBits(widenedData[index]) != floatBits(widened)) {
+          fprintf(stderr, "%s widened [%u] is '%g' not '%g'!\n",
+                  formatNames[format], index, widenedData[index], widened);
+          failures++;
+          break;
+        }
+      }
+    }
+  }
+
+  // upload both columns in each format, narrowed on the host, and add them
+  // on the device in full precision, the error is measured against adding
+  // the full precision columns
+  printf("\n%-10s %-14s %12s %10s %12s %12s\n", "format", "rounding",
+         "uploaded MB", "device ms", "mean error", "max error");
+  for (uint32_t format = FLOAT; format < FORMAT_COUNT; format++) {
+    for (uint32_t stochastic = 0; stochastic < 2; stochastic++) {
+      if (stochastic && format == FLOAT) {
+        continue;
+      }
+      PushConstants pushConstants = {valueCount, 11 + stochastic, 1.0f / 127,
+                                     127.0f};
+      const std::vector<uint32_t> packedA =
+          narrowValues(columnA, (Format)format, stochastic, pushConstants);
+      pushConstants.seed += 2;
+      const std::vector<uint32_t> packedB =
+          narrowValues(columnB, (Format)format, stochastic, pushConstants);
+      const VkDeviceSize packedSize = sizeof(uint32_t) * packedA.size();
+      memcpy(data + hostOffsets[UPLOAD_A], packedA.data(), packedSize);
+      memcpy(data + hostOffsets[UPLOAD_B], packedB.data(), packedSize);
+      memset(sumData, 0, columnSize);
+
+      double milliseconds;
+      error = submit(
+          [&] {
+            VkBufferCopy region = {0, 0, packedSize};
+            vkCmdCopyBuffer(commandBuffer, hostBuffers[UPLOAD_A],
+                            deviceBuffers[A], 1, &region);
+            vkCmdCopyBuffer(commandBuffer, hostBuffers[UPLOAD_B],
+                            deviceBuffers[B], 1, &region);
+            recordBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                          VK_ACCESS_TRANSFER_WRITE_BIT,
+                          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                          VK_ACCESS_SHADER_READ_BIT);
+            recordPrecision(commandBuffer, precision, descriptorSets[ADD_SET],
+                            ADD, (Format)format, false, pushConstants);
+            recordBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                          VK_ACCESS_SHADER_WRITE_BIT,
+                          VK_PIPELINE_STAGE_TRANSFER_BIT,
+                          VK_ACCESS_TRANSFER_READ_BIT);
+            region.size = columnSize;
+            vkCmdCopyBuffer(commandBuffer, deviceBuffers[C], hostBuffers[SUM],
+                            1, &region);
+          },
+          &milliseconds);
+      if (error) {
+        return error;
+      }
+
+      double errorSum = 0.0;
+      double maxError = 0.0;
+      for (uint32_t index = 0; index < valueCount; index++) {
+        const float expected =
+            widenValue(packedA.data(), index, (Format)format,
+                       pushConstants.scale) +
+            widenValue(packedB.data(), index, (Format)format,
+                       pushConstants.scale);
+        if (floatBits(sumData[index]) != floatBits(expected)) {
+          fprintf(stderr, "%s sum [%u] is '%g' not '%g'!\n",
+                  formatNames[format], index, sumData[index], expected);
+          failures++;
+          break;
+        }
+        const double difference =
+            (double)sumData[index] - ((double)columnA[index] + columnB[index]);
+        errorSum += difference;
+        maxError = std::max(maxError, std::fabs(difference));
+      }
+      printf("%-10s %-14s %12.2f %10.3f %12.3e %12.3e\n", formatNames[format],
+             roundingNames[stochastic], 2 * packedSize * 1e-6, milliseconds,
+             errorSum / valueCount, maxError);
+    }
+  }
+  vkUnmapMemory(device, hostMemory);
+
+  if (queryPool) {
+    vkDestroyQueryPool(device, queryPool, nullptr);
+  }
+  vkDestroyCommandPool(device, commandPool, nullptr);
+  vkFreeMemory(device, hostMemory, nullptr);
+  vkFreeMemory(device, deviceMemory, nullptr);
+  for (auto buffer : hostBuffers) {
+    vkDestroyBuffer(device, buffer, nullptr);
+  }
+  for (auto buffer : deviceBuffers) {
+    vkDestroyBuffer(device, buffer, nullptr);
+  }
+  vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+  for (auto &formats : precision.pipelines) {
+    for (auto &roundings : formats) {
+      for (auto pipeline : roundings) {
+        if (pipeline) {
+          vkDestroyPipeline(device, pipeline, nullptr);
+        }
+      }
+    }
+  }
+  vkDestroyPipelineLayout(device, precision.pipelineLayout, nullptr);
+  vkDestroyDescriptorSetLayout(device, precision.setLayout, nullptr);
+  vkDestroyDevice(device, nullptr);
+  vkDestroyInstance(instance, nullptr);
+
+  if (failures) {
+    return 1;
+  }
+  printf("success\n");
+
+  return 0;
+}
@@ -0,0 +1,810 @@
+#include <vulkan/vulkan.h>
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// load a SPIR-V binary from disc
+std::vector<char> loadShaderCode(const char *filename) {
+  std::vector<char> shaderCode;
+  if (FILE *fp = fopen(filename, "rb")) {
+    char buf[1024];
+    while (size_t len = fread(buf, 1, sizeof(buf), fp)) {
+      shaderCode.insert(shaderCode.end(), buf, buf + len);
+    }
+    fclose(fp);
+  }
+  return shaderCode;
+}
+
+// search for compatible memory properties and return the memory type index
+int32_t findMemoryTypeFromProperties(
+    uint32_t memoryTypeBits, VkPhysicalDeviceMemoryProperties properties,
+    VkMemoryPropertyFlags requiredProperties) {
+  assert(properties.memoryTypeCount < 32u);
+  for (uint32_t index = 0; index < properties.memoryTypeCount; ++index) {
+    if (memoryTypeBits & (1u << index) &&
+        // Find the first memory type that supports all the required flags.
+        ((properties.memoryTypes[index].propertyFlags & requiredProperties) ==
+         requiredProperties)) {
+      return (int32_t)index;
+    }
+  }
+  return -1;
+}
+
+// create a compute pipeline from a SPIR-V binary found in SHADER_PATH
+VkResult createComputePipeline(VkDevice device, VkPipelineLayout layout,
+                               const char *filename,
+                               const VkSpecializationInfo *specializationInfo,
+                               VkPipeline *pipeline) {
+  auto shaderCode =
+      loadShaderCode((std::string(SHADER_PATH) + filename).c_str());
+  if (shaderCode.empty()) {
+    fprintf(stderr, "failed to load '%s'\n", filename);
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
+  shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  shaderModuleCreateInfo.pCode =
+      reinterpret_cast<uint32_t *>(shaderCode.data());
+  shaderModuleCreateInfo.codeSize = shaderCode.size();
+  VkShaderModule shaderModule = VK_NULL_HANDLE;
+  VkResult error = vkCreateShaderModule(device, &shaderModuleCreateInfo,
+                                        nullptr, &shaderModule);
+  if (error) {
+    return error;
+  }
+  VkComputePipelineCreateInfo pipelineCreateInfo = {};
+  pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineCreateInfo.stage.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipelineCreateInfo.stage.module = shaderModule;
+  pipelineCreateInfo.stage.pName = "main";
+  pipelineCreateInfo.stage.pSpecializationInfo = specializationInfo;
+  pipelineCreateInfo.layout = layout;
+  error = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1,
+                                   &pipelineCreateInfo, nullptr, pipeline);
+  vkDestroyShaderModule(device, shaderModule, nullptr);
+  return error;
+}
+
+// create the buffers with usage and bind them to a single allocation of a
+// memory type with the properties which every buffer supports
+VkResult createBuffers(VkDevice device,
+                       const VkPhysicalDeviceMemoryProperties &properties,
+                       VkMemoryPropertyFlags memoryPropertyFlags,
+                       const std::vector<VkDeviceSize> &sizes,
+                       VkBufferUsageFlags usage, uint32_t queueFamilyIndex,
+                       std::vector<VkBuffer> &buffers, VkDeviceMemory *memory,
+                       std::vector<VkDeviceSize> &offsets) {
+  VkDeviceSize requiredMemorySize = 0;
+  uint32_t memoryTypeBits = ~0u;
+  for (VkDeviceSize size : sizes) {
+    VkBufferCreateInfo bufferCreateInfo = {};
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.size = size;
+    bufferCreateInfo.usage = usage;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    bufferCreateInfo.queueFamilyIndexCount = 1;
+    bufferCreateInfo.pQueueFamilyIndices = &queueFamilyIndex;
+    VkBuffer buffer;
+    VkResult error =
+        vkCreateBuffer(device, &bufferCreateInfo, nullptr, &buffer);
+    if (error) {
+      return error;
+    }
+    buffers.push_back(buffer);
+    VkMemoryRequirements memoryRequirements;
+    vkGetBufferMemoryRequirements(device, buffer, &memoryRequirements);
+    memoryTypeBits &= memoryRequirements.memoryTypeBits;
+    const VkDeviceSize alignment = memoryRequirements.alignment;
+    requiredMemorySize =
+        (requiredMemorySize + alignment - 1) / alignment * alignment;
+    offsets.push_back(requiredMemorySize);
+    requiredMemorySize += memoryRequirements.size;
+  }
+
+  // falling back to another memory type could give memory the caller cannot
+  // map, or must flush, so fail instead
+  auto memoryTypeIndex = findMemoryTypeFromProperties(
+      memoryTypeBits, properties, memoryPropertyFlags);
+  if (0 > memoryTypeIndex) {
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+  }
+  VkMemoryAllocateInfo allocateInfo = {};
+  allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocateInfo.allocationSize = requiredMemorySize;
+  allocateInfo.memoryTypeIndex = memoryTypeIndex;
+  VkResult error = vkAllocateMemory(device, &allocateInfo, nullptr, memory);
+  if (error) {
+    return error;
+  }
+  for (size_t index = 0; index < buffers.size(); index++) {
+    error = vkBindBufferMemory(device, buffers[index], *memory,
+                               offsets[index]);
+    if (error) {
+      return error;
+    }
+  }
+  return VK_SUCCESS;
+}
+
+// a fast, not cryptographic, hash of size bytes, 8 bytes at a time
+uint64_t hashBytes(const void *data, size_t size, uint64_t hash) {
+  const uint64_t multiplier = 0x9e3779b97f4a7c15ull;
+  const uint8_t *bytes = reinterpret_cast<const uint8_t *>(data);
+  size_t index = 0;
+  for (; index + sizeof(uint64_t) <= size; index += sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, bytes + index, sizeof(word));
+    hash = (hash ^ word) * multiplier;
+    hash ^= hash >> 29;
+  }
+  uint64_t tail = 0;
+  memcpy(&tail, bytes + index, size - index);
+  hash = (hash ^ tail ^ size) * multiplier;
+  return hash ^ hash >> 32;
+}
+
+// identifies a result by what determines it, the pipeline, its
+// specialization and the contents of its inputs, as two independent 64 bit
+// hashes so a collision returning the wrong result is negligible
+struct CacheKey {
+  uint64_t hashes[2];
+
+  bool operator==(const CacheKey &other) const {
+    return hashes[0] == other.hashes[0] && hashes[1] == other.hashes[1];
+  }
+};
+
+struct CacheKeyHash {
+  size_t operator()(const CacheKey &key) const { return key.hashes[0]; }
+};
+
+// add size bytes of data to the key
+void hashKey(CacheKey &key, const void *data, size_t size) {
+  key.hashes[0] = hashBytes(data, size, key.hashes[0]);
+  key.hashes[1] = hashBytes(data, size, key.hashes[1] ^ 0x5bd1e995);
+}
+
+struct CachedResult {
+  CacheKey key;
+  VkBuffer buffer;
+  VkDeviceMemory memory;
+  VkDeviceSize size;
+};
+
+// result buffers in device memory bounded to capacity bytes, the least
+// recently used result is evicted first, entries are ordered from the most
+// recently used
+struct ResultCache {
+  VkDevice device;
+  VkPhysicalDeviceMemoryProperties memoryProperties;
+  VkBufferUsageFlags usage;
+  uint32_t queueFamilyIndex;
+  VkDeviceSize capacity;
+  VkDeviceSize size;
+  std::list<CachedResult> entries;
+  std::unordered_map<CacheKey, std::list<CachedResult>::iterator,
+                     CacheKeyHash>
+      index;
+  uint32_t hits;
+  uint32_t misses;
+  uint32_t evictions;
+};
+
+// return the result for key and make it the most recently used, or nullptr
+// if it is not cached
+const CachedResult *findResult(ResultCache &cache, const CacheKey &key) {
+  auto found = cache.index.find(key);
+  if (found == cache.index.end()) {
+    cache.misses++;
+    return nullptr;
+  }
+  cache.hits++;
+  cache.entries.splice(cache.entries.begin(), cache.entries, found->second);
+  return &cache.entries.front();
+}
+
+void destroyResult(VkDevice device, const CachedResult &result) {
+  vkDestroyBuffer(device, result.buffer, nullptr);
+  vkFreeMemory(device, result.memory, nullptr);
+}
+
+// create a result buffer of size bytes for key, evicting the least recently
+// used results until it fits, the caller must ensure the device is no longer
+// using the evicted buffers, here every job is waited for
+VkResult insertResult(ResultCache &cache, const CacheKey &key,
+                      VkDeviceSize size, const CachedResult **result) {
+  while (!cache.entries.empty() && cache.size + size > cache.capacity) {
+    const CachedResult &evicted = cache.entries.back();
+    cache.size -= evicted.size;
+    cache.index.erase(evicted.key);
+    destroyResult(cache.device, evicted);
+    cache.entries.pop_back();
+    cache.evictions++;
+  }
+  CachedResult entry = {};
+  entry.key = key;
+  entry.size = size;
+  std::vector<VkBuffer> buffers;
+  std::vector<VkDeviceSize> offsets;
+  VkResult error = createBuffers(
+      cache.device, cache.memoryProperties,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, {size}, cache.usage,
+      cache.queueFamilyIndex, buffers, &entry.memory, offsets);
+  if (!buffers.empty()) {
+    entry.buffer = buffers[0];
+  }
+  if (error) {
+    destroyResult(cache.device, entry);
+    return error;
+  }
+  cache.entries.push_front(entry);
+  cache.index[key] = cache.entries.begin();
+  cache.size += size;
+  *result = &cache.entries.front();
+  return VK_SUCCESS;
+}
+
+// remove the result for key, when the job computing it failed its buffer
+// does not hold the result
+void eraseResult(ResultCache &cache, const CacheKey &key) {
+  auto found = cache.index.find(key);
+  if (found == cache.index.end()) {
+    return;
+  }
+  cache.size -= found->second->size;
+  destroyResult(cache.device, *found->second);
+  cache.entries.erase(found->second);
+  cache.index.erase(found);
+}
+
+void destroyResultCache(ResultCache &cache) {
+  for (const CachedResult &entry : cache.entries) {
+    destroyResult(cache.device, entry);
+  }
+  cache.entries.clear();
+  cache.index.clear();
+  cache.size = 0;
+}
+
+uint32_t divideRoundUp(uint32_t value, uint32_t divisor) {
+  return (value + divisor - 1) / divisor;
+}
+
+uint32_t nextRandom(uint32_t &seed) {
+  seed = seed * 1664525u + 1013904223u;
+  return seed >> 8;
+}
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+int main() {
+  VkApplicationInfo applicationInfo = {};
+  applicationInfo.pApplicationName = "Vulkan result cache example";
+  applicationInfo.apiVersion = VK_MAKE_VERSION(1, 0, 0);
+
+  VkInstanceCreateInfo instanceCreateInfo = {};
+  instanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+  instanceCreateInfo.pApplicationInfo = &applicationInfo;
+#ifdef ENABLE_LAYERS
+  // without a debug report callback, see vector_add, the validation layer
+  // prints its messages to stdout
+  std::vector<const char *> enabledLayerNames{"VK_LAYER_KHRONOS_validation"};
+  instanceCreateInfo.enabledLayerCount = enabledLayerNames.size();
+  instanceCreateInfo.ppEnabledLayerNames = enabledLayerNames.data();
+#endif
+
+  VkInstance instance = VK_NULL_HANDLE;
+  VkResult error = vkCreateInstance(&instanceCreateInfo, nullptr, &instance);
+  if (error) {
+    return error;
+  }
+
+  uint32_t count;
+  error = vkEnumeratePhysicalDevices(instance, &count, nullptr);
+  if (error) {
+    return error;
+  }
+  std::vector<VkPhysicalDevice> physicalDevices(count);
+  error = vkEnumeratePhysicalDevices(instance, &count, physicalDevices.data());
+  if (error) {
+    return error;
+  }
+
+  // find the first physical device with a compute queue
+  VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+  uint32_t queueFamilyIndex = 0;
+  uint32_t timestampValidBits = 0;
+  for (auto device : physicalDevices) {
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilyProperties(count);
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count,
+                                             queueFamilyProperties.data());
+    for (uint32_t index = 0; index < count; index++) {
+      if (queueFamilyProperties[index].queueFlags & VK_QUEUE_COMPUTE_BIT) {
+        physicalDevice = device;
+        queueFamilyIndex = index;
+        timestampValidBits = queueFamilyProperties[index].timestampValidBits;
+        break;
+      }
+    }
+    if (physicalDevice) {
+      break;
+    }
+  }
+  if (!physicalDevice) {
+    fprintf(stderr, "no device with a compute queue\n");
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+  }
+
+  VkPhysicalDeviceProperties physicalDeviceProperties;
+  vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties);
+  const VkPhysicalDeviceLimits &limits = physicalDeviceProperties.limits;
+
+  VkDeviceQueueCreateInfo queueCreateInfo = {};
+  queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+  queueCreateInfo.queueCount = 1;
+  queueCreateInfo.queueFamilyIndex = queueFamilyIndex;
+  float queuePriority = 1.0f;
+  queueCreateInfo.pQueuePriorities = &queuePriority;
+
+  VkDeviceCreateInfo deviceCreateInfo = {};
+  deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+  deviceCreateInfo.queueCreateInfoCount = 1;
+  deviceCreateInfo.pQueueCreateInfos = &queueCreateInfo;
+  VkDevice device = VK_NULL_HANDLE;
+  error = vkCreateDevice(physicalDevice, &deviceCreateInfo, nullptr, &device);
+  if (error) {
+    return error;
+  }
+
+  VkQueue queue;
+  vkGetDeviceQueue(device, queueFamilyIndex, 0, &queue);
+
+  // a, b and the result
+  std::vector<VkDescriptorSetLayoutBinding> layoutBindings;
+  VkDescriptorSetLayoutBinding layoutBinding = {};
+  layoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  layoutBinding.descriptorCount = 1;
+  layoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  for (uint32_t binding = 0; binding < 3; binding++) {
+    layoutBinding.binding = binding;
+    layoutBindings.push_back(layoutBinding);
+  }
+
+  VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo = {};
+  setLayoutCreateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  setLayoutCreateInfo.bindingCount = layoutBindings.size();
+  setLayoutCreateInfo.pBindings = layoutBindings.data();
+  VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+  error = vkCreateDescriptorSetLayout(device, &setLayoutCreateInfo, nullptr,
+                                      &setLayout);
+  if (error) {
+    return error;
+  }
+
+  VkPushConstantRange pushConstantRange = {};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(uint32_t);
+
+  VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+  pipelineLayoutCreateInfo.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutCreateInfo.setLayoutCount = 1;
+  pipelineLayoutCreateInfo.pSetLayouts = &setLayout;
+  pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+  pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+  VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+  error = vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr,
+                                 &pipelineLayout);
+  if (error) {
+    return error;
+  }
+
+  // the operation is the specialization of the pipeline, part of the key of
+  // every result
+  enum { ADD, MULTIPLY, OPERATION_COUNT };
+  const char *operationNames[OPERATION_COUNT] = {"add", "multiply"};
+  const char *shaderName = "elementwise.spv";
+  VkPipeline pipelines[OPERATION_COUNT];
+  const VkSpecializationMapEntry mapEntry = {0, 0, sizeof(uint32_t)};
+  for (uint32_t operation = 0; operation < OPERATION_COUNT; operation++) {
+    VkSpecializationInfo specializationInfo = {};
+    specializationInfo.mapEntryCount = 1;
+    specializationInfo.pMapEntries = &mapEntry;
+    specializationInfo.dataSize = sizeof(uint32_t);
+    specializationInfo.pData = &operation;
+    error = createComputePipeline(device, pipelineLayout, shaderName,
+                                  &specializationInfo, &pipelines[operation]);
+    if (error) {
+      return error;
+    }
+  }
+  const uint32_t maxGroupCount = limits.maxComputeWorkGroupCount[0];
+
+  // a pool of input pairs of 4M integers, each job applies an operation to
+  // one of the pairs, so there are only 8 distinct jobs
+  const uint32_t elementCount = 1 << 22;
+  const VkDeviceSize bufferSize = sizeof(int32_t) * elementCount;
+  const uint32_t pairCount = 4;
+  std::vector<std::vector<int32_t>> inputsA(pairCount);
+  std::vector<std::vector<int32_t>> inputsB(pairCount);
+  uint32_t seed = 42;
+  for (uint32_t pair = 0; pair < pairCount; pair++) {
+    inputsA[pair].resize(elementCount);
+    inputsB[pair].resize(elementCount);
+    for (uint32_t index = 0; index < elementCount; index++) {
+      inputsA[pair][index] = nextRandom(seed) % 1000;
+      inputsB[pair][index] = nextRandom(seed) % 1000;
+    }
+  }
+  struct Job {
+    uint32_t operation;
+    uint32_t pair;
+  };
+  std::vector<Job> jobs(32);
+  for (Job &job : jobs) {
+    job.operation = nextRandom(seed) % OPERATION_COUNT;
+    job.pair = nextRandom(seed) % pairCount;
+  }
+
+  VkPhysicalDeviceMemoryProperties memoryProperties;
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+  const VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                   VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+                                   VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+  // the inputs are uploaded from host visible memory to device local memory
+  // and results are read back to be checked, without the cache every job
+  // writes to the same result buffer
+  enum { UPLOAD_A, UPLOAD_B, READ_BACK, HOST_BUFFER_COUNT };
+  std::vector<VkBuffer> hostBuffers;
+  std::vector<VkDeviceSize> hostOffsets;
+  VkDeviceMemory hostMemory = VK_NULL_HANDLE;
+  error = createBuffers(device, memoryProperties,
+                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                        {bufferSize, bufferSize, bufferSize}, usage,
+                        queueFamilyIndex, hostBuffers, &hostMemory,
+                        hostOffsets);
+  if (error) {
+    return error;
+  }
+  enum { A, B, UNCACHED_RESULT, DEVICE_BUFFER_COUNT };
+  std::vector<VkBuffer> deviceBuffers;
+  std::vector<VkDeviceSize> deviceOffsets;
+  VkDeviceMemory deviceMemory = VK_NULL_HANDLE;
+  error = createBuffers(device, memoryProperties,
+                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                        {bufferSize, bufferSize, bufferSize}, usage,
+                        queueFamilyIndex, deviceBuffers, &deviceMemory,
+                        deviceOffsets);
+  if (error) {
+    return error;
+  }
+
+  // room for half of the distinct results, so some are evicted
+  ResultCache cache = {};
+  cache.device = device;
+  cache.memoryProperties = memoryProperties;
+  cache.usage = usage;
+  cache.queueFamilyIndex = queueFamilyIndex;
+  cache.capacity = 4 * bufferSize;
+
+  VkDescriptorPoolSize poolSize = {};
+  poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  poolSize.descriptorCount = 3;
+  VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = {};
+  descriptorPoolCreateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  descriptorPoolCreateInfo.maxSets = 1;
+  descriptorPoolCreateInfo.poolSizeCount = 1;
+  descriptorPoolCreateInfo.pPoolSizes = &poolSize;
+  VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+  error = vkCreateDescriptorPool(device, &descriptorPoolCreateInfo, nullptr,
+                                 &descriptorPool);
+  if (error) {
+    return error;
+  }
+
+  VkDescriptorSetAllocateInfo descriptorSetAllocateInfo = {};
+  descriptorSetAllocateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  descriptorSetAllocateInfo.descriptorPool = descriptorPool;
+  descriptorSetAllocateInfo.descriptorSetCount = 1;
+  descriptorSetAllocateInfo.pSetLayouts = &setLayout;
+  VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+  error = vkAllocateDescriptorSets(device, &descriptorSetAllocateInfo,
+                                   &descriptorSet);
+  if (error) {
+    return error;
+  }
+
+  // bind a and b once, the result is bound by each job which computes one
+  VkDescriptorBufferInfo bufferInfos[3] = {
+      {deviceBuffers[A], 0, VK_WHOLE_SIZE},
+      {deviceBuffers[B], 0, VK_WHOLE_SIZE},
+      {deviceBuffers[UNCACHED_RESULT], 0, VK_WHOLE_SIZE}};
+  VkWriteDescriptorSet writeDescriptorSet = {};
+  writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  writeDescriptorSet.dstSet = descriptorSet;
+  writeDescriptorSet.dstArrayElement = 0;
+  writeDescriptorSet.descriptorCount = 1;
+  writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  for (uint32_t binding = 0; binding < 3; binding++) {
+    writeDescriptorSet.dstBinding = binding;
+    writeDescriptorSet.pBufferInfo = &bufferInfos[binding];
+    vkUpdateDescriptorSets(device, 1, &writeDescriptorSet, 0, nullptr);
+  }
+  writeDescriptorSet.dstBinding = 2;
+  writeDescriptorSet.pBufferInfo = &bufferInfos[2];
+
+  char *data = nullptr;
+  error = vkMapMemory(device, hostMemory, 0, VK_WHOLE_SIZE, 0,
+                      reinterpret_cast<void **>(&data));
+  if (error) {
+    return error;
+  }
+  const int32_t *readBackData =
+      reinterpret_cast<int32_t *>(data + hostOffsets[READ_BACK]);
+  VkQueryPool queryPool = VK_NULL_HANDLE;
+  if (timestampValidBits) {
+    VkQueryPoolCreateInfo queryPoolCreateInfo = {};
+    queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolCreateInfo.queryCount = 2;
+    error = vkCreateQueryPool(device, &queryPoolCreateInfo, nullptr,
+                              &queryPool);
+    if (error) {
+      return error;
+    }
+  }
+
+  VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+  commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+  commandPoolCreateInfo.queueFamilyIndex = queueFamilyIndex;
+  VkCommandPool commandPool = VK_NULL_HANDLE;
+  error = vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr,
+                              &commandPool);
+  if (error) {
+    return error;
+  }
+
+  VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
+  commandBufferAllocateInfo.sType =
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  commandBufferAllocateInfo.commandPool = commandPool;
+  commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  commandBufferAllocateInfo.commandBufferCount = 1;
+  VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+  error = vkAllocateCommandBuffers(device, &commandBufferAllocateInfo,
+                                   &commandBuffer);
+  if (error) {
+    return error;
+  }
+
+  // record the work of function into the command buffer, submit it, wait for
+  // it to complete and return the time between the timestamps in
+  // milliseconds, or 0 if timestamps are not supported
+  auto submit = [&](std::function<void()> function,
+                    double *milliseconds) -> VkResult {
+    VkResult result = vkResetCommandPool(device, commandPool, 0);
+    if (result) {
+      return result;
+    }
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    result = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    if (result) {
+      return result;
+    }
+    if (queryPool) {
+      vkCmdResetQueryPool(commandBuffer, queryPool, 0, 2);
+      vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                          queryPool, 0);
+    }
+    function();
+    if (queryPool) {
+      vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                          queryPool, 1);
+    }
+    result = vkEndCommandBuffer(commandBuffer);
+    if (result) {
+      return result;
+    }
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    result = vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+    if (result) {
+      return result;
+    }
+    vkQueueWaitIdle(queue);
+
+    *milliseconds = 0.0;
+    if (queryPool) {
+      uint64_t timestamps[2];
+      result = vkGetQueryPoolResults(
+          device, queryPool, 0, 2, sizeof(timestamps), timestamps,
+          sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+      if (result) {
+        return result;
+      }
+      *milliseconds =
+          (timestamps[1] - timestamps[0]) * limits.timestampPeriod * 1e-6;
+    }
+    return VK_SUCCESS;
+  };
+
+  // run a job and return the buffer holding its result, with a cache a
+  // repeated job skips the upload and the dispatch
+  auto runJob = [&](const Job &job, ResultCache *cache,
+                    VkBuffer *resultBuffer) -> VkResult {
+    *resultBuffer = deviceBuffers[UNCACHED_RESULT];
+    CacheKey key = {};
+    if (cache) {
+      hashKey(key, shaderName, strlen(shaderName));
+      hashKey(key, &job.operation, sizeof(job.operation));
+      hashKey(key, &elementCount, sizeof(elementCount));
+      hashKey(key, inputsA[job.pair].data(), bufferSize);
+      hashKey(key, inputsB[job.pair].data(), bufferSize);
+      if (const CachedResult *cached = findResult(*cache, key)) {
+        *resultBuffer = cached->buffer;
+        return VK_SUCCESS;
+      }
+      const CachedResult *inserted;
+      VkResult result = insertResult(*cache, key, bufferSize, &inserted);
+      if (result) {
+        return result;
+      }
+      *resultBuffer = inserted->buffer;
+    }
+    bufferInfos[2].buffer = *resultBuffer;
+    vkUpdateDescriptorSets(device, 1, &writeDescriptorSet, 0, nullptr);
+
+    memcpy(data + hostOffsets[UPLOAD_A], inputsA[job.pair].data(),
+           bufferSize);
+    memcpy(data + hostOffsets[UPLOAD_B], inputsB[job.pair].data(),
+           bufferSize);
+    double milliseconds;
+    VkResult result = submit(
+        [&] {
+          VkBufferCopy region = {0, 0, bufferSize};
+          vkCmdCopyBuffer(commandBuffer, hostBuffers[UPLOAD_A],
+                          deviceBuffers[A], 1, &region);
+          vkCmdCopyBuffer(commandBuffer, hostBuffers[UPLOAD_B],
+                          deviceBuffers[B], 1, &region);
+          VkMemoryBarrier memoryBarrier = {};
+          memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+          memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+          memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+          vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                               VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1,
+                               &memoryBarrier, 0, nullptr, 0, nullptr);
+          vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                            pipelines[job.operation]);
+          vkCmdBindDescriptorSets(commandBuffer,
+                                  VK_PIPELINE_BIND_POINT_COMPUTE,
+                                  pipelineLayout, 0, 1, &descriptorSet, 0,
+                                  nullptr);
+          vkCmdPushConstants(commandBuffer, pipelineLayout,
+                             VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t),
+                             &elementCount);
+          vkCmdDispatch(commandBuffer,
+                        std::min(divideRoundUp(elementCount, 256),
+                                 maxGroupCount),
+                        1, 1);
+        },
+        &milliseconds);
+    // a failed job must not leave an entry whose buffer was never written
+    if (result && cache) {
+      eraseResult(*cache, key);
+    }
+    return result;
+  };
+
+  // run every job without and then with the cache, the job time includes
+  // hashing the inputs but not reading back the result to check it
+  printf("%-10s %10s %8s %8s %10s %10s\n", "cache", "jobs ms", "hits",
+         "misses", "evictions", "cached MB");
+  int failures = 0;
+  for (uint32_t cached = 0; cached < 2; cached++) {
+    double jobMilliseconds = 0.0;
+    for (const Job &job : jobs) {
+      VkBuffer resultBuffer;
+      const auto start = std::chrono::steady_clock::now();
+      error = runJob(job, cached ? &cache : nullptr, &resultBuffer);
+      if (error) {
+        return error;
+      }
+      jobMilliseconds += millisecondsSince(start);
+
+      double milliseconds;
+      error = submit(
+          [&] {
+            VkMemoryBarrier memoryBarrier = {};
+            memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+            memoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            vkCmdPipelineBarrier(commandBuffer,
+                                 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                 VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1,
+                                 &memoryBarrier, 0, nullptr, 0, nullptr);
+            VkBufferCopy region = {0, 0, bufferSize};
+            vkCmdCopyBuffer(commandBuffer, resultBuffer,
+                            hostBuffers[READ_BACK], 1, &region);
+          },
+          &milliseconds);
+      if (error) {
+        return error;
+      }
+      const std::vector<int32_t> &a = inputsA[job.pair];
+      const std::vector<int32_t> &b = inputsB[job.pair];
+      for (uint32_t index = 0; index < elementCount; index++) {
+        const int32_t expected = job.operation == MULTIPLY
+                                     ? a[index] * b[index]
+                                     : a[index] + b[index];
+        if (readBackData[index] != expected) {
+          fprintf(stderr, "%s of pair %u [%u] is '%d' not '%d'!\n",
+                  operationNames[job.operation], job.pair, index,
+                  readBackData[index], expected);
+          failures++;
+          break;
+        }
+      }
+    }
+    printf("%-10s %10.3f %8u %8u %10u %10.2f\n", cached ? "on" : "off",
+           jobMilliseconds, cache.hits, cache.misses, cache.evictions,
+           cache.size * 1e-6);
+  }
+  vkUnmapMemory(device, hostMemory);
+
+  destroyResultCache(cache);
+  if (queryPool) {
+    vkDestroyQueryPool(device, queryPool, nullptr);
+  }
+  vkDestroyCommandPool(device, commandPool, nullptr);
+  vkFreeMemory(device, hostMemory, nullptr);
+  vkFreeMemory(device, deviceMemory, nullptr);
+  for (auto buffer : hostBuffers) {
+    vkDestroyBuffer(device, buffer, nullptr);
+  }
+  for (auto buffer : deviceBuffers) {
+    vkDestroyBuffer(device, buffer, nullptr);
+  }
+  vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+  for (auto pipeline : pipelines) {
+    vkDestroyPipeline(device, pipeline, nullptr);
+  }
+  vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+  vkDestroyDescriptorSetLayout(device, setLayout, nullptr);
+  vkDestroyDevice(device, nullptr);
+  vkDestroyInstance(instance, nullptr);
+
+  if (failures) {
+    return 1;
+  }
+  printf("success\n");
+
+  return 0;
+}
@@ -0,0 +1,936 @@
+#include <vulkan/vulkan.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+// load a SPIR-V binary from disc
+std::vector<char> loadShaderCode(const char *filename) {
+  std::vector<char> shaderCode;
+  if (FILE *fp = fopen(filename, "rb")) {
+    char buf[1024];
+    while (size_t len = fread(buf, 1, sizeof(buf), fp)) {
+      shaderCode.insert(shaderCode.end(), buf, buf + len);
+    }
+    fclose(fp);
+  }
+  return shaderCode;
+}
+
+// search for compatible memory properties and return the memory type index
+int32_t findMemoryTypeFromProperties(
+    uint32_t memoryTypeBits, VkPhysicalDeviceMemoryProperties properties,
+    VkMemoryPropertyFlags requiredProperties) {
+  assert(properties.memoryTypeCount < 32u);
+  for (uint32_t index = 0; index < properties.memoryTypeCount; ++index) {
+    if (memoryTypeBits & (1u << index) &&
+        // Find the first memory type that supports all the required flags.
+        ((properties.memoryTypes[index].propertyFlags & requiredProperties) ==
+         requiredProperties)) {
+      return (int32_t)index;
+    }
+  }
+  return -1;
+}
+
+// create a compute pipeline from a SPIR-V binary found in SHADER_PATH
+VkResult createComputePipeline(VkDevice device, VkPipelineLayout layout,
+                               const char *filename,
+                               const VkSpecializationInfo *specializationInfo,
+                               VkPipeline *pipeline) {
+  auto shaderCode =
+      loadShaderCode((std::string(SHADER_PATH) + filename).c_str());
+  if (shaderCode.empty()) {
+    fprintf(stderr, "failed to load '%s'\n", filename);
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
+  shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  shaderModuleCreateInfo.pCode =
+      reinterpret_cast<uint32_t *>(shaderCode.data());
+  shaderModuleCreateInfo.codeSize = shaderCode.size();
+  VkShaderModule shaderModule = VK_NULL_HANDLE;
+  VkResult error = vkCreateShaderModule(device, &shaderModuleCreateInfo,
+                                        nullptr, &shaderModule);
+  if (error) {
+    return error;
+  }
+  VkComputePipelineCreateInfo pipelineCreateInfo = {};
+  pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineCreateInfo.stage.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipelineCreateInfo.stage.module = shaderModule;
+  pipelineCreateInfo.stage.pName = "main";
+  pipelineCreateInfo.stage.pSpecializationInfo = specializationInfo;
+  pipelineCreateInfo.layout = layout;
+  error = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1,
+                                   &pipelineCreateInfo, nullptr, pipeline);
+  vkDestroyShaderModule(device, shaderModule, nullptr);
+  return error;
+}
+
+// a square matrix in compressed sparse row format
+struct CsrMatrix {
+  uint32_t rows;
+  std::vector<uint32_t> rowOffsets;
+  std::vector<uint32_t> columnIndices;
+  std::vector<float> values;
+};
+
+// row length statistics used to choose how to multiply a matrix
+struct RowStatistics {
+  double mean;
+  double deviation;
+  uint32_t max;
+};
+
+RowStatistics analyzeRows(const CsrMatrix &matrix) {
+  RowStatistics statistics = {};
+  double sumOfSquares = 0.0;
+  for (uint32_t row = 0; row < matrix.rows; row++) {
+    const uint32_t length =
+        matrix.rowOffsets[row + 1] - matrix.rowOffsets[row];
+    statistics.mean += length;
+    sumOfSquares += (double)length * length;
+    statistics.max = std::max(statistics.max, length);
+  }
+  statistics.mean /= matrix.rows;
+  statistics.deviation = sqrt(
+      std::max(sumOfSquares / matrix.rows - statistics.mean * statistics.mean,
+               0.0));
+  return statistics;
+}
+
+enum SpmvFormat { CSR_VECTOR, CSR_MERGE, ELL, FORMAT_COUNT };
+
+struct SpmvPlan {
+  SpmvFormat format;
+  uint32_t lanesPerRow;  // CSR_VECTOR
+  uint32_t ellWidth;     // ELL
+};
+
+// mirrors the push constant block shared by the shaders
+struct SpmvParams {
+  uint32_t rows;
+  uint32_t lanesPerRow;
+  uint32_t itemsPerThread;
+  uint32_t threadCount;
+  uint32_t ellWidth;
+};
+
+// the shaders share a pipeline layout whose descriptor set binds the CSR row
+// offsets, column indices and values, the ELL columns and values, x, y, the
+// merge path carries, then b and the inverse diagonal for the Jacobi update
+struct Spmv {
+  VkPipelineLayout pipelineLayout;
+  VkPipeline vector;
+  VkPipeline merge[2];  // indexed by the fixup constant
+  VkPipeline ell;
+  VkPipeline jacobi;
+  uint32_t subgroupSize;
+  uint32_t maxGroupCount;
+};
+
+const uint32_t localSize = 256;
+// items, nonzeros or row ends, consumed by each invocation of the merge path
+// kernel
+const uint32_t itemsPerThread = 16;
+
+uint32_t divideRoundUp(uint32_t value, uint32_t divisor) {
+  return (value + divisor - 1) / divisor;
+}
+
+uint32_t nextPowerOfTwo(uint32_t value) {
+  uint32_t power = 1;
+  while (power < value) {
+    power *= 2;
+  }
+  return power;
+}
+
+// fill in the parameters of the given format for a matrix
+SpmvPlan planSpmv(SpmvFormat format, const RowStatistics &statistics,
+                  uint32_t subgroupSize) {
+  SpmvPlan plan = {};
+  plan.format = format;
+  // enough lanes to cover a typical row in one step
+  plan.lanesPerRow = std::min(
+      nextPowerOfTwo((uint32_t)ceil(statistics.mean)), subgroupSize);
+  plan.ellWidth = statistics.max;
+  return plan;
+}
+
+// choose the format from the row length statistics
+SpmvPlan planSpmv(const RowStatistics &statistics, uint32_t subgroupSize) {
+  // padding every row to the longest costs little when the rows are of
+  // similar length, ELL then needs no row offsets and its loads coalesce
+  if (statistics.max == 0 || statistics.mean / statistics.max >= 0.75) {
+    return planSpmv(ELL, statistics, subgroupSize);
+  }
+  // with very uneven rows most subgroups of the vector kernel sit idle while
+  // a few work through the longest rows, the merge path gives every
+  // invocation an equal share of the work instead
+  if (statistics.deviation > statistics.mean ||
+      statistics.max > 32 * statistics.mean) {
+    return planSpmv(CSR_MERGE, statistics, subgroupSize);
+  }
+  return planSpmv(CSR_VECTOR, statistics, subgroupSize);
+}
+
+// ELL pads every row to the longest, only use it when that at most doubles
+// the storage
+bool ellSuitable(const CsrMatrix &matrix, const RowStatistics &statistics) {
+  return (uint64_t)matrix.rows * statistics.max <= 2 * matrix.values.size();
+}
+
+// convert to ELL with entry k of each row stored at k * rows + row
+void convertToEll(const CsrMatrix &matrix, uint32_t width,
+                  uint32_t *ellColumns, float *ellValues) {
+  for (uint32_t row = 0; row < matrix.rows; row++) {
+    const uint32_t begin = matrix.rowOffsets[row];
+    const uint32_t length = matrix.rowOffsets[row + 1] - begin;
+    for (uint32_t entry = 0; entry < width; entry++) {
+      const uint32_t index = entry * matrix.rows + row;
+      ellColumns[index] =
+          entry < length ? matrix.columnIndices[begin + entry] : row;
+      ellValues[index] = entry < length ? matrix.values[begin + entry] : 0.0f;
+    }
+  }
+}
+
+void recordComputeBarrier(VkCommandBuffer commandBuffer) {
+  VkMemoryBarrier memoryBarrier = {};
+  memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  memoryBarrier.dstAccessMask =
+      VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1,
+                       &memoryBarrier, 0, nullptr, 0, nullptr);
+}
+
+// y = A * x, the matrix must already be in the buffers of the plan's format
+void recordSpmv(VkCommandBuffer commandBuffer, const Spmv &spmv,
+                const SpmvPlan &plan, uint32_t rows, uint32_t nonzeros) {
+  SpmvParams params = {};
+  params.rows = rows;
+  params.lanesPerRow = plan.lanesPerRow;
+  params.itemsPerThread = itemsPerThread;
+  params.ellWidth = plan.ellWidth;
+  VkPipeline pipeline;
+  uint32_t groupCount;
+  switch (plan.format) {
+    case CSR_VECTOR:
+      pipeline = spmv.vector;
+      groupCount = divideRoundUp(rows, localSize / plan.lanesPerRow);
+      break;
+    case CSR_MERGE:
+      pipeline = spmv.merge[0];
+      params.threadCount = divideRoundUp(rows + nonzeros, itemsPerThread);
+      groupCount = divideRoundUp(params.threadCount, localSize);
+      break;
+    default:
+      pipeline = spmv.ell;
+      groupCount = divideRoundUp(rows, localSize);
+      break;
+  }
+  groupCount = std::min(groupCount, spmv.maxGroupCount);
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+  vkCmdPushConstants(commandBuffer, spmv.pipelineLayout,
+                     VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(SpmvParams),
+                     &params);
+  vkCmdDispatch(commandBuffer, groupCount, 1, 1);
+  if (plan.format == CSR_MERGE) {
+    recordComputeBarrier(commandBuffer);
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                      spmv.merge[1]);
+    vkCmdDispatch(commandBuffer, groupCount, 1, 1);
+  }
+}
+
+// x += (b - y) / diag(A), following recordSpmv
+void recordJacobiUpdate(VkCommandBuffer commandBuffer, const Spmv &spmv,
+                        uint32_t rows) {
+  SpmvParams params = {};
+  params.rows = rows;
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                    spmv.jacobi);
+  vkCmdPushConstants(commandBuffer, spmv.pipelineLayout,
+                     VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(SpmvParams),
+                     &params);
+  vkCmdDispatch(commandBuffer,
+                std::min(divideRoundUp(rows, localSize), spmv.maxGroupCount),
+                1, 1);
+}
+
+uint32_t nextRandom(uint32_t &seed) {
+  seed = seed * 1664525u + 1013904223u;
+  return seed >> 8;
+}
+
+// uniformly distributed in [-1, 1)
+float randomValue(uint32_t &seed) {
+  return (float)nextRandom(seed) / (float)(1 << 23) - 1.0f;
+}
+
+// the 5 point Laplacian of a size by size grid shifted to a diagonal of 5,
+// it is strictly diagonally dominant so Jacobi iteration converges quickly
+CsrMatrix makeShiftedLaplacian(uint32_t size) {
+  CsrMatrix matrix;
+  matrix.rows = size * size;
+  matrix.rowOffsets.push_back(0);
+  for (uint32_t i = 0; i < size; i++) {
+    for (uint32_t j = 0; j < size; j++) {
+      const uint32_t row = i * size + j;
+      matrix.columnIndices.push_back(row);
+      matrix.values.push_back(5.0f);
+      const int64_t neighbours[4][2] = {
+          {i - 1ll, j}, {i + 1ll, j}, {i, j - 1ll}, {i, j + 1ll}};
+      for (auto &neighbour : neighbours) {
+        if (neighbour[0] >= 0 && neighbour[0] < size && neighbour[1] >= 0 &&
+            neighbour[1] < size) {
+          matrix.columnIndices.push_back(neighbour[0] * size + neighbour[1]);
+          matrix.values.push_back(-1.0f);
+        }
+      }
+      matrix.rowOffsets.push_back(matrix.columnIndices.size());
+    }
+  }
+  return matrix;
+}
+
+// a random matrix with a diagonal and row lengths chosen by lengthOf
+template <class LengthOf>
+CsrMatrix makeRandomMatrix(uint32_t rows, uint32_t &seed, LengthOf lengthOf) {
+  CsrMatrix matrix;
+  matrix.rows = rows;
+  matrix.rowOffsets.push_back(0);
+  for (uint32_t row = 0; row < rows; row++) {
+    const uint32_t length = std::max(lengthOf(seed), 1u);
+    matrix.columnIndices.push_back(row);
+    matrix.values.push_back(randomValue(seed) + 2.0f);
+    for (uint32_t entry = 1; entry < length; entry++) {
+      matrix.columnIndices.push_back(nextRandom(seed) % rows);
+      matrix.values.push_back(randomValue(seed));
+    }
+    matrix.rowOffsets.push_back(matrix.columnIndices.size());
+  }
+  return matrix;
+}
+
+void hostSpmv(const CsrMatrix &matrix, const float *x, double *y,
+              double *magnitudes) {
+  for (uint32_t row = 0; row < matrix.rows; row++) {
+    double sum = 0.0;
+    double magnitude = 0.0;
+    for (uint32_t index = matrix.rowOffsets[row];
+         index < matrix.rowOffsets[row + 1]; index++) {
+      const double product =
+          (double)matrix.values[index] * x[matrix.columnIndices[index]];
+      sum += product;
+      magnitude += fabs(product);
+    }
+    y[row] = sum;
+    magnitudes[row] = magnitude;
+  }
+}
+
+int main() {
+  VkApplicationInfo applicationInfo = {};
+  applicationInfo.pApplicationName = "Vulkan SpMV example";
+  // subgroup operations are core in Vulkan 1.1
+  applicationInfo.apiVersion = VK_API_VERSION_1_1;
+
+  VkInstanceCreateInfo instanceCreateInfo = {};
+  instanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+  instanceCreateInfo.pApplicationInfo = &applicationInfo;
+#ifdef ENABLE_LAYERS
+  // without a debug report callback, see vector_add, the validation layer
+  // prints its messages to stdout
+  std::vector<const char *> enabledLayerNames{"VK_LAYER_KHRONOS_validation"};
+  instanceCreateInfo.enabledLayerCount = enabledLayerNames.size();
+  instanceCreateInfo.ppEnabledLayerNames = enabledLayerNames.data();
+#endif
+
+  VkInstance instance = VK_NULL_HANDLE;
+  VkResult error = vkCreateInstance(&instanceCreateInfo, nullptr, &instance);
+  if (error) {
+    return error;
+  }
+
+  uint32_t count;
+  error = vkEnumeratePhysicalDevices(instance, &count, nullptr);
+  if (error) {
+    return error;
+  }
+  std::vector<VkPhysicalDevice> physicalDevices(count);
+  error = vkEnumeratePhysicalDevices(instance, &count, physicalDevices.data());
+  if (error) {
+    return error;
+  }
+
+  // find a Vulkan 1.1 physical device with a compute queue which supports
+  // subgroup arithmetic and shuffles in compute shaders
+  const VkSubgroupFeatureFlags requiredSubgroupOperations =
+      VK_SUBGROUP_FEATURE_BASIC_BIT | VK_SUBGROUP_FEATURE_ARITHMETIC_BIT |
+      VK_SUBGROUP_FEATURE_SHUFFLE_BIT;
+  VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+  uint32_t queueFamilyIndex = 0;
+  uint32_t timestampValidBits = 0;
+  VkPhysicalDeviceSubgroupProperties subgroupProperties = {};
+  subgroupProperties.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES;
+  VkPhysicalDeviceProperties2 properties = {};
+  properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+  properties.pNext = &subgroupProperties;
+  for (auto device : physicalDevices) {
+    vkGetPhysicalDeviceProperties(device, &properties.properties);
+    if (properties.properties.apiVersion < VK_API_VERSION_1_1) {
+      continue;
+    }
+    vkGetPhysicalDeviceProperties2(device, &properties);
+    if (!(subgroupProperties.supportedStages & VK_SHADER_STAGE_COMPUTE_BIT) ||
+        (subgroupProperties.supportedOperations &
+         requiredSubgroupOperations) != requiredSubgroupOperations) {
+      continue;
+    }
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilyProperties(count);
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count,
+                                             queueFamilyProperties.data());
+    for (uint32_t index = 0; index < count; index++) {
+      if (queueFamilyProperties[index].queueFlags & VK_QUEUE_COMPUTE_BIT) {
+        physicalDevice = device;
+        queueFamilyIndex = index;
+        timestampValidBits = queueFamilyProperties[index].timestampValidBits;
+        break;
+      }
+    }
+    if (physicalDevice) {
+      break;
+    }
+  }
+  if (!physicalDevice) {
+    fprintf(stderr, "no device supports subgroup arithmetic and shuffles\n");
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+  }
+  const VkPhysicalDeviceLimits &limits = properties.properties.limits;
+
+  VkDeviceQueueCreateInfo queueCreateInfo = {};
+  queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+  queueCreateInfo.queueCount = 1;
+  queueCreateInfo.queueFamilyIndex = queueFamilyIndex;
+  float queuePriority = 1.0f;
+  queueCreateInfo.pQueuePriorities = &queuePriority;
+
+  VkDeviceCreateInfo deviceCreateInfo = {};
+  deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+  deviceCreateInfo.queueCreateInfoCount = 1;
+  deviceCreateInfo.pQueueCreateInfos = &queueCreateInfo;
+  VkDevice device = VK_NULL_HANDLE;
+  error = vkCreateDevice(physicalDevice, &deviceCreateInfo, nullptr, &device);
+  if (error) {
+    return error;
+  }
+
+  VkQueue queue;
+  vkGetDeviceQueue(device, queueFamilyIndex, 0, &queue);
+
+  enum {
+    ROW_OFFSETS,
+    COLUMN_INDICES,
+    VALUES,
+    ELL_COLUMNS,
+    ELL_VALUES,
+    X,
+    Y,
+    CARRIES,
+    B,
+    INVERSE_DIAGONAL,
+    BUFFER_COUNT
+  };
+
+  std::vector<VkDescriptorSetLayoutBinding> layoutBindings;
+  VkDescriptorSetLayoutBinding layoutBinding = {};
+  layoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  layoutBinding.descriptorCount = 1;
+  layoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  for (uint32_t binding = 0; binding < BUFFER_COUNT; binding++) {
+    layoutBinding.binding = binding;
+    layoutBindings.push_back(layoutBinding);
+  }
+
+  VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo = {};
+  setLayoutCreateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  setLayoutCreateInfo.bindingCount = layoutBindings.size();
+  setLayoutCreateInfo.pBindings = layoutBindings.data();
+  VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+  error = vkCreateDescriptorSetLayout(device, &setLayoutCreateInfo, nullptr,
+                                      &setLayout);
+  if (error) {
+    return error;
+  }
+
+  VkPushConstantRange pushConstantRange = {};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(SpmvParams);
+
+  Spmv spmv = {};
+  spmv.subgroupSize = subgroupProperties.subgroupSize;
+  spmv.maxGroupCount = limits.maxComputeWorkGroupCount[0];
+  VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+  pipelineLayoutCreateInfo.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutCreateInfo.setLayoutCount = 1;
+  pipelineLayoutCreateInfo.pSetLayouts = &setLayout;
+  pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+  pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+  error = vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr,
+                                 &spmv.pipelineLayout);
+  if (error) {
+    return error;
+  }
+
+  error = createComputePipeline(device, spmv.pipelineLayout,
+                                "spmv_csr_vector.spv", nullptr, &spmv.vector);
+  if (error) {
+    return error;
+  }
+  VkSpecializationMapEntry specializationMapEntry = {};
+  specializationMapEntry.constantID = 0;
+  specializationMapEntry.offset = 0;
+  specializationMapEntry.size = sizeof(VkBool32);
+  for (VkBool32 fixup = VK_FALSE; fixup <= VK_TRUE; fixup++) {
+    VkSpecializationInfo specializationInfo = {};
+    specializationInfo.mapEntryCount = 1;
+    specializationInfo.pMapEntries = &specializationMapEntry;
+    specializationInfo.dataSize = sizeof(VkBool32);
+    specializationInfo.pData = &fixup;
+    error = createComputePipeline(device, spmv.pipelineLayout,
+                                  "spmv_csr_merge.spv", &specializationInfo,
+                                  &spmv.merge[fixup]);
+    if (error) {
+      return error;
+    }
+  }
+  error = createComputePipeline(device, spmv.pipelineLayout, "spmv_ell.spv",
+                                nullptr, &spmv.ell);
+  if (error) {
+    return error;
+  }
+  error = createComputePipeline(device, spmv.pipelineLayout, "jacobi.spv",
+                                nullptr, &spmv.jacobi);
+  if (error) {
+    return error;
+  }
+
+  // rows of similar length, rows whose lengths vary over a wide range, and
+  // the Laplacian, kept last as it is also used to run a Jacobi solve
+  uint32_t seed = 11;
+  const char *names[] = {"uniform", "power law", "laplacian"};
+  std::vector<CsrMatrix> matrices;
+  matrices.push_back(makeRandomMatrix(1 << 17, seed, [](uint32_t &seed) {
+    return 16 + nextRandom(seed) % 33;
+  }));
+  // a Pareto distribution, most rows are short but a few hold thousands
+  matrices.push_back(makeRandomMatrix(1 << 17, seed, [](uint32_t &seed) {
+    return (uint32_t)std::min(
+        2.0 / ((nextRandom(seed) + 1.0) / (1 << 24)), 16384.0);
+  }));
+  matrices.push_back(makeShiftedLaplacian(512));
+  std::vector<RowStatistics> statistics;
+  VkDeviceSize bufferSizes[BUFFER_COUNT] = {};
+  for (auto &matrix : matrices) {
+    statistics.push_back(analyzeRows(matrix));
+    const VkDeviceSize rows = matrix.rows;
+    const VkDeviceSize nonzeros = matrix.values.size();
+    const VkDeviceSize ellEntries =
+        ellSuitable(matrix, statistics.back())
+            ? rows * statistics.back().max
+            : 0;
+    const VkDeviceSize sizes[BUFFER_COUNT] = {
+        sizeof(uint32_t) * (rows + 1),
+        sizeof(uint32_t) * nonzeros,
+        sizeof(float) * nonzeros,
+        sizeof(uint32_t) * ellEntries,
+        sizeof(float) * ellEntries,
+        sizeof(float) * rows,
+        sizeof(float) * rows,
+        2 * sizeof(uint32_t) * divideRoundUp(rows + nonzeros, itemsPerThread),
+        sizeof(float) * rows,
+        sizeof(float) * rows};
+    for (uint32_t index = 0; index < BUFFER_COUNT; index++) {
+      bufferSizes[index] = std::max(bufferSizes[index], sizes[index]);
+    }
+  }
+
+  VkBuffer buffers[BUFFER_COUNT];
+  for (uint32_t index = 0; index < BUFFER_COUNT; index++) {
+    VkBufferCreateInfo bufferCreateInfo = {};
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.size = bufferSizes[index];
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    bufferCreateInfo.queueFamilyIndexCount = 1;
+    bufferCreateInfo.pQueueFamilyIndices = &queueFamilyIndex;
+    error = vkCreateBuffer(device, &bufferCreateInfo, nullptr, &buffers[index]);
+    if (error) {
+      return error;
+    }
+  }
+
+  VkDeviceSize bufferOffsets[BUFFER_COUNT];
+  VkDeviceSize requiredMemorySize = 0;
+  VkMemoryRequirements memoryRequirements;
+  for (uint32_t index = 0; index < BUFFER_COUNT; index++) {
+    vkGetBufferMemoryRequirements(device, buffers[index], &memoryRequirements);
+    const VkDeviceSize alignment = memoryRequirements.alignment;
+    requiredMemorySize =
+        (requiredMemorySize + alignment - 1) / alignment * alignment;
+    bufferOffsets[index] = requiredMemorySize;
+    requiredMemorySize += memoryRequirements.size;
+  }
+
+  VkPhysicalDeviceMemoryProperties memoryProperties;
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+  auto memoryTypeIndex = findMemoryTypeFromProperties(
+      memoryRequirements.memoryTypeBits, memoryProperties,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  if (0 > memoryTypeIndex) {
+    return ~42;  // returns -43
+  }
+
+  VkMemoryAllocateInfo allocateInfo = {};
+  allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocateInfo.allocationSize = requiredMemorySize;
+  allocateInfo.memoryTypeIndex = memoryTypeIndex;
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  error = vkAllocateMemory(device, &allocateInfo, nullptr, &memory);
+  if (error) {
+    return error;
+  }
+  for (uint32_t index = 0; index < BUFFER_COUNT; index++) {
+    error = vkBindBufferMemory(device, buffers[index], memory,
+                               bufferOffsets[index]);
+    if (error) {
+      return error;
+    }
+  }
+
+  VkDescriptorPoolSize poolSize = {};
+  poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  poolSize.descriptorCount = layoutBindings.size();
+  VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = {};
+  descriptorPoolCreateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  descriptorPoolCreateInfo.maxSets = 1;
+  descriptorPoolCreateInfo.poolSizeCount = 1;
+  descriptorPoolCreateInfo.pPoolSizes = &poolSize;
+  VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+  error = vkCreateDescriptorPool(device, &descriptorPoolCreateInfo, nullptr,
+                                 &descriptorPool);
+  if (error) {
+    return error;
+  }
+
+  VkDescriptorSetAllocateInfo descriptorSetAllocateInfo = {};
+  descriptorSetAllocateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  descriptorSetAllocateInfo.descriptorPool = descriptorPool;
+  descriptorSetAllocateInfo.descriptorSetCount = 1;
+  descriptorSetAllocateInfo.pSetLayouts = &setLayout;
+  VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+  error = vkAllocateDescriptorSets(device, &descriptorSetAllocateInfo,
+                                   &descriptorSet);
+  if (error) {
+    return error;
+  }
+
+  VkDescriptorBufferInfo bufferInfos[BUFFER_COUNT];
+  std::vector<VkWriteDescriptorSet> descriptorSetWrites;
+  VkWriteDescriptorSet writeDescriptorSet = {};
+  writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  writeDescriptorSet.dstSet = descriptorSet;
+  writeDescriptorSet.dstArrayElement = 0;
+  writeDescriptorSet.descriptorCount = 1;
+  writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  for (uint32_t index = 0; index < BUFFER_COUNT; index++) {
+    bufferInfos[index].buffer = buffers[index];
+    bufferInfos[index].offset = 0;
+    bufferInfos[index].range = VK_WHOLE_SIZE;
+    writeDescriptorSet.dstBinding = index;
+    writeDescriptorSet.pBufferInfo = &bufferInfos[index];
+    descriptorSetWrites.push_back(writeDescriptorSet);
+  }
+  vkUpdateDescriptorSets(device, descriptorSetWrites.size(),
+                         descriptorSetWrites.data(), 0, nullptr);
+
+  char *data = nullptr;
+  error = vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0,
+                      reinterpret_cast<void **>(&data));
+  if (error) {
+    return error;
+  }
+  void *mapped[BUFFER_COUNT];
+  for (uint32_t index = 0; index < BUFFER_COUNT; index++) {
+    mapped[index] = data + bufferOffsets[index];
+  }
+  float *xData = static_cast<float *>(mapped[X]);
+  float *yData = static_cast<float *>(mapped[Y]);
+
+  VkQueryPool queryPool = VK_NULL_HANDLE;
+  if (timestampValidBits) {
+    VkQueryPoolCreateInfo queryPoolCreateInfo = {};
+    queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolCreateInfo.queryCount = 2;
+    error = vkCreateQueryPool(device, &queryPoolCreateInfo, nullptr,
+                              &queryPool);
+    if (error) {
+      return error;
+    }
+  }
+
+  VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+  commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+  commandPoolCreateInfo.queueFamilyIndex = queueFamilyIndex;
+  VkCommandPool commandPool = VK_NULL_HANDLE;
+  error = vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr,
+                              &commandPool);
+  if (error) {
+    return error;
+  }
+
+  VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
+  commandBufferAllocateInfo.sType =
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  commandBufferAllocateInfo.commandPool = commandPool;
+  commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  commandBufferAllocateInfo.commandBufferCount = 1;
+  VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+  error = vkAllocateCommandBuffers(device, &commandBufferAllocateInfo,
+                                   &commandBuffer);
+  if (error) {
+    return error;
+  }
+
+  // record the work of function into the command buffer, submit it, wait for
+  // it to complete and return the time between the timestamps in
+  // milliseconds, or 0 if timestamps are not supported
+  auto submit = [&](std::function<void()> function,
+                    double *milliseconds) -> VkResult {
+    VkResult result = vkResetCommandPool(device, commandPool, 0);
+    if (result) {
+      return result;
+    }
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    result = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    if (result) {
+      return result;
+    }
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                            spmv.pipelineLayout, 0, 1, &descriptorSet, 0,
+                            nullptr);
+    if (queryPool) {
+      vkCmdResetQueryPool(commandBuffer, queryPool, 0, 2);
+      vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                          queryPool, 0);
+    }
+    function();
+    if (queryPool) {
+      vkCmdWriteTimestamp(commandBuffer,
+                          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, queryPool, 1);
+    }
+    result = vkEndCommandBuffer(commandBuffer);
+    if (result) {
+      return result;
+    }
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    result = vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+    if (result) {
+      return result;
+    }
+    vkQueueWaitIdle(queue);
+
+    *milliseconds = 0.0;
+    if (queryPool) {
+      uint64_t timestamps[2];
+      result = vkGetQueryPoolResults(
+          device, queryPool, 0, 2, sizeof(timestamps), timestamps,
+          sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+      if (result) {
+        return result;
+      }
+      *milliseconds =
+          (timestamps[1] - timestamps[0]) * limits.timestampPeriod * 1e-6;
+    }
+    return VK_SUCCESS;
+  };
+
+  // time every format on every matrix, the automatic choice is marked with a
+  // star, formats which do not suit a matrix are skipped
+  const uint32_t repetitions = 10;
+  const char *formatNames[FORMAT_COUNT] = {"csr vector", "csr merge", "ell"};
+  printf("%-10s %8s %8s %8s", "matrix", "rows", "mean", "max");
+  for (auto formatName : formatNames) {
+    printf(" %12s", formatName);
+  }
+  printf("   (ms per multiply)\n");
+  int failures = 0;
+  for (uint32_t index = 0; index < matrices.size(); index++) {
+    const CsrMatrix &matrix = matrices[index];
+    const uint32_t nonzeros = matrix.values.size();
+    const bool useEll = ellSuitable(matrix, statistics[index]);
+    memcpy(mapped[ROW_OFFSETS], matrix.rowOffsets.data(),
+           sizeof(uint32_t) * matrix.rowOffsets.size());
+    memcpy(mapped[COLUMN_INDICES], matrix.columnIndices.data(),
+           sizeof(uint32_t) * nonzeros);
+    memcpy(mapped[VALUES], matrix.values.data(), sizeof(float) * nonzeros);
+    if (useEll) {
+      convertToEll(matrix, statistics[index].max,
+                   static_cast<uint32_t *>(mapped[ELL_COLUMNS]),
+                   static_cast<float *>(mapped[ELL_VALUES]));
+    }
+    for (uint32_t row = 0; row < matrix.rows; row++) {
+      xData[row] = randomValue(seed);
+    }
+    std::vector<double> expected(matrix.rows);
+    std::vector<double> magnitudes(matrix.rows);
+    hostSpmv(matrix, xData, expected.data(), magnitudes.data());
+
+    const SpmvFormat chosen =
+        planSpmv(statistics[index], spmv.subgroupSize).format;
+    printf("%-10s %8u %8.1f %8u", names[index], matrix.rows,
+           statistics[index].mean, statistics[index].max);
+    for (uint32_t format = 0; format < FORMAT_COUNT; format++) {
+      if (format == ELL && !useEll) {
+        printf(" %12s", "-");
+        continue;
+      }
+      const SpmvPlan plan = planSpmv(SpmvFormat(format), statistics[index],
+                                     spmv.subgroupSize);
+      memset(yData, 0, sizeof(float) * matrix.rows);
+      double milliseconds;
+      error = submit(
+          [&] {
+            for (uint32_t repetition = 0; repetition < repetitions;
+                 repetition++) {
+              if (repetition) {
+                recordComputeBarrier(commandBuffer);
+              }
+              recordSpmv(commandBuffer, spmv, plan, matrix.rows, nonzeros);
+            }
+          },
+          &milliseconds);
+      if (error) {
+        return error;
+      }
+      printf(" %11.3f%c", milliseconds / repetitions,
+             format == chosen ? '*' : ' ');
+
+      for (uint32_t row = 0; row < matrix.rows; row++) {
+        // float accumulation error grows with the sum of the magnitudes
+        if (!(fabs(yData[row] - expected[row]) <=
+              1e-5 * (magnitudes[row] + 1.0))) {
+          fprintf(stderr, "\n%s y[%u] is '%f' not '%f'!\n",
+                  formatNames[format], row, yData[row], expected[row]);
+          failures++;
+          break;
+        }
+      }
+    }
+    printf("\n");
+  }
+
+  // solve A * x = b with Jacobi iteration on the Laplacian, which is still in
+  // the buffers, the whole solve is a single submission with no transfers
+  // between iterations
+  const CsrMatrix &laplacian = matrices.back();
+  const SpmvPlan plan = planSpmv(statistics.back(), spmv.subgroupSize);
+  std::vector<float> solution(laplacian.rows);
+  for (auto &value : solution) {
+    value = randomValue(seed);
+  }
+  std::vector<double> b(laplacian.rows);
+  std::vector<double> magnitudes(laplacian.rows);
+  hostSpmv(laplacian, solution.data(), b.data(), magnitudes.data());
+  float *bData = static_cast<float *>(mapped[B]);
+  float *inverseDiagonalData = static_cast<float *>(mapped[INVERSE_DIAGONAL]);
+  for (uint32_t row = 0; row < laplacian.rows; row++) {
+    bData[row] = b[row];
+    // the diagonal is the first entry of each row
+    inverseDiagonalData[row] =
+        1.0f / laplacian.values[laplacian.rowOffsets[row]];
+    xData[row] = 0.0f;
+  }
+  const uint32_t iterations = 100;
+  double milliseconds;
+  error = submit(
+      [&] {
+        for (uint32_t iteration = 0; iteration < iterations; iteration++) {
+          if (iteration) {
+            recordComputeBarrier(commandBuffer);
+          }
+          recordSpmv(commandBuffer, spmv, plan, laplacian.rows,
+                     laplacian.values.size());
+          recordComputeBarrier(commandBuffer);
+          recordJacobiUpdate(commandBuffer, spmv, laplacian.rows);
+        }
+      },
+      &milliseconds);
+  if (error) {
+    return error;
+  }
+  double maxError = 0.0;
+  for (uint32_t row = 0; row < laplacian.rows; row++) {
+    maxError = std::max(maxError, (double)fabs(xData[row] - solution[row]));
+  }
+  printf("jacobi: %u iterations using %s in %.3f ms, max error %g\n",
+         iterations, formatNames[plan.format], milliseconds, maxError);
+  if (!(maxError < 1e-4)) {
+    failures++;
+  }
+  vkUnmapMemory(device, memory);
+
+  if (queryPool) {
+    vkDestroyQueryPool(device, queryPool, nullptr);
+  }
+  vkDestroyCommandPool(device, commandPool, nullptr);
+  vkFreeMemory(device, memory, nullptr);
+  for (auto buffer : buffers) {
+    vkDestroyBuffer(device, buffer, nullptr);
+  }
+  vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+  vkDestroyPipeline(device, spmv.jacobi, nullptr);
+  vkDestroyPipeline(device, spmv.ell, nullptr);
+  vkDestroyPipeline(device, spmv.merge[1], nullptr);
+  vkDestroyPipeline(device, spmv.merge[0], nullptr);
+  vkDestroyPipeline(device, spmv.vector, nullptr);
+  vkDestroyPipelineLayout(device, spmv.pipelineLayout, nullptr);
+  vkDestroyDescriptorSetLayout(device, setLayout, nullptr);
+  vkDestroyDevice(device, nullptr);
+  vkDestroyInstance(instance, nullptr);
+
+  if (failures) {
+    return 1;
+  }
+  printf("success\n");
+
+  return 0;
+}
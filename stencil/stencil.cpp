@@ -0,0 +1,726 @@
+#include <vulkan/vulkan.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+// load a SPIR-V binary from disc
+std::vector<char> loadShaderCode(const char *filename) {
+  std::vector<char> shaderCode;
+  if (FILE *fp = fopen(filename, "rb")) {
+    char buf[1024];
+    while (size_t len = fread(buf, 1, sizeof(buf), fp)) {
+      shaderCode.insert(shaderCode.end(), buf, buf + len);
+    }
+    fclose(fp);
+  }
+  return shaderCode;
+}
+
+// search for compatible memory properties and return the memory type index
+int32_t findMemoryTypeFromProperties(
+    uint32_t memoryTypeBits, VkPhysicalDeviceMemoryProperties properties,
+    VkMemoryPropertyFlags requiredProperties) {
+  assert(properties.memoryTypeCount < 32u);
+  for (uint32_t index = 0; index < properties.memoryTypeCount; ++index) {
+    if (memoryTypeBits & (1u << index) &&
+        // Find the first memory type that supports all the required flags.
+        ((properties.memoryTypes[index].propertyFlags & requiredProperties) ==
+         requiredProperties)) {
+      return (int32_t)index;
+    }
+  }
+  return -1;
+}
+
+// create a compute pipeline from a SPIR-V binary found in SHADER_PATH
+VkResult createComputePipeline(VkDevice device, VkPipelineLayout layout,
+                               const char *filename,
+                               const VkSpecializationInfo *specializationInfo,
+                               VkPipeline *pipeline) {
+  auto shaderCode =
+      loadShaderCode((std::string(SHADER_PATH) + filename).c_str());
+  if (shaderCode.empty()) {
+    fprintf(stderr, "failed to load '%s'\n", filename);
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
+  shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  shaderModuleCreateInfo.pCode =
+      reinterpret_cast<uint32_t *>(shaderCode.data());
+  shaderModuleCreateInfo.codeSize = shaderCode.size();
+  VkShaderModule shaderModule = VK_NULL_HANDLE;
+  VkResult error = vkCreateShaderModule(device, &shaderModuleCreateInfo,
+                                        nullptr, &shaderModule);
+  if (error) {
+    return error;
+  }
+  VkComputePipelineCreateInfo pipelineCreateInfo = {};
+  pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineCreateInfo.stage.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipelineCreateInfo.stage.module = shaderModule;
+  pipelineCreateInfo.stage.pName = "main";
+  pipelineCreateInfo.stage.pSpecializationInfo = specializationInfo;
+  pipelineCreateInfo.layout = layout;
+  error = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1,
+                                   &pipelineCreateInfo, nullptr, pipeline);
+  vkDestroyShaderModule(device, shaderModule, nullptr);
+  return error;
+}
+
+// taps fill the rest of the 128 bytes of push constants every device
+// supports, enough for a 5 by 5 filter or a 1D filter of radius 12
+const uint32_t maxTaps = 25;
+
+// mirrors the push constant block shared by both shaders
+struct StencilParams {
+  uint32_t width;
+  uint32_t height;
+  float taps[maxTaps];
+};
+
+// the shaders share a pipeline layout whose descriptor set binds the input
+// then the output, each radius needs its own pipeline as the radii size the
+// shared memory tiles, they are created on first use and cached
+struct Stencil {
+  VkDevice device;
+  VkPipelineLayout pipelineLayout;
+  std::map<uint32_t, VkPipeline> pipelines;
+  uint32_t maxGroupCount[2];
+};
+
+uint32_t divideRoundUp(uint32_t value, uint32_t divisor) {
+  return (value + divisor - 1) / divisor;
+}
+
+VkResult getStencilPipeline(Stencil &stencil, bool twoD, uint32_t radiusX,
+                            uint32_t radiusY, VkPipeline *pipeline) {
+  const uint32_t key = radiusX | radiusY << 8 | (twoD ? 1 : 0) << 16;
+  auto found = stencil.pipelines.find(key);
+  if (found != stencil.pipelines.end()) {
+    *pipeline = found->second;
+    return VK_SUCCESS;
+  }
+  const uint32_t radii[2] = {radiusX, radiusY};
+  VkSpecializationMapEntry specializationMapEntries[2] = {};
+  for (uint32_t index = 0; index < 2; index++) {
+    specializationMapEntries[index].constantID = index;
+    specializationMapEntries[index].offset = sizeof(uint32_t) * index;
+    specializationMapEntries[index].size = sizeof(uint32_t);
+  }
+  VkSpecializationInfo specializationInfo = {};
+  specializationInfo.mapEntryCount = twoD ? 2 : 1;
+  specializationInfo.pMapEntries = specializationMapEntries;
+  specializationInfo.dataSize = sizeof(radii);
+  specializationInfo.pData = radii;
+  VkResult error = createComputePipeline(
+      stencil.device, stencil.pipelineLayout,
+      twoD ? "stencil_2d.spv" : "stencil_1d.spv", &specializationInfo,
+      pipeline);
+  if (error) {
+    return error;
+  }
+  stencil.pipelines[key] = *pipeline;
+  return VK_SUCCESS;
+}
+
+// filter each of the height rows of width elements with 2 * radius + 1 taps,
+// see stencil_1d.comp
+VkResult recordStencil1d(VkCommandBuffer commandBuffer, Stencil &stencil,
+                         VkDescriptorSet descriptorSet, uint32_t width,
+                         uint32_t height, uint32_t radius, const float *taps) {
+  assert(2 * radius + 1 <= maxTaps);
+  VkPipeline pipeline;
+  VkResult error = getStencilPipeline(stencil, false, radius, 0, &pipeline);
+  if (error) {
+    return error;
+  }
+  StencilParams params = {};
+  params.width = width;
+  params.height = height;
+  std::copy(taps, taps + 2 * radius + 1, params.taps);
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                          stencil.pipelineLayout, 0, 1, &descriptorSet, 0,
+                          nullptr);
+  vkCmdPushConstants(commandBuffer, stencil.pipelineLayout,
+                     VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(StencilParams),
+                     &params);
+  // each workgroup covers 1024 elements of a row
+  vkCmdDispatch(commandBuffer,
+                std::min(divideRoundUp(width, 1024), stencil.maxGroupCount[0]),
+                std::min(height, stencil.maxGroupCount[1]), 1);
+  return VK_SUCCESS;
+}
+
+// filter a width by height image with a (2 * radiusX + 1) by
+// (2 * radiusY + 1) filter whose taps are stored row by row, see
+// stencil_2d.comp
+VkResult recordStencil2d(VkCommandBuffer commandBuffer, Stencil &stencil,
+                         VkDescriptorSet descriptorSet, uint32_t width,
+                         uint32_t height, uint32_t radiusX, uint32_t radiusY,
+                         const float *taps) {
+  const uint32_t tapCount = (2 * radiusX + 1) * (2 * radiusY + 1);
+  assert(tapCount <= maxTaps);
+  VkPipeline pipeline;
+  VkResult error =
+      getStencilPipeline(stencil, true, radiusX, radiusY, &pipeline);
+  if (error) {
+    return error;
+  }
+  StencilParams params = {};
+  params.width = width;
+  params.height = height;
+  std::copy(taps, taps + tapCount, params.taps);
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                          stencil.pipelineLayout, 0, 1, &descriptorSet, 0,
+                          nullptr);
+  vkCmdPushConstants(commandBuffer, stencil.pipelineLayout,
+                     VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(StencilParams),
+                     &params);
+  // each workgroup covers a tile of 32 by 32
+  vkCmdDispatch(commandBuffer,
+                std::min(divideRoundUp(width, 32), stencil.maxGroupCount[0]),
+                std::min(divideRoundUp(height, 32), stencil.maxGroupCount[1]),
+                1);
+  return VK_SUCCESS;
+}
+
+void recordComputeBarrier(VkCommandBuffer commandBuffer) {
+  VkMemoryBarrier memoryBarrier = {};
+  memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  memoryBarrier.dstAccessMask =
+      VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1,
+                       &memoryBarrier, 0, nullptr, 0, nullptr);
+}
+
+// the same filter on the host, in double precision
+void hostStencil(const float *input, float *output, uint32_t width,
+                 uint32_t height, uint32_t radiusX, uint32_t radiusY,
+                 const float *taps) {
+  for (int y = 0; y < (int)height; y++) {
+    for (int x = 0; x < (int)width; x++) {
+      double sum = 0.0;
+      for (int ty = 0; ty <= 2 * (int)radiusY; ty++) {
+        const int sy =
+            std::min(std::max(y + ty - (int)radiusY, 0), (int)height - 1);
+        for (int tx = 0; tx <= 2 * (int)radiusX; tx++) {
+          const int sx =
+              std::min(std::max(x + tx - (int)radiusX, 0), (int)width - 1);
+          sum += (double)taps[ty * (2 * radiusX + 1) + tx] *
+                 input[sy * width + sx];
+        }
+      }
+      output[y * width + x] = sum;
+    }
+  }
+}
+
+int main() {
+  VkApplicationInfo applicationInfo = {};
+  applicationInfo.pApplicationName = "Vulkan stencil example";
+  applicationInfo.apiVersion = VK_MAKE_VERSION(1, 0, 0);
+
+  VkInstanceCreateInfo instanceCreateInfo = {};
+  instanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+  instanceCreateInfo.pApplicationInfo = &applicationInfo;
+#ifdef ENABLE_LAYERS
+  // without a debug report callback, see vector_add, the validation layer
+  // prints its messages to stdout
+  std::vector<const char *> enabledLayerNames{"VK_LAYER_KHRONOS_validation"};
+  instanceCreateInfo.enabledLayerCount = enabledLayerNames.size();
+  instanceCreateInfo.ppEnabledLayerNames = enabledLayerNames.data();
+#endif
+
+  VkInstance instance = VK_NULL_HANDLE;
+  VkResult error = vkCreateInstance(&instanceCreateInfo, nullptr, &instance);
+  if (error) {
+    return error;
+  }
+
+  uint32_t count;
+  error = vkEnumeratePhysicalDevices(instance, &count, nullptr);
+  if (error) {
+    return error;
+  }
+  std::vector<VkPhysicalDevice> physicalDevices(count);
+  error = vkEnumeratePhysicalDevices(instance, &count, physicalDevices.data());
+  if (error) {
+    return error;
+  }
+
+  // find the first physical device with a compute queue
+  VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+  uint32_t queueFamilyIndex = 0;
+  uint32_t timestampValidBits = 0;
+  for (auto device : physicalDevices) {
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilyProperties(count);
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count,
+                                             queueFamilyProperties.data());
+    for (uint32_t index = 0; index < count; index++) {
+      if (queueFamilyProperties[index].queueFlags & VK_QUEUE_COMPUTE_BIT) {
+        physicalDevice = device;
+        queueFamilyIndex = index;
+        timestampValidBits = queueFamilyProperties[index].timestampValidBits;
+        break;
+      }
+    }
+    if (physicalDevice) {
+      break;
+    }
+  }
+  if (!physicalDevice) {
+    fprintf(stderr, "no device with a compute queue\n");
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+  }
+
+  VkPhysicalDeviceProperties physicalDeviceProperties;
+  vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties);
+  const VkPhysicalDeviceLimits &limits = physicalDeviceProperties.limits;
+
+  VkDeviceQueueCreateInfo queueCreateInfo = {};
+  queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+  queueCreateInfo.queueCount = 1;
+  queueCreateInfo.queueFamilyIndex = queueFamilyIndex;
+  float queuePriority = 1.0f;
+  queueCreateInfo.pQueuePriorities = &queuePriority;
+
+  VkDeviceCreateInfo deviceCreateInfo = {};
+  deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+  deviceCreateInfo.queueCreateInfoCount = 1;
+  deviceCreateInfo.pQueueCreateInfos = &queueCreateInfo;
+  VkDevice device = VK_NULL_HANDLE;
+  error = vkCreateDevice(physicalDevice, &deviceCreateInfo, nullptr, &device);
+  if (error) {
+    return error;
+  }
+
+  VkQueue queue;
+  vkGetDeviceQueue(device, queueFamilyIndex, 0, &queue);
+
+  // input and output
+  std::vector<VkDescriptorSetLayoutBinding> layoutBindings;
+  VkDescriptorSetLayoutBinding layoutBinding = {};
+  layoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  layoutBinding.descriptorCount = 1;
+  layoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  for (uint32_t binding = 0; binding < 2; binding++) {
+    layoutBinding.binding = binding;
+    layoutBindings.push_back(layoutBinding);
+  }
+
+  VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo = {};
+  setLayoutCreateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  setLayoutCreateInfo.bindingCount = layoutBindings.size();
+  setLayoutCreateInfo.pBindings = layoutBindings.data();
+  VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+  error = vkCreateDescriptorSetLayout(device, &setLayoutCreateInfo, nullptr,
+                                      &setLayout);
+  if (error) {
+    return error;
+  }
+
+  VkPushConstantRange pushConstantRange = {};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(StencilParams);
+
+  Stencil stencil;
+  stencil.device = device;
+  stencil.maxGroupCount[0] = limits.maxComputeWorkGroupCount[0];
+  stencil.maxGroupCount[1] = limits.maxComputeWorkGroupCount[1];
+  VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+  pipelineLayoutCreateInfo.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutCreateInfo.setLayoutCount = 1;
+  pipelineLayoutCreateInfo.pSetLayouts = &setLayout;
+  pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+  pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+  error = vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr,
+                                 &stencil.pipelineLayout);
+  if (error) {
+    return error;
+  }
+
+  const uint32_t width = 2048;
+  const uint32_t height = 2048;
+  const uint32_t elementCount = width * height;
+  enum { IMAGE, TEMPORARY, RESULT, BUFFER_COUNT };
+  VkBuffer buffers[BUFFER_COUNT];
+  for (uint32_t index = 0; index < BUFFER_COUNT; index++) {
+    VkBufferCreateInfo bufferCreateInfo = {};
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.size = sizeof(float) * elementCount;
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    bufferCreateInfo.queueFamilyIndexCount = 1;
+    bufferCreateInfo.pQueueFamilyIndices = &queueFamilyIndex;
+    error = vkCreateBuffer(device, &bufferCreateInfo, nullptr, &buffers[index]);
+    if (error) {
+      return error;
+    }
+  }
+
+  VkDeviceSize bufferOffsets[BUFFER_COUNT];
+  VkDeviceSize requiredMemorySize = 0;
+  VkMemoryRequirements memoryRequirements;
+  for (uint32_t index = 0; index < BUFFER_COUNT; index++) {
+    vkGetBufferMemoryRequirements(device, buffers[index], &memoryRequirements);
+    const VkDeviceSize alignment = memoryRequirements.alignment;
+    requiredMemorySize =
+        (requiredMemorySize + alignment - 1) / alignment * alignment;
+    bufferOffsets[index] = requiredMemorySize;
+    requiredMemorySize += memoryRequirements.size;
+  }
+
+  VkPhysicalDeviceMemoryProperties memoryProperties;
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+  auto memoryTypeIndex = findMemoryTypeFromProperties(
+      memoryRequirements.memoryTypeBits, memoryProperties,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  if (0 > memoryTypeIndex) {
+    return ~42;  // returns -43
+  }
+
+  VkMemoryAllocateInfo allocateInfo = {};
+  allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocateInfo.allocationSize = requiredMemorySize;
+  allocateInfo.memoryTypeIndex = memoryTypeIndex;
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  error = vkAllocateMemory(device, &allocateInfo, nullptr, &memory);
+  if (error) {
+    return error;
+  }
+  for (uint32_t index = 0; index < BUFFER_COUNT; index++) {
+    error = vkBindBufferMemory(device, buffers[index], memory,
+                               bufferOffsets[index]);
+    if (error) {
+      return error;
+    }
+  }
+
+  // a filter from the image to the result, and the two passes of a separable
+  // filter through the temporary
+  enum { IMAGE_TO_RESULT, IMAGE_TO_TEMPORARY, TEMPORARY_TO_RESULT, SET_COUNT };
+  const uint32_t setBuffers[SET_COUNT][2] = {
+      {IMAGE, RESULT}, {IMAGE, TEMPORARY}, {TEMPORARY, RESULT}};
+
+  VkDescriptorPoolSize poolSize = {};
+  poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  poolSize.descriptorCount = 2 * SET_COUNT;
+  VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = {};
+  descriptorPoolCreateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  descriptorPoolCreateInfo.maxSets = SET_COUNT;
+  descriptorPoolCreateInfo.poolSizeCount = 1;
+  descriptorPoolCreateInfo.pPoolSizes = &poolSize;
+  VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+  error = vkCreateDescriptorPool(device, &descriptorPoolCreateInfo, nullptr,
+                                 &descriptorPool);
+  if (error) {
+    return error;
+  }
+
+  std::vector<VkDescriptorSetLayout> setLayouts(SET_COUNT, setLayout);
+  VkDescriptorSetAllocateInfo descriptorSetAllocateInfo = {};
+  descriptorSetAllocateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  descriptorSetAllocateInfo.descriptorPool = descriptorPool;
+  descriptorSetAllocateInfo.descriptorSetCount = SET_COUNT;
+  descriptorSetAllocateInfo.pSetLayouts = setLayouts.data();
+  VkDescriptorSet descriptorSets[SET_COUNT];
+  error = vkAllocateDescriptorSets(device, &descriptorSetAllocateInfo,
+                                   descriptorSets);
+  if (error) {
+    return error;
+  }
+
+  VkDescriptorBufferInfo bufferInfos[SET_COUNT][2];
+  std::vector<VkWriteDescriptorSet> descriptorSetWrites;
+  VkWriteDescriptorSet writeDescriptorSet = {};
+  writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  writeDescriptorSet.dstArrayElement = 0;
+  writeDescriptorSet.descriptorCount = 1;
+  writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  for (uint32_t set = 0; set < SET_COUNT; set++) {
+    for (uint32_t binding = 0; binding < 2; binding++) {
+      bufferInfos[set][binding].buffer = buffers[setBuffers[set][binding]];
+      bufferInfos[set][binding].offset = 0;
+      bufferInfos[set][binding].range = VK_WHOLE_SIZE;
+      writeDescriptorSet.dstSet = descriptorSets[set];
+      writeDescriptorSet.dstBinding = binding;
+      writeDescriptorSet.pBufferInfo = &bufferInfos[set][binding];
+      descriptorSetWrites.push_back(writeDescriptorSet);
+    }
+  }
+  vkUpdateDescriptorSets(device, descriptorSetWrites.size(),
+                         descriptorSetWrites.data(), 0, nullptr);
+
+  char *data = nullptr;
+  error = vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0,
+                      reinterpret_cast<void **>(&data));
+  if (error) {
+    return error;
+  }
+  float *image = reinterpret_cast<float *>(data + bufferOffsets[IMAGE]);
+  float *result = reinterpret_cast<float *>(data + bufferOffsets[RESULT]);
+  uint32_t seed = 13;
+  for (uint32_t index = 0; index < elementCount; index++) {
+    seed = seed * 1664525u + 1013904223u;
+    image[index] = (float)(seed >> 8) / (float)(1 << 24);
+  }
+
+  VkQueryPool queryPool = VK_NULL_HANDLE;
+  if (timestampValidBits) {
+    VkQueryPoolCreateInfo queryPoolCreateInfo = {};
+    queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolCreateInfo.queryCount = 2;
+    error = vkCreateQueryPool(device, &queryPoolCreateInfo, nullptr,
+                              &queryPool);
+    if (error) {
+      return error;
+    }
+  }
+
+  VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+  commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+  commandPoolCreateInfo.queueFamilyIndex = queueFamilyIndex;
+  VkCommandPool commandPool = VK_NULL_HANDLE;
+  error = vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr,
+                              &commandPool);
+  if (error) {
+    return error;
+  }
+
+  VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
+  commandBufferAllocateInfo.sType =
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  commandBufferAllocateInfo.commandPool = commandPool;
+  commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  commandBufferAllocateInfo.commandBufferCount = 1;
+  VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+  error = vkAllocateCommandBuffers(device, &commandBufferAllocateInfo,
+                                   &commandBuffer);
+  if (error) {
+    return error;
+  }
+
+  // record the work of function into the command buffer, submit it, wait for
+  // it to complete and return the time between the timestamps in
+  // milliseconds, or 0 if timestamps are not supported
+  auto submit = [&](std::function<VkResult()> function,
+                    double *milliseconds) -> VkResult {
+    VkResult result = vkResetCommandPool(device, commandPool, 0);
+    if (result) {
+      return result;
+    }
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    result = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    if (result) {
+      return result;
+    }
+    if (queryPool) {
+      vkCmdResetQueryPool(commandBuffer, queryPool, 0, 2);
+      vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                          queryPool, 0);
+    }
+    result = function();
+    if (result) {
+      return result;
+    }
+    if (queryPool) {
+      vkCmdWriteTimestamp(commandBuffer,
+                          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, queryPool, 1);
+    }
+    result = vkEndCommandBuffer(commandBuffer);
+    if (result) {
+      return result;
+    }
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    result = vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+    if (result) {
+      return result;
+    }
+    vkQueueWaitIdle(queue);
+
+    *milliseconds = 0.0;
+    if (queryPool) {
+      uint64_t timestamps[2];
+      result = vkGetQueryPoolResults(
+          device, queryPool, 0, 2, sizeof(timestamps), timestamps,
+          sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+      if (result) {
+        return result;
+      }
+      *milliseconds =
+          (timestamps[1] - timestamps[0]) * limits.timestampPeriod * 1e-6;
+    }
+    return VK_SUCCESS;
+  };
+
+  // a 1D box filter along rows, a 3 by 3 Laplacian, a 5 by 5 Gaussian and a
+  // 17 by 17 Gaussian applied as a horizontal then a vertical pass
+  float box[9];
+  std::fill(box, box + 9, 1.0f / 9.0f);
+  const float laplacian[9] = {0, 1, 0, 1, -4, 1, 0, 1, 0};
+  const float binomial[5] = {1, 4, 6, 4, 1};
+  float gaussian5x5[25];
+  for (uint32_t y = 0; y < 5; y++) {
+    for (uint32_t x = 0; x < 5; x++) {
+      gaussian5x5[y * 5 + x] = binomial[y] * binomial[x] / 256.0f;
+    }
+  }
+  float gaussian17[17];
+  float gaussianSum = 0.0f;
+  for (int32_t tap = 0; tap < 17; tap++) {
+    gaussian17[tap] = exp(-(tap - 8) * (tap - 8) / (2.0f * 3.0f * 3.0f));
+    gaussianSum += gaussian17[tap];
+  }
+  for (auto &tap : gaussian17) {
+    tap /= gaussianSum;
+  }
+
+  struct Test {
+    const char *name;
+    uint32_t passes;
+    std::function<VkResult()> record;
+    std::function<void(float *, float *)> reference;
+  };
+  const Test tests[] = {
+      {"box 1x9", 1,
+       [&] {
+         return recordStencil1d(commandBuffer, stencil,
+                                descriptorSets[IMAGE_TO_RESULT], width,
+                                height, 4, box);
+       },
+       [&](float *, float *output) {
+         hostStencil(image, output, width, height, 4, 0, box);
+       }},
+      {"laplacian 3x3", 1,
+       [&] {
+         return recordStencil2d(commandBuffer, stencil,
+                                descriptorSets[IMAGE_TO_RESULT], width,
+                                height, 1, 1, laplacian);
+       },
+       [&](float *, float *output) {
+         hostStencil(image, output, width, height, 1, 1, laplacian);
+       }},
+      {"gaussian 5x5", 1,
+       [&] {
+         return recordStencil2d(commandBuffer, stencil,
+                                descriptorSets[IMAGE_TO_RESULT], width,
+                                height, 2, 2, gaussian5x5);
+       },
+       [&](float *, float *output) {
+         hostStencil(image, output, width, height, 2, 2, gaussian5x5);
+       }},
+      {"gaussian 17x17", 2,
+       [&] {
+         VkResult error = recordStencil1d(commandBuffer, stencil,
+                                          descriptorSets[IMAGE_TO_TEMPORARY],
+                                          width, height, 8, gaussian17);
+         if (error) {
+           return error;
+         }
+         recordComputeBarrier(commandBuffer);
+         return recordStencil2d(commandBuffer, stencil,
+                                descriptorSets[TEMPORARY_TO_RESULT], width,
+                                height, 0, 8, gaussian17);
+       },
+       [&](float *temporary, float *output) {
+         hostStencil(image, temporary, width, height, 8, 0, gaussian17);
+         hostStencil(temporary, output, width, height, 0, 8, gaussian17);
+       }},
+  };
+
+  // each pass reads and writes every element once, that is the traffic a
+  // bandwidth bound filter achieves
+  const uint32_t repetitions = 10;
+  printf("%-16s %10s %10s\n", "filter", "device ms", "GB/s");
+  int failures = 0;
+  std::vector<float> temporary(elementCount);
+  std::vector<float> expected(elementCount);
+  for (const Test &test : tests) {
+    double milliseconds;
+    error = submit(
+        [&] {
+          for (uint32_t repetition = 0; repetition < repetitions;
+               repetition++) {
+            if (repetition) {
+              recordComputeBarrier(commandBuffer);
+            }
+            VkResult error = test.record();
+            if (error) {
+              return error;
+            }
+          }
+          return VK_SUCCESS;
+        },
+        &milliseconds);
+    if (error) {
+      return error;
+    }
+    milliseconds /= repetitions;
+    const double bytes = 2.0 * sizeof(float) * elementCount * test.passes;
+    printf("%-16s %10.3f %10.1f\n", test.name, milliseconds,
+           milliseconds > 0.0 ? bytes / milliseconds * 1e-6 : 0.0);
+
+    test.reference(temporary.data(), expected.data());
+    for (uint32_t index = 0; index < elementCount; index++) {
+      if (!(fabs(result[index] - expected[index]) <= 1e-5)) {
+        fprintf(stderr, "%s result[%u] is '%f' not '%f'!\n", test.name, index,
+                result[index], expected[index]);
+        failures++;
+        break;
+      }
+    }
+  }
+  vkUnmapMemory(device, memory);
+
+  if (queryPool) {
+    vkDestroyQueryPool(device, queryPool, nullptr);
+  }
+  vkDestroyCommandPool(device, commandPool, nullptr);
+  vkFreeMemory(device, memory, nullptr);
+  for (auto buffer : buffers) {
+    vkDestroyBuffer(device, buffer, nullptr);
+  }
+  vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+  for (auto &pipeline : stencil.pipelines) {
+    vkDestroyPipeline(device, pipeline.second, nullptr);
+  }
+  vkDestroyPipelineLayout(device, stencil.pipelineLayout, nullptr);
+  vkDestroyDescriptorSetLayout(device, setLayout, nullptr);
+  vkDestroyDevice(device, nullptr);
+  vkDestroyInstance(instance, nullptr);
+
+  if (failures) {
+    return 1;
+  }
+  printf("success\n");
+
+  return 0;
+}
@@ -0,0 +1,742 @@
+#include <vulkan/vulkan.h>
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+// load a SPIR-V binary from disc
+std::vector<char> loadShaderCode(const char *filename) {
+  std::vector<char> shaderCode;
+  if (FILE *fp = fopen(filename, "rb")) {
+    char buf[1024];
+    while (size_t len = fread(buf, 1, sizeof(buf), fp)) {
+      shaderCode.insert(shaderCode.end(), buf, buf + len);
+    }
+    fclose(fp);
+  }
+  return shaderCode;
+}
+
+// search for compatible memory properties and return the memory type index
+int32_t findMemoryTypeFromProperties(
+    uint32_t memoryTypeBits, VkPhysicalDeviceMemoryProperties properties,
+    VkMemoryPropertyFlags requiredProperties) {
+  assert(properties.memoryTypeCount < 32u);
+  for (uint32_t index = 0; index < properties.memoryTypeCount; ++index) {
+    if (memoryTypeBits & (1u << index) &&
+        // Find the first memory type that supports all the required flags.
+        ((properties.memoryTypes[index].propertyFlags & requiredProperties) ==
+         requiredProperties)) {
+      return (int32_t)index;
+    }
+  }
+  return -1;
+}
+
+// create a compute pipeline from a SPIR-V binary found in SHADER_PATH
+VkResult createComputePipeline(VkDevice device, VkPipelineLayout layout,
+                               const char *filename,
+                               const VkSpecializationInfo *specializationInfo,
+                               VkPipeline *pipeline) {
+  auto shaderCode =
+      loadShaderCode((std::string(SHADER_PATH) + filename).c_str());
+  if (shaderCode.empty()) {
+    fprintf(stderr, "failed to load '%s'\n", filename);
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
+  shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  shaderModuleCreateInfo.pCode =
+      reinterpret_cast<uint32_t *>(shaderCode.data());
+  shaderModuleCreateInfo.codeSize = shaderCode.size();
+  VkShaderModule shaderModule = VK_NULL_HANDLE;
+  VkResult error = vkCreateShaderModule(device, &shaderModuleCreateInfo,
+                                        nullptr, &shaderModule);
+  if (error) {
+    return error;
+  }
+  VkComputePipelineCreateInfo pipelineCreateInfo = {};
+  pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineCreateInfo.stage.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipelineCreateInfo.stage.module = shaderModule;
+  pipelineCreateInfo.stage.pName = "main";
+  pipelineCreateInfo.stage.pSpecializationInfo = specializationInfo;
+  pipelineCreateInfo.layout = layout;
+  error = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1,
+                                   &pipelineCreateInfo, nullptr, pipeline);
+  vkDestroyShaderModule(device, shaderModule, nullptr);
+  return error;
+}
+
+// mirror the push constant blocks of top_k.comp and bounds.comp
+struct TopKParams {
+  uint32_t count;
+  uint32_t k;
+  uint32_t shift;
+};
+
+struct BoundsParams {
+  uint32_t count;
+  uint32_t queryCount;
+};
+
+// the values of the pass specialization constant of top_k.comp
+enum TopKPass { HISTOGRAM, SELECT, GATHER, SORT, PASS_COUNT };
+
+// the most selected values the sort pass can order in shared memory
+const uint32_t maxSortedCount = 1024;
+
+// the size of the state of top_k.comp, four counters and a histogram
+const VkDeviceSize topKStateSize = sizeof(uint32_t) * (4 + 256);
+
+// the shaders share a pipeline layout whose descriptor set binds four storage
+// buffers, the values, state, selected values and selected indices of
+// top_k.comp or the sorted values, queries and results of bounds.comp which
+// does not use the fourth
+struct Selection {
+  VkPipelineLayout pipelineLayout;
+  VkPipeline topK[PASS_COUNT];
+  // lower_bound then upper_bound
+  VkPipeline bounds[2];
+  uint32_t maxGroupCount;
+};
+
+uint32_t divideRoundUp(uint32_t value, uint32_t divisor) {
+  return (value + divisor - 1) / divisor;
+}
+
+void recordComputeBarrier(VkCommandBuffer commandBuffer) {
+  VkMemoryBarrier memoryBarrier = {};
+  memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  memoryBarrier.dstAccessMask =
+      VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1,
+                       &memoryBarrier, 0, nullptr, 0, nullptr);
+}
+
+// select the k largest of count values into the selected values and indices,
+// ordered largest first when sorted is true, state is the buffer bound as the
+// state of top_k.comp, it is zeroed here
+VkResult recordTopK(VkCommandBuffer commandBuffer, const Selection &selection,
+                    VkDescriptorSet descriptorSet, VkBuffer state,
+                    uint32_t count, uint32_t k, bool sorted) {
+  if (k == 0 || k > count || (sorted && k > maxSortedCount)) {
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+  }
+  vkCmdFillBuffer(commandBuffer, state, 0, topKStateSize, 0);
+  VkMemoryBarrier memoryBarrier = {};
+  memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  memoryBarrier.dstAccessMask =
+      VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1,
+                       &memoryBarrier, 0, nullptr, 0, nullptr);
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                          selection.pipelineLayout, 0, 1, &descriptorSet, 0,
+                          nullptr);
+
+  // enough workgroups to fill the device, more would only add atomics on the
+  // global histogram and counters
+  const uint32_t groupCount =
+      std::min(std::min(divideRoundUp(count, 256), 1024u),
+               selection.maxGroupCount);
+  auto record = [&](TopKPass pass, uint32_t shift, uint32_t groups) {
+    TopKParams params = {count, k, shift};
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                      selection.topK[pass]);
+    vkCmdPushConstants(commandBuffer, selection.pipelineLayout,
+                       VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(TopKParams),
+                       &params);
+    vkCmdDispatch(commandBuffer, groups, 1, 1);
+  };
+  for (int32_t shift = 24; shift >= 0; shift -= 8) {
+    record(HISTOGRAM, shift, groupCount);
+    recordComputeBarrier(commandBuffer);
+    record(SELECT, shift, 1);
+    recordComputeBarrier(commandBuffer);
+  }
+  record(GATHER, 0, groupCount);
+  if (sorted) {
+    recordComputeBarrier(commandBuffer);
+    record(SORT, 0, 1);
+  }
+  return VK_SUCCESS;
+}
+
+// find the lower_bound, or upper_bound when upper is true, of queryCount
+// queries in count sorted values
+void recordBounds(VkCommandBuffer commandBuffer, const Selection &selection,
+                  VkDescriptorSet descriptorSet, bool upper, uint32_t count,
+                  uint32_t queryCount) {
+  BoundsParams params = {count, queryCount};
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                    selection.bounds[upper]);
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                          selection.pipelineLayout, 0, 1, &descriptorSet, 0,
+                          nullptr);
+  vkCmdPushConstants(commandBuffer, selection.pipelineLayout,
+                     VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(BoundsParams),
+                     &params);
+  vkCmdDispatch(
+      commandBuffer,
+      std::min(divideRoundUp(queryCount, 256), selection.maxGroupCount), 1,
+      1);
+}
+
+uint32_t nextRandom(uint32_t &seed) {
+  seed = seed * 1664525u + 1013904223u;
+  return seed >> 8;
+}
+
+// one of 64K evenly spaced values in [-1, 1), so large inputs have many
+// duplicates and the k-th largest is usually tied
+float quantizedValue(uint32_t &seed) {
+  return (float)(nextRandom(seed) % 65536) / 32768.0f - 1.0f;
+}
+
+// milliseconds elapsed since start
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+int main() {
+  VkApplicationInfo applicationInfo = {};
+  applicationInfo.pApplicationName = "Vulkan top k example";
+  applicationInfo.apiVersion = VK_MAKE_VERSION(1, 0, 0);
+
+  VkInstanceCreateInfo instanceCreateInfo = {};
+  instanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+  instanceCreateInfo.pApplicationInfo = &applicationInfo;
+#ifdef ENABLE_LAYERS
+  // without a debug report callback, see vector_add, the validation layer
+  // prints its messages to stdout
+  std::vector<const char *> enabledLayerNames{"VK_LAYER_KHRONOS_validation"};
+  instanceCreateInfo.enabledLayerCount = enabledLayerNames.size();
+  instanceCreateInfo.ppEnabledLayerNames = enabledLayerNames.data();
+#endif
+
+  VkInstance instance = VK_NULL_HANDLE;
+  VkResult error = vkCreateInstance(&instanceCreateInfo, nullptr, &instance);
+  if (error) {
+    return error;
+  }
+
+  uint32_t count;
+  error = vkEnumeratePhysicalDevices(instance, &count, nullptr);
+  if (error) {
+    return error;
+  }
+  std::vector<VkPhysicalDevice> physicalDevices(count);
+  error = vkEnumeratePhysicalDevices(instance, &count, physicalDevices.data());
+  if (error) {
+    return error;
+  }
+
+  // find the first physical device with a compute queue
+  VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+  uint32_t queueFamilyIndex = 0;
+  uint32_t timestampValidBits = 0;
+  for (auto device : physicalDevices) {
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilyProperties(count);
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count,
+                                             queueFamilyProperties.data());
+    for (uint32_t index = 0; index < count; index++) {
+      if (queueFamilyProperties[index].queueFlags & VK_QUEUE_COMPUTE_BIT) {
+        physicalDevice = device;
+        queueFamilyIndex = index;
+        timestampValidBits = queueFamilyProperties[index].timestampValidBits;
+        break;
+      }
+    }
+    if (physicalDevice) {
+      break;
+    }
+  }
+  if (!physicalDevice) {
+    fprintf(stderr, "no device with a compute queue\n");
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+  }
+
+  VkPhysicalDeviceProperties physicalDeviceProperties;
+  vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties);
+  const VkPhysicalDeviceLimits &limits = physicalDeviceProperties.limits;
+
+  VkDeviceQueueCreateInfo queueCreateInfo = {};
+  queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+  queueCreateInfo.queueCount = 1;
+  queueCreateInfo.queueFamilyIndex = queueFamilyIndex;
+  float queuePriority = 1.0f;
+  queueCreateInfo.pQueuePriorities = &queuePriority;
+
+  VkDeviceCreateInfo deviceCreateInfo = {};
+  deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+  deviceCreateInfo.queueCreateInfoCount = 1;
+  deviceCreateInfo.pQueueCreateInfos = &queueCreateInfo;
+  VkDevice device = VK_NULL_HANDLE;
+  error = vkCreateDevice(physicalDevice, &deviceCreateInfo, nullptr, &device);
+  if (error) {
+    return error;
+  }
+
+  VkQueue queue;
+  vkGetDeviceQueue(device, queueFamilyIndex, 0, &queue);
+
+  std::vector<VkDescriptorSetLayoutBinding> layoutBindings;
+  VkDescriptorSetLayoutBinding layoutBinding = {};
+  layoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  layoutBinding.descriptorCount = 1;
+  layoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  for (uint32_t binding = 0; binding < 4; binding++) {
+    layoutBinding.binding = binding;
+    layoutBindings.push_back(layoutBinding);
+  }
+
+  VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo = {};
+  setLayoutCreateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  setLayoutCreateInfo.bindingCount = layoutBindings.size();
+  setLayoutCreateInfo.pBindings = layoutBindings.data();
+  VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+  error = vkCreateDescriptorSetLayout(device, &setLayoutCreateInfo, nullptr,
+                                      &setLayout);
+  if (error) {
+    return error;
+  }
+
+  VkPushConstantRange pushConstantRange = {};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  pushConstantRange.offset = 0;
+  // large enough for either shader's parameters
+  pushConstantRange.size = std::max(sizeof(TopKParams), sizeof(BoundsParams));
+
+  Selection selection;
+  selection.maxGroupCount = limits.maxComputeWorkGroupCount[0];
+  VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+  pipelineLayoutCreateInfo.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutCreateInfo.setLayoutCount = 1;
+  pipelineLayoutCreateInfo.pSetLayouts = &setLayout;
+  pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+  pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+  error = vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr,
+                                 &selection.pipelineLayout);
+  if (error) {
+    return error;
+  }
+
+  // both shaders take a single 32 bit specialization constant, the pass of
+  // top_k.comp or whether bounds.comp finds upper bounds
+  VkSpecializationMapEntry specializationMapEntry = {};
+  specializationMapEntry.constantID = 0;
+  specializationMapEntry.offset = 0;
+  specializationMapEntry.size = sizeof(uint32_t);
+  VkSpecializationInfo specializationInfo = {};
+  specializationInfo.mapEntryCount = 1;
+  specializationInfo.pMapEntries = &specializationMapEntry;
+  specializationInfo.dataSize = sizeof(uint32_t);
+  for (uint32_t pass = 0; pass < PASS_COUNT; pass++) {
+    specializationInfo.pData = &pass;
+    error = createComputePipeline(device, selection.pipelineLayout,
+                                  "top_k.spv", &specializationInfo,
+                                  &selection.topK[pass]);
+    if (error) {
+      return error;
+    }
+  }
+  for (VkBool32 upper : {VK_FALSE, VK_TRUE}) {
+    specializationInfo.pData = &upper;
+    error = createComputePipeline(device, selection.pipelineLayout,
+                                  "bounds.spv", &specializationInfo,
+                                  &selection.bounds[upper]);
+    if (error) {
+      return error;
+    }
+  }
+
+  // 16M values to select from and sort for the searches, 1M queries
+  const uint32_t valueCount = 1 << 24;
+  const uint32_t queryCount = 1 << 20;
+  const uint32_t maxK = 1 << 17;
+  enum {
+    VALUES,
+    STATE,
+    TOP_VALUES,
+    TOP_INDICES,
+    SORTED,
+    QUERIES,
+    RESULTS,
+    BUFFER_COUNT
+  };
+  const VkDeviceSize bufferSizes[BUFFER_COUNT] = {
+      sizeof(float) * valueCount, topKStateSize,
+      sizeof(float) * maxK,       sizeof(uint32_t) * maxK,
+      sizeof(float) * valueCount, sizeof(float) * queryCount,
+      sizeof(uint32_t) * queryCount};
+  VkBuffer buffers[BUFFER_COUNT];
+  for (uint32_t index = 0; index < BUFFER_COUNT; index++) {
+    VkBufferCreateInfo bufferCreateInfo = {};
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.size = bufferSizes[index];
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    if (index == STATE) {
+      // zeroed on the device with vkCmdFillBuffer
+      bufferCreateInfo.usage |= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    }
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    bufferCreateInfo.queueFamilyIndexCount = 1;
+    bufferCreateInfo.pQueueFamilyIndices = &queueFamilyIndex;
+    error = vkCreateBuffer(device, &bufferCreateInfo, nullptr, &buffers[index]);
+    if (error) {
+      return error;
+    }
+  }
+  VkDeviceSize bufferOffsets[BUFFER_COUNT];
+  VkDeviceSize requiredMemorySize = 0;
+  VkMemoryRequirements memoryRequirements;
+  for (uint32_t index = 0; index < BUFFER_COUNT; index++) {
+    vkGetBufferMemoryRequirements(device, buffers[index], &memoryRequirements);
+    const VkDeviceSize alignment = memoryRequirements.alignment;
+    requiredMemorySize =
+        (requiredMemorySize + alignment - 1) / alignment * alignment;
+    bufferOffsets[index] = requiredMemorySize;
+    requiredMemorySize += memoryRequirements.size;
+  }
+
+  VkPhysicalDeviceMemoryProperties memoryProperties;
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+  auto memoryTypeIndex = findMemoryTypeFromProperties(
+      memoryRequirements.memoryTypeBits, memoryProperties,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  if (0 > memoryTypeIndex) {
+    return ~42;  // returns -43
+  }
+
+  VkMemoryAllocateInfo allocateInfo = {};
+  allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocateInfo.allocationSize = requiredMemorySize;
+  allocateInfo.memoryTypeIndex = memoryTypeIndex;
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  error = vkAllocateMemory(device, &allocateInfo, nullptr, &memory);
+  if (error) {
+    return error;
+  }
+  for (uint32_t index = 0; index < BUFFER_COUNT; index++) {
+    error = vkBindBufferMemory(device, buffers[index], memory,
+                               bufferOffsets[index]);
+    if (error) {
+      return error;
+    }
+  }
+
+  // the bounds set repeats its results buffer in the unused fourth binding
+  enum { TOP_K_SET, BOUNDS_SET, SET_COUNT };
+  const uint32_t setBuffers[SET_COUNT][4] = {
+      {VALUES, STATE, TOP_VALUES, TOP_INDICES},
+      {SORTED, QUERIES, RESULTS, RESULTS}};
+
+  VkDescriptorPoolSize poolSize = {};
+  poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  poolSize.descriptorCount = 4 * SET_COUNT;
+  VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = {};
+  descriptorPoolCreateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  descriptorPoolCreateInfo.maxSets = SET_COUNT;
+  descriptorPoolCreateInfo.poolSizeCount = 1;
+  descriptorPoolCreateInfo.pPoolSizes = &poolSize;
+  VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+  error = vkCreateDescriptorPool(device, &descriptorPoolCreateInfo, nullptr,
+                                 &descriptorPool);
+  if (error) {
+    return error;
+  }
+
+  std::vector<VkDescriptorSetLayout> setLayouts(SET_COUNT, setLayout);
+  VkDescriptorSetAllocateInfo descriptorSetAllocateInfo = {};
+  descriptorSetAllocateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  descriptorSetAllocateInfo.descriptorPool = descriptorPool;
+  descriptorSetAllocateInfo.descriptorSetCount = SET_COUNT;
+  descriptorSetAllocateInfo.pSetLayouts = setLayouts.data();
+  VkDescriptorSet descriptorSets[SET_COUNT];
+  error = vkAllocateDescriptorSets(device, &descriptorSetAllocateInfo,
+                                   descriptorSets);
+  if (error) {
+    return error;
+  }
+
+  VkDescriptorBufferInfo bufferInfos[SET_COUNT][4];
+  std::vector<VkWriteDescriptorSet> descriptorSetWrites;
+  VkWriteDescriptorSet writeDescriptorSet = {};
+  writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  writeDescriptorSet.dstArrayElement = 0;
+  writeDescriptorSet.descriptorCount = 1;
+  writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  for (uint32_t set = 0; set < SET_COUNT; set++) {
+    for (uint32_t binding = 0; binding < 4; binding++) {
+      bufferInfos[set][binding].buffer = buffers[setBuffers[set][binding]];
+      bufferInfos[set][binding].offset = 0;
+      bufferInfos[set][binding].range = VK_WHOLE_SIZE;
+      writeDescriptorSet.dstSet = descriptorSets[set];
+      writeDescriptorSet.dstBinding = binding;
+      writeDescriptorSet.pBufferInfo = &bufferInfos[set][binding];
+      descriptorSetWrites.push_back(writeDescriptorSet);
+    }
+  }
+  vkUpdateDescriptorSets(device, descriptorSetWrites.size(),
+                         descriptorSetWrites.data(), 0, nullptr);
+
+  char *data = nullptr;
+  error = vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0,
+                      reinterpret_cast<void **>(&data));
+  if (error) {
+    return error;
+  }
+  float *valueData = reinterpret_cast<float *>(data + bufferOffsets[VALUES]);
+  float *topValueData =
+      reinterpret_cast<float *>(data + bufferOffsets[TOP_VALUES]);
+  uint32_t *topIndexData =
+      reinterpret_cast<uint32_t *>(data + bufferOffsets[TOP_INDICES]);
+  float *sortedData = reinterpret_cast<float *>(data + bufferOffsets[SORTED]);
+  float *queryData = reinterpret_cast<float *>(data + bufferOffsets[QUERIES]);
+  uint32_t *resultData =
+      reinterpret_cast<uint32_t *>(data + bufferOffsets[RESULTS]);
+
+  VkQueryPool queryPool = VK_NULL_HANDLE;
+  if (timestampValidBits) {
+    VkQueryPoolCreateInfo queryPoolCreateInfo = {};
+    queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolCreateInfo.queryCount = 2;
+    error = vkCreateQueryPool(device, &queryPoolCreateInfo, nullptr,
+                              &queryPool);
+    if (error) {
+      return error;
+    }
+  }
+
+  VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+  commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+  commandPoolCreateInfo.queueFamilyIndex = queueFamilyIndex;
+  VkCommandPool commandPool = VK_NULL_HANDLE;
+  error = vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr,
+                              &commandPool);
+  if (error) {
+    return error;
+  }
+
+  VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
+  commandBufferAllocateInfo.sType =
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  commandBufferAllocateInfo.commandPool = commandPool;
+  commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  commandBufferAllocateInfo.commandBufferCount = 1;
+  VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+  error = vkAllocateCommandBuffers(device, &commandBufferAllocateInfo,
+                                   &commandBuffer);
+  if (error) {
+    return error;
+  }
+
+  // record the work of function into the command buffer, submit it, wait for
+  // it to complete and return the time between the timestamps in
+  // milliseconds, or 0 if timestamps are not supported
+  auto submit = [&](std::function<VkResult()> function,
+                    double *milliseconds) -> VkResult {
+    VkResult result = vkResetCommandPool(device, commandPool, 0);
+    if (result) {
+      return result;
+    }
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    result = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    if (result) {
+      return result;
+    }
+    if (queryPool) {
+      vkCmdResetQueryPool(commandBuffer, queryPool, 0, 2);
+      vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                          queryPool, 0);
+    }
+    result = function();
+    if (result) {
+      return result;
+    }
+    if (queryPool) {
+      vkCmdWriteTimestamp(commandBuffer,
+                          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, queryPool, 1);
+    }
+    result = vkEndCommandBuffer(commandBuffer);
+    if (result) {
+      return result;
+    }
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    result = vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+    if (result) {
+      return result;
+    }
+    vkQueueWaitIdle(queue);
+
+    *milliseconds = 0.0;
+    if (queryPool) {
+      uint64_t timestamps[2];
+      result = vkGetQueryPoolResults(
+          device, queryPool, 0, 2, sizeof(timestamps), timestamps,
+          sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+      if (result) {
+        return result;
+      }
+      *milliseconds =
+          (timestamps[1] - timestamps[0]) * limits.timestampPeriod * 1e-6;
+    }
+    return VK_SUCCESS;
+  };
+
+  uint32_t seed = 42;
+  for (uint32_t index = 0; index < valueCount; index++) {
+    valueData[index] = quantizedValue(seed);
+  }
+  printf("%-24s %10s %10s\n", "operation", "device ms", "host ms");
+  int failures = 0;
+
+  // which of the tied values are selected depends on the order of the atomics
+  // so the values are compared in order and every index must be distinct and
+  // refer to its value
+  for (uint32_t k : {100u, maxSortedCount, maxK}) {
+    const bool sorted = k <= maxSortedCount;
+    const std::string name = "top " + std::to_string(k) +
+                             (sorted ? " sorted" : " unsorted");
+    double milliseconds;
+    error = submit(
+        [&] {
+          return recordTopK(commandBuffer, selection,
+                            descriptorSets[TOP_K_SET], buffers[STATE],
+                            valueCount, k, sorted);
+        },
+        &milliseconds);
+    if (error) {
+      return error;
+    }
+    auto start = std::chrono::steady_clock::now();
+    std::vector<float> expected(valueData, valueData + valueCount);
+    std::nth_element(expected.begin(), expected.begin() + (k - 1),
+                     expected.end(), std::greater<float>());
+    expected.resize(k);
+    std::sort(expected.begin(), expected.end(), std::greater<float>());
+    const double hostMilliseconds = millisecondsSince(start);
+    printf("%-24s %10.3f %10.3f\n", name.c_str(), milliseconds,
+           hostMilliseconds);
+
+    std::vector<float> actual(topValueData, topValueData + k);
+    if (!sorted) {
+      std::sort(actual.begin(), actual.end(), std::greater<float>());
+    }
+    std::vector<uint32_t> indices(topIndexData, topIndexData + k);
+    std::sort(indices.begin(), indices.end());
+    for (uint32_t index = 0; index < k; index++) {
+      if (actual[index] != expected[index]) {
+        fprintf(stderr, "%s [%u] is '%f' not '%f'!\n", name.c_str(), index,
+                actual[index], expected[index]);
+        failures++;
+        break;
+      }
+      if (topIndexData[index] >= valueCount ||
+          valueData[topIndexData[index]] != topValueData[index] ||
+          (index && indices[index] == indices[index - 1])) {
+        fprintf(stderr, "%s index [%u] is wrong!\n", name.c_str(), index);
+        failures++;
+        break;
+      }
+    }
+  }
+
+  // search the sorted values for queries from the same distribution, so many
+  // queries are present, some repeatedly
+  memcpy(sortedData, valueData, sizeof(float) * valueCount);
+  std::sort(sortedData, sortedData + valueCount);
+  for (uint32_t index = 0; index < queryCount; index++) {
+    queryData[index] = quantizedValue(seed) * 1.0625f;
+  }
+  for (bool upper : {false, true}) {
+    const std::string name = upper ? "upper_bound" : "lower_bound";
+    double milliseconds;
+    error = submit(
+        [&] {
+          recordBounds(commandBuffer, selection, descriptorSets[BOUNDS_SET],
+                       upper, valueCount, queryCount);
+          return VK_SUCCESS;
+        },
+        &milliseconds);
+    if (error) {
+      return error;
+    }
+    std::vector<uint32_t> expected(queryCount);
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t index = 0; index < queryCount; index++) {
+      const float *bound =
+          upper ? std::upper_bound(sortedData, sortedData + valueCount,
+                                   queryData[index])
+                : std::lower_bound(sortedData, sortedData + valueCount,
+                                   queryData[index]);
+      expected[index] = bound - sortedData;
+    }
+    const double hostMilliseconds = millisecondsSince(start);
+    printf("%-24s %10.3f %10.3f\n", name.c_str(), milliseconds,
+           hostMilliseconds);
+    for (uint32_t index = 0; index < queryCount; index++) {
+      if (resultData[index] != expected[index]) {
+        fprintf(stderr, "%s [%u] is '%u' not '%u'!\n", name.c_str(), index,
+                resultData[index], expected[index]);
+        failures++;
+        break;
+      }
+    }
+  }
+  vkUnmapMemory(device, memory);
+
+  if (queryPool) {
+    vkDestroyQueryPool(device, queryPool, nullptr);
+  }
+  vkDestroyCommandPool(device, commandPool, nullptr);
+  vkFreeMemory(device, memory, nullptr);
+  for (auto buffer : buffers) {
+    vkDestroyBuffer(device, buffer, nullptr);
+  }
+  vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+  for (auto pipeline : selection.topK) {
+    vkDestroyPipeline(device, pipeline, nullptr);
+  }
+  for (auto pipeline : selection.bounds) {
+    vkDestroyPipeline(device, pipeline, nullptr);
+  }
+  vkDestroyPipelineLayout(device, selection.pipelineLayout, nullptr);
+  vkDestroyDescriptorSetLayout(device, setLayout, nullptr);
+  vkDestroyDevice(device, nullptr);
+  vkDestroyInstance(instance, nullptr);
+
+  if (failures) {
+    return 1;
+  }
+  printf("success\n");
+
+  return 0;
+}
@@ -0,0 +1,712 @@
+#include <vulkan/vulkan.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+// load a SPIR-V binary from disc
+std::vector<char> loadShaderCode(const char *filename) {
+  std::vector<char> shaderCode;
+  if (FILE *fp = fopen(filename, "rb")) {
+    char buf[1024];
+    while (size_t len = fread(buf, 1, sizeof(buf), fp)) {
+      shaderCode.insert(shaderCode.end(), buf, buf + len);
+    }
+    fclose(fp);
+  }
+  return shaderCode;
+}
+
+// search for compatible memory properties and return the memory type index
+int32_t findMemoryTypeFromProperties(
+    uint32_t memoryTypeBits, VkPhysicalDeviceMemoryProperties properties,
+    VkMemoryPropertyFlags requiredProperties) {
+  assert(properties.memoryTypeCount < 32u);
+  for (uint32_t index = 0; index < properties.memoryTypeCount; ++index) {
+    if (memoryTypeBits & (1u << index) &&
+        // Find the first memory type that supports all the required flags.
+        ((properties.memoryTypes[index].propertyFlags & requiredProperties) ==
+         requiredProperties)) {
+      return (int32_t)index;
+    }
+  }
+  return -1;
+}
+
+// create a compute pipeline from a SPIR-V binary found in SHADER_PATH
+VkResult createComputePipeline(VkDevice device, VkPipelineLayout layout,
+                               const char *filename,
+                               const VkSpecializationInfo *specializationInfo,
+                               VkPipeline *pipeline) {
+  auto shaderCode =
+      loadShaderCode((std::string(SHADER_PATH) + filename).c_str());
+  if (shaderCode.empty()) {
+    fprintf(stderr, "failed to load '%s'\n", filename);
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
+  shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  shaderModuleCreateInfo.pCode =
+      reinterpret_cast<uint32_t *>(shaderCode.data());
+  shaderModuleCreateInfo.codeSize = shaderCode.size();
+  VkShaderModule shaderModule = VK_NULL_HANDLE;
+  VkResult error = vkCreateShaderModule(device, &shaderModuleCreateInfo,
+                                        nullptr, &shaderModule);
+  if (error) {
+    return error;
+  }
+  VkComputePipelineCreateInfo pipelineCreateInfo = {};
+  pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineCreateInfo.stage.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipelineCreateInfo.stage.module = shaderModule;
+  pipelineCreateInfo.stage.pName = "main";
+  pipelineCreateInfo.stage.pSpecializationInfo = specializationInfo;
+  pipelineCreateInfo.layout = layout;
+  error = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1,
+                                   &pipelineCreateInfo, nullptr, pipeline);
+  vkDestroyShaderModule(device, shaderModule, nullptr);
+  return error;
+}
+
+// mirror the push constant blocks of transpose.comp and aos_soa.comp
+struct TransposeParams {
+  uint32_t rows;
+  uint32_t columns;
+  uint32_t batchCount;
+};
+
+struct AosSoaParams {
+  uint32_t count;
+  uint32_t fieldStride;
+};
+
+// the shaders share a pipeline layout whose descriptor set binds the input
+// then the output, the conversions between arrays of structures and
+// structures of arrays are specialized for their field count and direction
+// on first use and cached
+struct Relayout {
+  VkDevice device;
+  VkPipelineLayout pipelineLayout;
+  VkPipeline transpose;
+  std::map<uint32_t, VkPipeline> conversions;
+  uint32_t maxGroupCount[3];
+  uint32_t maxFieldCount;
+};
+
+uint32_t divideRoundUp(uint32_t value, uint32_t divisor) {
+  return (value + divisor - 1) / divisor;
+}
+
+// the distance between the field arrays of a structure of arrays, rounding
+// up to 64 elements keeps each array aligned to 256 bytes, the largest
+// minStorageBufferOffsetAlignment allowed, so each can also be bound alone
+uint32_t fieldStrideFor(uint32_t count) {
+  return divideRoundUp(count, 64) * 64;
+}
+
+// transpose batchCount row major matrices of rows by columns
+void recordTranspose(VkCommandBuffer commandBuffer, const Relayout &relayout,
+                     VkDescriptorSet descriptorSet, uint32_t rows,
+                     uint32_t columns, uint32_t batchCount) {
+  TransposeParams params = {rows, columns, batchCount};
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                    relayout.transpose);
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                          relayout.pipelineLayout, 0, 1, &descriptorSet, 0,
+                          nullptr);
+  vkCmdPushConstants(commandBuffer, relayout.pipelineLayout,
+                     VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(TransposeParams),
+                     &params);
+  // each workgroup covers a tile of 32 by 32
+  vkCmdDispatch(
+      commandBuffer,
+      std::min(divideRoundUp(columns, 32), relayout.maxGroupCount[0]),
+      std::min(divideRoundUp(rows, 32), relayout.maxGroupCount[1]),
+      std::min(batchCount, relayout.maxGroupCount[2]));
+}
+
+// convert count structures of fieldCount 32 bit fields to a structure of
+// arrays, or back when toStructureOfArrays is false, see aos_soa.comp
+VkResult recordAosSoa(VkCommandBuffer commandBuffer, Relayout &relayout,
+                      VkDescriptorSet descriptorSet, bool toStructureOfArrays,
+                      uint32_t count, uint32_t fieldCount,
+                      uint32_t fieldStride) {
+  if (fieldCount == 0 || fieldCount > relayout.maxFieldCount) {
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+  }
+  const uint32_t key = fieldCount << 1 | (toStructureOfArrays ? 1 : 0);
+  auto found = relayout.conversions.find(key);
+  VkPipeline pipeline;
+  if (found != relayout.conversions.end()) {
+    pipeline = found->second;
+  } else {
+    const uint32_t constants[2] = {toStructureOfArrays, fieldCount};
+    VkSpecializationMapEntry specializationMapEntries[2] = {};
+    for (uint32_t index = 0; index < 2; index++) {
+      specializationMapEntries[index].constantID = index;
+      specializationMapEntries[index].offset = sizeof(uint32_t) * index;
+      specializationMapEntries[index].size = sizeof(uint32_t);
+    }
+    VkSpecializationInfo specializationInfo = {};
+    specializationInfo.mapEntryCount = 2;
+    specializationInfo.pMapEntries = specializationMapEntries;
+    specializationInfo.dataSize = sizeof(constants);
+    specializationInfo.pData = constants;
+    VkResult error = createComputePipeline(
+        relayout.device, relayout.pipelineLayout, "aos_soa.spv",
+        &specializationInfo, &pipeline);
+    if (error) {
+      return error;
+    }
+    relayout.conversions[key] = pipeline;
+  }
+
+  AosSoaParams params = {count, fieldStride};
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                          relayout.pipelineLayout, 0, 1, &descriptorSet, 0,
+                          nullptr);
+  vkCmdPushConstants(commandBuffer, relayout.pipelineLayout,
+                     VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(AosSoaParams),
+                     &params);
+  // each workgroup covers 256 structures
+  vkCmdDispatch(commandBuffer,
+                std::min(divideRoundUp(count, 256), relayout.maxGroupCount[0]),
+                1, 1);
+  return VK_SUCCESS;
+}
+
+void recordComputeBarrier(VkCommandBuffer commandBuffer) {
+  VkMemoryBarrier memoryBarrier = {};
+  memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  memoryBarrier.dstAccessMask =
+      VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1,
+                       &memoryBarrier, 0, nullptr, 0, nullptr);
+}
+
+// milliseconds elapsed since start
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+int main() {
+  VkApplicationInfo applicationInfo = {};
+  applicationInfo.pApplicationName = "Vulkan transpose example";
+  applicationInfo.apiVersion = VK_MAKE_VERSION(1, 0, 0);
+
+  VkInstanceCreateInfo instanceCreateInfo = {};
+  instanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+  instanceCreateInfo.pApplicationInfo = &applicationInfo;
+#ifdef ENABLE_LAYERS
+  // without a debug report callback, see vector_add, the validation layer
+  // prints its messages to stdout
+  std::vector<const char *> enabledLayerNames{"VK_LAYER_KHRONOS_validation"};
+  instanceCreateInfo.enabledLayerCount = enabledLayerNames.size();
+  instanceCreateInfo.ppEnabledLayerNames = enabledLayerNames.data();
+#endif
+
+  VkInstance instance = VK_NULL_HANDLE;
+  VkResult error = vkCreateInstance(&instanceCreateInfo, nullptr, &instance);
+  if (error) {
+    return error;
+  }
+
+  uint32_t count;
+  error = vkEnumeratePhysicalDevices(instance, &count, nullptr);
+  if (error) {
+    return error;
+  }
+  std::vector<VkPhysicalDevice> physicalDevices(count);
+  error = vkEnumeratePhysicalDevices(instance, &count, physicalDevices.data());
+  if (error) {
+    return error;
+  }
+
+  // find the first physical device with a compute queue
+  VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+  uint32_t queueFamilyIndex = 0;
+  uint32_t timestampValidBits = 0;
+  for (auto device : physicalDevices) {
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilyProperties(count);
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count,
+                                             queueFamilyProperties.data());
+    for (uint32_t index = 0; index < count; index++) {
+      if (queueFamilyProperties[index].queueFlags & VK_QUEUE_COMPUTE_BIT) {
+        physicalDevice = device;
+        queueFamilyIndex = index;
+        timestampValidBits = queueFamilyProperties[index].timestampValidBits;
+        break;
+      }
+    }
+    if (physicalDevice) {
+      break;
+    }
+  }
+  if (!physicalDevice) {
+    fprintf(stderr, "no device with a compute queue\n");
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+  }
+
+  VkPhysicalDeviceProperties physicalDeviceProperties;
+  vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties);
+  const VkPhysicalDeviceLimits &limits = physicalDeviceProperties.limits;
+
+  VkDeviceQueueCreateInfo queueCreateInfo = {};
+  queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+  queueCreateInfo.queueCount = 1;
+  queueCreateInfo.queueFamilyIndex = queueFamilyIndex;
+  float queuePriority = 1.0f;
+  queueCreateInfo.pQueuePriorities = &queuePriority;
+
+  VkDeviceCreateInfo deviceCreateInfo = {};
+  deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+  deviceCreateInfo.queueCreateInfoCount = 1;
+  deviceCreateInfo.pQueueCreateInfos = &queueCreateInfo;
+  VkDevice device = VK_NULL_HANDLE;
+  error = vkCreateDevice(physicalDevice, &deviceCreateInfo, nullptr, &device);
+  if (error) {
+    return error;
+  }
+
+  VkQueue queue;
+  vkGetDeviceQueue(device, queueFamilyIndex, 0, &queue);
+
+  // input and output
+  std::vector<VkDescriptorSetLayoutBinding> layoutBindings;
+  VkDescriptorSetLayoutBinding layoutBinding = {};
+  layoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  layoutBinding.descriptorCount = 1;
+  layoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  for (uint32_t binding = 0; binding < 2; binding++) {
+    layoutBinding.binding = binding;
+    layoutBindings.push_back(layoutBinding);
+  }
+
+  VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo = {};
+  setLayoutCreateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  setLayoutCreateInfo.bindingCount = layoutBindings.size();
+  setLayoutCreateInfo.pBindings = layoutBindings.data();
+  VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+  error = vkCreateDescriptorSetLayout(device, &setLayoutCreateInfo, nullptr,
+                                      &setLayout);
+  if (error) {
+    return error;
+  }
+
+  VkPushConstantRange pushConstantRange = {};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  pushConstantRange.offset = 0;
+  // large enough for either shader's parameters
+  pushConstantRange.size =
+      std::max(sizeof(TransposeParams), sizeof(AosSoaParams));
+
+  Relayout relayout;
+  relayout.device = device;
+  relayout.maxGroupCount[0] = limits.maxComputeWorkGroupCount[0];
+  relayout.maxGroupCount[1] = limits.maxComputeWorkGroupCount[1];
+  relayout.maxGroupCount[2] = limits.maxComputeWorkGroupCount[2];
+  // a tile of 256 structures plus one pad word every 32 words must fit in
+  // shared memory
+  relayout.maxFieldCount =
+      limits.maxComputeSharedMemorySize / (sizeof(float) * 264);
+  VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+  pipelineLayoutCreateInfo.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutCreateInfo.setLayoutCount = 1;
+  pipelineLayoutCreateInfo.pSetLayouts = &setLayout;
+  pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+  pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+  error = vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr,
+                                 &relayout.pipelineLayout);
+  if (error) {
+    return error;
+  }
+
+
+  error = createComputePipeline(device, relayout.pipelineLayout,
+                                "transpose.spv", nullptr, &relayout.transpose);
+  if (error) {
+    return error;
+  }
+
+  // each buffer holds 16M floats, with room to spare for the alignment of
+  // the field arrays
+  const uint32_t elementCount = 1 << 24;
+  const VkDeviceSize bufferSize = sizeof(float) * (elementCount + 1024);
+  enum { A, B, C, BUFFER_COUNT };
+  VkBuffer buffers[BUFFER_COUNT];
+  for (uint32_t index = 0; index < BUFFER_COUNT; index++) {
+    VkBufferCreateInfo bufferCreateInfo = {};
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.size = bufferSize;
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    bufferCreateInfo.queueFamilyIndexCount = 1;
+    bufferCreateInfo.pQueueFamilyIndices = &queueFamilyIndex;
+    error = vkCreateBuffer(device, &bufferCreateInfo, nullptr, &buffers[index]);
+    if (error) {
+      return error;
+    }
+  }
+  VkDeviceSize bufferOffsets[BUFFER_COUNT];
+  VkDeviceSize requiredMemorySize = 0;
+  VkMemoryRequirements memoryRequirements;
+  for (uint32_t index = 0; index < BUFFER_COUNT; index++) {
+    vkGetBufferMemoryRequirements(device, buffers[index], &memoryRequirements);
+    const VkDeviceSize alignment = memoryRequirements.alignment;
+    requiredMemorySize =
+        (requiredMemorySize + alignment - 1) / alignment * alignment;
+    bufferOffsets[index] = requiredMemorySize;
+    requiredMemorySize += memoryRequirements.size;
+  }
+
+  VkPhysicalDeviceMemoryProperties memoryProperties;
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+  auto memoryTypeIndex = findMemoryTypeFromProperties(
+      memoryRequirements.memoryTypeBits, memoryProperties,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  if (0 > memoryTypeIndex) {
+    return ~42;  // returns -43
+  }
+
+  VkMemoryAllocateInfo allocateInfo = {};
+  allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocateInfo.allocationSize = requiredMemorySize;
+  allocateInfo.memoryTypeIndex = memoryTypeIndex;
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  error = vkAllocateMemory(device, &allocateInfo, nullptr, &memory);
+  if (error) {
+    return error;
+  }
+  for (uint32_t index = 0; index < BUFFER_COUNT; index++) {
+    error = vkBindBufferMemory(device, buffers[index], memory,
+                               bufferOffsets[index]);
+    if (error) {
+      return error;
+    }
+  }
+
+  // a conversion and the conversion back
+  enum { A_TO_B, B_TO_C, SET_COUNT };
+  const uint32_t setBuffers[SET_COUNT][2] = {{A, B}, {B, C}};
+
+  VkDescriptorPoolSize poolSize = {};
+  poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  poolSize.descriptorCount = 2 * SET_COUNT;
+  VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = {};
+  descriptorPoolCreateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  descriptorPoolCreateInfo.maxSets = SET_COUNT;
+  descriptorPoolCreateInfo.poolSizeCount = 1;
+  descriptorPoolCreateInfo.pPoolSizes = &poolSize;
+  VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+  error = vkCreateDescriptorPool(device, &descriptorPoolCreateInfo, nullptr,
+                                 &descriptorPool);
+  if (error) {
+    return error;
+  }
+
+  std::vector<VkDescriptorSetLayout> setLayouts(SET_COUNT, setLayout);
+  VkDescriptorSetAllocateInfo descriptorSetAllocateInfo = {};
+  descriptorSetAllocateInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  descriptorSetAllocateInfo.descriptorPool = descriptorPool;
+  descriptorSetAllocateInfo.descriptorSetCount = SET_COUNT;
+  descriptorSetAllocateInfo.pSetLayouts = setLayouts.data();
+  VkDescriptorSet descriptorSets[SET_COUNT];
+  error = vkAllocateDescriptorSets(device, &descriptorSetAllocateInfo,
+                                   descriptorSets);
+  if (error) {
+    return error;
+  }
+
+  VkDescriptorBufferInfo bufferInfos[SET_COUNT][2];
+  std::vector<VkWriteDescriptorSet> descriptorSetWrites;
+  VkWriteDescriptorSet writeDescriptorSet = {};
+  writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  writeDescriptorSet.dstArrayElement = 0;
+  writeDescriptorSet.descriptorCount = 1;
+  writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  for (uint32_t set = 0; set < SET_COUNT; set++) {
+    for (uint32_t binding = 0; binding < 2; binding++) {
+      bufferInfos[set][binding].buffer = buffers[setBuffers[set][binding]];
+      bufferInfos[set][binding].offset = 0;
+      bufferInfos[set][binding].range = VK_WHOLE_SIZE;
+      writeDescriptorSet.dstSet = descriptorSets[set];
+      writeDescriptorSet.dstBinding = binding;
+      writeDescriptorSet.pBufferInfo = &bufferInfos[set][binding];
+      descriptorSetWrites.push_back(writeDescriptorSet);
+    }
+  }
+  vkUpdateDescriptorSets(device, descriptorSetWrites.size(),
+                         descriptorSetWrites.data(), 0, nullptr);
+
+  char *data = nullptr;
+  error = vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0,
+                      reinterpret_cast<void **>(&data));
+  if (error) {
+    return error;
+  }
+  float *aData = reinterpret_cast<float *>(data + bufferOffsets[A]);
+  float *bData = reinterpret_cast<float *>(data + bufferOffsets[B]);
+  float *cData = reinterpret_cast<float *>(data + bufferOffsets[C]);
+  for (uint32_t index = 0; index < elementCount; index++) {
+    aData[index] = (float)index;
+  }
+
+  VkQueryPool queryPool = VK_NULL_HANDLE;
+  if (timestampValidBits) {
+    VkQueryPoolCreateInfo queryPoolCreateInfo = {};
+    queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolCreateInfo.queryCount = 2;
+    error = vkCreateQueryPool(device, &queryPoolCreateInfo, nullptr,
+                              &queryPool);
+    if (error) {
+      return error;
+    }
+  }
+
+  VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+  commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+  commandPoolCreateInfo.queueFamilyIndex = queueFamilyIndex;
+  VkCommandPool commandPool = VK_NULL_HANDLE;
+  error = vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr,
+                              &commandPool);
+  if (error) {
+    return error;
+  }
+
+  VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
+  commandBufferAllocateInfo.sType =
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  commandBufferAllocateInfo.commandPool = commandPool;
+  commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  commandBufferAllocateInfo.commandBufferCount = 1;
+  VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+  error = vkAllocateCommandBuffers(device, &commandBufferAllocateInfo,
+                                   &commandBuffer);
+  if (error) {
+    return error;
+  }
+
+  // record the work of function into the command buffer, submit it, wait for
+  // it to complete and return the time between the timestamps in
+  // milliseconds, or 0 if timestamps are not supported
+  auto submit = [&](std::function<VkResult()> function,
+                    double *milliseconds) -> VkResult {
+    VkResult result = vkResetCommandPool(device, commandPool, 0);
+    if (result) {
+      return result;
+    }
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    result = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    if (result) {
+      return result;
+    }
+    if (queryPool) {
+      vkCmdResetQueryPool(commandBuffer, queryPool, 0, 2);
+      vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                          queryPool, 0);
+    }
+    result = function();
+    if (result) {
+      return result;
+    }
+    if (queryPool) {
+      vkCmdWriteTimestamp(commandBuffer,
+                          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, queryPool, 1);
+    }
+    result = vkEndCommandBuffer(commandBuffer);
+    if (result) {
+      return result;
+    }
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    result = vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+    if (result) {
+      return result;
+    }
+    vkQueueWaitIdle(queue);
+
+    *milliseconds = 0.0;
+    if (queryPool) {
+      uint64_t timestamps[2];
+      result = vkGetQueryPoolResults(
+          device, queryPool, 0, 2, sizeof(timestamps), timestamps,
+          sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+      if (result) {
+        return result;
+      }
+      *milliseconds =
+          (timestamps[1] - timestamps[0]) * limits.timestampPeriod * 1e-6;
+    }
+    return VK_SUCCESS;
+  };
+
+
+  // square and ragged transposes, then conversions of structures with an
+  // odd, a power of two and a prime number of fields, every conversion is
+  // converted back and must reproduce its input exactly
+  struct Test {
+    std::string name;
+    uint32_t elements;
+    std::function<VkResult(VkDescriptorSet, bool)> record;
+    std::function<void(const float *, float *)> host;
+  };
+  std::vector<Test> tests;
+  const uint32_t shapes[2][3] = {{4096, 4096, 1}, {1000, 3000, 5}};
+  for (auto &shape : shapes) {
+    const uint32_t rows = shape[0];
+    const uint32_t columns = shape[1];
+    const uint32_t batchCount = shape[2];
+    Test test;
+    test.name = "transpose " + std::to_string(rows) + "x" +
+                std::to_string(columns) + "x" + std::to_string(batchCount);
+    test.elements = rows * columns * batchCount;
+    test.record = [=, &relayout](VkDescriptorSet descriptorSet, bool back) {
+      recordTranspose(commandBuffer, relayout, descriptorSet,
+                      back ? columns : rows, back ? rows : columns,
+                      batchCount);
+      return VK_SUCCESS;
+    };
+    test.host = [=](const float *input, float *output) {
+      for (uint32_t batch = 0; batch < batchCount; batch++) {
+        const uint32_t base = batch * rows * columns;
+        for (uint32_t y = 0; y < rows; y++) {
+          for (uint32_t x = 0; x < columns; x++) {
+            output[base + x * rows + y] = input[base + y * columns + x];
+          }
+        }
+      }
+    };
+    tests.push_back(test);
+  }
+  for (uint32_t fieldCount : {3u, 4u, 7u}) {
+    const uint32_t count = elementCount / fieldCount;
+    const uint32_t fieldStride = fieldStrideFor(count);
+    Test test;
+    test.name = "aos to soa " + std::to_string(fieldCount) + " fields";
+    test.elements = count * fieldCount;
+    test.record = [=, &relayout](VkDescriptorSet descriptorSet, bool back) {
+      return recordAosSoa(commandBuffer, relayout, descriptorSet, !back,
+                          count, fieldCount, fieldStride);
+    };
+    test.host = [=](const float *input, float *output) {
+      for (uint32_t index = 0; index < count; index++) {
+        for (uint32_t field = 0; field < fieldCount; field++) {
+          output[field * fieldStride + index] =
+              input[index * fieldCount + field];
+        }
+      }
+    };
+    tests.push_back(test);
+  }
+
+  // the device reads and writes every element once, the host conversion is
+  // timed for comparison
+  const uint32_t repetitions = 10;
+  printf("%-24s %10s %10s %10s\n", "conversion", "device ms", "GB/s",
+         "host ms");
+  int failures = 0;
+  std::vector<float> expected(elementCount + 1024);
+  for (const Test &test : tests) {
+    double milliseconds;
+    error = submit(
+        [&] {
+          for (uint32_t repetition = 0; repetition < repetitions;
+               repetition++) {
+            if (repetition) {
+              recordComputeBarrier(commandBuffer);
+            }
+            VkResult error = test.record(descriptorSets[A_TO_B], false);
+            if (error) {
+              return error;
+            }
+          }
+          return VK_SUCCESS;
+        },
+        &milliseconds);
+    if (error) {
+      return error;
+    }
+    milliseconds /= repetitions;
+    // the padding between field arrays is not written, start from the
+    // device's output so only the converted elements are compared
+    memcpy(expected.data(), bData, sizeof(float) * expected.size());
+    auto start = std::chrono::steady_clock::now();
+    test.host(aData, expected.data());
+    const double hostMilliseconds = millisecondsSince(start);
+    const double bytes = 2.0 * sizeof(float) * test.elements;
+    printf("%-24s %10.3f %10.1f %10.3f\n", test.name.c_str(), milliseconds,
+           milliseconds > 0.0 ? bytes / milliseconds * 1e-6 : 0.0,
+           hostMilliseconds);
+    for (uint32_t index = 0; index < expected.size(); index++) {
+      if (bData[index] != expected[index]) {
+        fprintf(stderr, "%s [%u] is '%f' not '%f'!\n", test.name.c_str(),
+                index, bData[index], expected[index]);
+        failures++;
+        break;
+      }
+    }
+
+    error = submit([&] { return test.record(descriptorSets[B_TO_C], true); },
+                   &milliseconds);
+    if (error) {
+      return error;
+    }
+    if (memcmp(aData, cData, sizeof(float) * test.elements)) {
+      fprintf(stderr, "%s did not convert back!\n", test.name.c_str());
+      failures++;
+    }
+  }
+  vkUnmapMemory(device, memory);
+
+  if (queryPool) {
+    vkDestroyQueryPool(device, queryPool, nullptr);
+  }
+  vkDestroyCommandPool(device, commandPool, nullptr);
+  vkFreeMemory(device, memory, nullptr);
+  for (auto buffer : buffers) {
+    vkDestroyBuffer(device, buffer, nullptr);
+  }
+  vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+  for (auto &pipeline : relayout.conversions) {
+    vkDestroyPipeline(device, pipeline.second, nullptr);
+  }
+  vkDestroyPipeline(device, relayout.transpose, nullptr);
+  vkDestroyPipelineLayout(device, relayout.pipelineLayout, nullptr);
+  vkDestroyDescriptorSetLayout(device, setLayout, nullptr);
+  vkDestroyDevice(device, nullptr);
+  vkDestroyInstance(instance, nullptr);
+
+  if (failures) {
+    return 1;
+  }
+  printf("success\n");
+
+  return 0;
+}